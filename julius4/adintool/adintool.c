@@ -47,15 +47,17 @@
 
 #include <julius/juliuslib.h>
 #include <signal.h>
+#include <time.h>
 
 #define MAXCONNECTION 10	///< Maximum number of server connection
+#define SHM_BUFSEC 10		///< Length of shared memory ring buffer in seconds
 
 /* input */
 static int file_counter = 0;	///< num of input files (for SP_RAWFILE)
 static int sfreq;		///< Temporal storage of sample rate
 
 /* output */
-enum{SPOUT_FILE, SPOUT_STDOUT, SPOUT_ADINNET, SPOUT_VECTORNET}; ///< value for speech_output
+enum{SPOUT_FILE, SPOUT_STDOUT, SPOUT_ADINNET, SPOUT_VECTORNET, SPOUT_SHM}; ///< value for speech_output
 static int speech_output = SPOUT_FILE; ///< output device
 static int total_speechlen;	///< total samples of recorded segments
 static int speechlen;		///< samples of one recorded segments
@@ -67,6 +69,9 @@ static boolean use_raw = FALSE;	///< Output in RAW format if TRUE
 static boolean continuous_segment = TRUE; ///< enable/disable successive output
 static short vecnet_paramtype = F_ERR_INVALID; ///< output parameter type
 static int vecnet_veclen = 0;	///< output vector dimension
+static int vecnet_framenum = 1;	///< number of frames to send in a message
+static VECT *vecnet_buf = NULL;	///< frames to be sent in the next message
+static int vecnet_bufnum = 0;	///< number of frames in vecnet_buf
 static int startid = 0;		///< output file numbering variable
 static int sid = 0;		///< current file ID (for SPOUT_FILE)
 static char *outpath = NULL;	///< work space for output file name formatting
@@ -76,6 +81,14 @@ static char *adinnet_serv[MAXCONNECTION]; ///< Server name to send recorded data
 static int sd[MAXCONNECTION];	///< Output socket descriptors
 static int adinnet_servnum = 0; ///< Number of server to connect
 static int adinnet_portnum = 0; ///< Number of server to connect
+static int codec = ADINNET_CODEC_PCM; ///< Audio codec to request to servers
+static int codec_used[MAXCONNECTION]; ///< Audio codec accepted by each server
+static unsigned char *codec_buf = NULL;	///< Work area for encoded data
+static unsigned long codec_samples = 0;	///< Total encoded samples
+static unsigned long codec_bytes = 0; ///< Total encoded bytes
+static clock_t codec_clock = 0;	///< Total CPU time for encoding
+static SHMRING *shmring = NULL;	///< Shared memory ring buffer for output
+static int shm_timeout = SHMRING_TIMEOUT_MSEC; ///< Time to wait for the reader of shared memory in msec
 static boolean writing_file = FALSE; ///< TRUE if writing to a file
 static boolean stop_at_next = FALSE; ///< TRUE if need to stop at next input by server command.  Will be set when PAUSE or TERMINATE command received while input.
 
@@ -109,6 +122,7 @@ opt_help(Jconf *jconf, char *arg[], int argnum)
   fprintf(stderr, "    file        speech file (\"foo.0000.wav\" - \"foo.N.wav\"\n");
   fprintf(stderr, "    adinnet     to adinnet server (I'm client)\n");
   fprintf(stderr, "    vecnet      to vecnet server as feature vector (I'm client)\n");
+  fprintf(stderr, "    shm         to shared memory for \"-input shm\" on the same host\n");
   fprintf(stderr, "    stdout      standard tty output\n");
   
   fprintf(stderr, "I/O options:\n");
@@ -117,13 +131,17 @@ opt_help(Jconf *jconf, char *arg[], int argnum)
 #endif
   fprintf(stderr, "    -server host[,host,...] (adinnet-out) server hostnames\n");
   fprintf(stderr, "    -port num[,num,...]     (adinnet-out) port numbers (%d)\n", ADINNET_PORT);
+  fprintf(stderr, "    -codec name     (adinnet-out) audio codec: pcm, ulaw, alaw, lpc (pcm)\n");
   fprintf(stderr, "    -inport num     (adinnet-in) port number (%d)\n", ADINNET_PORT);
+  fprintf(stderr, "    -shmname name   (shm-out) shared memory name (%s)\n", SHMRING_NAME);
+  fprintf(stderr, "    -shmtimeout msec (shm-out) give up if not read for this time, -1 to wait forever (%d)\n", SHMRING_TIMEOUT_MSEC);
   fprintf(stderr, "    -filename foo   (file-out) filename to record\n");
   fprintf(stderr, "    -startid id     (file-out) recording start id (%04d)\n", startid);
 
   fprintf(stderr, "Feature extraction options (other than in jconf):\n");
   fprintf(stderr, "    -paramtype desc     parameter type in HTK format\n");
   fprintf(stderr, "    -veclen num         total vector length\n");
+  fprintf(stderr, "    -vecframes num      (vecnet-out) frames to send in a message (1)\n");
   
   fprintf(stderr, "Recording and Pause segmentation options:\n");
 
@@ -203,7 +221,11 @@ opt_out(Jconf *jconf, char *arg[], int argnum)
     speech_output = SPOUT_FILE;
     break;
   case 's':
-    speech_output = SPOUT_STDOUT;
+    if (strmatch(arg[0], "shm")) {
+      speech_output = SPOUT_SHM;
+    } else {
+      speech_output = SPOUT_STDOUT;
+    }
     break;
   case 'a':
     speech_output = SPOUT_ADINNET;
@@ -281,6 +303,21 @@ opt_port(Jconf *jconf, char *arg[], int argnum)
   return TRUE;
 }
 
+static boolean
+opt_codec(Jconf *jconf, char *arg[], int argnum)
+{
+  if ((codec = adinnet_codec_lookup(arg[0])) < 0) {
+    fprintf(stderr, "Error: unknown codec: %s\n", arg[0]);
+    return FALSE;
+  }
+  return TRUE;
+}
+static boolean
+opt_shmtimeout(Jconf *jconf, char *arg[], int argnum)
+{
+  shm_timeout = atoi(arg[0]);
+  return TRUE;
+}
 static boolean
 opt_filename(Jconf *jconf, char *arg[], int argnum)
 {
@@ -306,6 +343,17 @@ opt_veclen(Jconf *jconf, char *arg[], int argnum)
   return TRUE;
 }
 static boolean
+opt_vecframes(Jconf *jconf, char *arg[], int argnum)
+{
+  vecnet_framenum = atoi(arg[0]);
+  if (vecnet_framenum < 1 || vecnet_framenum > VECINNET_MAXFRAMES) {
+    fprintf(stderr, "Error: -vecframes should be 1 to %d\n", VECINNET_MAXFRAMES);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+static boolean
 opt_startid(Jconf *jconf, char *arg[], int argnum)
 {
   startid = atoi(arg[0]);
@@ -502,6 +550,7 @@ put_status(Recog *recog)
       fprintf(stderr, " (%s:%d)", adinnet_serv[i], adinnet_port[i]);
     }
     fprintf(stderr, "\n");
+    fprintf(stderr, "\t       Codec: %s\n", adinnet_codec_name(codec));
     break;
   case SPOUT_VECTORNET:
     fprintf(stderr, "\t  OutputType: feature vector sequence\n");
@@ -515,8 +564,14 @@ put_status(Recog *recog)
       char buf[80];
       fprintf(stderr, "\t   ParamType: %s\n", param_code2str(buf, vecnet_paramtype, FALSE));
       fprintf(stderr, "\t   VectorLen: %d\n", vecnet_veclen);
+      fprintf(stderr, "\t  Frames/Msg: %d\n", vecnet_framenum);
     }
     break;
+  case SPOUT_SHM:
+    fprintf(stderr, "\t  OutputType: waveform\n");
+    fprintf(stderr, "\t    OutputTo: shared memory\n");
+    fprintf(stderr, "\t        Name: %s\n", jconf->input.shm_name);
+    break;
   }
 
   fprintf(stderr, "----------------------------------------\n");
@@ -681,6 +736,98 @@ adin_callback_file(SP16 *now, int len, Recog *recog)
   return(0);
 }
 
+/** 
+ * <JA>
+ * ǡ沽ơ̤դФ롥
+ * 
+ * @param speech [in] ǡ
+ * @param len [in] Ĺʥץ
+ * </JA>
+ * <EN>
+ * Encode speech data and send it to the servers that accepted the codec.
+ * 
+ * @param speech [in] speech data
+ * @param len [in] length of above in samples
+ * </EN>
+ */
+static void
+adin_send_encoded(SP16 *speech, int len)
+{
+  int i, n, num, bytes;
+  clock_t c;
+
+  for (n = 0; n < len; n += num) {
+    num = len - n;
+    if (num > ADINNET_CODEC_BLOCK) num = ADINNET_CODEC_BLOCK;
+    c = clock();
+    bytes = adinnet_encode(codec, &(speech[n]), num, codec_buf);
+    codec_clock += clock() - c;
+    codec_bytes += bytes;
+    for (i=0;i<adinnet_servnum;i++) {
+      if (codec_used[i] != codec) continue;
+      if (wt(sd[i], (char *)codec_buf, bytes) < 0) {
+	perror("adintool: cannot write");
+	fprintf(stderr, "failed to send data to %s:%d\n", adinnet_serv[i], adinnet_port[i]);
+      }
+    }
+  }
+  codec_samples += len;
+}
+
+/** 
+ * <JA>
+ * ̤פϤ롥
+ * </JA>
+ * <EN>
+ * Output statistics of audio compression.
+ * </EN>
+ */
+static void
+put_codec_stat()
+{
+  if (speech_output != SPOUT_ADINNET || codec_samples == 0) return;
+  fprintf(stderr, "codec %s: %lu samples in %lu bytes (%.1f%%), encode %.1f msec\n", adinnet_codec_name(codec), codec_samples, codec_bytes, (float)codec_bytes * 100.0 / (codec_samples * sizeof(SP16)), (float)codec_clock * 1000.0 / CLOCKS_PER_SEC);
+}
+
+/** 
+ * <JA>
+ * ɤ߹ץͭΥ󥰥Хåե˽񤭹ॳХåؿ
+ * 
+ * @param now [in] Ͽ줿ץ
+ * @param len [in] Ĺʥץ
+ * 
+ * @return 顼 -1 0 ֤
+ * </JA>
+ * <EN>
+ * Callback handler to write the sample fragments to the shared memory
+ * ring buffer.
+ * 
+ * @param now [in] recorded fragments of speech sample
+ * @param len [in] length of above in samples
+ * 
+ * @return -1 on error, 0 on success.
+ * </EN>
+ */
+static int
+adin_callback_shm(SP16 *now, int len, Recog *recog)
+{
+  if (recog->jconf->input.speech_input == SP_MIC && speechlen == 0) {
+    /* erase "<<<please speak>>>" text on tty */
+    fprintf(stderr, "\r                    \r");
+  }
+
+  if (shmring_write(shmring, now, len) < len) {
+    fprintf(stderr, "adintool: failed to write to shared memory\n");
+    return -1;
+  }
+  /* accumulate sample num of this segment */
+  speechlen += len;
+
+  /* display progress in dots */
+  fprintf(stderr, ".");
+  return(0);
+}
+
 /**
  * <JA>
  * ɤ߹ץ򥽥åȥǥץ "fd" adinnetФ
@@ -740,10 +887,14 @@ adin_callback_adinnet(SP16 *now, int len, Recog *recog)
     }
   }
 
+  if (codec != ADINNET_CODEC_PCM) {
+    adin_send_encoded(&(now[start]), len);
+  }
 #ifdef WORDS_BIGENDIAN
   swap_sample_bytes(&(now[start]), len);
 #endif
   for (i=0;i<adinnet_servnum;i++) {
+    if (codec_used[i] != ADINNET_CODEC_PCM) continue;
     count = wt(sd[i], (char *)&(now[start]), len * sizeof(SP16));
     if (count < 0) {
       perror("adintool: cannot write");
@@ -755,15 +906,6 @@ adin_callback_adinnet(SP16 *now, int len, Recog *recog)
 #endif
   /* accumulate sample num of this segment */
   speechlen += len;
-#ifdef HAVE_PTHREAD
-  if (recog->adin->enable_thread) {
-    /* if input length reaches limit, rehash the ad-in buffer */
-    if (recog->adin->speechlen > MAXSPEECHLEN - 16000) {
-      recog->adin->rehash = TRUE;
-      fprintf(stderr, "+");
-    }
-  }
-#endif
   
   /* display progress in dots */
   fprintf(stderr, ".");
@@ -834,6 +976,50 @@ typedef struct {
   char outprob_p;             ///< (1 byte) != 0 if input is outprob vector
 } ConfigurationHeader;
 
+/** 
+ * <JA>
+ * ԤΥե졼1ĤΥåǤޤȤ롥
+ * </JA>
+ * <EN>
+ * Send frames waiting in the buffer as a message.
+ * </EN>
+ */
+static void
+vecnet_flush()
+{
+  int j;
+
+  if (vecnet_bufnum == 0) return;
+  for (j=0;j<adinnet_servnum;j++) {
+    vecnet_send_data(sd[j], vecnet_buf, sizeof(VECT) * vecnet_veclen * vecnet_bufnum);
+  }
+  vecnet_bufnum = 0;
+}
+
+/** 
+ * <JA>
+ * 1ե졼Хåեɲä-vecframes ʬޤä롥
+ * 
+ * @param vec [in] ħ̥٥ȥ
+ * </JA>
+ * <EN>
+ * Add a frame to the buffer, and send them when -vecframes frames are
+ * stored.
+ * 
+ * @param vec [in] feature vector
+ * </EN>
+ */
+static void
+vecnet_send_frame(VECT *vec)
+{
+  if (vecnet_buf == NULL) {
+    vecnet_buf = (VECT *)mymalloc(sizeof(VECT) * vecnet_veclen * vecnet_framenum);
+  }
+  memcpy(&(vecnet_buf[vecnet_bufnum * vecnet_veclen]), vec, sizeof(VECT) * vecnet_veclen);
+  vecnet_bufnum++;
+  if (vecnet_bufnum >= vecnet_framenum) vecnet_flush();
+}
+
 void
 vecnet_send_header(Recog *recog)
 {
@@ -899,9 +1085,7 @@ vecnet_sub(SP16 *Speech, int nowlen, Recog *recog)
 	}
 #endif
 	/* send 1 frame */
-	for (j=0;j<adinnet_servnum;j++) {
-	  vecnet_send_data(sd[j], mfcc->tmpmfcc, sizeof(VECT) * vecnet_veclen);
-	}
+	vecnet_send_frame(mfcc->tmpmfcc);
 	mfcc->f++;
       }
     }
@@ -975,15 +1159,6 @@ adin_callback_vecnet(SP16 *now, int len, Recog *recog)
 
   /* accumulate sample num of this segment */
   speechlen += len;
-#ifdef HAVE_PTHREAD
-  if (recog->adin->enable_thread) {
-    /* if input length reaches limit, rehash the ad-in buffer */
-    if (recog->adin->speechlen > MAXSPEECHLEN - 16000) {
-      recog->adin->rehash = TRUE;
-      fprintf(stderr, "+");
-    }
-  }
-#endif
   
   /* display progress in dots */
   fprintf(stderr, ".");
@@ -995,6 +1170,9 @@ vecnet_send_end_of_segment()
 {
   int i, j;
   
+  /* send frames left in the buffer */
+  vecnet_flush();
+
   /* send header value of '0' as an end-of-utterance marker */
   i = 0;
   for (j=0;j<adinnet_servnum;j++) {
@@ -1010,6 +1188,9 @@ vecnet_send_end_of_session()
 {
   int i, j;
 
+  /* send frames left in the buffer */
+  vecnet_flush();
+
   /* send negative header value as an end-of-session marker */
   i = -1;
   for (j=0;j<adinnet_servnum;j++) {
@@ -1281,6 +1462,12 @@ interrupt_record(int signum)
   if (speech_output == SPOUT_VECTORNET) {
     vecnet_send_end_of_session();
   }
+  if (shmring != NULL) {
+    /* tell end of input to the reader */
+    shmring_finish(shmring);
+    shmring_close(shmring, FALSE);
+  }
+  put_codec_stat();
   /* terminate program */
   exit(1);
 }
@@ -1332,10 +1519,13 @@ main(int argc, char *argv[])
   j_add_option("-server", 1, 1, "hostname (-out adinnet)", opt_server);
   j_add_option("-NA", 1, 1, "NetAudio server host:unit (-in netaudio)", opt_NA);
   j_add_option("-port", 1, 1, "port number (-out adinnet)", opt_port);
+  j_add_option("-codec", 1, 1, "audio codec (-out adinnet)", opt_codec);
   j_add_option("-inport", 1, 1, "port number (-in adinnet)", opt_inport);
+  j_add_option("-shmtimeout", 1, 1, "time to wait for reader in msec (-out shm)", opt_shmtimeout);
   j_add_option("-filename", 1, 1, "(base) filename to record (-out file)", opt_filename);
   j_add_option("-paramtype", 1, 1, "feature parameter type in HTK format", opt_paramtype);
   j_add_option("-veclen", 1, 1, "feature parameter vector length", opt_veclen);
+  j_add_option("-vecframes", 1, 1, "frames to send in a message (-out vecnet)", opt_vecframes);
   j_add_option("-startid", 1, 1, "recording start id (-out file)", opt_startid);
   j_add_option("-freq", 1, 1, "sampling frequency in Hz", opt_freq);
   j_add_option("-nosegment", 0, 0, "not segment input speech, record all", opt_nosegment);
@@ -1462,7 +1652,38 @@ main(int argc, char *argv[])
       sd[i] = make_connection(adinnet_serv[i], adinnet_port[i]);
       if (sd[i] < 0) return 1;	/* on error */
       fprintf(stderr, "connected\n");
+      codec_used[i] = ADINNET_CODEC_PCM;
+      if (speech_output == SPOUT_ADINNET && codec != ADINNET_CODEC_PCM) {
+	/* request audio codec */
+	if ((codec_used[i] = adinnet_codec_request(sd[i], codec)) < 0) {
+	  fprintf(stderr, "failed to request codec to #%d\n", i+1);
+	  return 1;
+	}
+	if (codec_used[i] != codec) {
+	  fprintf(stderr, "#%d does not support codec \"%s\", send in %s\n", i+1, adinnet_codec_name(codec), adinnet_codec_name(codec_used[i]));
+	  codec_used[i] = ADINNET_CODEC_PCM;
+	}
+      }
     }
+    if (speech_output == SPOUT_ADINNET && codec != ADINNET_CODEC_PCM) {
+      for(i=0;i<adinnet_servnum;i++) {
+	if (codec_used[i] == codec) break;
+      }
+      if (i < adinnet_servnum) {
+	codec_buf = (unsigned char *)mymalloc(adinnet_codec_maxbytes(codec, ADINNET_CODEC_BLOCK));
+      } else {
+	/* no server accepted the codec */
+	codec = ADINNET_CODEC_PCM;
+      }
+    }
+  } else if (speech_output == SPOUT_SHM) {
+    /* create shared memory ring buffer of SHM_BUFSEC seconds */
+    SHMRING_CONF conf;
+    memset(&conf, 0, sizeof(SHMRING_CONF));
+    conf.sfreq = sfreq;
+    fprintf(stderr, "creating shared memory \"%s\"...", jconf->input.shm_name);
+    if ((shmring = shmring_create(jconf->input.shm_name, sizeof(SP16), sfreq * SHM_BUFSEC, &conf, shm_timeout)) == NULL) return 1;
+    fprintf(stderr, "done\n");
   } else if (speech_output == SPOUT_STDOUT) {
     /* output to stdout */
     fd = 1;
@@ -1577,6 +1798,8 @@ main(int argc, char *argv[])
 	  exit(1);
 	}
 	ret = adin_go(adin_callback_vecnet, adinnet_check_command, recog);
+      } else if (speech_output == SPOUT_SHM) {
+	ret = adin_go(adin_callback_shm, NULL, recog);
       } else {
 	ret = adin_go(adin_callback_file, NULL, recog);
       }
@@ -1641,6 +1864,21 @@ main(int argc, char *argv[])
 		 trigger_sample, (float)trigger_sample / (float)sfreq, 
 		 trigger_sample + speechlen, (float)(trigger_sample + speechlen) / (float)sfreq);
 	}
+      } else if (speech_output == SPOUT_SHM) {
+	if (speechlen > 0) {
+	  if (ret >= 0) { /* segmented by adin-cut or end of stream */
+	    /* mark end of segment in the ring */
+	    if (shmring_mark_segment(shmring) == FALSE) {
+	      fprintf(stderr, "adintool: failed to write to shared memory\n");
+	      return 1;
+	    }
+	  }
+	  /* output info */
+	  printf("sent: %d samples (%.2f sec.) [%6d (%5.2fs) - %6d (%5.2fs)]\n", 
+		 speechlen, (float)speechlen / (float)sfreq,
+		 trigger_sample, (float)trigger_sample / (float)sfreq, 
+		 trigger_sample + speechlen, (float)(trigger_sample + speechlen) / (float)sfreq);
+	}
       }
 
       /*************************************/
@@ -1701,5 +1939,13 @@ main(int argc, char *argv[])
     vecnet_param_update(recog);
   }
 
+  if (shmring != NULL) {
+    /* tell end of input to the reader, which will remove the segment */
+    shmring_finish(shmring);
+    shmring_close(shmring, FALSE);
+  }
+
+  put_codec_stat();
+
   return 0;
 }
@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #if defined(_WIN32) && !defined(__CYGWIN32__)
 #define WINSOCK
 #endif
@@ -169,6 +170,7 @@ typedef struct {
 } ConfigurationHeader;
 
 #define VECINNET_PORT 5531	///< Port number to send the data
+#define VECINNET_MAXFRAMES 1024	///< Maximum number of frames in a message
 
 /**********************************************************************/
 /**********************************************************************/
@@ -227,10 +229,11 @@ int send_end_of_session(int sd)
 /**********************************************************************/
 /**********************************************************************/
 /**********************************************************************/
-/* usage: exename paramfile host [port] */
+/* usage: exename paramfile host [port [framenum]] */
 int main(int argc, char *argv[])
 {
   int portnum;			///< Port number
+  int framenum;			///< Number of frames to send in a message
   int sd;
   ConfigurationHeader conf;	///< Configuration of vector to be sent
 
@@ -242,7 +245,7 @@ int main(int argc, char *argv[])
 
   /* application argument check */
   if (argc < 3) {
-    fprintf(stderr, "usage: %s paramfile hostname [portnum]\n", argv[0]);
+    fprintf(stderr, "usage: %s paramfile hostname [portnum [framenum]]\n", argv[0]);
     return -1;
   }
 
@@ -286,7 +289,12 @@ int main(int argc, char *argv[])
 
   /* port number: use VECINNET_PORT (= Julius default) if not specified */
   portnum = (argc >= 4) ? atoi(argv[3]) : VECINNET_PORT;
-
+  /* number of frames per message: 1 if not specified */
+  framenum = (argc >= 5) ? atoi(argv[4]) : 1;
+  if (framenum < 1 || framenum > VECINNET_MAXFRAMES) {
+    fprintf(stderr, "Error: framenum should be 1 to %d\n", VECINNET_MAXFRAMES);
+    return -1;
+  }
 
   /* connect to server */
   if ((sd = make_connection(argv[2], portnum)) < 0) {
@@ -298,37 +306,42 @@ int main(int argc, char *argv[])
     return -1;
   }
     
-  /* send data, frame by frame*/
+  /* send data, "framenum" frames in a message */
   {
-    int i;
-    float *buf;
+    int i, n;
+    float *buf, *vec;
 
-    buf = (float *)malloc(sizeof(float) * vecdim);
+    buf = (float *)malloc(sizeof(float) * conf.veclen * framenum);
+    vec = (float *)malloc(sizeof(float) * vecdim);
+    n = 0;
     for (i = 0; i < framelen; i++) {
-      if (fread(buf, sizeof(float), vecdim, fp) != vecdim) {
+      if (fread(vec, sizeof(float), vecdim, fp) != vecdim) {
 	fprintf(stderr, "Error: failed to read vectors in %s\n", argv[1]);
 	close_socket(sd); cleanup_socket(); return -1;
       }
-      swap_bytes((char *)buf, sizeof(float), vecdim);
+      swap_bytes((char *)vec, sizeof(float), vecdim);
 
 #if !defined(OUTPROBVECTOR) && defined(SEND26TO25)
       /* send 26 dim data as 25 dim */
       {
 	int j;
 	for (j = 13; j < vecdim; j++) {
-	  buf[j-1] = buf[j];
+	  vec[j-1] = vec[j];
 	}
-	if (send_data(sd, buf, sizeof(float) * (vecdim - 1)) == -1) {
+      }
+#endif
+      memcpy(&(buf[n * conf.veclen]), vec, sizeof(float) * conf.veclen);
+      n++;
+      if (n == framenum || i == framelen - 1) {
+	if (send_data(sd, buf, sizeof(float) * conf.veclen * n) == -1) {
 	  close_socket(sd); cleanup_socket(); return -1;
 	}
+	n = 0;
       }
-#else
-      if (send_data(sd, buf, sizeof(float) * vecdim) == -1) {
-	close_socket(sd); cleanup_socket(); return -1;
-      }
-#endif
       printf("frame %d\n", i);
     }
+    free(vec);
+    free(buf);
   }
   /* send end-of-utterance at each end of utterance unit */
   if (send_end_of_utterance(sd) == -1) {
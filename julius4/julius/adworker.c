@@ -0,0 +1,364 @@
+/**
+ * @file   adworker.c
+ *
+ * <JA>
+ * @brief  adinnet 饤Ȥǧ
+ *
+ * -input adinnet ΤȤԤåȤȤʣ
+ * ץ fork ʣΥ饤ȤƱǧ롥
+ * ϥǥɤ߹߸ fork 뤿ᡤǥϥץ֤
+ * ͭ (ԡ饤)ƥƱԤåȤ
+ * ³դ1ĤĽǧ롥ɸϤϿƥץ
+ * ѥפ졤ƥץԤȤ˥ֹդƽϤ뤿ᡤ
+ * ʣνϤԤǺ뤳ȤϤʤƥץ
+ * ʥǽλƵưλ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Parallel recognition of adinnet clients
+ *
+ * With -input adinnet, worker processes are forked after the listen
+ * socket is ready, and several clients are recognized at the same time.
+ * The workers are forked after models are loaded, so the models are
+ * shared among them by copy-on-write.  Each worker accepts connections
+ * on the same listen socket and recognizes them one by one.  The stdout
+ * of each worker is sent to the parent by a pipe, and the parent outputs
+ * it line by line with the worker number, so outputs of the workers are
+ * never mixed within a line.  The parent restarts a worker terminated by
+ * a signal, and returns when all workers have exited.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include "app.h"
+
+#if !defined(FORK_ADINNET) && defined(HAVE_WORKER_PROCESS)
+#define HAVE_ADNET_WORKER
+#include <sys/wait.h>
+#include <signal.h>
+#endif
+
+static int adworker_num = 0;	///< Number of worker processes
+
+#ifdef HAVE_ADNET_WORKER
+
+/**
+ * Output of a worker not yet terminated by newline.
+ *
+ */
+typedef struct {
+  char *buf;			///< Received output not yet terminated by newline
+  int len;			///< Length of @a buf
+  int alloced;			///< Allocated size of @a buf
+} ADNET_OUTBUF;
+
+static WORKER_PROC *worker;	///< Worker processes
+static ADNET_OUTBUF *outbuf;	///< Output buffer of each worker
+static volatile sig_atomic_t term_p = 0; ///< TRUE when the parent is told to terminate
+
+/**
+ * <JA>
+ * ƥץνλʥΥϥɥ顥ե饰ΩƤǡ
+ * νλϥᥤ롼פǹԤ
+ *
+ * @param sig [in] ʥֹ
+ * </JA>
+ * <EN>
+ * Handler of termination signals in the parent.  It only sets a flag,
+ * and the workers are terminated in the main loop.
+ *
+ * @param sig [in] signal number
+ * </EN>
+ */
+static void
+adworker_term(int sig)
+{
+  term_p = 1;
+}
+
+/**
+ * <JA>
+ * νɸϤѥפڤؤǧ롼פ롥
+ *
+ * @param id [in] ֹ
+ * @param cmd_fd [in] (̤)
+ * @param res_fd [in] ƤؽϤѥ
+ * @param data [in] 󥸥󥤥󥹥
+ * </JA>
+ * <EN>
+ * Body of a worker.  It switches stdout to a pipe and enters the
+ * recognition loop.
+ *
+ * @param id [in] worker number
+ * @param cmd_fd [in] (not used)
+ * @param res_fd [in] pipe to send output to the parent
+ * @param data [in] engine instance
+ * </EN>
+ */
+static void
+adworker_main(int id, int cmd_fd, int res_fd, void *data)
+{
+  dup2(res_fd, 1);
+  close(res_fd);
+  main_recognition_stream_loop((Recog *)data);
+}
+
+/**
+ * <JA>
+ * ץ1ĵư롥
+ *
+ * @param recog [in] 󥸥󥤥󥹥
+ * @param id [in] ֹ
+ *
+ * @return  TRUE, Ի FALSE
+ * </JA>
+ * <EN>
+ * Start a worker process.
+ *
+ * @param recog [in] engine instance
+ * @param id [in] worker number
+ *
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ */
+static boolean
+adworker_start(Recog *recog, int id)
+{
+  if (worker_start(worker, adworker_num, id, FALSE, adworker_main, recog) == FALSE) return FALSE;
+  outbuf[id].len = 0;
+  fprintf(stderr, "adworker: worker %d started as process [%d]\n", id, worker[id].pid);
+  return TRUE;
+}
+
+/**
+ * <JA>
+ * äϤΤԤǽäԤֹ
+ * դɸϤ˽Ϥ롥
+ *
+ * @param id [in] ֹ
+ * @param flush_p [in] TRUE ʤԤǽäƤʤĤϤ
+ * </JA>
+ * <EN>
+ * Output lines received from a worker and terminated by newline to
+ * stdout, prefixed by the worker number.
+ *
+ * @param id [in] worker number
+ * @param flush_p [in] TRUE to output also the rest not terminated by newline
+ * </EN>
+ */
+static void
+adworker_output(int id, boolean flush_p)
+{
+  ADNET_OUTBUF *o;
+  char *p, *q;
+
+  o = &(outbuf[id]);
+  p = o->buf;
+  while (p < o->buf + o->len) {
+    q = memchr(p, '\n', o->buf + o->len - p);
+    if (q == NULL) {
+      if (! flush_p) break;
+      q = o->buf + o->len;
+    }
+    printf("[worker %d] ", id);
+    fwrite(p, 1, q - p, stdout);
+    printf("\n");
+    p = q + 1;
+  }
+  if (p > o->buf + o->len) p = o->buf + o->len;
+  fflush(stdout);
+  o->len -= p - o->buf;
+  if (o->len > 0) memmove(o->buf, p, o->len);
+}
+
+#endif /* HAVE_ADNET_WORKER */
+
+/**
+ * <JA>
+ * adinnet ǧԤɤ֤
+ *
+ * @return ǧԤ TRUE
+ * </JA>
+ * <EN>
+ * Return whether parallel recognition of adinnet clients is enabled.
+ *
+ * @return TRUE if enabled.
+ * </EN>
+ */
+boolean
+is_adworker_mode()
+{
+  return(adworker_num > 1);
+}
+
+/**
+ * <JA>
+ * adinnet ǧǽ꤫ɤĴ٤롥
+ *
+ * @param jconf [in] ѥ᡼
+ *
+ * @return ǽǤ TRUE, Ǥʤ FALSE
+ * </JA>
+ * <EN>
+ * Check if the configuration allows parallel recognition of adinnet
+ * clients.
+ *
+ * @param jconf [in] global configuration
+ *
+ * @return TRUE if allowed, FALSE if not.
+ * </EN>
+ */
+boolean
+adworker_check(Jconf *jconf)
+{
+#ifdef HAVE_ADNET_WORKER
+  if (jconf->input.speech_input != SP_ADINNET) {
+    fprintf(stderr, "Error: -adworker works only with -input adinnet\n");
+    return FALSE;
+  }
+  if (is_module_mode()) {
+    fprintf(stderr, "Error: -adworker cannot be used with -module\n");
+    return FALSE;
+  }
+  return TRUE;
+#else
+  fprintf(stderr, "Error: -adworker is not supported on this platform or build\n");
+  return FALSE;
+#endif
+}
+
+/**
+ * <JA>
+ * adinnet ǧΥᥤ롼סץưνϤ
+ * Ѥ롥ʥǽλϺƵư롥ƥץ
+ * SIGINT ޤ SIGTERM λ롥
+ *
+ * @param recog [in] 󥸥󥤥󥹥
+ *
+ * @return λ TRUE, ưǤʤä FALSE
+ * </JA>
+ * <EN>
+ * Main loop of parallel recognition of adinnet clients.  It starts the
+ * worker processes, and relays their output.  A worker terminated by a
+ * signal is restarted.  When the parent receives SIGINT or SIGTERM, all
+ * workers are terminated.
+ *
+ * @param recog [in] engine instance
+ *
+ * @return TRUE when all workers have exited, FALSE if failed to start
+ * the workers.
+ * </EN>
+ */
+boolean
+adworker_loop(Recog *recog)
+{
+#ifdef HAVE_ADNET_WORKER
+  ADNET_OUTBUF *o;
+  int alive, i, ret, status;
+  pid_t pid;
+  fd_set rfds;
+  boolean killed_p;
+
+  worker = (WORKER_PROC *)mymalloc(sizeof(WORKER_PROC) * adworker_num);
+  worker_init(worker, adworker_num);
+  outbuf = (ADNET_OUTBUF *)mymalloc(sizeof(ADNET_OUTBUF) * adworker_num);
+  for(i=0;i<adworker_num;i++) {
+    outbuf[i].alloced = 4096;
+    outbuf[i].buf = (char *)mymalloc(outbuf[i].alloced);
+    outbuf[i].len = 0;
+  }
+
+  /* start workers */
+  alive = 0;
+  for(i=0;i<adworker_num;i++) {
+    if (adworker_start(recog, i) == FALSE) break;
+    alive++;
+  }
+  if (alive < adworker_num) {
+    /* do not leave workers already started */
+    fprintf(stderr, "Error: adworker: failed to start %d workers\n", adworker_num);
+    worker_wait_all(worker, adworker_num, TRUE);
+    for(i=0;i<adworker_num;i++) free(outbuf[i].buf);
+    free(outbuf);
+    free(worker);
+    return FALSE;
+  }
+
+  signal(SIGINT, adworker_term);
+  signal(SIGTERM, adworker_term);
+  killed_p = FALSE;
+
+  while (alive > 0) {
+    if (term_p && ! killed_p) {
+      fprintf(stderr, "adworker: terminating workers\n");
+      for(i=0;i<adworker_num;i++) {
+	if (worker[i].pid > 0) kill(worker[i].pid, SIGTERM);
+      }
+      killed_p = TRUE;
+    }
+    if ((ret = worker_select(worker, adworker_num, &rfds)) < 0) break;
+    if (ret == 0) continue;
+    for(i=0;i<adworker_num;i++) {
+      if (worker[i].res_fd < 0 || !FD_ISSET(worker[i].res_fd, &rfds)) continue;
+      o = &(outbuf[i]);
+      if (o->len >= o->alloced) {
+	o->alloced *= 2;
+	o->buf = (char *)myrealloc(o->buf, o->alloced);
+      }
+      ret = read(worker[i].res_fd, o->buf + o->len, o->alloced - o->len);
+      if (ret < 0 && errno == EINTR) continue;
+      if (ret > 0) {
+	o->len += ret;
+	adworker_output(i, FALSE);
+	continue;
+      }
+      /* worker has gone */
+      adworker_output(i, TRUE);
+      pid = worker[i].pid;
+      status = worker_wait(&(worker[i]), FALSE);
+      alive--;
+      if (WIFSIGNALED(status)) {
+	fprintf(stderr, "adworker: worker %d [%d] killed by signal %d\n", i, pid, WTERMSIG(status));
+	if (! term_p) {
+	  /* restart */
+	  if (adworker_start(recog, i) == TRUE) alive++;
+	}
+      } else {
+	fprintf(stderr, "adworker: worker %d [%d] exited with status %d\n", i, pid, WEXITSTATUS(status));
+      }
+    }
+  }
+  /* reap the rest on error */
+  worker_wait_all(worker, adworker_num, TRUE);
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  for(i=0;i<adworker_num;i++) free(outbuf[i].buf);
+  free(outbuf);
+  free(worker);
+  return TRUE;
+#else
+  return FALSE;
+#endif /* HAVE_ADNET_WORKER */
+}
+
+/************************************************************************/
+static boolean
+opt_adworker(Jconf *jconf, char *arg[], int argnum)
+{
+  adworker_num = atoi(arg[0]);
+  return TRUE;
+}
+void
+adworker_add_option()
+{
+  j_add_option("-adworker", 1, 1, "recognize adinnet clients by num processes", opt_adworker);
+}
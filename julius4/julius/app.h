@@ -43,3 +43,34 @@ void outfile_set_fname(char *input_filename);
 void record_add_option();
 void record_setup(Recog *recog, void *data);
 
+/* worker.c */
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+#define HAVE_WORKER_PROCESS	///< Worker processes by fork() are available
+/**
+ * Worker process seen from the parent.
+ *
+ */
+typedef struct {
+  pid_t pid;			///< Process ID, -1 if not running
+  int cmd_fd;			///< Pipe to send commands to the worker, -1 if none
+  int res_fd;			///< Pipe to receive output from the worker, -1 if closed
+} WORKER_PROC;
+void worker_init(WORKER_PROC *w, int num);
+boolean worker_start(WORKER_PROC *w, int num, int id, boolean cmd_p, void (*func)(int id, int cmd_fd, int res_fd, void *data), void *data);
+int worker_select(WORKER_PROC *w, int num, fd_set *rfds);
+int worker_wait(WORKER_PROC *w, boolean kill_p);
+void worker_wait_all(WORKER_PROC *w, int num, boolean kill_p);
+#endif
+
+/* batch.c */
+boolean is_batch_mode();
+boolean batch_check(Jconf *jconf);
+void batch_recognition_loop(Recog *recog);
+void batch_add_option();
+
+/* adworker.c */
+boolean is_adworker_mode();
+boolean adworker_check(Jconf *jconf);
+boolean adworker_loop(Recog *recog);
+void adworker_add_option();
+
@@ -0,0 +1,527 @@
+/**
+ * @file   batch.c
+ *
+ * <JA>
+ * @brief  եꥹϤХåǧ
+ *
+ * -filelist Ϳ줿ϥեʣΥץ
+ * ǧ롥ϥǥɤ߹߸ fork 뤿ᡤ
+ * ǥϥץ֤Ƕͭ (ԡ饤)ƥ
+ * 1ե뤴Ȥ˿ƥץؼǧνϤƥץ
+ * ֤ƥץϽϤϥꥹȤν¤٤ɸϤ˽Ϥ
+ * ե뤴Ȥμ»ַΤΥ롼ץåȤɸ२顼˽Ϥ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Parallel batch recognition of file list input
+ *
+ * Input files given by -filelist are recognized in parallel by
+ * worker processes.  The workers are forked after models are loaded,
+ * so the models are shared among them by copy-on-write.  Each worker
+ * recognizes one file at a time as told by the parent process, and
+ * returns its output to the parent.  The parent outputs them to stdout
+ * in the order of the input list, and reports the real time factor of
+ * each file and the total throughput to stderr.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include "app.h"
+
+#ifdef HAVE_WORKER_PROCESS
+#define HAVE_BATCH_WORKER
+#include <sys/time.h>
+#include <signal.h>
+#endif
+
+extern boolean outfile_enabled;
+
+static int batch_worker_num = 0; ///< Number of worker processes
+
+#ifdef HAVE_BATCH_WORKER
+
+/**
+ * Result of a file returned from a worker.
+ *
+ */
+typedef struct {
+  int id;			///< Index of the file in the list
+  boolean ok;			///< TRUE if recognized successfully
+  double wavsec;		///< Length of input in seconds
+  double procsec;		///< Elapsed time for recognition in seconds
+  int len;			///< Length of output following this
+} BATCH_RESULT;
+
+static char **fname;		///< List of input file names
+static int fnum;		///< Number of input files
+static double wavsec;		///< Input length accumulated in a worker
+
+/**
+ * <JA>
+ * ä֤
+ *
+ * @return ߻ ()
+ * </JA>
+ * <EN>
+ * Return current time in seconds.
+ *
+ * @return current time in seconds.
+ * </EN>
+ */
+static double
+now_sec()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+/**
+ * <JA>
+ * Хȿμ¤ɤ߽񤭤롥
+ *
+ * @param fd [in] ե뵭һ
+ * @param buf [i/o] Хåե
+ * @param len [in] Хȿ
+ * @param readp [in] ɤ߹ߤʤ TRUE, 񤭹ߤʤ FALSE
+ *
+ * @return  TRUE, EOF ޤϥ顼 FALSE
+ * </JA>
+ * <EN>
+ * Read or write exactly the given bytes.
+ *
+ * @param fd [in] file descriptor
+ * @param buf [i/o] buffer
+ * @param len [in] number of bytes
+ * @param readp [in] TRUE for read, FALSE for write
+ *
+ * @return TRUE on success, FALSE on EOF or error.
+ * </EN>
+ */
+static boolean
+rw_all(int fd, char *buf, int len, boolean readp)
+{
+  int ret;
+
+  while (len > 0) {
+    ret = readp ? read(fd, buf, len) : write(fd, buf, len);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret <= 0) return FALSE;
+    buf += ret;
+    len -= ret;
+  }
+  return TRUE;
+}
+
+/**
+ * <JA>
+ * 1ѥλΥХåĹѻ롥
+ *
+ * @param recog [in] 󥸥󥤥󥹥
+ * @param dummy [in] (̤)
+ * </JA>
+ * <EN>
+ * Callback at end of the 1st pass: accumulate input length.
+ *
+ * @param recog [in] engine instance
+ * @param dummy [in] (not used)
+ * </EN>
+ */
+static void
+batch_count_input(Recog *recog, void *dummy)
+{
+  HTK_Param *param;
+
+  param = recog->mfcclist->param;
+  if (param == NULL) return;
+  /* wshift is in 100ns unit */
+  wavsec += (double)param->samplenum * param->header.wshift / 10000000.0;
+}
+
+/**
+ * <JA>
+ * Υᥤ롼סƤäֹΥեǧ
+ * ̤ȽϤ֤ɸϤϰեڤؤ졤1ե
+ * ȤνϤΤޤ޿Ƥ롥
+ *
+ * @param wid [in] ֹ (̤)
+ * @param cmd_fd [in] Ƥλؼѥ
+ * @param res_fd [in] Ƥط̤ѥ
+ * @param data [in] 󥸥󥤥󥹥
+ * </JA>
+ * <EN>
+ * Main loop of a worker.  It recognizes the file whose index is given
+ * by the parent, and returns the result and output.  Stdout is
+ * switched to a temporary file, and the output of each file is sent to
+ * the parent as is.
+ *
+ * @param wid [in] worker number (not used)
+ * @param cmd_fd [in] pipe to receive commands from the parent
+ * @param res_fd [in] pipe to send results to the parent
+ * @param data [in] engine instance
+ * </EN>
+ */
+static void
+batch_worker(int wid, int cmd_fd, int res_fd, void *data)
+{
+  Recog *recog;
+  Jconf *jconf;
+  FILE *tmpfp;
+  BATCH_RESULT res;
+  char *buf;
+  int buflen;
+  int id, ret;
+  double t;
+
+  recog = (Recog *)data;
+  jconf = recog->jconf;
+
+  if ((tmpfp = tmpfile()) == NULL) {
+    perror("batch_worker");
+    return;
+  }
+  fflush(stdout);
+  dup2(fileno(tmpfp), 1);
+  buf = NULL;
+  buflen = 0;
+
+  callback_add(recog, CALLBACK_EVENT_PASS1_END, batch_count_input, NULL);
+
+  while (rw_all(cmd_fd, (char *)&id, sizeof(int), TRUE)) {
+    /* clear output */
+    fflush(stdout);
+    lseek(1, 0, SEEK_SET);
+    ftruncate(1, 0);
+
+    printf("\n");
+    if (verbose_flag) printf("------\n");
+    if (jconf->input.speech_input == SP_MFCFILE) {
+      VERMES("### read analyzed parameter\n");
+      if (verbose_flag) printf("\ninput MFCC file: %s\n", fname[id]);
+    } else {
+      VERMES("### read waveform input\n");
+    }
+    if (outfile_enabled) outfile_set_fname(fname[id]);
+
+    wavsec = 0.0;
+    t = now_sec();
+    res.ok = FALSE;
+    if (j_open_stream(recog, fname[id]) == 0) {
+      do {
+	ret = j_recognize_stream(recog);
+      } while (ret == 1);
+      if (ret == 0) res.ok = TRUE;
+    }
+    res.procsec = now_sec() - t;
+    res.wavsec = wavsec;
+    res.id = id;
+
+    /* send the output of this file */
+    fflush(stdout);
+    res.len = lseek(1, 0, SEEK_CUR);
+    if (res.len > buflen) {
+      buflen = res.len;
+      buf = (char *)myrealloc(buf, buflen);
+    }
+    lseek(1, 0, SEEK_SET);
+    if (res.len > 0 && rw_all(1, buf, res.len, TRUE) == FALSE) res.len = 0;
+    if (rw_all(res_fd, (char *)&res, sizeof(BATCH_RESULT), FALSE) == FALSE) break;
+    if (res.len > 0 && rw_all(res_fd, buf, res.len, FALSE) == FALSE) break;
+  }
+
+  if (buf) free(buf);
+  fclose(tmpfp);
+}
+
+/**
+ * <JA>
+ * ϥꥹȤɤ߹ࡥԤ '#' ǻϤޤԤ̵뤵롥
+ *
+ * @param listfile [in] եꥹ
+ *
+ * @return  TRUE, Ի FALSE
+ * </JA>
+ * <EN>
+ * Read input list.  Empty lines and lines beginning with '#' are
+ * skipped.
+ *
+ * @param listfile [in] file list
+ *
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ */
+static boolean
+batch_read_list(char *listfile)
+{
+  FILE *fp;
+  char buf[MAXPATHLEN];
+  int maxnum;
+
+  if ((fp = fopen(listfile, "r")) == NULL) {
+    fprintf(stderr, "Error: cannot open inputlist \"%s\"\n", listfile);
+    return FALSE;
+  }
+  fnum = 0;
+  maxnum = 100;
+  fname = (char **)mymalloc(sizeof(char *) * maxnum);
+  while (getl_fp(buf, MAXPATHLEN, fp) != NULL) {
+    if (buf[0] == '\0' || buf[0] == '#') continue;
+    if (fnum >= maxnum) {
+      maxnum *= 2;
+      fname = (char **)myrealloc(fname, sizeof(char *) * maxnum);
+    }
+    fname[fnum++] = strcpy((char *)mymalloc(strlen(buf) + 1), buf);
+  }
+  fclose(fp);
+  return TRUE;
+}
+
+#endif /* HAVE_BATCH_WORKER */
+
+/**
+ * <JA>
+ * ХåǧԤɤ֤
+ *
+ * @return ХåǧԤ TRUE
+ * </JA>
+ * <EN>
+ * Return whether parallel batch recognition is enabled.
+ *
+ * @return TRUE if enabled.
+ * </EN>
+ */
+boolean
+is_batch_mode()
+{
+  return(batch_worker_num > 1);
+}
+
+/**
+ * <JA>
+ * Хåǧǽ꤫ɤĴ٤롥
+ *
+ * @param jconf [in] ѥ᡼
+ *
+ * @return ǽǤ TRUE, Ǥʤ FALSE
+ * </JA>
+ * <EN>
+ * Check if the configuration allows parallel batch recognition.
+ *
+ * @param jconf [in] global configuration
+ *
+ * @return TRUE if allowed, FALSE if not.
+ * </EN>
+ */
+boolean
+batch_check(Jconf *jconf)
+{
+#ifdef HAVE_BATCH_WORKER
+  if (jconf->input.speech_input != SP_RAWFILE
+      && jconf->input.speech_input != SP_MFCFILE) {
+    fprintf(stderr, "Error: -batchworker works only with -input rawfile or mfcfile\n");
+    return FALSE;
+  }
+  if (jconf->input.inputlist_filename == NULL) {
+    fprintf(stderr, "Error: -batchworker requires -filelist\n");
+    return FALSE;
+  }
+  if (is_module_mode()) {
+    fprintf(stderr, "Error: -batchworker cannot be used with -module\n");
+    return FALSE;
+  }
+  return TRUE;
+#else
+  fprintf(stderr, "Error: -batchworker is not supported on this platform\n");
+  return FALSE;
+#endif
+}
+
+/**
+ * <JA>
+ * ХåǧΥᥤ롼סץưƥե
+ * ơϤϽ˽Ϥ롥
+ *
+ * @param recog [in] 󥸥󥤥󥹥
+ * </JA>
+ * <EN>
+ * Main loop of parallel batch recognition.  It starts worker processes,
+ * assigns files to them, and outputs results in the input order.
+ *
+ * @param recog [in] engine instance
+ * </EN>
+ */
+void
+batch_recognition_loop(Recog *recog)
+{
+#ifdef HAVE_BATCH_WORKER
+  WORKER_PROC *w;
+  int *wfile;
+  BATCH_RESULT res;
+  char **outbuf;
+  BATCH_RESULT *outres;
+  boolean *done;
+  int wnum, alive, next_id, next_out;
+  int i, ret;
+  fd_set rfds;
+  double t, total_wav, total_proc;
+  int okcount;
+
+  if (batch_read_list(recog->jconf->input.inputlist_filename) == FALSE) return;
+  if (fnum == 0) {
+    fprintf(stderr, "0 files processed\n");
+    return;
+  }
+  wnum = (batch_worker_num < fnum) ? batch_worker_num : fnum;
+  outbuf = (char **)mymalloc(sizeof(char *) * fnum);
+  outres = (BATCH_RESULT *)mymalloc(sizeof(BATCH_RESULT) * fnum);
+  done = (boolean *)mymalloc(sizeof(boolean) * fnum);
+  for(i=0;i<fnum;i++) {
+    outbuf[i] = NULL;
+    done[i] = FALSE;
+  }
+  w = (WORKER_PROC *)mymalloc(sizeof(WORKER_PROC) * wnum);
+  worker_init(w, wnum);
+  wfile = (int *)mymalloc(sizeof(int) * wnum);
+
+  /* a dead worker should not kill the parent */
+  signal(SIGPIPE, SIG_IGN);
+
+  t = now_sec();
+
+  /* start workers */
+  alive = 0;
+  for(i=0;i<wnum;i++) {
+    if (worker_start(w, wnum, i, TRUE, batch_worker, recog) == FALSE) break;
+    wfile[i] = -1;
+    alive++;
+  }
+  wnum = alive;
+  if (wnum == 0) {
+    free(wfile);
+    free(w);
+    return;
+  }
+  fprintf(stderr, "batch: %d files, %d worker processes\n", fnum, wnum);
+
+  /* assign the first files */
+  next_id = 0;
+  for(i=0;i<wnum;i++) {
+    wfile[i] = next_id;
+    if (rw_all(w[i].cmd_fd, (char *)&next_id, sizeof(int), FALSE) == FALSE) {
+      wfile[i] = -1;
+      continue;
+    }
+    next_id++;
+  }
+
+  next_out = 0;
+  while (alive > 0) {
+    /* wait for results */
+    if ((ret = worker_select(w, wnum, &rfds)) < 0) break;
+    if (ret == 0) continue;
+    for(i=0;i<wnum;i++) {
+      if (w[i].res_fd < 0 || !FD_ISSET(w[i].res_fd, &rfds)) continue;
+      if (rw_all(w[i].res_fd, (char *)&res, sizeof(BATCH_RESULT), TRUE) == FALSE) {
+	/* worker has gone */
+	if (wfile[i] >= 0) {
+	  fprintf(stderr, "Error: worker process [%d] exited while processing \"%s\"\n", w[i].pid, fname[wfile[i]]);
+	  outres[wfile[i]].ok = FALSE;
+	  outres[wfile[i]].len = 0;
+	  done[wfile[i]] = TRUE;
+	}
+	worker_wait(&(w[i]), FALSE);
+	alive--;
+	continue;
+      }
+      outres[res.id] = res;
+      if (res.len > 0) {
+	outbuf[res.id] = (char *)mymalloc(res.len);
+	if (rw_all(w[i].res_fd, outbuf[res.id], res.len, TRUE) == FALSE) {
+	  outres[res.id].len = 0;
+	}
+      }
+      done[res.id] = TRUE;
+      /* assign next file, or tell the worker to exit */
+      wfile[i] = -1;
+      if (next_id < fnum) {
+	wfile[i] = next_id;
+	if (rw_all(w[i].cmd_fd, (char *)&next_id, sizeof(int), FALSE) == TRUE) {
+	  next_id++;
+	} else {
+	  wfile[i] = -1;
+	}
+      } else {
+	close(w[i].cmd_fd);
+	w[i].cmd_fd = -1;
+      }
+    }
+    /* output results in the input order */
+    while (next_out < fnum && done[next_out]) {
+      if (outbuf[next_out]) {
+	fwrite(outbuf[next_out], 1, outres[next_out].len, stdout);
+	free(outbuf[next_out]);
+	outbuf[next_out] = NULL;
+      }
+      fflush(stdout);
+      if (outres[next_out].ok && outres[next_out].wavsec > 0.0) {
+	fprintf(stderr, "batch: %s: %.2f sec. in %.2f sec. (RTF %.3f)\n", fname[next_out], outres[next_out].wavsec, outres[next_out].procsec, outres[next_out].procsec / outres[next_out].wavsec);
+      } else {
+	fprintf(stderr, "batch: %s: failed\n", fname[next_out]);
+      }
+      next_out++;
+    }
+  }
+  worker_wait_all(w, wnum, FALSE);
+  t = now_sec() - t;
+
+  /* report throughput */
+  okcount = 0;
+  total_wav = total_proc = 0.0;
+  for(i=0;i<next_out;i++) {
+    if (outres[i].ok == FALSE) continue;
+    okcount++;
+    total_wav += outres[i].wavsec;
+    total_proc += outres[i].procsec;
+  }
+  fprintf(stderr, "%d files processed\n", okcount);
+  if (next_out < fnum) {
+    fprintf(stderr, "Error: %d files not processed\n", fnum - next_out);
+  }
+  if (t > 0.0 && total_wav > 0.0) {
+    fprintf(stderr, "batch: %.2f sec. of input in %.2f sec. by %d workers: %.2f files/sec, x%.2f real time (RTF %.3f per worker)\n", total_wav, t, wnum, okcount / t, total_wav / t, total_proc / total_wav);
+  }
+
+  for(i=0;i<fnum;i++) {
+    if (outbuf[i]) free(outbuf[i]);
+    free(fname[i]);
+  }
+  free(fname);
+  free(done);
+  free(outres);
+  free(outbuf);
+  free(wfile);
+  free(w);
+#endif /* HAVE_BATCH_WORKER */
+}
+
+/************************************************************************/
+static boolean
+opt_batchworker(Jconf *jconf, char *arg[], int argnum)
+{
+  batch_worker_num = atoi(arg[0]);
+  return TRUE;
+}
+void
+batch_add_option()
+{
+  j_add_option("-batchworker", 1, 1, "recognize files in -filelist by num processes", opt_batchworker);
+}
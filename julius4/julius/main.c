@@ -95,6 +95,8 @@ main(int argc, char *argv[])
   /* add application options */
   record_add_option();
   module_add_option();
+  batch_add_option();
+  adworker_add_option();
   charconv_add_option();
   j_add_option("-separatescore", 0, 0, "output AM and LM scores separately", opt_separatescore);
   j_add_option("-logfile", 1, 1, "output log to file", opt_logfile);
@@ -131,6 +133,14 @@ main(int argc, char *argv[])
     if (logfile) fclose(fp);
     return -1;
   }
+  if (is_batch_mode() && batch_check(jconf) == FALSE) {
+    if (logfile) fclose(fp);
+    return -1;
+  }
+  if (is_adworker_mode() && adworker_check(jconf) == FALSE) {
+    if (logfile) fclose(fp);
+    return -1;
+  }
 
   /* create a recognition instance */
   recog = j_recog_new();
@@ -228,7 +238,19 @@ main(int argc, char *argv[])
   }
 
   /* enter recongnition loop */
-  main_recognition_stream_loop(recog);
+  if (is_batch_mode()) {
+    /* recognize files in the list by worker processes */
+    batch_recognition_loop(recog);
+  } else if (is_adworker_mode()) {
+    /* recognize adinnet clients by worker processes */
+    if (adworker_loop(recog) == FALSE) {
+      j_recog_free(recog);
+      if (logfile) fclose(fp);
+      return -1;
+    }
+  } else {
+    main_recognition_stream_loop(recog);
+  }
 
   /* end proc */
   if (is_module_mode()) module_disconnect();
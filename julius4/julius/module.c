@@ -4,12 +4,57 @@
 
 #define DEFAULT_MODULEPORT 10500
 
+/*
+ * With pthread, an event loop thread serves the clients.  The first
+ * client becomes the controller, which can send commands, and the
+ * following clients are subscribers which only receive the outputs.
+ * Outputs are queued for each client and sent by the thread, so a slow
+ * client never blocks recognition.
+ */
+#if defined(HAVE_PTHREAD) && (!defined(_WIN32) || defined(__CYGWIN32__))
+#define MODULE_ASYNC
+#include <pthread.h>
+#include <signal.h>
+#endif
+
 static int module_mode = FALSE;
 static int module_port = DEFAULT_MODULEPORT;
-int module_sd = -1;
+int module_sd = -1;		///< Socket to the client (not used while the server thread runs)
 static FILE *module_fp;
+static int module_in_sd = -1;	///< Descriptor to read commands from
 static RecogProcess *cur = NULL;
 
+#ifdef MODULE_ASYNC
+
+#define MODULE_MAXCLIENT 16	///< Maximum number of clients at a time
+#define MODULE_MAXQUEUE 1048576	///< Client is dropped when its output queue exceeds this bytes
+#define MODULE_FLUSHSEC 3	///< Seconds to wait for each client to receive the rest at exit
+
+/**
+ * A client connected to the module server.
+ *
+ */
+typedef struct {
+  int sd;			///< Socket descriptor, -1 if not used
+  char *out;			///< Output not sent yet
+  int outlen;			///< Length of output in out
+  int outalloc;			///< Allocated length of out
+  boolean drop;			///< TRUE if the client should be disconnected
+} MODULE_CLIENT;
+
+static MODULE_CLIENT client[MODULE_MAXCLIENT]; ///< Connected clients
+static int controller = -1;	///< Index of controller client, -1 if none
+static int listen_sd = -1;	///< Socket to listen to clients
+static int cmd_pipe[2];		///< Pipe to pass commands to recognition
+static int wake_pipe[2];	///< Pipe to wake up the server thread
+static pthread_t server_thread;	///< Event loop thread
+static pthread_mutex_t client_mutex = PTHREAD_MUTEX_INITIALIZER; ///< Lock for client[] and flags below
+static boolean server_running = FALSE; ///< TRUE while the thread is running
+static boolean server_shutdown = FALSE; ///< TRUE to tell the thread to exit
+static boolean replying = FALSE; ///< TRUE while executing a command
+
+#endif /* MODULE_ASYNC */
+
 #define MAXBUFLEN 4096 ///< Maximum line length of a message sent from a client
 static char mbuf[MAXBUFLEN];	///< Work buffer for message output
 static char buf[MAXBUFLEN];	///< Work buffer for exec
@@ -18,6 +63,333 @@ static char inbuf[MAXBUFLEN];
 static char outbuf[MAXBUFLEN];
 #endif
 
+#ifdef MODULE_ASYNC
+/** 
+ * Wake up the server thread.
+ * 
+ */
+static void
+module_wakeup()
+{
+  char c = 0;
+
+  /* the pipe is non-blocking: ignore when already full */
+  if (write(wake_pipe[1], &c, 1) < 0) {
+    /* nothing to do */
+  }
+}
+
+/** 
+ * Queue output data to clients.  The data goes to all clients, or only
+ * to the controller while executing its command.  A client whose queue
+ * exceeds MODULE_MAXQUEUE is marked to be dropped.
+ * 
+ * @param data [in] data to send
+ * @param len [in] length of data in bytes
+ */
+static void
+module_enqueue(char *data, int len)
+{
+  MODULE_CLIENT *c;
+  int i;
+
+  pthread_mutex_lock(&client_mutex);
+  for(i=0;i<MODULE_MAXCLIENT;i++) {
+    c = &(client[i]);
+    if (c->sd < 0 || c->drop) continue;
+    if (replying && i != controller) continue;
+    if (c->outlen + len > MODULE_MAXQUEUE) {
+      fprintf(stderr, "Warning: module: client #%d does not receive, dropped\n", i);
+      c->drop = TRUE;
+      continue;
+    }
+    if (c->outlen + len > c->outalloc) {
+      while (c->outlen + len > c->outalloc) c->outalloc *= 2;
+      c->out = (char *)myrealloc(c->out, c->outalloc);
+    }
+    memcpy(&(c->out[c->outlen]), data, len);
+    c->outlen += len;
+  }
+  pthread_mutex_unlock(&client_mutex);
+
+  module_wakeup();
+}
+
+/** 
+ * Register a new client.  The first client, or the next one after the
+ * controller has gone, becomes the controller.
+ * 
+ * @param sd [in] socket descriptor of the client
+ * 
+ * @return index of the client, or -1 if too many clients.
+ */
+static int
+module_client_add(int sd)
+{
+  MODULE_CLIENT *c;
+  int i;
+
+  for(i=0;i<MODULE_MAXCLIENT;i++) {
+    if (client[i].sd < 0) break;
+  }
+  if (i >= MODULE_MAXCLIENT) return -1;
+  c = &(client[i]);
+  c->sd = sd;
+  c->outlen = 0;
+  c->drop = FALSE;
+  if (c->out == NULL) {
+    c->outalloc = MAXBUFLEN;
+    c->out = (char *)mymalloc(c->outalloc);
+  }
+  fcntl(sd, F_SETFL, fcntl(sd, F_GETFL) | O_NONBLOCK);
+  if (controller < 0) controller = i;
+
+  return i;
+}
+
+/** 
+ * Disconnect a client.
+ * 
+ * @param i [in] index of the client
+ */
+static void
+module_client_close(int i)
+{
+  close_socket(client[i].sd);
+  client[i].sd = -1;
+  client[i].outlen = 0;
+  client[i].drop = FALSE;
+  if (i == controller) {
+    controller = -1;
+    printf("///  controller #%d disconnected\n", i);
+  } else {
+    printf("///  subscriber #%d disconnected\n", i);
+  }
+}
+
+/** 
+ * Send queued output to a client as much as possible without blocking.
+ * 
+ * @param i [in] index of the client
+ */
+static void
+module_client_flush(int i)
+{
+  MODULE_CLIENT *c = &(client[i]);
+  int ret;
+
+  ret = send(c->sd, c->out, c->outlen,
+#ifdef MSG_NOSIGNAL
+	     MSG_NOSIGNAL
+#else
+	     0
+#endif
+	     );
+  if (ret < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      c->drop = TRUE;
+    }
+    return;
+  }
+  if (ret < c->outlen) memmove(c->out, &(c->out[ret]), c->outlen - ret);
+  c->outlen -= ret;
+}
+
+/** 
+ * Event loop of the module server thread.  It accepts new clients,
+ * passes data from the controller to the command pipe, and sends the
+ * queued output to each client when it is writable.  Data from
+ * subscribers are discarded.
+ * 
+ * @param dummy [in] not used
+ * 
+ * @return NULL.
+ */
+static void *
+module_server_loop(void *dummy)
+{
+  fd_set rfds, wfds;
+  int maxfd, i, sd, len;
+  char cmdbuf[MAXBUFLEN];	/* data from controller not passed yet */
+  int cmdlen = 0;
+  char rbuf[MAXBUFLEN];
+  MODULE_CLIENT *c;
+  struct timeval tv;
+
+  for(;;) {
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    FD_SET(wake_pipe[0], &rfds);
+    FD_SET(listen_sd, &rfds);
+    maxfd = (wake_pipe[0] > listen_sd) ? wake_pipe[0] : listen_sd;
+    pthread_mutex_lock(&client_mutex);
+    if (server_shutdown) {
+      pthread_mutex_unlock(&client_mutex);
+      break;
+    }
+    for(i=0;i<MODULE_MAXCLIENT;i++) {
+      c = &(client[i]);
+      if (c->sd < 0) continue;
+      if (c->drop) {
+	module_client_close(i);
+	continue;
+      }
+      if (c->outlen > 0) FD_SET(c->sd, &wfds);
+      if (i == controller && cmdlen > 0) {
+	/* wait for recognition to read the commands */
+	FD_SET(cmd_pipe[1], &wfds);
+	if (maxfd < cmd_pipe[1]) maxfd = cmd_pipe[1];
+      } else {
+	FD_SET(c->sd, &rfds);
+      }
+      if (maxfd < c->sd) maxfd = c->sd;
+    }
+    pthread_mutex_unlock(&client_mutex);
+
+    if (select(maxfd+1, &rfds, &wfds, NULL, NULL) < 0) {
+      if (errno == EINTR) continue;
+      perror("Error: module: select");
+      break;
+    }
+
+    if (FD_ISSET(wake_pipe[0], &rfds)) {
+      /* just woken up */
+      while (read(wake_pipe[0], rbuf, MAXBUFLEN) > 0);
+    }
+
+    pthread_mutex_lock(&client_mutex);
+
+    if (FD_ISSET(listen_sd, &rfds)) {
+      if ((sd = accept_from(listen_sd)) >= 0) {
+	if ((i = module_client_add(sd)) < 0) {
+	  fprintf(stderr, "Warning: module: too many clients, rejected\n");
+	  close_socket(sd);
+	} else if (i == controller) {
+	  printf("///  controller #%d connected\n", i);
+	} else {
+	  printf("///  subscriber #%d connected\n", i);
+	}
+      }
+    }
+
+    if (cmdlen > 0 && FD_ISSET(cmd_pipe[1], &wfds)) {
+      if ((len = write(cmd_pipe[1], cmdbuf, cmdlen)) > 0) {
+	if (len < cmdlen) memmove(cmdbuf, &(cmdbuf[len]), cmdlen - len);
+	cmdlen -= len;
+      }
+    }
+
+    for(i=0;i<MODULE_MAXCLIENT;i++) {
+      c = &(client[i]);
+      if (c->sd < 0 || c->drop) continue;
+      if (FD_ISSET(c->sd, &rfds)) {
+	if (i == controller) {
+	  len = recv(c->sd, cmdbuf, MAXBUFLEN, 0);
+	  if (len > 0) cmdlen = len;
+	} else {
+	  len = recv(c->sd, rbuf, MAXBUFLEN, 0);
+	}
+	if (len == 0 || (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+	  /* disconnected */
+	  c->drop = TRUE;
+	  continue;
+	}
+      }
+      if (FD_ISSET(c->sd, &wfds)) {
+	module_client_flush(i);
+      }
+    }
+
+    pthread_mutex_unlock(&client_mutex);
+  }
+
+  /* send the rest of output and disconnect all, giving up on a client
+     which does not receive within MODULE_FLUSHSEC */
+  pthread_mutex_lock(&client_mutex);
+  for(i=0;i<MODULE_MAXCLIENT;i++) {
+    c = &(client[i]);
+    if (c->sd < 0) continue;
+    while (c->outlen > 0 && !c->drop) {
+      FD_ZERO(&wfds);
+      FD_SET(c->sd, &wfds);
+      tv.tv_sec = MODULE_FLUSHSEC;
+      tv.tv_usec = 0;
+      if (select(c->sd+1, NULL, &wfds, NULL, &tv) <= 0) break;
+      module_client_flush(i);
+    }
+    module_client_close(i);
+  }
+  pthread_mutex_unlock(&client_mutex);
+
+  return NULL;
+}
+
+/** 
+ * Start the module server thread, with the first client already
+ * connected as the controller.
+ * 
+ * @param sd [in] listening socket
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+module_server_start(int sd)
+{
+  int i;
+
+  for(i=0;i<MODULE_MAXCLIENT;i++) {
+    client[i].sd = -1;
+    client[i].out = NULL;
+    client[i].outlen = client[i].outalloc = 0;
+    client[i].drop = FALSE;
+  }
+  controller = -1;
+  listen_sd = sd;
+  if (pipe(cmd_pipe) < 0 || pipe(wake_pipe) < 0) {
+    perror("Error: module: pipe");
+    return FALSE;
+  }
+  fcntl(cmd_pipe[1], F_SETFL, fcntl(cmd_pipe[1], F_GETFL) | O_NONBLOCK);
+  fcntl(wake_pipe[0], F_SETFL, fcntl(wake_pipe[0], F_GETFL) | O_NONBLOCK);
+  fcntl(wake_pipe[1], F_SETFL, fcntl(wake_pipe[1], F_GETFL) | O_NONBLOCK);
+  /* a disconnected client should not kill the process */
+  signal(SIGPIPE, SIG_IGN);
+
+  module_client_add(module_sd);
+  module_in_sd = cmd_pipe[0];
+  if ((module_fp = fdopen(module_in_sd, "r")) == NULL) {
+    fprintf(stderr, "Error: failed to fdopen command pipe\n");
+    return FALSE;
+  }
+  /* unbuffered, so that select() on the pipe tells remaining commands */
+  setvbuf(module_fp, NULL, _IONBF, 0);
+  server_shutdown = FALSE;
+  if (pthread_create(&server_thread, NULL, module_server_loop, NULL) != 0) {
+    fprintf(stderr, "Error: failed to create module server thread\n");
+    return FALSE;
+  }
+  server_running = TRUE;
+
+  return TRUE;
+}
+
+/** 
+ * Stop the module server thread after sending the queued output.
+ * 
+ */
+static void
+module_server_stop()
+{
+  pthread_mutex_lock(&client_mutex);
+  server_shutdown = TRUE;
+  pthread_mutex_unlock(&client_mutex);
+  module_wakeup();
+  pthread_join(server_thread, NULL);
+  server_running = FALSE;
+  close_socket(listen_sd);
+}
+#endif /* MODULE_ASYNC */
+
 /** 
  * Generic function to send a formatted message to client module.
  *
@@ -43,6 +415,13 @@ module_send(int sd, char *fmt, ...)
     buf = charconv(inbuf, outbuf, MAXBUFLEN);
 #else
     buf = inbuf;
+#endif
+#ifdef MODULE_ASYNC
+    if (server_running) {
+      /* queue for the server thread: never blocks */
+      module_enqueue(buf, strlen(buf));
+      return(ret);
+    }
 #endif
     if (
 #ifdef WINSOCK
@@ -202,8 +581,21 @@ msock_exec_command(char *command, Recog *recog)
     }
   } else if (strmatch(command, "DIE")) {
     /* disconnect */
+#ifdef MODULE_ASYNC
+    if (server_running) {
+      /* let the server thread disconnect it after sending output */
+      pthread_mutex_lock(&client_mutex);
+      if (controller >= 0) client[controller].drop = TRUE;
+      pthread_mutex_unlock(&client_mutex);
+      module_wakeup();
+    } else {
+      close_socket(module_sd);
+      module_sd = -1;
+    }
+#else
     close_socket(module_sd);
     module_sd = -1;
+#endif
 #if defined(_WIN32) && !defined(__CYGWIN32__)
     /* this is single process and has not forked, so
        we just disconnect the connection here.  */
@@ -427,6 +819,7 @@ msock_exec_command(char *command, Recog *recog)
 	}
       }
       cur->lm->global_modified = FALSE;
+      cur->lm->global_rebuilt = FALSE;
       module_send(module_sd, "<GRAMMAR STATUS=\"READY\"/>\n.\n");
     } else {
       module_send(module_sd, "<GRAMMAR STATUS=\"ERROR\" REASON=\"NOT A GRAMMAR-BASED LM\"/>\n.\n");
@@ -656,6 +1049,25 @@ msock_exec_command(char *command, Recog *recog)
   }
 }
 
+/** 
+ * Execute a command from the controller.  Responses to the command are
+ * sent only to the controller.
+ * 
+ * @param command [in] command string
+ * @param recog [i/o] engine instance
+ */
+static void
+msock_reply_command(char *command, Recog *recog)
+{
+#ifdef MODULE_ASYNC
+  replying = TRUE;
+#endif
+  msock_exec_command(command, recog);
+#ifdef MODULE_ASYNC
+  replying = FALSE;
+#endif
+}
+
 /** 
  * <JA>
  * ߥ饤ȥ⥸塼뤫̿᤬Хåեˤ뤫Ĵ١
@@ -677,20 +1089,20 @@ msock_check_and_process_command(Recog *recog, void *dummy)
 
   /* check if some commands are waiting in queue */
   FD_ZERO(&rfds);
-  FD_SET(module_sd, &rfds);
+  FD_SET(module_in_sd, &rfds);
   tv.tv_sec = 0;
   tv.tv_usec = 0;	      /* 0 msec timeout: return immediately */
-  ret = select(module_sd+1, &rfds, NULL, NULL, &tv);
+  ret = select(module_in_sd+1, &rfds, NULL, NULL, &tv);
   if (ret < 0) {
     perror("msock_check_and_process_command: cannot poll\n");
   }
   if (ret > 0) {
     /* there is data to read */
     /* process command and change status if necessaty */
-    while(select(module_sd+1, &rfds, NULL, NULL, &tv) > 0 &&
+    while(select(module_in_sd+1, &rfds, NULL, NULL, &tv) > 0 &&
 	  myfgets(mbuf, MAXBUFLEN, module_fp)
 	  != NULL) {
-      msock_exec_command(mbuf, recog);
+      msock_reply_command(mbuf, recog);
     }
   }
 }
@@ -718,7 +1130,7 @@ msock_process_command(Recog *recog, void *dummy)
     if (
 	myfgets(mbuf, MAXBUFLEN, module_fp)
 	!= NULL) {
-      msock_exec_command(mbuf, recog);
+      msock_reply_command(mbuf, recog);
     }
   }
 }
@@ -786,6 +1198,9 @@ module_server()
   printf  ("///////////////////////////////\n");
   printf  ("///  Module mode ready\n");
   printf  ("///  waiting client at %5d\n", module_port);
+#ifdef MODULE_ASYNC
+  printf  ("///  (first one is controller, others are subscribers)\n");
+#endif
   printf  ("///////////////////////////////\n");
   printf  ("///  ");
   
@@ -805,17 +1220,35 @@ module_server()
     return;
   }
 #else
+# ifdef MODULE_ASYNC
+  /* serve it and later clients by the server thread */
+  if (module_server_start(listen_sd) == FALSE) {
+    close_socket(module_sd);
+    module_sd = -1;
+  }
+  return;
+# endif
   if ((module_fp = fdopen(module_sd, "r+")) == NULL) {
     fprintf(stderr, "Error; failed to fdopen socket\n");
     return;
   }
 #endif
+  module_in_sd = module_sd;
 }
 
 void
 module_disconnect()
 {
   /* disconnect control module */
+#ifdef MODULE_ASYNC
+  if (server_running) {
+    /* tell all clients, and disconnect them after sending output */
+    module_send(module_sd, "<SYSINFO PROCESS=\"ERREXIT\"/>\n.\n");
+    module_server_stop();
+    module_sd = -1;
+    return;
+  }
+#endif
   if (module_sd >= 0) { /* connected now */
     module_send(module_sd, "<SYSINFO PROCESS=\"ERREXIT\"/>\n.\n");
     close_socket(module_sd);
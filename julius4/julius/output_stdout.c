@@ -700,12 +700,11 @@ put_hypo_phoneme(WORD_ID *seq, int n, WORD_INFO *winfo)
 static void
 put_hypo_cmscore(NODE *hypo, int id)
 {
-  int i;
-  int j;
+  WORDHIST *h;
   
   if (hypo != NULL) {
-    for (i=hypo->seqnum-1;i>=0;i--) {
-      printf(" %5.3f", hypo->cmscore[i][id]);
+    for (h=hypo->hist;h;h=h->prev) {
+      printf(" %5.3f", h->cmscore[id]);
     }
   }
   printf("\n");  
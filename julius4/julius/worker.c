@@ -0,0 +1,251 @@
+/**
+ * @file   worker.c
+ *
+ * <JA>
+ * @brief  ץεưȽλ
+ *
+ * Хåǧ (batch.c)  adinnet ǧ (adworker.c) Ѥ
+ * ץδԤϥǥɤ߹߸ fork
+ * 뤿ᡤǥϥץ֤Ƕͭ (ԡ饤)
+ * ƥץȥδ֤ϡƤλؼѥ (Ǥ) 
+ * νϤѥפǷФ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Start and stop worker processes
+ *
+ * This manages worker processes for parallel batch recognition
+ * (batch.c) and parallel recognition of adinnet clients (adworker.c).
+ * The workers are forked after models are loaded, so the models are
+ * shared among them by copy-on-write.  The parent and each worker are
+ * connected by an optional pipe to send commands to the worker, and a
+ * pipe to receive output from the worker.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include "app.h"
+
+#ifdef HAVE_WORKER_PROCESS
+
+#include <sys/wait.h>
+#include <signal.h>
+
+/**
+ * <JA>
+ * ξ֤롥
+ *
+ * @param w [out] 
+ * @param num [in] 
+ * </JA>
+ * <EN>
+ * Initialize status of workers.
+ *
+ * @param w [out] array of workers
+ * @param num [in] number of workers
+ * </EN>
+ */
+void
+worker_init(WORKER_PROC *w, int num)
+{
+  int i;
+
+  for(i=0;i<num;i++) {
+    w[i].pid = -1;
+    w[i].cmd_fd = -1;
+    w[i].res_fd = -1;
+  }
+}
+
+/**
+ * <JA>
+ * ץ1ĵư롥Ǥϥʥᤷ
+ * ¾ΥΥѥפĤƤ @a func ¹Ԥƽλ롥
+ *
+ * @param w [i/o] 
+ * @param num [in] 
+ * @param id [in] ưֹ
+ * @param cmd_p [in] TRUE ʤؼѥפ
+ * @param func [in] Ǽ¹Ԥؿ
+ * @param data [in] @a func Ϥǡ
+ *
+ * @return ƥץǡ TRUE, Ի FALSE
+ * </JA>
+ * <EN>
+ * Start a worker process.  The worker restores signal handlers, closes
+ * pipes of other workers, and exits after executing @a func.
+ *
+ * @param w [i/o] array of workers
+ * @param num [in] number of workers
+ * @param id [in] index of the worker to start
+ * @param cmd_p [in] TRUE to make also a pipe to send commands
+ * @param func [in] function to be executed in the worker
+ * @param data [in] data to be passed to @a func
+ *
+ * @return in the parent, TRUE on success, FALSE on failure.
+ * </EN>
+ */
+boolean
+worker_start(WORKER_PROC *w, int num, int id, boolean cmd_p, void (*func)(int id, int cmd_fd, int res_fd, void *data), void *data)
+{
+  int cmd[2], res[2];
+  int i;
+
+  cmd[0] = cmd[1] = -1;
+  if (cmd_p && pipe(cmd) < 0) {
+    perror("worker_start");
+    return FALSE;
+  }
+  if (pipe(res) < 0) {
+    perror("worker_start");
+    if (cmd_p) {
+      close(cmd[0]); close(cmd[1]);
+    }
+    return FALSE;
+  }
+  /* flush buffered output not to be duplicated in workers */
+  fflush(NULL);
+  if ((w[id].pid = fork()) < 0) {
+    perror("worker_start");
+    if (cmd_p) {
+      close(cmd[0]); close(cmd[1]);
+    }
+    close(res[0]); close(res[1]);
+    w[id].pid = -1;
+    return FALSE;
+  }
+  if (w[id].pid == 0) {
+    /* worker: restore signals and close pipes of other workers */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    for(i=0;i<num;i++) {
+      if (i == id || w[i].pid <= 0) continue;
+      if (w[i].cmd_fd >= 0) close(w[i].cmd_fd);
+      if (w[i].res_fd >= 0) close(w[i].res_fd);
+    }
+    if (cmd_p) close(cmd[1]);
+    close(res[0]);
+    (*func)(id, cmd[0], res[1], data);
+    fflush(stdout);
+    exit(0);
+  }
+  if (cmd_p) close(cmd[0]);
+  close(res[1]);
+  w[id].cmd_fd = cmd[1];
+  w[id].res_fd = res[0];
+  return TRUE;
+}
+
+/**
+ * <JA>
+ * ϤѥפƤΤ줫ɤ߹ޤ
+ * Ԥġ
+ *
+ * @param w [in] 
+ * @param num [in] 
+ * @param rfds [out] ɤ߹ѥפν
+ *
+ * @return ɤ߹ѥפοʥǤ줿 0, 顼 -1
+ * </JA>
+ * <EN>
+ * Wait until output can be read from any worker whose output pipe is
+ * open.
+ *
+ * @param w [in] array of workers
+ * @param num [in] number of workers
+ * @param rfds [out] set of pipes ready to read
+ *
+ * @return number of pipes ready to read, 0 if interrupted by a signal,
+ * or -1 on error.
+ * </EN>
+ */
+int
+worker_select(WORKER_PROC *w, int num, fd_set *rfds)
+{
+  int i, maxfd, ret;
+
+  FD_ZERO(rfds);
+  maxfd = -1;
+  for(i=0;i<num;i++) {
+    if (w[i].res_fd < 0) continue;
+    FD_SET(w[i].res_fd, rfds);
+    if (maxfd < w[i].res_fd) maxfd = w[i].res_fd;
+  }
+  if ((ret = select(maxfd + 1, rfds, NULL, NULL, NULL)) < 0) {
+    if (errno == EINTR) {
+      FD_ZERO(rfds);
+      return 0;
+    }
+    perror("worker_select");
+  }
+  return ret;
+}
+
+/**
+ * <JA>
+ * ΥѥפĤνλԤġ
+ *
+ * @param w [i/o] 
+ * @param kill_p [in] TRUE ʤ SIGTERM 
+ *
+ * @return waitpid() 줿λ֡ưƤʤ 0
+ * </JA>
+ * <EN>
+ * Close pipes of a worker, and wait for it to exit.
+ *
+ * @param w [i/o] worker
+ * @param kill_p [in] TRUE to send SIGTERM to it first
+ *
+ * @return exit status given by waitpid(), or 0 if the worker is not
+ * running.
+ * </EN>
+ */
+int
+worker_wait(WORKER_PROC *w, boolean kill_p)
+{
+  int status;
+
+  if (w->pid <= 0) return 0;
+  if (kill_p) kill(w->pid, SIGTERM);
+  if (w->cmd_fd >= 0) close(w->cmd_fd);
+  if (w->res_fd >= 0) close(w->res_fd);
+  w->cmd_fd = w->res_fd = -1;
+  status = 0;
+  while (waitpid(w->pid, &status, 0) < 0 && errno == EINTR);
+  w->pid = -1;
+  return status;
+}
+
+/**
+ * <JA>
+ * ΥѥפĤλԤġ
+ *
+ * @param w [i/o] 
+ * @param num [in] 
+ * @param kill_p [in] TRUE ʤ SIGTERM 
+ * </JA>
+ * <EN>
+ * Close pipes of all workers, and wait for them to exit.
+ *
+ * @param w [i/o] array of workers
+ * @param num [in] number of workers
+ * @param kill_p [in] TRUE to send SIGTERM to them first
+ * </EN>
+ */
+void
+worker_wait_all(WORKER_PROC *w, int num, boolean kill_p)
+{
+  int i;
+
+  for(i=0;i<num;i++) worker_wait(&(w[i]), kill_p);
+}
+
+#endif /* HAVE_WORKER_PROCESS */
@@ -290,5 +290,40 @@
  */
 #define SCORE_PRUNING
 
+/**
+ * Enable word-end beam and LM look-ahead beam at the 1st pass.
+ * The LM look-ahead beam refers to the frame maximum computed for
+ * SCORE_PRUNING, so it will be disabled without it.
+ * 
+ */
+#define WORDEND_PRUNING
+#ifndef SCORE_PRUNING
+#undef WORDEND_PRUNING
+#endif
+
+/**
+ * Allow parallel generation of next word hypotheses at the 2nd pass
+ * (-pass2thread).  Requires POSIX threads, and is available only with
+ * the default 2nd pass, i.e. without PASS2_STRICT_IWCD.
+ * 
+ */
+#define PASS2_THREAD
+#if !defined(HAVE_PTHREAD) || defined(PASS2_STRICT_IWCD)
+#undef PASS2_THREAD
+#endif
+#define PASS2_THREAD_BATCH 256	///< Number of words to be expanded in parallel at a time
+
+/**
+ * Allow reusing scan_word() results among 2nd pass hypotheses whose
+ * initial scores and score envelope are the same (-scancache).  Available
+ * only with the default 2nd pass, i.e. without PASS2_STRICT_IWCD.
+ * 
+ */
+#define SCAN_CACHE
+#ifdef PASS2_STRICT_IWCD
+#undef SCAN_CACHE
+#endif
+#define SCAN_CACHE_HASH_SIZE 4096 ///< Number of hash buckets of scan cache (should be power of 2)
+
 #endif /* __J_DEFINE_H__ */
 
@@ -40,6 +40,8 @@ void bt_discount_pescore(WCHMM_INFO *wchmm, BACKTRELLIS *bt, HTK_Param *param);
 void bt_discount_lm(BACKTRELLIS *bt);
 void bt_sort_rw(BACKTRELLIS *bt);
 TRELLIS_ATOM *bt_binsearch_atom(BACKTRELLIS *bt, int time, WORD_ID wkey);
+void bt_make_index(BACKTRELLIS *bt);
+TRELLIS_ATOM *bt_lookup_atom(BACKTRELLIS *bt, int time, WORD_ID wkey);
 
 /* factoring_sub.c */
 void make_iwcache_index(WCHMM_INFO *wchmm);
@@ -86,6 +88,7 @@ void spsegment_restart_mfccs(Recog *recog, int rewind_frame, boolean reprocess);
 void outprob_style_cache_init(WCHMM_INFO *wchmm);
 CD_Set *lcdset_lookup_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID category);
 void lcdset_register_with_category_all(WCHMM_INFO *wchmm);
+void lcdset_register_with_category_append(WCHMM_INFO *wchmm, int wbegin);
 void lcdset_remove_with_category_all(WCHMM_INFO *wchmm);
 #endif
 LOGPROB outprob_style(WCHMM_INFO *wchmm, int node, int last_wid, int t, HTK_Param *param);
@@ -94,6 +97,8 @@ void error_missing_left_triphone(HMM_Logical *base, char *lc_name);
 
 /* ngram_decode.c */
 #include "search.h"
+void ngram_memo_prepare(PROCESS_LM *lm);
+void ngram_memo_free(PROCESS_LM *lm);
 int ngram_firstwords(NEXTWORD **nw, int peseqlen, int maxnw, RecogProcess *r);
 int ngram_nextwords(NODE *hypo, NEXTWORD **nw, int maxnw, RecogProcess *r);
 boolean ngram_acceptable(NODE *hypo, RecogProcess *r);
@@ -103,6 +108,17 @@ boolean dfa_acceptable(NODE *hypo, RecogProcess *r);
 boolean dfa_look_around(NEXTWORD *nword, NODE *hypo, RecogProcess *r);
 
 /* search_bestfirst_main.c */
+void wordhist_push(NODE *dst, NODE *src, WORD_ID w);
+void wordhist_share(NODE *dst, NODE *src);
+void wordhist_pop(NODE *node);
+void wordhist_release(NODE *node);
+WORD_ID *wordhist_to_array(NODE *node);
+void wordhist_clear_stocker(StackDecode *s);
+void hypo_stack_init(HYPOSTACK *s, int stacksize, boolean heap);
+NODE *hypo_stack_pop_best(HYPOSTACK *s);
+int hypo_stack_can_put(HYPOSTACK *s, NODE *new);
+int hypo_stack_put(HYPOSTACK *s, NODE *new);
+void hypo_stack_free(HYPOSTACK *s);
 void segment_set_last_nword(NODE *hypo, RecogProcess *r);
 void pass2_finalize_on_no_result(RecogProcess *r, boolean use_1pass_as_final);
 void wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num);
@@ -120,6 +136,15 @@ void scan_word(NODE *now, HTK_Param *param, RecogProcess *r);
 void next_word(NODE *now, NODE *newParam, NEXTWORD *nword, HTK_Param *param, RecogProcess *r);
 void start_word(NODE *newParam, NEXTWORD *nword, HTK_Param *param, RecogProcess *r);
 void last_next_word(NODE *now, NODE *newParam, HTK_Param *param, RecogProcess *r);
+#ifdef PASS2_THREAD
+void next_word_parallel(NODE *now, NEXTWORD **nword, int num, HTK_Param *param, RecogProcess *r);
+void next_word_thread_start(RecogProcess *r);
+void next_word_thread_end(RecogProcess *r);
+#endif
+#ifdef SCAN_CACHE
+void scan_cache_init(RecogProcess *r);
+void scan_cache_free(RecogProcess *r);
+#endif
 
 /* wav2mfcc.c */
 boolean wav2mfcc(SP16 speech[], int speechlen, Recog *recog);
@@ -132,10 +157,12 @@ void j_put_library_defs(FILE *stream);
 
 /* wchmm.c */
 WCHMM_INFO *wchmm_new();
+WCHMM_INFO *wchmm_new_shared(WCHMM_INFO *src);
 void wchmm_free(WCHMM_INFO *w);
 void print_wchmm_info(WCHMM_INFO *wchmm);
 boolean build_wchmm(WCHMM_INFO *wchmm, JCONF_LM *lmconf);
 boolean build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf);
+boolean build_wchmm_append(WCHMM_INFO *wchmm, JCONF_LM *lmconf);
 
 /* wchmm_check.c */
 void wchmm_check_interactive(WCHMM_INFO *wchmm);
@@ -355,6 +355,18 @@ typedef struct __jconf_lm__ {
    */
   char unknown_name[UNK_WORD_MAXLEN];
 
+  /**
+   * Number of entries of N-gram probability memo on the 2nd pass in
+   * log2.  0 disables it (-ngrammemo)
+   */
+  int ngram_memo_bits;
+
+  /**
+   * Number of threads to parse ARPA N-gram at startup.  0 means the
+   * number of CPUs, and 1 disables threading (-lmthread)
+   */
+  int ngram_read_thread;
+
   /**
    * List of additional dictionary files
    */
@@ -484,6 +496,27 @@ typedef struct __jconf_search__ {
      */
 #endif
     LOGPROB score_pruning_width;
+
+#ifdef WORDEND_PRUNING
+    /**
+     * Word-end beam width by rank at the 1st pass.  Only the best N
+     * word ends at each frame will be expanded to the next words.
+     * -1 disables it.
+     */
+    int wordend_beam_width;
+    /**
+     * Word-end beam width by score at the 1st pass.  Only the word
+     * ends within this score offset from the best word end at each
+     * frame will be expanded to the next words.  -1 disables it.
+     */
+    LOGPROB wordend_score_width;
+    /**
+     * LM look-ahead beam width by score at the 1st pass.  Tokens whose
+     * score falls below the last frame maximum minus this value when
+     * the LM factoring value is updated will be pruned.  -1 disables it.
+     */
+    LOGPROB lmla_score_width;
+#endif
     
 #if defined(WPAIR) && defined(WPAIR_KEEP_NLIMIT)
     /**
@@ -562,6 +595,21 @@ typedef struct __jconf_search__ {
      * at 2nd pass of DFA for speedup (-looktrellis)
      */
     boolean looktrellis_flag;
+
+#ifdef PASS2_THREAD
+    /**
+     * Number of threads to generate next word hypotheses in parallel
+     * at 2nd pass.  Values less than 2 disable it (-pass2thread)
+     */
+    int thread_num;
+#endif
+#ifdef SCAN_CACHE
+    /**
+     * Memory limit of scan cache at 2nd pass in MBytes.  0 disables
+     * it (-scancache)
+     */
+    int scan_cache_size;
+#endif
     
   } pass2;
 
@@ -745,10 +793,6 @@ typedef struct __jconf_search__ {
      * Result: Progressive output interval on 1st pass in msec (-proginterval)
      */
     int progout_interval;
-    /**
-     * Result: INTERNAL: interval in number of frames
-     */
-    int progout_interval_frame;
 
     /**
      * Get results for all grammars independently on 2nd pass on DFA
@@ -888,6 +932,14 @@ typedef struct __Jconf__ {
      */
     char *netaudio_devname;
 #endif
+    /**
+     * Name of shared memory segment for shm / vecshm input (-shmname)
+     */
+    char *shm_name;
+    /**
+     * TRUE if feature vectors are read from shared memory (-input vecshm)
+     */
+    boolean vecin_shm;
     /**
      * Check input parameter type with header of the hmmdefs
      * for parameter file input.  FALSE avoids the check.
@@ -1225,7 +1277,7 @@ penalty2 ->jconf.lm.penalty2
 peseqlen ->recog.peseqlen
 progout_flag ->jconf.output.progout_flag
 progout_interval ->jconf.output.progout_interval
-progout_interval_frame (beam.c) ->jconf.output.progout_interval
+progout_interval_frame (beam.c) ->recog.pass1.progout_interval_frame
 realtime_flag ->jconf.search.pass1.realtime_flag
 record_dirname ->jconf.output.record_dirname
 rejectshortlen ->jconf.reject.rejectshortlen
@@ -115,6 +115,12 @@ void j_jconf_free(Jconf *jconf);
 Recog *j_recog_new();
 void j_recog_free(Recog *recog);
 
+/* m_share.c */
+void j_model_ref(void *model);
+boolean j_model_unref(void *model);
+boolean j_model_is_shared(void *model);
+Recog *j_create_instance_shared(Recog *base);
+
 #ifdef __cplusplus
 }
 #endif
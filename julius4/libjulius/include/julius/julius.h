@@ -39,6 +39,7 @@
 /* read libsent includes */
 #include <sent/stddefs.h>
 #include <sent/tcpip.h>
+#include <sent/shmring.h>
 #include <sent/speech.h>
 #include <sent/mfcc.h>
 #include <sent/htk_param.h>
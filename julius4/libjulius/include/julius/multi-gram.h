@@ -41,6 +41,7 @@ typedef struct __multi_gram__ {
   int state_begin;		///< Location of DFA states in the global grammar
   int cate_begin;		///< Location of category entries in the global grammar
   int word_begin;		///< Location of words in the dictionary of global grammar
+  int word_num;			///< Number of words in the dictionary of global grammar
   struct __multi_gram__ *next;	///< Link to the next grammar entry
 } MULTIGRAM;
 
@@ -56,7 +57,7 @@ typedef struct __gram_list__ {
 #define MULTIGRAM_DELETE     1  ///< Grammar hook bit specifying that this grammar is to be deleted
 #define MULTIGRAM_ACTIVATE   2  ///< Grammar hook bit specifying that this grammar is to be activated
 #define MULTIGRAM_DEACTIVATE 4  ///< Grammar hook bit specifying that this grammar is to be deactivated
-#define MULTIGRAM_MODIFIED   8 /// < Grammar hook bit indicating modification  and needs rebuilding the whole lexicon
+#define MULTIGRAM_MODIFIED   8 /// < Grammar hook bit indicating modification, to be re-installed at the tail of global grammar
 
 
 #endif /* __J_MULTI_GRAM_H__ */
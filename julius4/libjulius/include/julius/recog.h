@@ -128,6 +128,16 @@ typedef struct __FSBeam__ {
   LOGPROB score_pruning_threshold;///< Score threshold for score pruning
   int score_pruning_count;	  ///< Number of tokens pruned by score (debug)
 #endif
+#ifdef WORDEND_PRUNING
+  LOGPROB wordend_pruning_threshold; ///< Score threshold of word ends to be expanded at current frame
+  LOGPROB *wordend_score;	  ///< Work area to sort word-end scores for rank pruning
+  int wordend_score_alloc;	  ///< Allocated length of @a wordend_score
+  int wordend_pruning_count;	  ///< Number of word ends pruned by word-end beam at current frame
+  int wordend_pruning_total;	  ///< Total number of word ends pruned by word-end beam (debug)
+  LOGPROB lmla_pruning_threshold; ///< Score threshold of LM look-ahead beam at current frame
+  int lmla_pruning_count;	  ///< Number of tokens pruned by LM look-ahead beam at current frame
+  int lmla_pruning_total;	  ///< Total number of tokens pruned by LM look-ahead beam (debug)
+#endif
     
   /* Active token list */
   TOKENID *token;       ///< Active token list that holds currently assigned tokens for each tree node
@@ -146,6 +156,7 @@ typedef struct __FSBeam__ {
   LOGPROB lm_penalty;          ///< Word insertion penalty (local copy)
   LOGPROB lm_penalty_trans; ///< Additional insertion penalty for transparent words (local copy)
   LOGPROB penalty1; ///< Word insertion penalty for DFA (local copy)
+  int progout_interval_frame; ///< Interval of progressive output in frames, computed from -proginterval at each input
 #if defined(WPAIR) && defined(WPAIR_KEEP_NLIMIT)
   boolean wpair_keep_nlimit; ///< Keeps only N token on word-pair approx. (local copy from jconf)
 #endif
@@ -203,6 +214,10 @@ typedef struct __StackDecode__ {
   LOGPROB *framemaxscore; ///< Maximum score of each frame on 2nd pass for score enveloping
 #endif
   NODE *stocker_root; ///< Node stocker for recycle
+  WORDHIST *wordhist_stocker; ///< Word history cell stocker for recycle
+  FRAMESCORE *framescore_stocker; ///< Frame score buffer stocker for recycle
+  WORD_ID *seqbuf;		///< Work area to expand a word history to array
+  int seqbuflen;		///< Allocated length of @a seqbuf
   int popctr;           ///< Num of popped hypotheses from stack
   int genectr;          ///< Num of generated hypotheses
   int pushctr;          ///< Num of hypotheses actually pushed to stack
@@ -246,6 +261,44 @@ typedef struct __StackDecode__ {
 #endif
   WORD_ID *cnword;		///< Work area for N-gram computation
   WORD_ID *cnwordrev;		///< Work area for N-gram computation
+  unsigned int *nw_stamp;	///< Generation stamp of each word for next word lookup on trellis
+  unsigned int nw_gen;		///< Current generation for @a nw_stamp
+  TRELLIS_ATOM **nw_owner;	///< Trellis word adopted for each word in the current generation
+  int *nw_frame;		///< Work area to hold frames to be looked up in order of priority
+  int *nw_pos;			///< Work area to hold current position on each frame for merging
+
+#ifdef PASS2_THREAD
+  /* Variables for parallel word expansion */
+  int thread_num;		///< Number of threads for word expansion, including the main thread (<= 1 if disabled)
+  pthread_t *thread;		///< Worker threads
+  pthread_mutex_t mutex;	///< Lock for the job variables below
+  pthread_cond_t cond_job;	///< Signaled when a new job is posted
+  pthread_cond_t cond_done;	///< Signaled when all words in a job has been processed
+  pthread_mutex_t outprob_mutex; ///< Lock for output probability computation on shared HMMWork
+  boolean thread_quit;		///< TRUE when worker threads should exit
+  NODE *job_src;		///< Source hypothesis of current job
+  NEXTWORD **job_nword;		///< Words to be connected in current job
+  HTK_Param *job_param;		///< Input parameter of current job
+  int job_num;			///< Number of words in current job
+  int job_next;			///< Index of the next word to be processed
+  int job_running;		///< Number of threads processing current job
+  NODE **expnode;		///< New hypotheses generated in current job
+  HMM_Logical **expphone;	///< Phone at the connection point of each new hypothesis
+  int expalloc;			///< Allocated length of @a expnode and @a expphone
+#endif
+
+#ifdef SCAN_CACHE
+  /* Variables for scan cache */
+  SCANCACHE **scache;		///< Hash buckets of scan cache (NULL if disabled)
+  SCANCACHE *scache_lru_head;	///< Most recently used entry
+  SCANCACHE *scache_lru_tail;	///< Least recently used entry
+  size_t scache_bytes;		///< Total bytes used by scan cache entries
+  size_t scache_maxbytes;	///< Memory limit of scan cache in bytes
+  int scache_lookup;		///< Number of lookups (statistics)
+  int scache_hit;		///< Number of hits (statistics)
+  int scache_saved_frames;	///< Total frames whose computation was skipped (statistics)
+  int scache_evicted;		///< Number of evicted entries (statistics)
+#endif
 
 } StackDecode;
 
@@ -383,14 +436,19 @@ typedef struct __adin__ {
   int rest_tail;                ///< Samples not processed yet in swap buffer
 
   ZEROCROSS zc;                 ///< Work area for zero-cross computation
+  ZMEAN zm;			///< Work area for DC offset removal
 
 #ifdef HAVE_PTHREAD
   /* Variables related to POSIX threading */
   pthread_t adin_thread;	///< Thread information
   pthread_mutex_t mutex;        ///< Lock primitive
-  SP16 *speech;         ///< Unprocessed samples recorded by A/D-in thread
-  int speechlen;                ///< Current length of @a speech
-  int freezelen;        ///< Number of samples to abondon processing
+  pthread_cond_t cond;		///< Signaled when A/D-in thread stores samples or changes status
+  SP16 *speech;         ///< Ring buffer of samples recorded by A/D-in thread
+  unsigned int speechsize;	///< Size of @a speech (power of 2)
+  volatile unsigned int speech_wp; ///< Total samples stored to @a speech by A/D-in thread
+  volatile unsigned int speech_rp; ///< Total samples taken from @a speech by main thread
+  volatile boolean speech_waiting; ///< TRUE while main thread is waiting for samples
+  int freezelen;        ///< Number of samples to abondon processing (-1 = no limit)
 /*
  * Semaphore to start/stop recognition.
  * 
@@ -762,6 +820,24 @@ typedef struct __process_am__ {
   
 } PROCESS_AM;
 
+/**
+ * Memo of N-gram probabilities computed on the 2nd pass.  Entries are
+ * direct-mapped by hash of the word sequence, and those of previous
+ * inputs are invalidated by the generation number.
+ * 
+ */
+typedef struct {
+  int bits;			///< Number of entries in log2
+  int n;			///< Maximum length of word sequence
+  WORD_ID *key;			///< Word sequence of each entry [entry * n]
+  unsigned char *len;		///< Length of word sequence of each entry
+  LOGPROB *prob;		///< Memorized probability of each entry
+  unsigned int *stamp;		///< Generation number of each entry
+  unsigned int gen;		///< Current generation number
+  int lookup;			///< Number of lookups in current input (statistics)
+  int hit;			///< Number of hits in current input (statistics)
+} NGRAM_MEMO;
+
 /**
  * instance for a LM.
  * 
@@ -828,12 +904,27 @@ typedef struct __process_lm__ {
    */
   boolean global_modified;
 
+  /**
+   * TRUE if the global grammar has been re-built from scratch in
+   * multigram_update().  If FALSE while @a global_modified is TRUE,
+   * grammars were only appended at the tail, and the tree lexicon can be
+   * extended incrementally.
+   * 
+   */
+  boolean global_rebuilt;
+
   /**
    * LM User function entry point
    * 
    */
   LMFunc lmfunc;
 
+  /**
+   * Memo of N-gram probabilities on the 2nd pass (NULL if disabled)
+   * 
+   */
+  NGRAM_MEMO *memo;
+
   /**
    * pointer to next
    * 
@@ -1073,6 +1164,12 @@ typedef struct __Recog__ {
    */
   RecogProcess *process_list;
 
+  /**
+   * Engine instance whose models are shared with this instance.  This
+   * is set only while composing this instance in j_create_instance_shared().
+   * 
+   */
+  struct __Recog__ *model_source;
 
   /**
    * TRUE when engine is processing a segment (for short-pause segmentation)
@@ -77,6 +77,47 @@ typedef struct __popnode__ {
 } POPNODE;
 #endif /* VISUALIZE */
 
+/**
+ * <JA>
+ * 2ѥʸñ. ϺǽñΥΤߤ
+ * ñ @a prev 򤿤ɤä. Ʊ⤫Ÿ줿ɤ
+ * ͭȿ 0 ˤʤäǥϲ. 
+ * </JA>
+ * <EN>
+ * Word history of a sentence hypothesis on the 2nd pass.  A hypothesis
+ * holds only the cell of its last word, and the preceding words are
+ * reached by @a prev.  Hypotheses expanded from the same one share the
+ * history, and a cell is released when its reference count becomes 0.
+ * </EN>
+ */
+typedef struct __wordhist__ {
+  WORD_ID word;			///< Word ID
+  short len;			///< Number of words up to this cell
+  int refcount;			///< Number of hypotheses and cells referring this
+  struct __wordhist__ *prev;	///< Cell of the previous word, NULL at the first word
+#ifdef CONFIDENCE_MEASURE
+#ifdef CM_MULTIPLE_ALPHA
+  LOGPROB cmscore[100];		///< Confidence score of the word (multiple)
+#else
+  LOGPROB cmscore;		///< Confidence score of the word
+#endif /* CM_MULTIPLE_ALPHA */
+#endif /* CONFIDENCE_MEASURE */
+} WORDHIST;
+
+/**
+ * <JA>
+ * ȿĤΥե졼ऴȤΥ. 
+ * </JA>
+ * <EN>
+ * Reference-counted per-frame score buffer.
+ * </EN>
+ */
+typedef struct __framescore__ {
+  LOGPROB *s;			///< Score of each frame
+  int refcount;			///< Number of hypotheses sharing this
+  struct __framescore__ *next;	///< Link to next buffer in the stocker
+} FRAMESCORE;
+
 /**
  * <JA>
  * 2ѥʸ
@@ -89,8 +130,8 @@ typedef struct __node__ {
   struct __node__    *next;	///< Link to next hypothesis, used in stack
   struct __node__    *prev;	///< Link to previous hypothesis, used in stack
   boolean endflag;              ///< TRUE if this is a final sentence result
-  WORD_ID seq[MAXSEQNUM];	///< Word sequence
-  short seqnum;                 ///< Length of @a seq
+  WORDHIST *hist;		///< Word sequence, as the cell of the last word
+  short seqnum;                 ///< Length of @a hist
   LOGPROB score;		///< Total score (forward+backward, LM+AM)
   short bestt;                  ///< Best connection frame of last word in word trellis
   short estimated_next_t;	///< Estimated next connection time frame (= beginning of last word on word trellis): next word hypothesis will be looked up near this frame on word trellis
@@ -103,18 +144,12 @@ typedef struct __node__ {
   /* for inter-word context dependency, the last phone on previous word
      need to be calculated later */
   LOGPROB *g_prev;		///< Viterbi score back to last 1 phoneme
+  FRAMESCORE *g_prev_buf;	///< Shared buffer holding @a g_prev
 #endif
   HMM_Logical *last_ph;		///< Last applied triphone
   boolean last_ph_sp_attached;  ///< Last phone which the inter-word sp has been attached for multipath mode
   LOGPROB lscore;		///< N-gram score of last word (will be used for 1-phoneme backscan and graph output, always 0 for dfa
   LOGPROB totallscore;		///< (n-gram) Accumulated language score (LM only)
-#ifdef CONFIDENCE_MEASURE
-#ifdef CM_MULTIPLE_ALPHA
-  LOGPROB cmscore[MAXSEQNUM][100]; ///< Confidence score of each word (multiple)
-#else
-  LOGPROB cmscore[MAXSEQNUM];	///< Confidence score of each word
-#endif /* CM_MULTIPLE_ALPHA */
-#endif /* CONFIDENCE_MEASURE */
 #ifdef VISUALIZE
   POPNODE *popnode;		///< Pointer to last popped node 
 #endif
@@ -135,6 +170,80 @@ typedef struct __node__ {
 #endif
 } NODE;
 
+/**
+ * <JA>
+ * 2ѥβ min-max ҡפݻ륹åβ. 
+ * 꾮åϥΥꥹȤݻ. 
+ * </JA>
+ * <EN>
+ * Minimum stack size to keep the 2nd pass hypotheses in a min-max heap.
+ * Smaller stacks are kept as a score-sorted list, which is faster there.
+ * </EN>
+ */
+#define HYPOSTACK_HEAP_MIN 2000
+
+/**
+ * <JA>
+ * 2ѥβ⥹å. ꥹȡޤ min-max ҡ
+ * Ȥݻ. ҡפǤϺಾμФȺ㥹֤
+ *  O(log n) ǹԤƱβϥꥹȤƱǰ. 
+ * </JA>
+ * <EN>
+ * Hypothesis stack on the 2nd pass.  It is kept as a score-sorted doubly
+ * linked list, or as a min-max heap.  The heap pops the best hypothesis
+ * and replaces the worst one in O(log n), and handles hypotheses of equal
+ * score in the same order as the list.
+ * </EN>
+ */
+typedef struct {
+  boolean heap;			///< TRUE if kept as a heap, FALSE as a list
+  NODE *start;			///< Top node of the list
+  NODE *bottom;			///< Bottom node of the list
+  NODE **node;			///< Heap array of hypotheses
+  int *order;			///< Order of each node in @a node among equal scores
+  int order_first;		///< Smallest value given to @a order
+  int order_last;		///< Largest value given to @a order
+  int num;			///< Current number of hypotheses in stack
+  int size;			///< Maximum number of hypotheses (stack size)
+} HYPOSTACK;
+
+#ifdef SCAN_CACHE
+/**
+ * <JA>
+ * scan_word() η׻̤Υå. Ʊñ졦ƱƥȲǡ
+ * Ʊϥե졼ࡦƱ g[] ٥פ
+ * Ʊδ֤ǡѤ. 
+ * </JA>
+ * <EN>
+ * Cached result of scan_word().  The forward scores are reused among
+ * hypotheses with the same word, right context phone, start frame and
+ * initial scores g[], under the same score envelope.
+ * </EN>
+ */
+typedef struct __scancache__ {
+  WORD_ID word;			///< Scanned word
+  HMM_Logical *last_ph;		///< Right context phone given at scan (NULL if none)
+  boolean last_ph_sp_attached;	///< Whether sp was attached to @a last_ph
+  int startt;			///< Start frame of the scan
+  int estimated_next_t;		///< Estimated word beginning frame given at scan
+  int endt;			///< Last frame computed at the scan
+  LOGPROB lscore;		///< LM score added at the word boundary of backscan
+  LOGPROB *in;			///< Initial scores [0..startt]
+#ifdef SCAN_BEAM
+  LOGPROB *envl;		///< Score envelope at the scan [0..startt]
+#endif
+  LOGPROB *g;			///< Resulting forward scores [0..startt]
+  LOGPROB *g_prev;		///< Resulting g_prev[0..startt], or NULL
+  short *wordend_frame;		///< Resulting word end frames [0..startt], or NULL
+  LOGPROB *wordend_gscore;	///< Resulting word end scores [0..startt], or NULL
+  LOGPROB final_g;		///< Resulting final score for multipath
+  size_t size;			///< Allocated bytes for this entry
+  struct __scancache__ *next;	///< Next entry in the same hash bucket
+  struct __scancache__ *lru_prev; ///< More recently used entry
+  struct __scancache__ *lru_next; ///< Less recently used entry
+} SCANCACHE;
+#endif
+
 /*
   HOW SCORES ARE CALCULATED:
   
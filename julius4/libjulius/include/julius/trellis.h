@@ -39,6 +39,23 @@ typedef struct __trellis_atom__ {
   struct __trellis_atom__ *next; ///< Temporary link to store generated trellis word on 1st pass
 } TRELLIS_ATOM;
 
+/**
+ * Number of trellis words to be allocated at once as a chunk.
+ * 
+ */
+#define TRELLIS_CHUNK_ATOMNUM 2048
+
+/**
+ * Chunk of trellis words.  Trellis words are appended sequentially to
+ * the chunks in the order of generation, i.e. grouped by frame.
+ * 
+ */
+typedef struct __trellis_chunk__ {
+  TRELLIS_ATOM atom[TRELLIS_CHUNK_ATOMNUM]; ///< Trellis words
+  int num;			///< Number of used trellis words in @a atom
+  struct __trellis_chunk__ *next; ///< Link to next chunk
+} TRELLIS_CHUNK;
+
 /**
  * Whole word trellis (aka backtrellis) generated as a result of 1st pass.
  * 
@@ -48,6 +65,11 @@ typedef struct __backtrellis__ {
   int *num;			///< Number of trellis words at frame [t]
   TRELLIS_ATOM ***rw;		///< List to trellis words at frame [t]: rw[t][0..num[t]]
   TRELLIS_ATOM *list;		///< Temporary storage point used in 1st pass
+  TRELLIS_CHUNK *chunk;		///< First chunk of trellis words
+  TRELLIS_CHUNK *chunk_last;	///< Current chunk to which new trellis words are appended
+  int atomnum;			///< Total number of trellis words
+  TRELLIS_ATOM ***index;	///< Hash index from (frame, word) to position on @a rw
+  unsigned int index_mask;	///< Size of @a index minus 1 (size is power of 2)
   BMALLOC_BASE *root;		///< memory allocation base for mybmalloc2()
 } BACKTRELLIS;
 
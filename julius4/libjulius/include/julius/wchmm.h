@@ -55,13 +55,7 @@
 typedef struct {
   HMM_Logical  *hmm;		///< Original HMM state on the dictionary
   short		state_loc;	///< State location within the phoneme (1-)
-  /* Context cache */
-  boolean	last_is_lset;	///< TRUE if last assigned model was context-dependent state set
-  union {
-    HTK_HMM_State *state;	///< Last assigned state (last_is_lset = FALSE)
-    CD_State_Set  *lset;	///< Last assigned lset (last_is_lset = TRUE)
-  } cache;
-  WORD_ID	lastwid_cache;	///< Last context word ID
+  int		cid;		///< Index of its context cache in wchmm->outcache
 } RC_INFO;
 
 /**
@@ -72,15 +66,23 @@ typedef struct {
 typedef struct {
   HMM_Logical  *hmm;		///< Original HMM state on the dictionary
   short		state_loc;	///< State location within the phoneme (1-)
-  /* Context cache */
-  boolean	last_is_lset;	///< TRUE if last assigned model was context-dependent state set
   WORD_ID	category;	///< Last context word's category ID
+  int		cid;		///< Index of its context cache in wchmm->outcache
+} LRC_INFO;
+
+/**
+ * Context cache of RC_INFO and LRC_INFO.  They are held apart from the
+ * tree lexicon, since the tree may be shared among engine instances.
+ * 
+ */
+typedef struct {
+  boolean	last_is_lset;	///< TRUE if last assigned model was context-dependent state set
   union {
-    HTK_HMM_State *state;	///< Last assigned state
-    CD_State_Set  *lset;	///< Last assigned lset
+    HTK_HMM_State *state;	///< Last assigned state (last_is_lset = FALSE)
+    CD_State_Set  *lset;	///< Last assigned lset (last_is_lset = TRUE)
   } cache;
   WORD_ID	lastwid_cache;	///< Last context word ID
-} LRC_INFO;
+} OUTSTYLE_CACHE;
 
 /* For word tail phoneme, pseudo phone on the dictionary will be directly
    used as context-dependent state set */
@@ -226,6 +228,7 @@ typedef struct wchmm_info {
   WORD_ID	*stend;		///< Word ID that ends at the state [nodeID]
   int	**offset;		///< Node ID of a phone [wordID][0..phonelen-1]
   int	*wordend;		///< Node ID of word-end state [wordID]
+  int	wordnum;		///< Number of words already added to this lexicon
   int	startnum;		///< Number of root nodes
   int	*startnode;		///< Root node index [0..startnum-1] -> node ID
   int	*wordbegin;		///< Node ID of word-beginning state [wordID] for multipath mode
@@ -238,6 +241,7 @@ typedef struct wchmm_info {
   LOGPROB	*wordend_a;	///< Transition prob. outside word [wordID] for non-multipath mode
 #ifdef PASS1_IWCD
   unsigned char *outstyle;	///< ID to indicate type of output probability container (one of AS_Style)
+  int	outcachenum;		///< Number of context caches used by RC_INFO and LRC_INFO
 #endif
   /* Successor lists on the tree are stored on sequencial list at @a sclist,
      and each node has index to the list */
@@ -252,6 +256,7 @@ typedef struct wchmm_info {
   WORD_ID *sclen;		///< Length of each succcessor list [scid]
   int   scnum;			///< Total number of factoring nodes that has successor list
   BMALLOC_BASE *malloc_root;	///< Pointer for block memory allocation
+  struct wchmm_info *share_src;	///< Lexicon whose tree data are shared with this, or NULL if this owns them
 #ifdef PASS1_IWCD
   APATNODE *lcdset_category_root; ///< Index of lexicon-dependent category-aware pseudo phone set when used on Julian
   BMALLOC_BASE *lcdset_mroot;
@@ -263,6 +268,11 @@ typedef struct wchmm_info {
 
   WCHMM_WORK wrk;		///< Other work area for 1st pass transition computation
 
+#ifdef PASS1_IWCD
+  OUTSTYLE_CACHE *outcache;	///< Context cache of word head states [cid]
+  int	outcachelen;		///< Allocated length of @a outcache
+#endif
+
   int separated_word_count; ///< Number of words actually separated (linearlized) from the tree
 
   char lccbuf[MAX_HMMNAME_LEN+7]; ///< Work area for HMM name conversion
@@ -38,9 +38,14 @@
  *        - ΥåɤϵưܥåɤΩư
  *          嵭ưԤʤ³. 
  *    - Thread 2: ǧԤʤܥå
- *        - Хåե @a speech ֤Ȥ˴ƻ뤷ʥץ뤬
- *          Thread 1 ˤäɲä줿餽λ
- *          ʬХåեͤ. 
+ *        - Хåե @a speech  Thread 1 ˤäƿʥץ뤬
+ *          ɲä줿餽λʬ. 
+ *          ץ뤬̵ȤϡThread 1 ΤԤ. 
+ *
+ * Хåե @a speech ñν񤭹¦ɤ߽Ф¦ΤΥ
+ * ХåեǤꡤƥåɤϼʬΰ֤Τߤ򹹿Τǡץ
+ * Ϥ˥åѤʤ. ϤɤդƤС֤Ĺ
+ * ¤̵. 
  *
  * </JA>
  * <EN>
@@ -86,7 +91,13 @@
  *        - performs input processing and recognition.
  *        - watches @a speech buffer, and if detect appendings of new samples
  *          by the Thread 1, proceed the processing for the appended samples
- *          and purge the finished samples from @a speech buffer.
+ *          and release the finished samples from @a speech buffer.  When
+ *          no sample is available, it waits for notification from Thread 1.
+ *
+ * The @a speech buffer is a ring buffer for single writer and single
+ * reader.  Since each thread updates only its own position, samples are
+ * passed without locking.  The length of an input segment is not limited
+ * as long as the processing keeps up with the input.
  *
  * </EN>
  *
@@ -115,6 +126,17 @@
 /// Enable some fixes relating adinnet+module
 #define TMP_FIX_200602		
 
+#ifdef HAVE_PTHREAD
+/// Memory barrier for the positions of the ring buffer shared by the threads
+#if defined(__GNUC__)
+#define ADIN_MEMORY_BARRIER() __sync_synchronize()
+#else
+#define ADIN_MEMORY_BARRIER()
+#endif
+/// Interval to call ad_check while waiting for samples (msec)
+#define ADIN_THREAD_WAIT_MSEC 50
+#endif
+
 /** 
  * <EN>
  * @brief  Set up parameters for A/D-in and input detection.
@@ -183,7 +205,7 @@ adin_setup_param(ADIn *adin, Jconf *jconf)
   if (jconf->reject.rejectlonglen >= 0) {
     adin->freezelen = (jconf->reject.rejectlonglen + 500.0) * jconf->input.sfreq / 1000.0;
   } else {
-    adin->freezelen = MAXSPEECHLEN;
+    adin->freezelen = -1;
   }
 #endif
 
@@ -452,7 +474,7 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 	}
 	if (a->need_zmean) {
 	  /* remove DC offset */
-	  sub_zmean(&(a->buffer[a->bp]), cnt);
+	  sub_zmean(&(a->zm), &(a->buffer[a->bp]), cnt);
 	}
       }
       
@@ -623,6 +645,7 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 		    /* in threaded mode, just stop transfer */
 		    pthread_mutex_lock(&(a->mutex));
 		    a->transfer_online = transfer_online_local = FALSE;
+		    pthread_cond_signal(&(a->cond));
 		    pthread_mutex_unlock(&(a->mutex));
 		  } else {
 		    /* in non-threaded mode, set end status and exit loop */
@@ -701,6 +724,7 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 		    /* in threaded mode, just stop transfer */
 		    pthread_mutex_lock(&(a->mutex));
 		    a->transfer_online = transfer_online_local = FALSE;
+		    pthread_cond_signal(&(a->cond));
 		    pthread_mutex_unlock(&(a->mutex));
 		  } else {
 		    /* in non-threaded mode, set end status and exit loop */
@@ -827,6 +851,7 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 		/* in threaded mode, just stop transfer */
 		pthread_mutex_lock(&(a->mutex));
 		a->transfer_online = transfer_online_local = FALSE;
+		pthread_cond_signal(&(a->cond));
 		pthread_mutex_unlock(&(a->mutex));
 	      } else {
 		/* in non-threaded mode, set end status and exit loop */
@@ -867,6 +892,7 @@ adin_cut(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Reco
 	if (a->enable_thread) { /* just stop transfer */
 	  pthread_mutex_lock(&(a->mutex));
 	  a->transfer_online = transfer_online_local = FALSE;
+	  pthread_cond_signal(&(a->cond));
 	  pthread_mutex_unlock(&(a->mutex));
 	} else {
 	  adin_purge(a, i+wstep);
@@ -938,21 +964,37 @@ static int
 adin_store_buffer(SP16 *now, int len, Recog *recog)
 {
   ADIn *a;
+  unsigned int wp, idx, n;
 
   a = recog->adin;
-  if (a->speechlen + len > MAXSPEECHLEN) {
+  wp = a->speech_wp;
+  if (wp - a->speech_rp + len > a->speechsize) {
     /* just mark as overflowed, and continue this thread */
     pthread_mutex_lock(&(a->mutex));
     a->adinthread_buffer_overflowed = TRUE;
+    pthread_cond_signal(&(a->cond));
     pthread_mutex_unlock(&(a->mutex));
     return(0);
   }
-  pthread_mutex_lock(&(a->mutex));
-  memcpy(&(a->speech[a->speechlen]), now, len * sizeof(SP16));
-  a->speechlen += len;
-  pthread_mutex_unlock(&(a->mutex));
+  /* samples between speech_rp and speech_wp are owned by main thread,
+     and the rest by this thread */
+  idx = wp & (a->speechsize - 1);
+  n = a->speechsize - idx;
+  if (n > len) n = len;
+  memcpy(&(a->speech[idx]), now, n * sizeof(SP16));
+  if (n < len) memcpy(a->speech, &(now[n]), (len - n) * sizeof(SP16));
+  /* publish the samples */
+  ADIN_MEMORY_BARRIER();
+  a->speech_wp = wp + len;
+  ADIN_MEMORY_BARRIER();
+  /* wake up main thread if it is waiting */
+  if (a->speech_waiting) {
+    pthread_mutex_lock(&(a->mutex));
+    pthread_cond_signal(&(a->cond));
+    pthread_mutex_unlock(&(a->mutex));
+  }
 #ifdef THREAD_DEBUG
-  jlog("DEBUG: input: stored %d samples, total=%d\n", len, a->speechlen);
+  jlog("DEBUG: input: stored %d samples, total=%u\n", len, a->speech_wp - a->speech_rp);
 #endif
 
   return(0);			/* continue */
@@ -985,7 +1027,10 @@ adin_thread_input_main(void *dummy)
   } else if (ret == 0) {	/* EOF */
     jlog("Stat: adin thread end with EOF\n");
   }
+  pthread_mutex_lock(&(recog->adin->mutex));
   recog->adin->adinthread_ended = TRUE;
+  pthread_cond_signal(&(recog->adin->cond));
+  pthread_mutex_unlock(&(recog->adin->mutex));
 
   /* return to end this thread */
 }
@@ -1009,9 +1054,12 @@ adin_thread_create(Recog *recog)
 
   a = recog->adin;
 
-  /* init storing buffer */
-  a->speech = (SP16 *)mymalloc(sizeof(SP16) * MAXSPEECHLEN);
-  a->speechlen = 0;
+  /* init storing buffer: ring buffer of 2^n samples */
+  a->speechsize = 1;
+  while (a->speechsize < MAXSPEECHLEN) a->speechsize <<= 1;
+  a->speech = (SP16 *)mymalloc(sizeof(SP16) * a->speechsize);
+  a->speech_wp = a->speech_rp = 0;
+  a->speech_waiting = FALSE;
 
   a->transfer_online = FALSE; /* tell adin-mic thread to wait at initial */
   a->adinthread_buffer_overflowed = FALSE;
@@ -1021,6 +1069,10 @@ adin_thread_create(Recog *recog)
     jlog("ERROR: adin_thread_create: failed to initialize mutex\n");
     return FALSE;
   }
+  if (pthread_cond_init(&(a->cond), NULL) != 0) { /* error */
+    jlog("ERROR: adin_thread_create: failed to initialize condition variable\n");
+    return FALSE;
+  }
   if (pthread_create(&(recog->adin->adin_thread), NULL, (void *)adin_thread_input_main, recog) != 0) {
     jlog("ERROR: adin_thread_create: failed to create AD-in thread\n");
     return FALSE;
@@ -1095,19 +1147,59 @@ adin_thread_cancel(Recog *recog)
 /* process thread functions */
 /****************************/
 
+/**
+ * <EN>
+ * Wait until A/D-in thread stores new samples or changes its status.
+ * It returns after ADIN_THREAD_WAIT_MSEC msec at longest, to call
+ * ad_check periodically.
+ * </EN>
+ * <JA>
+ * A/D-in åɤʥץ¸뤫֤ѤޤԤ. 
+ * ad_check Ū˸Ƥ֤ᡤĹ ADIN_THREAD_WAIT_MSEC ߥä. 
+ * </JA>
+ *
+ * @param a [in] AD-in work area
+ */
+static void
+adin_thread_wait(ADIn *a)
+{
+  struct timeval now;
+  struct timespec timeout;
+
+  gettimeofday(&now, NULL);
+  timeout.tv_sec = now.tv_sec;
+  timeout.tv_nsec = (now.tv_usec + ADIN_THREAD_WAIT_MSEC * 1000) * 1000;
+  if (timeout.tv_nsec >= 1000000000) {
+    timeout.tv_sec++;
+    timeout.tv_nsec -= 1000000000;
+  }
+  pthread_mutex_lock(&(a->mutex));
+  a->speech_waiting = TRUE;
+  ADIN_MEMORY_BARRIER();
+  /* status changes are signaled with the lock, and new samples are
+     signaled if speech_waiting is seen by A/D-in thread */
+  if (a->speech_wp == a->speech_rp && a->transfer_online
+      && ! a->adinthread_buffer_overflowed && ! a->adinthread_ended) {
+    pthread_cond_timedwait(&(a->cond), &(a->mutex), &timeout);
+  }
+  a->speech_waiting = FALSE;
+  pthread_mutex_unlock(&(a->mutex));
+}
+
 /**
  * <EN>
  * @brief  Main processing function for thread mode.
  *
  * It waits for the new samples to be stored in @a speech by A/D-in thread,
- * and if found, process them.  The interface are the same as adin_cut().
+ * and if found, process them and release them from the ring buffer.
+ * The interface are the same as adin_cut().
  * </EN>
  * <JA>
  * @brief  åɥ⡼ѥᥤؿ
  *
  * δؿ A/D-in åɤˤäƥץ뤬¸ΤԤ
- * ¸줿ץ缡Ƥޤ. ֤ͤ adin_cut() 
- * ƱǤ. 
+ * ¸줿ץ缡ƥ󥰥ХåեƤޤ. 
+ * ֤ͤ adin_cut() ƱǤ. 
  * </JA>
  * 
  * @param ad_process [in] function to process triggerted input.
@@ -1122,12 +1214,14 @@ adin_thread_cancel(Recog *recog)
 static int
 adin_thread_process(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Recog *recog)
 {
-  int prev_len, nowlen;
+  unsigned int rp, idx;
+  int nowlen, processed_len;
   int ad_process_ret;
   int i;
   boolean overflowed_p;
   boolean transfer_online_local;
   boolean ended_p;
+  boolean frozen_p;
   ADIn *a;
 
   a = recog->adin;
@@ -1137,21 +1231,23 @@ adin_thread_process(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Rec
   /*if (speechlen == 0) transfer_online = TRUE;*/ /* tell adin-mic thread to start recording */
   a->transfer_online = TRUE;
 #ifdef THREAD_DEBUG
-  jlog("DEBUG: process: reset, speechlen = %d, online=%d\n", a->speechlen, a->transfer_online);
+  jlog("DEBUG: process: reset, speechlen = %u, online=%d\n", a->speech_wp - a->speech_rp, a->transfer_online);
 #endif
   a->adinthread_buffer_overflowed = FALSE;
   pthread_mutex_unlock(&(a->mutex));
 
   /* main processing loop */
-  prev_len = 0;
+  processed_len = 0;
+  frozen_p = FALSE;
   for(;;) {
-    /* get current length (locking) */
-    pthread_mutex_lock(&(a->mutex));
-    nowlen = a->speechlen;
+    /* get current status, and then the samples stored before it */
     overflowed_p = a->adinthread_buffer_overflowed;
     transfer_online_local = a->transfer_online;
     ended_p = a->adinthread_ended;
-    pthread_mutex_unlock(&(a->mutex));
+    ADIN_MEMORY_BARRIER();
+    rp = a->speech_rp;
+    nowlen = (int)(a->speech_wp - rp);
+    ADIN_MEMORY_BARRIER();
     /* check if thread is alive */
     if (ended_p) {
       /* adin thread has already exited, so return EOF to stop this input */
@@ -1159,10 +1255,10 @@ adin_thread_process(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Rec
     }
     /* check if other input thread has overflowed */
     if (overflowed_p) {
-      jlog("WARNING: adin_thread_process: too long input (> %d samples), segmented now\n", MAXSPEECHLEN);
+      jlog("WARNING: adin_thread_process: input buffer overflow (> %u samples), segmented now\n", a->speechsize);
       /* segment input here */
+      a->speech_rp = rp + nowlen;
       pthread_mutex_lock(&(a->mutex));
-      a->speechlen = 0;
       a->transfer_online = transfer_online_local = FALSE;
       pthread_mutex_unlock(&(a->mutex));
       return(1);		/* return with segmented status */
@@ -1173,39 +1269,42 @@ adin_thread_process(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Rec
 	if ((i == -1 && nowlen == 0) || i == -2) {
 	  pthread_mutex_lock(&(a->mutex));
 	  a->transfer_online = transfer_online_local = FALSE;
-	  a->speechlen = 0;
 	  pthread_mutex_unlock(&(a->mutex));
+	  a->speech_rp = rp + nowlen;
 	  return(-2);
 	}
       }
     }
-    if (prev_len < nowlen && nowlen <= a->freezelen) {
+    if (nowlen > 0) {
+      /* got new sample, process */
+      /* samples between speech_rp and speech_wp would not be altered by
+	 A/D-in thread until speech_rp is moved.  Process them in place
+	 up to the end of the ring buffer. */
+      idx = rp & (a->speechsize - 1);
+      if (nowlen > (int)(a->speechsize - idx)) nowlen = a->speechsize - idx;
 #ifdef THREAD_DEBUG
-      jlog("DEBUG: process: proceed [%d-%d]\n",prev_len, nowlen);
+      jlog("DEBUG: process: proceed [%d-%d]\n", processed_len, processed_len + nowlen);
 #endif
-      /* got new sample, process */
-      /* As the speech[] buffer is monotonously increase,
-	 content of speech buffer [prev_len..nowlen] would not alter
-	 in both threads
-	 So locking is not needed while processing.
-       */
-      /*jlog("DEBUG: main: read %d-%d\n", prev_len, nowlen);*/
+      if (frozen_p || (a->freezelen >= 0 && processed_len + nowlen > a->freezelen)) {
+	/* too long input: abandon processing of the rest samples until
+	   the end of this segment, so that later samples are not joined
+	   to the processed ones */
+	frozen_p = TRUE;
+	a->speech_rp = rp + nowlen;
+	continue;
+      }
       if (ad_process != NULL) {
-	ad_process_ret = (*ad_process)(&(a->speech[prev_len]), nowlen - prev_len, recog);
+	ad_process_ret = (*ad_process)(&(a->speech[idx]), nowlen, recog);
 #ifdef THREAD_DEBUG
 	jlog("DEBUG: ad_process_ret=%d\n", ad_process_ret);
 #endif
 	switch(ad_process_ret) {
 	case 1:			/* segmented */
 	  /* segmented by callback function */
-	  /* purge processed samples and keep transfering */
+	  /* release processed samples and keep transfering */
+	  ADIN_MEMORY_BARRIER();
+	  a->speech_rp = rp + nowlen;
 	  pthread_mutex_lock(&(a->mutex));
-	  if(a->speechlen > nowlen) {
-	    memmove(a->speech, &(a->speech[nowlen]), (a->speechlen - nowlen) * sizeof(SP16));
-	    a->speechlen -= nowlen;
-	  } else {
-	    a->speechlen = 0;
-	  }
 	  a->transfer_online = transfer_online_local = FALSE;
 	  pthread_mutex_unlock(&(a->mutex));
 	  /* keep transfering */
@@ -1218,26 +1317,23 @@ adin_thread_process(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Rec
 	}
       }
       if (a->rehash) {
-	/* rehash */
-	pthread_mutex_lock(&(a->mutex));
-	if (debug2_flag) jlog("STAT: adin_cut: rehash from %d to %d\n", a->speechlen, a->speechlen - prev_len);
-	a->speechlen -= prev_len;
-	nowlen -= prev_len;
-	memmove(a->speech, &(a->speech[prev_len]), a->speechlen * sizeof(SP16));
-	pthread_mutex_unlock(&(a->mutex));
+	/* rehash: processed samples are already released, so just restart
+	   counting the input length */
+	if (debug2_flag) jlog("STAT: adin_cut: rehash from %d to %d\n", processed_len + nowlen, nowlen);
+	processed_len = 0;
 	a->rehash = FALSE;
       }
-      prev_len = nowlen;
+      processed_len += nowlen;
+      /* release the processed samples */
+      ADIN_MEMORY_BARRIER();
+      a->speech_rp = rp + nowlen;
     } else {
       if (transfer_online_local == FALSE) {
 	/* segmented by zero-cross */
-	/* reset storing buffer for next input */
-	pthread_mutex_lock(&(a->mutex));
-	a->speechlen = 0;
-	pthread_mutex_unlock(&(a->mutex));
         break;
       }
-      usleep(50000);   /* wait = 0.05sec*/            
+      /* wait for new samples */
+      adin_thread_wait(a);
     }
   }
 
@@ -1317,7 +1413,7 @@ adin_go(int (*ad_process)(SP16 *, int, Recog *), int (*ad_check)(Recog *), Recog
 boolean
 adin_standby(ADIn *a, int freq, void *arg)
 {
-  if (a->need_zmean) zmean_reset();
+  if (a->need_zmean) zmean_reset(&(a->zm));
   if (a->ad_standby != NULL) return(a->ad_standby(freq, arg));
   return TRUE;
 }
@@ -1345,7 +1441,7 @@ adin_begin(ADIn *a, char *file_or_dev_name)
   if (a->input_side_segment == FALSE) {
     a->total_captured_len = 0;
     a->last_trigger_len = 0;
-    if (a->need_zmean) zmean_reset();
+    if (a->need_zmean) zmean_reset(&(a->zm));
     if (a->ad_begin != NULL) return(a->ad_begin(file_or_dev_name));
   }
   return TRUE;
@@ -58,6 +58,12 @@
 
 #include <julius/julius.h>
 
+/**
+ * Hash function for the (frame, word) index of the word trellis.
+ * 
+ */
+#define BT_INDEX_HASH(T, W) ((unsigned int)(T) * 2654435761U ^ (unsigned int)(W) * 40503U)
+
 /** 
  * <JA>
  * ñȥꥹݻ ñȥꥹ ¤Τ(ư1¹)
@@ -81,6 +87,10 @@ bt_init(BACKTRELLIS *bt)
   bt->num  = NULL;
   bt->rw   = NULL;
   bt->list = NULL;
+  bt->chunk = bt->chunk_last = NULL;
+  bt->atomnum = 0;
+  bt->index = NULL;
+  bt->index_mask = 0;
   bt->root = NULL;
 }
 
@@ -110,6 +120,10 @@ bt_prepare(BACKTRELLIS *bt)
   bt->num = NULL;
   bt->rw = NULL;
   bt->list = NULL;
+  bt->chunk = bt->chunk_last = NULL;
+  bt->atomnum = 0;
+  bt->index = NULL;
+  bt->index_mask = 0;
   bt->root = NULL;
 }  
 
@@ -136,10 +150,13 @@ bt_free(BACKTRELLIS *bt)
 
 /** 
  * <EN>
- * Allocate a new trellis word atom.
+ * Allocate a new trellis word atom.  Atoms are appended to the last
+ * chunk in the order of generation, so the atoms of the same frame
+ * are placed contiguously.
  * </EN>
  * <JA>
- * ȥꥹñ򿷤˳դ. 
+ * ȥꥹñ򿷤˳դ. ȥꥹñ˥󥯤
+ * ɲäΤǡƱե졼ΥȥꥹñϢ³֤. 
  * </JA>
  * 
  * @param bt [out] pointer to the word trellis structure.
@@ -154,8 +171,23 @@ TRELLIS_ATOM *
 bt_new(BACKTRELLIS *bt)
 {
   TRELLIS_ATOM *new;
+  TRELLIS_CHUNK *c;
 
-  new = (TRELLIS_ATOM *)mybmalloc2(sizeof(TRELLIS_ATOM), &(bt->root));
+  c = bt->chunk_last;
+  if (c == NULL || c->num >= TRELLIS_CHUNK_ATOMNUM) {
+    c = (TRELLIS_CHUNK *)mybmalloc2(sizeof(TRELLIS_CHUNK), &(bt->root));
+    c->num = 0;
+    c->next = NULL;
+    if (bt->chunk_last == NULL) {
+      bt->chunk = c;
+    } else {
+      bt->chunk_last->next = c;
+    }
+    bt->chunk_last = c;
+  }
+  new = &(c->atom[c->num]);
+  c->num++;
+  bt->atomnum++;
   return new;
 }
 
@@ -205,7 +237,7 @@ bt_store(BACKTRELLIS *bt, TRELLIS_ATOM *tatom)
  * </JA>
  * <EN>
  * Re-locate the stored atom lists per frame (will be called after the
- * 1st pass).
+ * 1st pass).  The atoms are scanned sequentially in the chunks.
  * 
  * @param bt [i/o] word trellis structure
  * </EN>
@@ -218,7 +250,8 @@ void
 bt_relocate_rw(BACKTRELLIS *bt)
 {
   TRELLIS_ATOM *tre;
-  int t;
+  TRELLIS_CHUNK *c;
+  int t, i;
   int totalnum, n;
   TRELLIS_ATOM **tmp;
 
@@ -232,11 +265,14 @@ bt_relocate_rw(BACKTRELLIS *bt)
   /* count number of trellis atom (= survived word end) for each frame */
   for (t=0;t<bt->framelen;t++) bt->num[t] = 0;
   totalnum = 0;
-  for (tre=bt->list;tre;tre=tre->next) {
-    /* the last frame (when triggered from sp to non-sp) should be discarded */
-    if (tre->endtime >= bt->framelen) continue;
-    bt->num[tre->endtime]++;
-    totalnum++;
+  for (c=bt->chunk;c;c=c->next) {
+    for (i=0;i<c->num;i++) {
+      tre = &(c->atom[i]);
+      /* the last frame (when triggered from sp to non-sp) should be discarded */
+      if (tre->endtime >= bt->framelen) continue;
+      bt->num[tre->endtime]++;
+      totalnum++;
+    }
   }
   /* if no atom found, return here with all bt->num[t] set to 0 */
   if (totalnum <= 0) {
@@ -256,13 +292,16 @@ bt_relocate_rw(BACKTRELLIS *bt)
   }
   /* then store the atoms */
   for (t=0;t<bt->framelen;t++) bt->num[t] = 0;
-  for (tre=bt->list;tre;tre=tre->next) {
-    /* the last frame (when triggered from sp to non-sp) should be discarded */
-    if (tre->endtime >= bt->framelen) continue;
-    t = tre->endtime;
-    
-    bt->rw[t][bt->num[t]] = tre;
-    bt->num[t]++;
+  for (c=bt->chunk;c;c=c->next) {
+    for (i=0;i<c->num;i++) {
+      tre = &(c->atom[i]);
+      /* the last frame (when triggered from sp to non-sp) should be discarded */
+      if (tre->endtime >= bt->framelen) continue;
+      t = tre->endtime;
+      
+      bt->rw[t][bt->num[t]] = tre;
+      bt->num[t]++;
+    }
   }
 }
 
@@ -585,4 +624,129 @@ bt_binsearch_atom(BACKTRELLIS *bt, int t, WORD_ID wkey)
   }
 }
 
+/** 
+ * <JA>
+ * bt_sort_rw() λ, (ե졼, ñID) ȥꥹñ֤
+ * 褦ˡץ󥢥ɥ쥹ˡΥϥå. 
+ * Ʊñ줬ʣϡȸƬΰ֤Ͽ. 
+ * 
+ * @param bt [i/o] ñȥꥹ¤
+ * </JA>
+ * <EN>
+ * Build an open-addressing hash index from (frame, word ID) to the
+ * position on the per-frame trellis word list, for constant-time lookup
+ * on the 2nd pass.  When the same word appears more than once on a frame,
+ * the first position on the sorted list is registered.  This should be
+ * called just after bt_sort_rw().
+ * 
+ * @param bt [i/o] word trellis structure
+ * </EN>
+ *
+ * @callergraph
+ * @callgraph
+ * 
+ */
+void
+bt_make_index(BACKTRELLIS *bt)
+{
+  unsigned int size, h;
+  int t, i;
+  TRELLIS_ATOM **p;
+
+  bt->index = NULL;
+  bt->index_mask = 0;
+  if (bt->num == NULL) return;
+
+  /* table size: power of 2, at least twice the number of atoms */
+  for (size = 2; size < (unsigned int)bt->atomnum * 2; size <<= 1);
+  bt->index = (TRELLIS_ATOM ***)mybmalloc2(sizeof(TRELLIS_ATOM **) * size, &(bt->root));
+  memset(bt->index, 0, sizeof(TRELLIS_ATOM **) * size);
+  bt->index_mask = size - 1;
+
+  for (t=0;t<bt->framelen;t++) {
+    for (i=0;i<bt->num[t];i++) {
+      p = &(bt->rw[t][i]);
+      /* register only the first one of the same words */
+      if (i > 0 && bt->rw[t][i-1]->wid == (*p)->wid) continue;
+      h = BT_INDEX_HASH(t, (*p)->wid) & bt->index_mask;
+      while (bt->index[h] != NULL) h = (h + 1) & bt->index_mask;
+      bt->index[h] = p;
+    }
+  }
+}
+
+/** 
+ * <JA>
+ * ñȥꥹλե졼ˡñνü뤫ɤ
+ * . bt_make_index() Ǻ줿Ѥ. ̵
+ * bt_binsearch_atom() Ʊ. 
+ * 
+ * @param bt [in] ñȥꥹ¤
+ * @param t [in] 뽪üʥե졼
+ * @param wkey [in] ññɣ
+ * 
+ * @return Ĥä礽ΥȥꥹñؤΥݥ󥿡Ĥʤ NULL. 
+ * </JA>
+ * <EN>
+ * Search a word on the specified frame in a word trellis data, using
+ * the index built by bt_make_index().  Falls back to bt_binsearch_atom()
+ * if the index has not been built.
+ * 
+ * @param bt [in] word trellis structure
+ * @param t [in] word end frame on which to search
+ * @param wkey [in] word ID to search
+ * 
+ * @return pointer to the found trellis word, or NULL if not found.
+ * </EN>
+ *
+ * @callergraph
+ * @callgraph
+ * 
+ */
+TRELLIS_ATOM *
+bt_lookup_atom(BACKTRELLIS *bt, int t, WORD_ID wkey)
+{
+  unsigned int h;
+  TRELLIS_ATOM **p;
+#ifdef WPAIR
+  TRELLIS_ATOM **end;
+  LOGPROB maxscore;
+  TRELLIS_ATOM *maxtre;
+#endif
+
+  if (bt->index == NULL) return(bt_binsearch_atom(bt, t, wkey));
+
+  h = BT_INDEX_HASH(t, wkey) & bt->index_mask;
+  while ((p = bt->index[h]) != NULL) {
+    if ((*p)->wid == wkey && (*p)->endtime == t) break;
+    h = (h + 1) & bt->index_mask;
+  }
+  if (p == NULL) return(NULL);
+
+#ifdef WPAIR
+  /* same word with different context will be found:
+     most likely one will be returned */
+  maxscore = LOG_ZERO;
+  maxtre = NULL;
+  end = &(bt->rw[t][bt->num[t]]);
+  for (; p < end && (*p)->wid == wkey; p++) {
+#ifdef WORD_GRAPH
+    /* only words on a graph path should be counted */
+    if (!(*p)->within_wordgraph) continue;
+#endif
+    if (maxscore < (*p)->backscore) {
+      maxscore = (*p)->backscore;
+      maxtre = *p;
+    }
+  }
+  return(maxtre);
+#else
+#ifdef WORD_GRAPH
+  /* treat only words on a graph path */
+  if (! (*p)->within_wordgraph) return(NULL);
+#endif
+  return(*p);
+#endif /* WPAIR */
+}
+
 /* end of file */
@@ -1855,7 +1855,7 @@ get_back_trellis_init(HTK_Param *param,	RecogProcess *r)
 
   /* ϤԤʤΥ󥿡Х׻ */
   /* set interval frame for progout */
-  r->config->output.progout_interval_frame = (int)((float)r->config->output.progout_interval / ((float)param->header.wshift / 10000.0));
+  d->progout_interval_frame = (int)((float)r->config->output.progout_interval / ((float)param->header.wshift / 10000.0));
 
   if (r->config->successive.enabled) {
     /* 硼ȥݡơѥѥ᡼ν */
@@ -1884,6 +1884,14 @@ get_back_trellis_init(HTK_Param *param,	RecogProcess *r)
   d->score_pruning_threshold = LOG_ZERO;
   d->score_pruning_count = 0;
 #endif
+#ifdef WORDEND_PRUNING
+  d->wordend_pruning_threshold = LOG_ZERO;
+  d->wordend_pruning_count = 0;
+  d->wordend_pruning_total = 0;
+  d->lmla_pruning_threshold = LOG_ZERO;
+  d->lmla_pruning_count = 0;
+  d->lmla_pruning_total = 0;
+#endif
 
   return TRUE;
 }
@@ -2044,6 +2052,14 @@ beam_intra_word_core(WCHMM_INFO *wchmm, FSBeam *d, TOKEN2 **tk_ret, int j, int n
 	     score, and then add the new LM value computed above. */
 	  tmpsum -= tk->last_lscore;
 	  tmpsum += ngram_score_cache;
+#ifdef WORDEND_PRUNING
+	  /* LMɤߥӡ: Υӡ೰ʤ¤ʤ */
+	  /* LM look-ahead beam: drop if the updated score is out of beam */
+	  if (tmpsum < d->lmla_pruning_threshold) {
+	    d->lmla_pruning_count++;
+	    return;
+	  }
+#endif
 	}
 	
 	if (wchmm->lmtype == LM_DFA && wchmm->lmvar == LM_DFA_GRAMMAR) {
@@ -2570,6 +2586,111 @@ beam_inter_word_factoring(WCHMM_INFO *wchmm, FSBeam *d)
 
 #endif /* UNIGRAM_FACTORING */
 
+#ifdef WORDEND_PRUNING
+
+/** 
+ * <JA>
+ * @brief  ñ콪üӡͤ. 
+ *
+ * ե졼ñܤԤñ콪üȡΥĴ١
+ *  N  (-bw) Ⱥ祹 (-bws) ξ㥹
+ * d->wordend_pruning_threshold ˥åȤ. Ʊñ콪ü
+ * ٤ƻĤᡤNĤĶ뤳Ȥ. 
+ * 
+ * @param r [i/o] ǧ󥹥
+ * @param tt [in] ñ콪üȡĥꥢID (0 ޤ 1)
+ * </JA>
+ * <EN>
+ * @brief  Set threshold of the word-end beam for the current frame.
+ *
+ * This function scans the word-end tokens in the beam that are going to
+ * be expanded to the next words at this frame, and sets the lowest score
+ * allowed by both the rank width (-bw) and the score width from the best
+ * word end (-bws) to d->wordend_pruning_threshold.  Word ends of the same
+ * score as the N-th one are all kept, so more than N may survive.
+ * 
+ * @param r [i/o] recognition process instance
+ * @param tt [in] work area id that holds the word-end tokens (0 or 1)
+ * </EN>
+ */
+static void
+set_wordend_pruning_threshold(RecogProcess *r, int tt)
+{
+  WCHMM_INFO *wchmm;
+  FSBeam *d;
+  TOKEN2 *tk;
+  LOGPROB *x;
+  LOGPROB score, maxscore, pivot, tmp;
+  int rankwidth;
+  int j, n, k, left, right, i, l;
+
+  wchmm = r->wchmm;
+  d = &(r->pass1);
+  rankwidth = r->config->pass1.wordend_beam_width;
+
+  d->wordend_pruning_threshold = LOG_ZERO;
+  if (rankwidth <= 0 && r->config->pass1.wordend_score_width < 0.0) return;
+
+  /* ΰ */
+  /* prepare work area */
+  n = d->n_end - d->n_start + 1;
+  if (n <= 0) return;
+  if (d->wordend_score_alloc < n) {
+    if (d->wordend_score != NULL) free(d->wordend_score);
+    d->wordend_score_alloc = n;
+    d->wordend_score = (LOGPROB *)mymalloc(sizeof(LOGPROB) * d->wordend_score_alloc);
+  }
+  x = d->wordend_score;
+
+  /* ñ콪üФ륹򽸤 */
+  /* collect outgoing scores of word ends */
+  n = 0;
+  maxscore = LOG_ZERO;
+  for (j = d->n_start; j <= d->n_end; j++) {
+    tk = &(d->tlist[tt][d->tindex[tt][j]]);
+    if (tk->score <= LOG_ZERO) continue;
+    if (wchmm->stend[tk->node] == WORD_INVALID) continue;
+#ifdef SCORE_PRUNING
+    if (tk->score < d->score_pruning_threshold) continue;
+#endif
+    score = tk->score;
+    if (!wchmm->hmminfo->multipath) score += wchmm->wordend_a[wchmm->stend[tk->node]];
+    if (maxscore < score) maxscore = score;
+    x[n++] = score;
+  }
+  if (n == 0) return;
+
+  if (r->config->pass1.wordend_score_width >= 0.0) {
+    d->wordend_pruning_threshold = maxscore - r->config->pass1.wordend_score_width;
+  }
+
+  if (rankwidth > 0 && n > rankwidth) {
+    /*  rankwidth ܤΥ (߽ quickselect) */
+    /* find the rankwidth-th best score by quickselect in descending order */
+    k = rankwidth - 1;
+    left = 0;
+    right = n - 1;
+    while (left < right) {
+      pivot = x[(left + right) / 2];
+      i = left;
+      l = right;
+      do {
+	while (x[i] > pivot) i++;
+	while (pivot > x[l]) l--;
+	if (i <= l) {
+	  tmp = x[i]; x[i] = x[l]; x[l] = tmp;
+	  i++; l--;
+	}
+      } while (i <= l);
+      if (l < k) left = i;
+      if (k < i) right = l;
+    }
+    if (d->wordend_pruning_threshold < x[k]) d->wordend_pruning_threshold = x[k];
+  }
+}
+
+#endif /* WORDEND_PRUNING */
+
 
 /** 
  * <JA>
@@ -2726,6 +2847,14 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
     /*******************************************************/
     sort_token_no_order(d, r->trellis_beam_width, &(d->n_start), &(d->n_end));
   
+#ifdef WORDEND_PRUNING
+    /* ñ콪üӡͤ */
+    /* determine threshold of word-end beam */
+    if (!final_for_multipath && lmvar != LM_DFA_WORD) {
+      set_wordend_pruning_threshold(r, tn);
+    }
+#endif
+
     /*************************/
     /* 2.3. ñViterbi׻  */
     /*    cross-word viterbi */
@@ -2761,6 +2890,14 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
 	if (final_for_multipath) continue;
 	/* ñǧ⡼ɤǤñܤɬפʤ */
 	if (lmvar == LM_DFA_WORD) continue;
+#ifdef WORDEND_PRUNING
+	/* ñ콪üӡ೰ñ콪üñܤʤ */
+	/* word ends out of word-end beam will not be expanded */
+	if (tk->score < d->wordend_pruning_threshold) {
+	  d->wordend_pruning_count++;
+	  continue;
+	}
+#endif
 
 	/******************************/
 	/* 2.5. ñ            */
@@ -2788,6 +2925,14 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
     /* NORMAL MODE */
     /*********************************/
 
+#ifdef WORDEND_PRUNING
+    /* ñ콪üӡͤ */
+    /* determine threshold of word-end beam */
+    if (lmvar != LM_DFA_WORD) {
+      set_wordend_pruning_threshold(r, tl);
+    }
+#endif
+
     for (j = d->n_start; j <= d->n_end; j++) {
       /* tk: оݥȡ  node: Υȡڹ¤ΡID */
       /* tk: token data  node: lexicon tree node ID that holds the 'tk' */
@@ -2826,6 +2971,14 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
 #endif
 	/* ñǧ⡼ɤǤñܤɬפʤ */
 	if (lmvar == LM_DFA_WORD) continue;
+#ifdef WORDEND_PRUNING
+	/* ñ콪üӡ೰ñ콪üñܤʤ */
+	/* word ends out of word-end beam will not be expanded */
+	if (tk->score + wchmm->wordend_a[wchmm->stend[node]] < d->wordend_pruning_threshold) {
+	  d->wordend_pruning_count++;
+	  continue;
+	}
+#endif
 
 	/******************************/
 	/* 2.3. ñ            */
@@ -2911,6 +3064,15 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
     // disable score pruning
     d->score_pruning_threshold = LOG_ZERO;
   }
+#endif
+#ifdef WORDEND_PRUNING
+  /* LMɤߥӡͤ򼡥ե졼Τ˥å */
+  /* set threshold of LM look-ahead beam for the next frame */
+  if (r->config->pass1.lmla_score_width >= 0.0) {
+    d->lmla_pruning_threshold = d->score_pruning_max - r->config->pass1.lmla_score_width;
+  } else {
+    d->lmla_pruning_threshold = LOG_ZERO;
+  }
 #endif
   /*******************************************************/
   /* 4. ǥȡ򥽡Ȥӡʬξ̤ */
@@ -2938,7 +3100,7 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
       if (r->config->output.progout_flag) {
 	/* : ե졼Υ٥ȥѥ֤˾񤭽 */
 	/* progressive result output: output current best path in certain time interval */
-	if (((t-1) % r->config->output.progout_interval_frame) == 0) {
+	if (((t-1) % r->pass1.progout_interval_frame) == 0) {
 	  r->have_interim = TRUE;
 	  bt_current_max(r, t-1);
 	}
@@ -2949,6 +3111,9 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
     /* for debug: output current max word */
     if (debug2_flag) {
       bt_current_max_word(r, t-1);
+#ifdef WORDEND_PRUNING
+      jlog("DEBUG: %3d: %d word ends pruned by word-end beam, %d tokens pruned by LM look-ahead beam\n", t, d->wordend_pruning_count, d->lmla_pruning_count);
+#endif
     }
 
 #ifdef DETERMINE
@@ -2960,6 +3125,13 @@ get_back_trellis_proceed(int t, HTK_Param *param, RecogProcess *r, boolean final
 #ifdef SPSEGMENT_NAIST
   }
 #endif
+
+#ifdef WORDEND_PRUNING
+  d->wordend_pruning_total += d->wordend_pruning_count;
+  d->lmla_pruning_total += d->lmla_pruning_count;
+  d->wordend_pruning_count = 0;
+  d->lmla_pruning_count = 0;
+#endif
     
   /* ӡΡɿ 0 ˤʤäƤޤä顤λ */
   if (d->tnum[tn] == 0) {
@@ -3041,6 +3213,12 @@ get_back_trellis_end(HTK_Param *param, RecogProcess *r)
 #ifdef SCORE_PRUNING
   if (debug2_flag) jlog("STAT: %d tokens pruned by score beam\n", d->score_pruning_count);
 #endif
+#ifdef WORDEND_PRUNING
+  if (debug2_flag) {
+    jlog("STAT: %d word ends pruned by word-end beam\n", d->wordend_pruning_total);
+    jlog("STAT: %d tokens pruned by LM look-ahead beam\n", d->lmla_pruning_total);
+  }
+#endif
     
 }
 
@@ -3096,6 +3274,7 @@ finalize_1st_pass(RecogProcess *r, int len)
 
   bt_relocate_rw(backtrellis);
   bt_sort_rw(backtrellis);
+  bt_make_index(backtrellis);
   if (backtrellis->num == NULL) {
     if (backtrellis->framelen > 0) {
       jlog("WARNING: %02d %s: input processed, but no survived word found\n", r->config->id, r->config->name);
@@ -3132,6 +3311,13 @@ void
 fsbeam_free(FSBeam *d)
 {
   free_nodes(d);
+#ifdef WORDEND_PRUNING
+  if (d->wordend_score != NULL) {
+    free(d->wordend_score);
+    d->wordend_score = NULL;
+    d->wordend_score_alloc = 0;
+  }
+#endif
   if (d->pausemodelnames != NULL) {
     free(d->pausemodelnames);
     free(d->pausemodel);
@@ -70,6 +70,8 @@ jconf_set_default_values(Jconf *j)
 #ifdef USE_NETAUDIO
   j->input.netaudio_devname		= NULL;
 #endif
+  j->input.shm_name			= NULL;
+  j->input.vecin_shm			= FALSE;
   j->input.paramtype_check_flag		= TRUE;
 
   j->detect.level_thres			= 2000;
@@ -198,6 +200,8 @@ jconf_set_default_values_lm(JCONF_LM *j)
   strcpy(j->wordrecog_tail_silence_model_name, "silE");
   j->wordrecog_silence_context_name[0] = '\0';
   strcpy(j->unknown_name, UNK_WORD_DEFAULT); // or UNK_WORD_DEFAULT2
+  j->ngram_memo_bits			= 0;
+  j->ngram_read_thread			= 0;
   j->additional_dict_files		= NULL;
   j->additional_dict_entries		= NULL;
 }
@@ -242,6 +246,11 @@ jconf_set_default_values_search(JCONF_SEARCH *j)
 #ifdef SCORE_PRUNING
   j->pass1.score_pruning_width		= -1.0;
 #endif
+#ifdef WORDEND_PRUNING
+  j->pass1.wordend_beam_width		= -1;
+  j->pass1.wordend_score_width		= -1.0;
+  j->pass1.lmla_score_width		= -1.0;
+#endif
 #if defined(WPAIR) && defined(WPAIR_KEEP_NLIMIT)
   j->pass1.wpair_keep_nlimit		= 3;
 #endif
@@ -267,6 +276,12 @@ jconf_set_default_values_search(JCONF_SEARCH *j)
   j->pass2.stack_size		= 500;
   j->pass2.lookup_range		= 5;
   j->pass2.looktrellis_flag	= FALSE; /* dfa */
+#ifdef PASS2_THREAD
+  j->pass2.thread_num		= 0;
+#endif
+#ifdef SCAN_CACHE
+  j->pass2.scan_cache_size	= 0;
+#endif
 
   j->graph.enabled			= FALSE;
   j->graph.lattice			= FALSE;
@@ -31,7 +31,7 @@
 #undef GDEBUG2
 
 #if defined(GDEBUG) || defined(GDEBUG2)
-static WCHMM_INFO *wchmm_local;	///< Local copy, just for debug
+static THREAD_LOCAL WCHMM_INFO *wchmm_local;	///< Local copy, just for debug
 #endif
 
 /** 
@@ -162,8 +162,9 @@ j_process_am_free(PROCESS_AM *am)
 {
   /* HMMWork hmmwrk */
   outprob_free(&(am->hmmwrk));
-  if (am->hmminfo) hmminfo_free(am->hmminfo);
-  if (am->hmm_gs) hmminfo_free(am->hmm_gs);
+  /* models may be shared with other engine instances */
+  if (am->hmminfo && j_model_unref(am->hmminfo)) hmminfo_free(am->hmminfo);
+  if (am->hmm_gs && j_model_unref(am->hmm_gs)) hmminfo_free(am->hmm_gs);
   /* not free am->jconf  */
   free(am);
 }
@@ -201,6 +202,7 @@ j_process_lm_new(Recog *recog, JCONF_LM *lmconf)
   new->lmvar = lmconf->lmvar;
   new->gram_maxid = 0;
   new->global_modified = FALSE;
+  new->global_rebuilt = FALSE;
 
   /* append to last */
   new->next = NULL;
@@ -230,10 +232,12 @@ j_process_lm_new(Recog *recog, JCONF_LM *lmconf)
 void
 j_process_lm_free(PROCESS_LM *lm)
 {
-  if (lm->winfo) word_info_free(lm->winfo);
-  if (lm->ngram) ngram_info_free(lm->ngram);
+  /* models may be shared with other engine instances */
+  if (lm->winfo && j_model_unref(lm->winfo)) word_info_free(lm->winfo);
+  if (lm->ngram && j_model_unref(lm->ngram)) ngram_info_free(lm->ngram);
   if (lm->grammars) multigram_free_all(lm->grammars);
   if (lm->dfa) dfa_info_free(lm->dfa);
+  if (lm->memo) ngram_memo_free(lm);
   /* not free lm->jconf  */
   free(lm);
 }
@@ -821,7 +825,7 @@ j_recog_new()
 void
 j_recog_free(Recog *recog)
 {
-  if (recog->gmm) hmminfo_free(recog->gmm);
+  if (recog->gmm && j_model_unref(recog->gmm)) hmminfo_free(recog->gmm);
 
   if (recog->speech) free(recog->speech);
 
@@ -878,7 +882,7 @@ j_recog_free(Recog *recog)
   }
 
   /* jconf */
-  if (recog->jconf) {
+  if (recog->jconf && j_model_unref(recog->jconf)) {
     j_jconf_free(recog->jconf);
   }
 
@@ -161,6 +161,19 @@ adin_select(ADIn *a, int source, int dev)
     a->silence_cut_default = FALSE;
     a->enable_thread 	   = FALSE;
     break;
+  case SP_SHM:
+    /* shared memory input */
+    a->ad_standby 	   = adin_shm_standby;
+    a->ad_begin 	   = adin_shm_begin;
+    a->ad_end 		   = adin_shm_end;
+    a->ad_resume	   = NULL;
+    a->ad_pause		   = NULL;
+    a->ad_terminate	   = NULL;
+    a->ad_read 		   = adin_shm_read;
+    a->ad_input_name	   = adin_shm_input_name;
+    a->silence_cut_default = FALSE;
+    a->enable_thread 	   = FALSE;
+    break;
   case SP_STDIN:
     /* standard input */
     a->ad_standby 	   = adin_stdin_standby;
@@ -323,6 +336,10 @@ adin_initialize(Recog *recog)
     case SP_STDIN:
       arg = NULL;
       break;
+    case SP_SHM:		/* arg: name of shared memory segment */
+      arg = mymalloc(strlen(jconf->input.shm_name)+1);
+      strcpy(arg, jconf->input.shm_name);
+      break;
 #ifdef USE_NETAUDIO
     case SP_NETAUDIO:		/* netaudio server/port name */
       arg = mymalloc(strlen(jconf->input.netaudio_devname)+1);
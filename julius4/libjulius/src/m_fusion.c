@@ -452,6 +452,7 @@ initialize_ngram(JCONF_LM *lmconf, WORD_INFO *winfo)
 
   /* allocate new */
   ngram = ngram_info_new();
+  ngram->read_thread_num = lmconf->ngram_read_thread;
   /* load LM */
   if (lmconf->ngram_filename != NULL) {	/* binary format */
     ret = init_ngram_bin(ngram, lmconf->ngram_filename);
@@ -681,6 +682,7 @@ j_load_lm(Recog *recog, JCONF_LM *lmconf)
     /* the whole lexicon will be forced to built in the boot sequence,
        so reset the global modification flag here */
     lm->global_modified = FALSE;
+    lm->global_rebuilt = FALSE;
   }
   
   jlog("STAT: *** LM%02d %s loaded\n", lmconf->id, lmconf->name);
@@ -994,9 +996,10 @@ create_mfcc_calc_instances(Recog *recog)
 boolean
 j_launch_recognition_instance(Recog *recog, JCONF_SEARCH *sconf)
 {
-  RecogProcess *p;
+  RecogProcess *p, *ptmp;
   PROCESS_AM *am;
   PROCESS_LM *lm;
+  WCHMM_INFO *src;
 
   jlog("STAT: composing recognizer instance SR%02d %s (AM%02d %s, LM%02d %s)\n", sconf->id, sconf->name, sconf->amconf->id, sconf->amconf->name, sconf->lmconf->id, sconf->lmconf->name);
 
@@ -1140,27 +1143,50 @@ j_launch_recognition_instance(Recog *recog, JCONF_SEARCH *sconf)
   }
 
   if (p->lmtype == LM_PROB) {
-    /* build wchmm with N-gram */
-    p->wchmm = wchmm_new();
-    p->wchmm->lmtype = p->lmtype;
-    p->wchmm->lmvar  = p->lmvar;
-    p->wchmm->ccd_flag = p->ccd_flag;
-    p->wchmm->category_tree = FALSE;
-    p->wchmm->hmmwrk = &(p->am->hmmwrk);
-    /* assign models */
-    p->wchmm->ngram = p->lm->ngram;
-    if (p->lmvar == LM_NGRAM_USER) {
-      /* register LM functions for 1st pass here */
-      p->wchmm->uni_prob_user = p->lm->lmfunc.uniprob;
-      p->wchmm->bi_prob_user = p->lm->lmfunc.biprob;
+    src = NULL;
+    if (recog->model_source != NULL) {
+      /* find the lexicon of the same search config in the source instance */
+      for(ptmp=recog->model_source->process_list;ptmp;ptmp=ptmp->next) {
+	if (ptmp->config == sconf && ptmp->lmtype == LM_PROB) src = ptmp->wchmm;
+      }
     }
-    p->wchmm->winfo = p->lm->winfo;
-    p->wchmm->hmminfo = p->am->hmminfo;
-    if (p->wchmm->category_tree) {
-      if (p->config->pass1.old_tree_function_flag) {
-	if (build_wchmm(p->wchmm, p->lm->config) == FALSE) {
-	  jlog("ERROR: m_fusion: error in bulding wchmm\n");
-	  return FALSE;
+    if (src != NULL) {
+      /* share the tree lexicon, with work areas of its own */
+      jlog("STAT: SR%02d %s: share tree lexicon with the source instance\n", sconf->id, sconf->name);
+      p->wchmm = wchmm_new_shared(src);
+      p->wchmm->hmmwrk = &(p->am->hmmwrk);
+      if (p->lmvar == LM_NGRAM_USER) {
+	p->wchmm->uni_prob_user = p->lm->lmfunc.uniprob;
+	p->wchmm->bi_prob_user = p->lm->lmfunc.biprob;
+      }
+    } else {
+      /* build wchmm with N-gram */
+      p->wchmm = wchmm_new();
+      p->wchmm->lmtype = p->lmtype;
+      p->wchmm->lmvar  = p->lmvar;
+      p->wchmm->ccd_flag = p->ccd_flag;
+      p->wchmm->category_tree = FALSE;
+      p->wchmm->hmmwrk = &(p->am->hmmwrk);
+      /* assign models */
+      p->wchmm->ngram = p->lm->ngram;
+      if (p->lmvar == LM_NGRAM_USER) {
+	/* register LM functions for 1st pass here */
+	p->wchmm->uni_prob_user = p->lm->lmfunc.uniprob;
+	p->wchmm->bi_prob_user = p->lm->lmfunc.biprob;
+      }
+      p->wchmm->winfo = p->lm->winfo;
+      p->wchmm->hmminfo = p->am->hmminfo;
+      if (p->wchmm->category_tree) {
+	if (p->config->pass1.old_tree_function_flag) {
+	  if (build_wchmm(p->wchmm, p->lm->config) == FALSE) {
+	    jlog("ERROR: m_fusion: error in bulding wchmm\n");
+	    return FALSE;
+	  }
+	} else {
+	  if (build_wchmm2(p->wchmm, p->lm->config) == FALSE) {
+	    jlog("ERROR: m_fusion: error in bulding wchmm\n");
+	    return FALSE;
+	  }
 	}
       } else {
 	if (build_wchmm2(p->wchmm, p->lm->config) == FALSE) {
@@ -1168,16 +1194,11 @@ j_launch_recognition_instance(Recog *recog, JCONF_SEARCH *sconf)
 	  return FALSE;
 	}
       }
-    } else {
-      if (build_wchmm2(p->wchmm, p->lm->config) == FALSE) {
-	jlog("ERROR: m_fusion: error in bulding wchmm\n");
-	return FALSE;
-      }
-    }
 
-    /* ư -check ǥå⡼ɤ */
-    if (p->config->sw.wchmm_check_flag) {
-      wchmm_check_interactive(p->wchmm);
+      /* ư -check ǥå⡼ɤ */
+      if (p->config->sw.wchmm_check_flag) {
+	wchmm_check_interactive(p->wchmm);
+      }
     }
 
     /* set beam width */
@@ -1447,6 +1468,12 @@ j_reload_adddict(Recog *recog, PROCESS_LM *lm)
   
   jlog("STAT: *** reloading (additional) dictionary of LM%02d %s\n", lm->config->id, lm->config->name);
 
+  /* dictionary and N-gram shared with other instances should not change */
+  if (j_model_is_shared(lm->winfo) || j_model_is_shared(lm->ngram)) {
+    jlog("ERROR: m_fusion: LM%02d %s is shared with other engine instances, cannot reload dictionary\n", lm->config->id, lm->config->name);
+    return FALSE;
+  }
+
   /* free current dictionary */
   if (lm->winfo) word_info_free(lm->winfo);
   if (lm->grammars) multigram_free_all(lm->grammars);
@@ -1492,6 +1519,7 @@ j_reload_adddict(Recog *recog, PROCESS_LM *lm)
     /* the whole lexicon will be forced to built in the boot sequence,
        so reset the global modification flag here */
     lm->global_modified = FALSE;
+    lm->global_rebuilt = FALSE;
   }
 
   /* re-create all recognition process instance */
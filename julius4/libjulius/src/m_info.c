@@ -477,6 +477,11 @@ print_engine_info(Recog *recog)
       put_voca(fp, lm->winfo, lm->winfo->head_silwid);
       jlog("\t(-siltail)tail sil word = ");
       put_voca(fp, lm->winfo, lm->winfo->tail_silwid);
+      if (lm->config->ngram_memo_bits > 0) {
+	jlog("\t(-ngrammemo)prob. memo  = %d entries\n", 1 << lm->config->ngram_memo_bits);
+      } else {
+	jlog("\t(-ngrammemo)prob. memo  = disabled\n");
+      }
     }
 
     if (lm->lmvar == LM_DFA_WORD) {
@@ -599,6 +604,23 @@ print_engine_info(Recog *recog)
     } else {
       jlog("\t(-bs)score pruning thres= %f\n", r->config->pass1.score_pruning_width);
     }
+#endif
+#ifdef WORDEND_PRUNING
+    if (r->config->pass1.wordend_beam_width < 0) {
+      jlog("\t(-bw)  word-end beam num= disabled\n");
+    } else {
+      jlog("\t(-bw)  word-end beam num= %d\n", r->config->pass1.wordend_beam_width);
+    }
+    if (r->config->pass1.wordend_score_width < 0.0) {
+      jlog("\t(-bws)    word-end thres= disabled\n");
+    } else {
+      jlog("\t(-bws)    word-end thres= %f\n", r->config->pass1.wordend_score_width);
+    }
+    if (r->config->pass1.lmla_score_width < 0.0) {
+      jlog("\t(-bls)LM lookahead thres= disabled\n");
+    } else {
+      jlog("\t(-bls)LM lookahead thres= %f\n", r->config->pass1.lmla_score_width);
+    }
 #endif
     jlog("\t(-n)search candidate num= %d\n", r->config->pass2.nbest);
     jlog("\t(-s)  search stack size = %d\n", r->config->pass2.stack_size);
@@ -621,6 +643,20 @@ print_engine_info(Recog *recog)
       jlog("\t(-b2)  pass2 beam width = %d\n", r->config->pass2.enveloped_bestfirst_width);
     }
     jlog("\t(-lookuprange)lookup range= %d  (tm-%d <= t <tm+%d)\n",r->config->pass2.lookup_range,r->config->pass2.lookup_range,r->config->pass2.lookup_range);
+#ifdef PASS2_THREAD
+    if (r->lmtype == LM_PROB && r->pass2.thread_num > 1) {
+      jlog("\t(-pass2thread) expansion= %d threads\n", r->pass2.thread_num);
+    } else {
+      jlog("\t(-pass2thread) expansion= single thread\n");
+    }
+#endif
+#ifdef SCAN_CACHE
+    if (r->lmtype == LM_DFA && r->config->pass2.scan_cache_size > 0) {
+      jlog("\t(-scancache)  scan cache= %d MB\n", r->config->pass2.scan_cache_size);
+    } else {
+      jlog("\t(-scancache)  scan cache= disabled\n");
+    }
+#endif
 #ifdef SCAN_BEAM
     jlog("\t(-sb)2nd scan beamthres = %.1f (in logscore)\n", r->config->pass2.scan_beam_thres);
 #endif
@@ -847,11 +883,17 @@ print_engine_info(Recog *recog)
       jlog("%s\n", jconf->input.inputlist_filename);
     }
   } else if (jconf->input.speech_input == SP_MFCMODULE) {
-    jlog("vector input module (feature or outprob)\n");
+    if (jconf->input.vecin_shm) {
+      jlog("vector input on shared memory \"%s\" (feature or outprob)\n", jconf->input.shm_name);
+    } else {
+      jlog("vector input module (feature or outprob)\n");
+    }
   } else if (jconf->input.speech_input == SP_STDIN) {
     jlog("standard input\n");
   } else if (jconf->input.speech_input == SP_ADINNET) {
     jlog("adinnet client\n");
+  } else if (jconf->input.speech_input == SP_SHM) {
+    jlog("shared memory \"%s\"\n", jconf->input.shm_name);
 #ifdef USE_NETAUDIO
   } else if (jconf->input.speech_input == SP_NETAUDIO) {
     char *p;
@@ -876,7 +918,7 @@ print_engine_info(Recog *recog)
     }
   }
   if (jconf->input.type == INPUT_WAVEFORM) {
-    if (jconf->input.speech_input == SP_RAWFILE || jconf->input.speech_input == SP_STDIN || jconf->input.speech_input == SP_ADINNET) {
+    if (jconf->input.speech_input == SP_RAWFILE || jconf->input.speech_input == SP_STDIN || jconf->input.speech_input == SP_ADINNET || jconf->input.speech_input == SP_SHM) {
       if (jconf->input.use_ds48to16) {
 	jlog("\t          sampling freq. = assume 48000Hz, then down to %dHz\n", jconf->input.sfreq);
       } else {
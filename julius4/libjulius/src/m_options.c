@@ -339,6 +339,15 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
 	jconf->input.type = INPUT_WAVEFORM;
 	jconf->input.speech_input = SP_ADINNET;
 	jconf->decodeopt.realtime_flag = TRUE;
+      } else if (strmatch(tmparg,"shm")) {
+#ifdef HAVE_SHM_OPEN
+	jconf->input.type = INPUT_WAVEFORM;
+	jconf->input.speech_input = SP_SHM;
+	jconf->decodeopt.realtime_flag = TRUE;
+#else
+	jlog("ERROR: m_options: \"-input shm\": shared memory support is not built-in\n");
+	return FALSE;
+#endif
 #ifdef USE_NETAUDIO
       } else if (strmatch(tmparg,"netaudio")) {
 	jconf->input.type = INPUT_WAVEFORM;
@@ -396,7 +405,19 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
 	jconf->input.plugin_source = -1;
 	jconf->input.type = INPUT_VECTOR;
 	jconf->input.speech_input = SP_MFCMODULE;
+	jconf->input.vecin_shm = FALSE;
+	jconf->decodeopt.realtime_flag = FALSE;
+      } else if (strmatch(tmparg,"vecshm")) {
+#ifdef HAVE_SHM_OPEN
+	jconf->input.plugin_source = -1;
+	jconf->input.type = INPUT_VECTOR;
+	jconf->input.speech_input = SP_MFCMODULE;
+	jconf->input.vecin_shm = TRUE;
 	jconf->decodeopt.realtime_flag = FALSE;
+#else
+	jlog("ERROR: m_options: \"-input vecshm\": shared memory support is not built-in\n");
+	return FALSE;
+#endif
 #ifdef ENABLE_PLUGIN
       } else if ((sid = plugin_find_optname("adin_get_optname", tmparg)) != -1) { /* adin plugin */
 	jconf->input.plugin_source = sid;
@@ -503,6 +524,29 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       GET_TMPARG;
       jconf->searchnow->pass2.lookup_range = atoi(tmparg);
       continue;
+    } else if (strmatch(argv[i],"-pass2thread")) { /* parallel expansion on 2nd pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      GET_TMPARG;
+#ifdef PASS2_THREAD
+      jconf->searchnow->pass2.thread_num = atoi(tmparg);
+#else
+      jlog("WARNING: m_options: PASS2_THREAD disabled, \"-pass2thread\" ignored\n");
+#endif
+      continue;
+    } else if (strmatch(argv[i],"-scancache")) { /* scan cache on 2nd pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
+      GET_TMPARG;
+#ifdef SCAN_CACHE
+      jconf->searchnow->pass2.scan_cache_size = atoi(tmparg);
+      if (jconf->searchnow->pass2.scan_cache_size < 0
+	  || (size_t)jconf->searchnow->pass2.scan_cache_size > ((size_t)-1) / (1024 * 1024)) {
+	jlog("ERROR: m_options: -scancache: invalid memory size: %s\n", tmparg);
+	return FALSE;
+      }
+#else
+      jlog("WARNING: m_options: SCAN_CACHE disabled, \"-scancache\" ignored\n");
+#endif
+      continue;
     } else if (strmatch(argv[i],"-graphout")) { /* enable graph output */
       if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE; 
       jconf->searchnow->graph.enabled = TRUE;
@@ -589,6 +633,23 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       GET_TMPARG;
       jconf->searchnow->pass1.score_pruning_width = atof(tmparg);
       continue;
+#endif
+#ifdef WORDEND_PRUNING
+    } else if (strmatch(argv[i],"-bw")) { /* word-end rank beam for 1st pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE;
+      GET_TMPARG;
+      jconf->searchnow->pass1.wordend_beam_width = atoi(tmparg);
+      continue;
+    } else if (strmatch(argv[i],"-bws")) { /* word-end score beam for 1st pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE;
+      GET_TMPARG;
+      jconf->searchnow->pass1.wordend_score_width = atof(tmparg);
+      continue;
+    } else if (strmatch(argv[i],"-bls")) { /* LM look-ahead score beam for 1st pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_SR)) return FALSE;
+      GET_TMPARG;
+      jconf->searchnow->pass1.lmla_score_width = atof(tmparg);
+      continue;
 #endif
     } else if (strmatch(argv[i],"-discount")) {	/* (bogus) */
       jlog("WARNING: m_options: option \"-discount\" is now bogus, ignored\n");
@@ -937,6 +998,24 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       GET_TMPARG;
       strncpy(jconf->lmnow->unknown_name, tmparg, UNK_WORD_MAXLEN);
       continue;
+    } else if (strmatch(argv[i],"-ngrammemo")) { /* N-gram memo on 2nd pass */
+      if (!check_section(jconf, argv[i], JCONF_OPT_LM)) return FALSE; 
+      GET_TMPARG;
+      jconf->lmnow->ngram_memo_bits = atoi(tmparg);
+      if (jconf->lmnow->ngram_memo_bits < 0 || jconf->lmnow->ngram_memo_bits > 24) {
+	jlog("ERROR: m_options: \"-ngrammemo\" should be in range of 0 to 24\n");
+	return FALSE;
+      }
+      continue;
+    } else if (strmatch(argv[i],"-lmthread")) { /* threads to read ARPA N-gram */
+      if (!check_section(jconf, argv[i], JCONF_OPT_LM)) return FALSE; 
+      GET_TMPARG;
+      jconf->lmnow->ngram_read_thread = atoi(tmparg);
+      if (jconf->lmnow->ngram_read_thread < 0) {
+	jlog("ERROR: m_options: \"-lmthread\" should be 0 or more\n");
+	return FALSE;
+      }
+      continue;
     } else if (strmatch(argv[i],"-iwspword")) { /* add short pause word */
       if (!check_section(jconf, argv[i], JCONF_OPT_LM)) return FALSE; 
       jconf->lmnow->enable_iwspword = TRUE;
@@ -976,6 +1055,12 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
       jconf->input.netaudio_devname = strcpy((char*)mymalloc(strlen(tmparg)+1),tmparg);
       continue;
 #endif
+    } else if (strmatch(argv[i],"-shmname")) { /* shared memory name */
+      if (!check_section(jconf, argv[i], JCONF_OPT_GLOBAL)) return FALSE; 
+      FREE_MEMORY(jconf->input.shm_name);
+      GET_TMPARG;
+      jconf->input.shm_name = strcpy((char*)mymalloc(strlen(tmparg)+1),tmparg);
+      continue;
     } else if (strmatch(argv[i],"-adport")) { /* adinnet port num */
       if (!check_section(jconf, argv[i], JCONF_OPT_GLOBAL)) return FALSE; 
       GET_TMPARG;
@@ -1469,6 +1554,10 @@ opt_parse(int argc, char *argv[], char *cwd, Jconf *jconf)
 			      NETAUDIO_DEVNAME);
   }
 #endif	/* USE_NETAUDIO */
+  if (!jconf->input.shm_name) {
+    jconf->input.shm_name = strcpy((char*)mymalloc(strlen(SHMRING_NAME)+1),
+				   SHMRING_NAME);
+  }
 
   return TRUE;
 }
@@ -1497,6 +1586,7 @@ opt_release(Jconf *jconf)
 #ifdef USE_NETAUDIO
   FREE_MEMORY(jconf->input.netaudio_devname);
 #endif	/* USE_NETAUDIO */
+  FREE_MEMORY(jconf->input.shm_name);
   FREE_MEMORY(jconf->reject.gmm_filename);
   FREE_MEMORY(jconf->reject.gmm_reject_cmn_string);
   FREE_MEMORY(jconf->outprob_outfile);
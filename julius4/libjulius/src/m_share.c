@@ -0,0 +1,323 @@
+/**
+ * @file   m_share.c
+ * 
+ * <JA>
+ * @brief  󥸥󥤥󥹥󥹴֤Υǥ붦ͭ
+ *
+ * ɤ߹ߺѤߤβǥ롤ǥ롤ñ켭GMMꡤ
+ * ۺѤߤڹ¤ƱץʣΥ󥸥󥤥󥹥󥹴֤
+ * ͭ. ͭǥϻȥȤǴ졤ǸλȼԤ
+ * Ȥ˼ºݤ˲. ͭ줿ǥǧˤѹ
+ * 줺õѲǡϤ٤ƥ󥹥󥹤Ȥκΰ
+ * (HMMWork, FSBeam, StackDecode, 쥹å) ֤.
+ *
+ * ʸˡϼ¹ѹ줦뤿ᡤʸˡθǥ϶ͭ줺
+ * 󥹥󥹤ȤʸˡꥹȤɤ߹ޤ. 
+ * </JA>
+ * 
+ * <EN>
+ * @brief  Model sharing among engine instances
+ *
+ * Loaded acoustic models, language models, dictionaries, GMM,
+ * configurations and built tree lexicons can be shared among multiple
+ * engine instances in a process.  Shared models are reference-counted,
+ * and will be actually freed when the last holder releases them.  The
+ * shared models are not modified while recognition, and all the data
+ * that changes while search are held in the per-instance work areas
+ * (HMMWork, FSBeam, StackDecode, LM score caches, etc.).
+ *
+ * Since grammars can be modified at run time, grammar-based language
+ * models are not shared, and will be loaded from the grammar list for
+ * each instance.
+ * </EN>
+ * 
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/julius.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/**
+ * Reference count of a shared model.  A model that is not in the list
+ * has only one holder.
+ * 
+ */
+typedef struct __model_ref__ {
+  void *model;			///< Pointer to the shared model
+  int count;			///< Number of holders of the model
+  struct __model_ref__ *next;	///< Pointer to the next entry
+} MODEL_REF;
+
+static MODEL_REF *ref_root = NULL; ///< List of shared models
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t ref_mutex = PTHREAD_MUTEX_INITIALIZER; ///< Lock for @a ref_root
+#endif
+
+/** 
+ * <JA>
+ * ǥλȥȤ䤹. ݻԤǥͭȤ
+ * Ƥ. 
+ * 
+ * @param model [in] ͭǥؤΥݥ
+ * </JA>
+ * <EN>
+ * Increment the reference count of a model.  This should be called when
+ * a new holder shares the model.
+ * 
+ * @param model [in] pointer to the model to be shared
+ * </EN>
+ * @callgraph
+ * @callergraph
+ * @ingroup instance
+ */
+void
+j_model_ref(void *model)
+{
+  MODEL_REF *r;
+
+  if (model == NULL) return;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&ref_mutex);
+#endif
+  for(r=ref_root;r;r=r->next) {
+    if (r->model == model) break;
+  }
+  if (r == NULL) {
+    /* first share: count the original holder */
+    r = (MODEL_REF *)mymalloc(sizeof(MODEL_REF));
+    r->model = model;
+    r->count = 1;
+    r->next = ref_root;
+    ref_root = r;
+  }
+  r->count++;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&ref_mutex);
+#endif
+}
+
+/** 
+ * <JA>
+ * ǥλȥȤ򸺤餹. ݻԤǥ˸Ƥӡ
+ * TRUE ֤äȤΤ߼ºݤ˥ǥ. 
+ * 
+ * @param model [in] ǥؤΥݥ
+ * 
+ * @return ¾ݻԤ餺ƽФǥ٤Ȥ TRUE,
+ * ޤ¾Υ󥹥󥹤ΤȤ FALSE ֤. 
+ * </JA>
+ * <EN>
+ * Decrement the reference count of a model.  A holder should call this
+ * before freeing the model, and actually free it only when TRUE is
+ * returned.
+ * 
+ * @param model [in] pointer to the model to be freed
+ * 
+ * @return TRUE if no other holder exists and the caller should free the
+ * model, or FALSE if it is still used by other instances.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ * @ingroup instance
+ */
+boolean
+j_model_unref(void *model)
+{
+  MODEL_REF *r, *prev;
+  boolean ret;
+
+  ret = TRUE;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&ref_mutex);
+#endif
+  prev = NULL;
+  for(r=ref_root;r;r=r->next) {
+    if (r->model == model) break;
+    prev = r;
+  }
+  if (r != NULL) {
+    /* other holders remain */
+    ret = FALSE;
+    r->count--;
+    if (r->count <= 1) {
+      /* the last holder is no longer sharing it */
+      if (prev == NULL) {
+	ref_root = r->next;
+      } else {
+	prev->next = r->next;
+      }
+      free(r);
+    }
+  }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&ref_mutex);
+#endif
+
+  return ret;
+}
+
+/** 
+ * <JA>
+ * ǥ뤬ʣݻԤ˶ͭƤ뤫ɤĴ٤. 
+ * 
+ * @param model [in] ǥؤΥݥ
+ * 
+ * @return ͭƤ TRUE, Ǥʤ FALSE ֤. 
+ * </JA>
+ * <EN>
+ * Check if a model is shared by multiple holders.
+ * 
+ * @param model [in] pointer to the model
+ * 
+ * @return TRUE if shared, or FALSE if not.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ * @ingroup instance
+ */
+boolean
+j_model_is_shared(void *model)
+{
+  MODEL_REF *r;
+  boolean ret;
+
+  if (model == NULL) return FALSE;
+  ret = FALSE;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&ref_mutex);
+#endif
+  for(r=ref_root;r;r=r->next) {
+    if (r->model == model) {
+      if (r->count > 1) ret = TRUE;
+      break;
+    }
+  }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&ref_mutex);
+#endif
+
+  return ret;
+}
+
+/** 
+ * <JA>
+ * @brief  ¸Υ󥸥󥤥󥹥󥹤ȥǥͭ뿷ʥ󥸥
+ * 󥹥󥹤.
+ *
+ * Υ󥹥󥹤ꡤǥ롤N-gram ǥ롤ñ켭
+ * GMM ڹ¤ͭΰΤߤ򿷤˳ݤ.
+ * ʸˡϸΥ󥹥󥹤ƱʸˡꥹȤ鿷ɤ߹ޤ.
+ * Υ󥹥󥹤 j_create_instance_from_jconf() 졤
+ * ǧǽʾ֤ˤ뤳. Ϥ줾Υ󥹥󥹤
+ * ̡Υåɤư뤳ȤǤ. ͭ줿
+ * ѹʤ. A/D-in ν j_adin_init() ǹԤ. 
+ * 
+ * @param base [in] ͭΥ󥸥󥤥󥹥
+ * 
+ * @return 줿󥸥󥤥󥹥󥹡顼 NULL ֤. 
+ * </JA>
+ * <EN>
+ * @brief  Create a new engine instance that shares models with an
+ * existing instance.
+ *
+ * The configuration, acoustic models, N-gram language models,
+ * dictionaries, GMM and tree lexicons of the base instance are shared,
+ * and only the work areas are newly allocated.  Grammars are loaded
+ * again from the same grammar list as the base instance.  The base
+ * instance should be created by j_create_instance_from_jconf() and
+ * ready for recognition.  Each instance can run in a separate thread
+ * after creation.  The shared configuration should not be modified.
+ * A/D-in should be initialized later by j_adin_init().
+ * 
+ * @param base [in] engine instance to share the models with
+ * 
+ * @return the newly created engine instance, or NULL on error.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ * @ingroup instance
+ */
+Recog *
+j_create_instance_shared(Recog *base)
+{
+  Recog *recog;
+  PROCESS_AM *am, *anew;
+  PROCESS_LM *lm, *lnew;
+
+  jlog("STAT: *** creating an engine instance sharing models\n");
+
+  recog = j_recog_new();
+  recog->jconf = base->jconf;
+  j_model_ref(recog->jconf);
+  recog->model_source = base;
+
+  /* acoustic models */
+  for(am=base->amlist;am;am=am->next) {
+    anew = j_process_am_new(recog, am->config);
+    anew->hmminfo = am->hmminfo;
+    j_model_ref(anew->hmminfo);
+    if (am->hmm_gs) {
+      anew->hmm_gs = am->hmm_gs;
+      j_model_ref(anew->hmm_gs);
+    }
+  }
+
+  /* language models */
+  for(lm=base->lmlist;lm;lm=lm->next) {
+    lnew = j_process_lm_new(recog, lm->config);
+    for(anew=recog->amlist;anew;anew=anew->next) {
+      if (anew->config == lm->am->config) lnew->am = anew;
+    }
+    if (lm->lmtype == LM_PROB) {
+      lnew->winfo = lm->winfo;
+      j_model_ref(lnew->winfo);
+      if (lm->ngram) {
+	lnew->ngram = lm->ngram;
+	j_model_ref(lnew->ngram);
+      }
+      /* user-defined LM functions */
+      lnew->lmfunc = lm->lmfunc;
+    }
+    if (lm->lmtype == LM_DFA) {
+      /* grammars may be modified at run time, so load them per instance */
+      if (multigram_load_all_gramlist(lnew) == FALSE) {
+	jlog("ERROR: m_share: some error occured in reading grammars\n");
+	recog->model_source = NULL;
+	j_recog_free(recog);
+	return NULL;
+      }
+      multigram_update(lnew);
+      lnew->global_modified = FALSE;
+      lnew->global_rebuilt = FALSE;
+    }
+  }
+
+  /* GMM */
+  if (base->gmm) {
+    recog->gmm = base->gmm;
+    j_model_ref(recog->gmm);
+  }
+
+  /* compose the instance: tree lexicons are taken from the base instance */
+  if (j_final_fusion(recog) == FALSE) {
+    jlog("ERROR: m_share: error in composing an engine instance\n");
+    recog->model_source = NULL;
+    j_recog_free(recog);
+    return NULL;
+  }
+  recog->model_source = NULL;
+
+  return recog;
+}
+
+/* end of file */
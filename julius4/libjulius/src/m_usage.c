@@ -102,6 +102,10 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "         netaudio          DatLink/NetAudio server\n");
 #endif
   fprintf(fp, "         adinnet           adinnet client (TCP/IP)\n");
+#ifdef HAVE_SHM_OPEN
+  fprintf(fp, "         shm               producer on shared memory\n");
+  fprintf(fp, "         vecshm            feature vectors on shared memory\n");
+#endif
   fprintf(fp, "         stdin             standard input\n");
 #ifdef ENABLE_PLUGIN
   if (global_plugin_list) {
@@ -119,6 +123,9 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-NA host:unit]     get audio from NetAudio server at host:unit\n");
 #endif
   fprintf(fp, "    [-adport portnum]   adinnet port number to listen         (%d)\n", jconf->input.adinnet_port);
+#ifdef HAVE_SHM_OPEN
+  fprintf(fp, "    [-shmname name]     shared memory name for shm/vecshm     (%s)\n", SHMRING_NAME);
+#endif
   fprintf(fp, "    [-48]               enable 48kHz sampling with internal down sampler (OFF)\n");
   fprintf(fp, "    [-zmean/-nozmean]   enable/disable DC offset removal      (OFF)\n");
   fprintf(fp, "    [-lvscale]          input level scaling factor (1.0: OFF) (%.1f)\n", jconf->preprocess.level_coef);
@@ -282,6 +289,10 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-iwspentry entry]  (n-gram) word entry for \"-iwspword\" (%s)\n", IWSPENTRY_DEFAULT);
   fprintf(fp, "    [-adddict dictfile] (n-gram) load extra dictionary\n");
   fprintf(fp, "    [-addentry entry]   (n-gram) load extra word entry\n");
+  fprintf(fp, "    [-ngrammemo N]      (n-gram) 2^N entries of prob. memo on 2nd pass (%d)\n", jconf->lm_root->ngram_memo_bits);
+  fprintf(fp, "                        (0: disable)\n");
+  fprintf(fp, "    [-lmthread N]       (n-gram) threads to read ARPA file (%d)\n", jconf->lm_root->ngram_read_thread);
+  fprintf(fp, "                        (0: number of CPUs, 1: no thread)\n");
   
   fprintf(fp, "\n Isolated Word Recognition:\n");
   fprintf(fp, "    -w file[,file2...]  (list of) wordlist file name(s)\n");
@@ -306,6 +317,12 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-bs score_width]   beam width (by score offset)          (disabled)\n");
   fprintf(fp, "                        (-1: disable)\n");
 #endif
+#ifdef WORDEND_PRUNING
+  fprintf(fp, "    [-bw wordnum]       word-end beam (by rank per frame)     (disabled)\n");
+  fprintf(fp, "    [-bws score_width]  word-end beam (by score offset)       (disabled)\n");
+  fprintf(fp, "    [-bls score_width]  LM look-ahead beam (by score offset)  (disabled)\n");
+  fprintf(fp, "                        (-1: disable)\n");
+#endif
 #ifdef WPAIR
 # ifdef WPAIR_KEEP_NLIMIT
   fprintf(fp, "    [-nlimit N]         keeps only N tokens on each state     (%d)\n", jconf->search_root->pass1.wpair_keep_nlimit);
@@ -331,6 +348,13 @@ j_output_argument_help(FILE *fp)
   fprintf(fp, "    [-m hyponum]        hypotheses overflow threshold num     (%d)\n", jconf->search_root->pass2.hypo_overflow);
 
   fprintf(fp, "    [-lookuprange N]    frame lookup range in word expansion  (%d)\n", jconf->search_root->pass2.lookup_range);
+#ifdef PASS2_THREAD
+  fprintf(fp, "    [-pass2thread N]    (ngram) # of threads for expansion    (%d)\n", jconf->search_root->pass2.thread_num);
+#endif
+#ifdef SCAN_CACHE
+  fprintf(fp, "    [-scancache MB]     (dfa) memory limit of word scan cache (%d)\n", jconf->search_root->pass2.scan_cache_size);
+  fprintf(fp, "                        (0: disable)\n");
+#endif
   fprintf(fp, "    [-looktrellis]      (dfa) expand only backtrellis words\n");
   fprintf(fp, "    [-[no]multigramout] (dfa) output per-grammar results\n");
   fprintf(fp, "    [-oldtree]          (dfa) use old build_wchmm()\n");
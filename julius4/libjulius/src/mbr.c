@@ -130,6 +130,32 @@ dppath(int a, int b, int c, int cost)
 }
 
 
+/** 
+ * <JA>
+ * 
+ * ñ򿷤˳դ˼Ф
+ * 
+ * @param n [in] 
+ * 
+ * @return ñ󡥻Ѹ free() 뤳ȡ
+ * </JA>
+ */
+
+static WORD_ID *
+get_wseq(NODE *n)
+{
+  WORD_ID *seq;
+  WORDHIST *h;
+
+  seq = (WORD_ID *)mymalloc(sizeof(WORD_ID) * (n->seqnum + 1));
+  for(h = n->hist; h != NULL; h = h->prev){
+    seq[h->len - 1] = h->word;
+  }
+
+  return seq;
+}
+
+
 /** 
  * <JA>
  * 
@@ -150,11 +176,14 @@ dpmatch(NODE *a, NODE *b, WORD_INFO *winfo)
   DP *d;
   int i, j;
   int cost;
+  WORD_ID *sa, *sb;
 
   char *c1, *c2;
 
   len1 = a->seqnum + 1;
   len2 = b->seqnum + 1;
+  sa = get_wseq(a);
+  sb = get_wseq(b);
 
   d = (DP *)mymalloc(sizeof(DP) * len1 * len2);
 
@@ -178,11 +207,11 @@ dpmatch(NODE *a, NODE *b, WORD_INFO *winfo)
 
   for(i = 1; i < len1; i++){
 
-    c1 = winfo->woutput[a->seq[i - 1]];
+    c1 = winfo->woutput[sa[i - 1]];
 
     for(j = 1; j < len2; j++){
 
-      c2 = winfo->woutput[b->seq[j - 1]];
+      c2 = winfo->woutput[sb[j - 1]];
 
       if (strmatch(c1, c2)) {
 
@@ -204,6 +233,9 @@ dpmatch(NODE *a, NODE *b, WORD_INFO *winfo)
     dp_print(d, len1, len2);
   }
 
+  free(sa);
+  free(sb);
+
   return d;
 }
 
@@ -241,9 +273,12 @@ calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
   float weight, error1, error2;
   DP *d;
   int i, j, now;
+  WORD_ID *sa, *sb;
 
   /* DPޥå󥰤Υѥ */
   d = dpmatch(a, b, winfo);
+  sa = get_wseq(a);
+  sb = get_wseq(b);
 
   weight = 0.0;
   i = a->seqnum;
@@ -261,19 +296,19 @@ calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
 
       if(d[now].r == 1){
 	/* Deletion error */
-	error1 += get_weight(winfo, a->seq[i - 1]);
+	error1 += get_weight(winfo, sa[i - 1]);
 	i--;
       }
       else if(d[now].r == 2){
 	/* Insertion error */
-	error2 += get_weight(winfo, b->seq[j - 1]);
+	error2 += get_weight(winfo, sb[j - 1]);
 	j--;
       }
       else if(d[now].r == 3){
 	if(d[now].c == 1){
 	  /* Substitution error */
-	  error1 += get_weight(winfo, a->seq[i - 1]);
-	  error2 += get_weight(winfo, b->seq[j - 1]);
+	  error1 += get_weight(winfo, sa[i - 1]);
+	  error2 += get_weight(winfo, sb[j - 1]);
 	}
 	else if(d[now].c == 0){
 	  /* Correct word */
@@ -283,6 +318,8 @@ calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
 	}
 	else{
 	  jlog("Error: calc_wld: cannot calculation Weighted Levenstein distance: cost error\n");
+	  free(sa);
+	  free(sb);
 	  return -1.0;
 	}
 
@@ -291,6 +328,8 @@ calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
       }
       else{
 	jlog("Error: calc_wld: cannot calculation Weighted Levenstein distance: table error: i = %d, j = %d\n", i, j);
+	free(sa);
+	free(sb);
 	return -1.0;
       }
     }
@@ -299,6 +338,8 @@ calc_wld(NODE *a, NODE *b, WORD_INFO *winfo)
   }
 
   free(d);
+  free(sa);
+  free(sb);
 
   return weight;
 }
@@ -20,6 +20,12 @@
  * 줾˳Ǽޤ. Ŭڤʥߥ󥰤
  * multigram_build() ƤӽФ줿Ȥˡglobal.h ѿ dfa
  *  winfo ˥ԡ졤ǧˤƻѤ褦ˤʤޤ. 
+ *
+ * ʸˡɲûϡХʸˡɲä줿ñΤߤڹ¤
+ * ɲäΤκƹۤϹԤޤ. ʸˡκñɲûϡ
+ * ʸˡñ򥰥Хʸˡãʤ֤ǻĤ(ʰ֤
+ * ɲäľ)ɤʸˡˤ°ʤñ줬ХʸˡȾĶ
+ * ȤˤΤΤƹۤޤ. ʸˡ̵ͭϺƹۤȼޤ. 
  * </JA>
  * 
  * <EN>
@@ -43,6 +49,15 @@
  * will be called to make the prepared global grammar to be used in the
  * actual recognition process, by copying the grammar and the dictionary
  * to the global variable dfa and winfo.
+ *
+ * When grammars are added, only the words appended at the tail of the
+ * global grammar are added to the existing tree lexicon, without
+ * rebuilding the whole.  When a grammar is deleted or words are added to
+ * a grammar, the words of the old grammar are left unreachable in the
+ * global grammar (and the modified one is appended again at the tail),
+ * and the whole is re-built only when such dead words become more than
+ * half of the global grammar.  Activation and deactivation of grammars
+ * never cause a rebuild.
  * 
  * @author Akinobu Lee
  * @date   Sat Jun 18 23:45:18 2005
@@ -63,6 +78,35 @@
 /// For debug: define to enable grammar update messages to stdout
 #define MDEBUG
 
+/** 
+ * <JA>
+ * ڹ¤ѹ塤ư˥ӡŪ˻ؼƤʤ
+ * ե륵ξ˥ӡꤹ. 
+ * 
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Reset the beam width after the tree lexicon has changed, if the beam
+ * width was not explicitly specified on startup or full search is
+ * specified.
+ * 
+ * @param r [i/o] recognition process instance
+ * </EN>
+ */
+static void
+multigram_reset_beam_width(RecogProcess *r)
+{
+  /* guess beam width from models, when not specified */
+  r->trellis_beam_width = set_beam_width(r->wchmm, r->config->pass1.specified_trellis_beam_width);
+  switch(r->config->pass1.specified_trellis_beam_width) {
+  case 0:
+    jlog("STAT: multi-gram: beam width set to %d (full) by lexicon change\n", r->trellis_beam_width);
+    break;
+  case -1:
+    jlog("STAT: multi-gram: beam width set to %d (guess) by lexicon change\n", r->trellis_beam_width);
+  }
+}
+
 /** 
  * <JA>
  * @brief  Хʸˡڹ¤ۤ. 
@@ -124,15 +168,7 @@ multigram_rebuild_wchmm(RecogProcess *r)
     return FALSE;
   }
   
-  /* guess beam width from models, when not specified */
-  r->trellis_beam_width = set_beam_width(r->wchmm, r->config->pass1.specified_trellis_beam_width);
-  switch(r->config->pass1.specified_trellis_beam_width) {
-  case 0:
-    jlog("STAT: multi-gram: beam width set to %d (full) by lexicon change\n", r->trellis_beam_width);
-    break;
-  case -1:
-    jlog("STAT: multi-gram: beam width set to %d (guess) by lexicon change\n", r->trellis_beam_width);
-  }
+  multigram_reset_beam_width(r);
 
   /* re-allocate factoring cache for the tree lexicon*/
   /* for n-gram only?? */
@@ -144,19 +180,56 @@ multigram_rebuild_wchmm(RecogProcess *r)
   return TRUE;
 }
 
+/** 
+ * <JA>
+ * @brief  Хʸˡɲä줿ñڹ¤ɲä. 
+ *
+ * ¸ڹ¤ϤΤޤޤˡɲä줿ʸˡñΤߤ
+ * ڹ¤ɲä. 
+ * 
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * @brief  Add words appended to the global grammar to the tree lexicon.
+ *
+ * Only the words of newly appended grammars are added to the tree
+ * lexicon, keeping the existing part as is.
+ * 
+ * @param r [i/o] recognition process instance
+ * </EN>
+ */
+static boolean
+multigram_append_wchmm(RecogProcess *r)
+{
+  if (build_wchmm_append(r->wchmm, r->lm->config) == FALSE) {
+    jlog("ERROR: multi-gram: failed to add words to lexicon tree for recognition\n");
+    return FALSE;
+  }
+  if (r->config->sw.wchmm_check_flag) {
+    wchmm_check_interactive(r->wchmm);
+  }
+  multigram_reset_beam_width(r);
+
+  return TRUE;
+}
+
 /** 
  * <EN>
  * @brief  Check for global grammar and (re-)build tree lexicon if needed.
  * 
  * If any modification of the global grammar has been occured, 
  * the tree lexicons and some other data for recognition will be re-constructed
- * from the updated global grammar.
+ * from the updated global grammar.  If grammars were only appended to
+ * the global grammar, their words are added to the current tree lexicon
+ * instead.
  * </EN>
  * <JA>
  * @brief  ХʸˡĴ١ɬפڹ¤ʺơ˹ۤ. 
  * 
  * Х뼭ѹСι줿Х
  * 񤫤ڹ¤ʤɤβǧѥǡ¤ƹۤ. 
+ * ʸˡɲä줿ξϡñ򸽺ߤڹ¤
+ * ɲä. 
  * 
  * </JA>
  * 
@@ -173,6 +246,19 @@ boolean
 multigram_build(RecogProcess *r)
 {
   if (r->lm->winfo != NULL) {
+    if (r->wchmm != NULL && r->lm->global_rebuilt == FALSE
+	&& r->wchmm->winfo == r->lm->winfo && r->wchmm->dfa == r->lm->dfa
+	&& r->config->pass1.old_tree_function_flag == FALSE) {
+      /* only appended: add the new words to tree lexicon */
+      if (multigram_append_wchmm(r) == FALSE) {
+	jlog("ERROR: multi-gram: failed to update tree lexicon\n");
+	return FALSE;
+      }
+#ifdef MDEBUG
+      jlog("STAT: wchmm update completed\n");
+#endif
+      return(TRUE);
+    }
     /* re-build tree lexicon for recognition process */
     if (multigram_rebuild_wchmm(r) == FALSE) {
       jlog("ERROR: multi-gram: failed to re-build tree lexicon\n");
@@ -223,6 +309,7 @@ multigram_append_to_global(DFA_INFO *gdfa, WORD_INFO *gwinfo, MULTIGRAM *m)
   if (voca_append(gwinfo, m->winfo, m->cate_begin, m->word_begin) == FALSE) {
     return FALSE;
   }
+  m->word_num = m->winfo->num;
   /* append category->word mapping table */
   terminfo_append(&(gdfa->term), &(m->dfa->term), m->cate_begin, m->word_begin);
   /* append catergory-pair information */
@@ -589,6 +676,9 @@ multigram_exec_activate(PROCESS_LM *lm)
  * 
  * ƽФʸˡꥹȤѹå. 
  * ꥹ˺ޡĤ줿ʸˡϡʸˡ
+ * ñϥХ뼭ãʤ֤ǻĤ. ѹ줿ʸˡ
+ * Х뼭ɲäľñƱͤ˻Ĥ. 
+ * ɤʸˡˤ°ʤñ줬Х뼭ȾĶϡ
  * Х뼭ƹۤ. ɲä줿ʸˡϡ
  * ʸˡ򸽺ߤΥХ뼭ɲä. 
  *
@@ -603,8 +693,12 @@ multigram_exec_activate(PROCESS_LM *lm)
  * previous call, and update the global grammar if needed.
  *
  * If there are grammars marked to be deleted in the grammar list,
- * they will be actually deleted from memory.  Then the global grammar is
- * built from scratch using the rest grammars.
+ * they will be actually deleted from memory, leaving their words in the
+ * global grammar unreachable.  Modified grammars will be appended again
+ * at the tail of the global grammar, leaving their old words also
+ * unreachable.  If such dead words become more than half of the global
+ * grammar, the global grammar is built from scratch using the rest
+ * grammars.
  * If there are new grammars, they are appended to the current global grammar.
  * 
  * @param lm [i/o] LM processing instance
@@ -622,6 +716,7 @@ multigram_update(PROCESS_LM *lm)
   MULTIGRAM *m;
   boolean active_changed = FALSE;
   boolean rebuild_flag;
+  int live;
 
   if (lm->lmvar == LM_DFA_GRAMMAR) {
     /* setup additional grammar info of new ones */
@@ -650,16 +745,28 @@ multigram_update(PROCESS_LM *lm)
 
   rebuild_flag = FALSE;
   /* delete grammars marked as "delete" */
-  if (multigram_exec_delete(lm)) { /* some built grammars deleted */
-    rebuild_flag = TRUE;	/* needs rebuilding global grammar */
-  }
+  /* their words are left in the global grammar, but never be reached
+     since no grammar refers to them */
+  multigram_exec_delete(lm);
   /* find modified grammar */
+  /* it will be appended again at the tail of the global grammar,
+     leaving the old words unreachable */
   for(m=lm->grammars;m;m=m->next) {
     if (m->hook & MULTIGRAM_MODIFIED) {
-      rebuild_flag = TRUE;	/* needs rebuilding global grammar */
+      m->newbie = TRUE;
       m->hook &= ~(MULTIGRAM_MODIFIED);
     }
   }
+  /* rebuild global grammar when the unreachable words are more than half */
+  if (lm->winfo != NULL) {
+    live = 0;
+    for(m=lm->grammars;m;m=m->next) {
+      if (! m->newbie) live += m->word_num;
+    }
+    if ((lm->winfo->num - live) * 2 > lm->winfo->num) {
+      rebuild_flag = TRUE;	/* needs rebuilding global grammar */
+    }
+  }
 
   if (rebuild_flag) {
     /* rebuild global grammar from scratch (including new) */
@@ -691,6 +798,7 @@ multigram_update(PROCESS_LM *lm)
       if (lm->lmvar == LM_DFA_WORD) {
 	/* just append dictionaty */
 	m->word_begin = lm->winfo->num;
+	m->word_num = m->winfo->num;
 	if (voca_append(lm->winfo, m->winfo, m->id, m->word_begin) == FALSE) {
 	  jlog("ERROR: multi-gram: failed to add dictionary #%d to recognition network\n", m->id);
 	  /* mark as delete */
@@ -709,6 +817,7 @@ multigram_update(PROCESS_LM *lm)
       jlog("ERROR: errorous grammar deleted\n");
     }
     lm->global_modified = TRUE;
+    lm->global_rebuilt = TRUE;
   } else {			/* global not need changed by the deletion */
     /* append only new grammars */
     for(m=lm->grammars;m;m=m->next) {
@@ -716,15 +825,18 @@ multigram_update(PROCESS_LM *lm)
 	if (lm->lmvar == LM_DFA_GRAMMAR && lm->dfa == NULL) {
 	  lm->dfa = dfa_info_new();
 	  dfa_state_init(lm->dfa);
+	  lm->global_rebuilt = TRUE;
 	}
 	if (lm->winfo == NULL) {
 	  lm->winfo = word_info_new();
 	  winfo_init(lm->winfo);
+	  lm->global_rebuilt = TRUE;
 	}
 	if (m->newbie) m->newbie = FALSE;
 	if (lm->lmvar == LM_DFA_WORD) {
 	  /* just append dictionaty */
 	  m->word_begin = lm->winfo->num;
+	  m->word_num = m->winfo->num;
 	  if (voca_append(lm->winfo, m->winfo, m->id, m->word_begin) == FALSE) {
 	    jlog("ERROR: multi-gram: failed to add dictionary #%d to recognition network\n", m->id);
 	    /* mark as delete */
@@ -1144,7 +1256,8 @@ multigram_get_grammar_by_id(PROCESS_LM *lm, unsigned short id)
  *
  * Category IDs of grammar in the adding words will be copied as is to
  * the target grammar, so they should be set beforehand correctly.
- * The whole tree lexicon will be rebuilt later.
+ * The grammar will be re-installed at the tail of the global grammar
+ * at the next update, and its words are added to the tree lexicon.
  *
  * Currently adding words to N-gram LM is not supported yet.
  * 
@@ -1155,7 +1268,8 @@ multigram_get_grammar_by_id(PROCESS_LM *lm, unsigned short id)
  * ɲäñʸˡƥIDˤĤƤϡǤ˥󤵤ƤΤ
  * Τޤޥԡ롥äơϤδؿƤӽФˡ
  * ɲоݤʸˡ褦ꤵƤɬפ롥
- * ڹ¤Τ˺ƹۤ롥
+ * ʸˡϼι˥Хʸˡɲäľ졤ñ줬
+ * ڹ¤ɲä롥
  *
  * ñN-gramǥؤμɲäϸߥݡȤƤʤ
  * 
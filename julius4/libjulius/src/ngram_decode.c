@@ -48,253 +48,312 @@
 #include <julius/julius.h>
 
 /** 
+ * <EN>
+ * Compute backward N-gram score from forward N-gram.
+ * </EN>
  * <JA>
- * ñ䥽 qsort Хåؿ. 
- * 
- * @param a [in] 1
- * @param b [in] 2
- * 
- * @return añID > bñID ʤ1, դʤ -1, Ʊʤ 0 ֤. 
+ *  N-gram  N-gram 黻Ф. 
  * </JA>
- * <EN>
- * qsort callback function to sort next word candidates by their word ID.
  * 
- * @param a [in] element 1
- * @param b [in] element 2
+ * @param ngram [in] N-gram data structure
+ * @param w [in] word sequence
+ * @param wlen [in] length of @a w
+ * 
+ * @return the backward probability of the word w[0].
  * 
- * @return 1 if word id of a > that of b, -1 if negative, 0 if equal.
- * </EN>
  */
-static int
-compare_nw(NEXTWORD **a, NEXTWORD **b)
+static LOGPROB
+ngram_forw2back(NGRAM_INFO *ngram, WORD_ID *w, int wlen)
 {
-  if ((*a)->id > (*b)->id) return 1;
-  if ((*a)->id < (*b)->id) return -1;
-  return 0;
+  int i;
+  LOGPROB p1, p2;
+
+  p1 = 0.0;
+  for(i = 1; i < ngram->n; i++) {
+    if (i >= wlen) break;
+    p1 += ngram_prob(ngram, i, &(w[1]));
+  }
+  p2 = 0.0;
+  for(i = 0; i < ngram->n; i++) {
+    if (i >= wlen) break;
+    p2 += ngram_prob(ngram, i+1, w);
+  }
+
+  return(p2 - p1);
 }
 
 /** 
+ * <EN>
+ * Prepare the N-gram probability memo of an LM for a new input.
+ * The memo will be allocated at the first call, and entries of the
+ * previous input will be invalidated by proceeding the generation number.
+ * </EN>
  * <JA>
- * ñꥹ⤫ñ򸡺. 
- * 
- * @param nw [in] ñꥹ
- * @param w [in] ñID
- * @param num [in] ñꥹȤĹ
- * 
- * @return Ĥä礽μñ乽¤ΤؤΥݥ󥿡Ĥʤ
- * NULL ֤. 
+ * ϤΤ N-gram ΨΥ. ǽθƤӽФ
+ * ΰݤʹߤֹʤϤΥȥ̵. 
  * </JA>
- * <EN>
- * Find a word from list of next word candidates.
  * 
- * @param nw [in] list of next word candidates
- * @param w [in] word id to search for
- * @param num [in] length of @a nw
+ * @param lm [i/o] LM processing instance
  * 
- * @return the pointer to the NEXTWORD data if found, or NULL if not found.
- * </EN>
  */
-/* find next word candiate whose id 'w' */
-static NEXTWORD *
-search_nw(NEXTWORD **nw, WORD_ID w, int num)
+void
+ngram_memo_prepare(PROCESS_LM *lm)
 {
-  int left,right,mid;
-  NEXTWORD *tmp;
-
-  if (num == 0) return NULL;
-  left = 0;
-  right = num - 1;
-  while (left < right) {
-    mid = (left + right) / 2;
-    if ((nw[mid])->id < w) {
-      left = mid + 1;
-    } else {
-      right = mid;
-    }
+  NGRAM_MEMO *m;
+  int i, size;
+
+  if (lm->ngram == NULL || lm->config->ngram_memo_bits <= 0) return;
+
+  if (lm->memo == NULL) {
+    size = 1 << lm->config->ngram_memo_bits;
+    m = (NGRAM_MEMO *)mymalloc(sizeof(NGRAM_MEMO));
+    m->bits = lm->config->ngram_memo_bits;
+    m->n = lm->ngram->n;
+    m->key = (WORD_ID *)mymalloc_big(sizeof(WORD_ID) * m->n, size);
+    m->len = (unsigned char *)mymalloc_big(sizeof(unsigned char), size);
+    m->prob = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), size);
+    m->stamp = (unsigned int *)mymalloc_big(sizeof(unsigned int), size);
+    for(i=0;i<size;i++) m->stamp[i] = 0;
+    m->gen = 0;
+    lm->memo = m;
   }
-  tmp = nw[left];
-  if (tmp->id == w) {
-    return tmp;
-  } else {
-    return NULL;
+  m = lm->memo;
+
+  /* proceed the generation */
+  if (++(m->gen) == 0) {
+    size = 1 << m->bits;
+    for(i=0;i<size;i++) m->stamp[i] = 0;
+    m->gen = 1;
   }
+  m->lookup = 0;
+  m->hit = 0;
 }
 
 /** 
  * <EN>
- * Compute backward N-gram score from forward N-gram.
+ * Free the N-gram probability memo of an LM.
  * </EN>
  * <JA>
- *  N-gram  N-gram 黻Ф. 
+ * N-gram ΨΥ. 
  * </JA>
  * 
- * @param ngram [in] N-gram data structure
- * @param w [in] word sequence
+ * @param lm [i/o] LM processing instance
+ * 
+ */
+void
+ngram_memo_free(PROCESS_LM *lm)
+{
+  NGRAM_MEMO *m;
+
+  m = lm->memo;
+  if (m == NULL) return;
+  free(m->key);
+  free(m->len);
+  free(m->prob);
+  free(m->stamp);
+  free(m);
+  lm->memo = NULL;
+}
+
+/** 
+ * <EN>
+ * Compute N-gram probability of a word sequence via the memo.
+ * The word sequence is in the order of the N-gram direction, i.e.
+ * the last word is the target word for backward N-gram, and the first
+ * word is for forward N-gram.
+ * </EN>
+ * <JA>
+ * 𤷤ñ N-gram Ψ. ñ N-gram 
+ * . ʤ N-gram ǤϺǸñ줬 N-gram Ǥ
+ * ǽñ줬оñǤ. 
+ * </JA>
+ * 
+ * @param lm [i/o] LM processing instance
+ * @param w [in] word sequence (N-gram entry IDs)
  * @param wlen [in] length of @a w
  * 
- * @return the backward probability of the word w[0].
+ * @return the N-gram probability of the target word.
  * 
  */
 static LOGPROB
-ngram_forw2back(NGRAM_INFO *ngram, WORD_ID *w, int wlen)
+ngram_memo_prob(PROCESS_LM *lm, WORD_ID *w, int wlen)
 {
+  NGRAM_MEMO *m;
+  unsigned int h;
+  WORD_ID *key;
+  LOGPROB p;
   int i;
-  LOGPROB p1, p2;
 
-  p1 = 0.0;
-  for(i = 1; i < ngram->n; i++) {
-    if (i >= wlen) break;
-    p1 += ngram_prob(ngram, i, &(w[1]));
+  m = lm->memo;
+
+  h = wlen;
+  for(i=0;i<wlen;i++) h = (h ^ (unsigned int)w[i]) * 0x9e3779b1U;
+  h >>= (32 - m->bits);
+  key = &(m->key[h * m->n]);
+
+  m->lookup++;
+  if (m->stamp[h] == m->gen && m->len[h] == wlen) {
+    for(i=0;i<wlen;i++) if (key[i] != w[i]) break;
+    if (i == wlen) {
+      m->hit++;
+      return(m->prob[h]);
+    }
   }
-  p2 = 0.0;
-  for(i = 0; i < ngram->n; i++) {
-    if (i >= wlen) break;
-    p2 += ngram_prob(ngram, i+1, w);
+
+  if (lm->ngram->dir == DIR_RL) {
+    p = ngram_prob(lm->ngram, wlen, w);
+  } else {
+    p = ngram_forw2back(lm->ngram, w, wlen);
   }
 
-  return(p2 - p1);
+  /* overwrite the entry */
+  for(i=0;i<wlen;i++) key[i] = w[i];
+  m->len[h] = wlen;
+  m->prob[h] = p;
+  m->stamp[h] = m->gen;
+
+  return(p);
 }
 
 /** 
  * <JA>
- * @brief  ñȥꥹ鼡ñФ. 
- *
- * ñȥꥹλꤷե졼˽ü¸ߤȥꥹñ
- * ΥꥹȤФμñȤƤ N-gram ³Ψ׻. 
- * ΥꥹȤñ¤Τɲä֤. 
+ * Ÿ⤫ N-gram ׻Ѥñʸ̮ΰ cnword[],
+ * cnwordrev[] ˥åȤ. Ʃñϥåפ.
  * 
  * @param r [in] ǧ󥹥
- * @param nw [i/o] ñꥹȡз̤ @a oldnum ʹߤɲä
- * @param oldnum [in] @a nw ˤǤ˳ǼƤ뼡ñο
  * @param hypo [in] Ÿʸ
- * @param t [in] ե졼
  * 
- * @return ХꥹȤɲäȤ @a nw ˴ޤޤ뼡ñ. 
+ * @return ʸ̮Ȥ줿 (ƩñǤʤ) ñο
  * </JA>
  * <EN>
- * @brief  Extract next word candidates from word trellis.
- *
- * This function extracts the list of trellis words whose word end
- * has survived in the word trellis at the specified frame.
- * The N-gram probabilities of them are then computed and added to
- * the current next word candidates data.
+ * Set word context for N-gram computation to work area cnword[] and
+ * cnwordrev[] from the source hypothesis.  Transparent words will be
+ * skipped.
  * 
  * @param r [in] recognition process instance
- * @param nw [in] list of next word candidates (new words will be appended at @a oldnum)
- * @param oldnum [in] number of words already stored in @a nw
  * @param hypo [in] the source sentence hypothesis
- * @param t [in] specified frame
  * 
- * @return the total number of words currently stored in the @a nw.
+ * @return the number of (non-transparent) context words.
  * </EN>
  */
 static int
-pick_backtrellis_words(RecogProcess *r, NEXTWORD **nw, int oldnum, NODE *hypo, short t)
+set_word_context(RecogProcess *r, NODE *hypo)
 {
   int i;
+  int cnnum;
+  WORDHIST *h;
+  StackDecode *dwrk;
+  WORD_INFO *winfo;
+  NGRAM_INFO *ngram;
+
+  winfo = r->lm->winfo;
+  ngram = r->lm->ngram;
+  dwrk = &(r->pass2);
+
+  cnnum = 0;
+  for(h=hypo->hist;h;h=h->prev) {
+    if (! winfo->is_transparent[h->word]) {
+      dwrk->cnword[cnnum+1] = h->word;
+      cnnum++;
+      if (cnnum >= ngram->n - 1) break;
+    }
+  }
+  if (ngram->dir == DIR_RL) {
+    for(i=0;i<cnnum;i++) {
+      dwrk->cnwordrev[cnnum-1-i] = dwrk->cnword[i+1];
+    }
+  }
+  /* use ngram id */
+  if (ngram->dir == DIR_RL) {
+    for(i=0;i<cnnum;i++) dwrk->cnwordrev[i] = winfo->wton[dwrk->cnwordrev[i]];
+  } else {
+    for(i=0;i<cnnum;i++) dwrk->cnword[i+1] = winfo->wton[dwrk->cnword[i+1]];
+  }
+
+  return(cnnum);
+}
+
+/** 
+ * <JA>
+ * @brief  ñ˸쥹Ϳ.
+ * 
+ * ñȥꥹññꥹȤɲäμñȤƤ
+ * N-gram ³Ψ׻. ñʸ̮Ϥ餫 set_word_context() 
+ * åȤƤ.
+ * 
+ * @param r [in] ǧ󥹥
+ * @param nw [out] ɲμñ
+ * @param tre [in] ñȤʤȥꥹñ
+ * @param hypo [in] Ÿʸ
+ * @param cnnum [in] ʸ̮ñο
+ * </JA>
+ * <EN>
+ * @brief  Give LM score to a next word candidate.
+ * 
+ * Add a trellis word to the next word candidates and compute its N-gram
+ * probability as the next word.  The word context should be set by
+ * set_word_context() beforehand.
+ * 
+ * @param r [in] recognition process instance
+ * @param nw [out] next word data to store
+ * @param tre [in] trellis word to be the next word
+ * @param hypo [in] the source sentence hypothesis
+ * @param cnnum [in] number of context words
+ * </EN>
+ */
+static void
+set_nextword(RecogProcess *r, NEXTWORD *nw, TRELLIS_ATOM *tre, NODE *hypo, int cnnum)
+{
   WORD_ID w;
   LOGPROB rawscore;
-#ifdef WPAIR
-  int w_old = WORD_INVALID;
-#endif
-  int num;
-  int cnnum;		///< Num of found non-transparent words (<=2)
-  int last_trans;		///< Num of skipped transparent words
   StackDecode *dwrk;
-
-  BACKTRELLIS *bt;
   WORD_INFO *winfo;
   NGRAM_INFO *ngram;
-  LOGPROB lm_weight2, lm_penalty2, lm_penalty_trans;
 
-  num = oldnum;
-  bt = r->backtrellis;
   winfo = r->lm->winfo;
   ngram = r->lm->ngram;
-  lm_weight2 = r->config->lmp.lm_weight2;
-  lm_penalty2 = r->config->lmp.lm_penalty2;
-  lm_penalty_trans = r->config->lmp.lm_penalty_trans;
   dwrk = &(r->pass2);
 
-  /* set word contexts to cnword[] from 1 considering transparent words */
+  w = tre->wid;
+
+  /* compute LM probability of the word */
   if (ngram) {
-    cnnum = 0;
-    last_trans = 0;
-    for(i=hypo->seqnum-1;i>=0;i--) {
-      if (! winfo->is_transparent[hypo->seq[i]]) {
-	dwrk->cnword[cnnum+1] = hypo->seq[i];
-	cnnum++;
-	if (cnnum >= ngram->n - 1) break;
-      } else {
-	last_trans++;
-      }
-    }
+    /* compute N-gram probability */
     if (ngram->dir == DIR_RL) {
-      for(i=0;i<cnnum;i++) {
-	dwrk->cnwordrev[cnnum-1-i] = dwrk->cnword[i+1];
+      /* just compute N-gram prob of the word candidate */
+      dwrk->cnwordrev[cnnum] = winfo->wton[w];
+      if (r->lm->memo) {
+	rawscore = ngram_memo_prob(r->lm, dwrk->cnwordrev, cnnum + 1);
+      } else {
+	rawscore = ngram_prob(ngram, cnnum + 1, dwrk->cnwordrev);
       }
-    }
-    /* use ngram id */
-    if (ngram->dir == DIR_RL) {
-      for(i=0;i<cnnum;i++) dwrk->cnwordrev[i] = winfo->wton[dwrk->cnwordrev[i]];
     } else {
-      for(i=0;i<cnnum;i++) dwrk->cnword[i+1] = winfo->wton[dwrk->cnword[i+1]];
-    }
-  }
-
-  /* lookup survived words in backtrellis on time frame 't' */
-  for (i=0;i<bt->num[t];i++) {
-    w = (bt->rw[t][i])->wid;
-#ifdef WORD_GRAPH
-    /* only words on the word graphs are expanded */
-    if (!(bt->rw[t][i])->within_wordgraph) continue;
-#endif /* not WORD_GRAPH */
-#ifdef WPAIR
-    /* some word have same word ID with different previous word, so
-       only one will be opened (best word will be selected later
-       by next_word() */
-    if (w == w_old) continue;	/* backtrellis is sorted by word ID */
-    else w_old = w;
-#endif /* WPAIR */
-    /* skip if already exist */
-    if (search_nw(nw, w, oldnum) != NULL) continue;
-
-    /* compute LM probability of the word */
-    if (ngram) {
-      /* compute N-gram probability */
-      if (ngram->dir == DIR_RL) {
-	/* just compute N-gram prob of the word candidate */
-	dwrk->cnwordrev[cnnum] = winfo->wton[w];
-	rawscore = ngram_prob(ngram, cnnum + 1, dwrk->cnwordrev);
+      dwrk->cnword[0] = winfo->wton[w];
+      if (r->lm->memo) {
+	rawscore = ngram_memo_prob(r->lm, dwrk->cnword, cnnum + 1);
       } else {
-	dwrk->cnword[0] = winfo->wton[w];
 	rawscore = ngram_forw2back(ngram, dwrk->cnword, cnnum + 1);
       }
+    }
 #ifdef CLASS_NGRAM
-      rawscore += winfo->cprob[w];
+    rawscore += winfo->cprob[w];
 #endif
-    }
-    if (r->lmvar == LM_NGRAM_USER) {
-      /* call user-defined function */
-      /* be careful that the word context is ordered in backward direction */
-      rawscore = (*(r->lm->lmfunc.lmprob))(winfo, hypo->seq, hypo->seqnum, w, rawscore);
-    }
+  }
+  if (r->lmvar == LM_NGRAM_USER) {
+    /* call user-defined function */
+    /* be careful that the word context is ordered in backward direction */
+    rawscore = (*(r->lm->lmfunc.lmprob))(winfo, wordhist_to_array(hypo), hypo->seqnum, w, rawscore);
+  }
 
-    nw[num]->tre   = bt->rw[t][i];
-    nw[num]->id    = w;
-    nw[num]->lscore = rawscore * lm_weight2 + lm_penalty2;
-    if (winfo->is_transparent[w]) {
-      /*nw[num]->lscore -= (LOGPROB)last_trans * TRANS_RENZOKU_PENALTY;*/
-      if (winfo->is_transparent[hypo->seq[hypo->seqnum-1]]) {
-	nw[num]->lscore += lm_penalty_trans;
-      }
+  nw->tre   = tre;
+  nw->id    = w;
+  nw->lscore = rawscore * r->config->lmp.lm_weight2 + r->config->lmp.lm_penalty2;
+  if (winfo->is_transparent[w]) {
+    /*nw->lscore -= (LOGPROB)last_trans * TRANS_RENZOKU_PENALTY;*/
+    if (winfo->is_transparent[hypo->hist->word]) {
+      nw->lscore += r->config->lmp.lm_penalty_trans;
     }
-    
-    /* j_printf("%d: %s added\n", num, winfo->wname[nw[num]->id]); */
-    num++;
   }
-
-  return num;
 }
 
 /** 
@@ -305,6 +364,11 @@ pick_backtrellis_words(RecogProcess *r, NEXTWORD **nw, int oldnum, NODE *hypo, s
  * ñ칽¤Τۤ. Ʊñ줬嵭ϰʣ硤
  * ե졼ˤäȤᤤȥꥹñ줬򤵤. 
  * 
+ * ƥե졼ΥȥꥹññIDǥȺѤߤʤΤǡޤͥ
+ * ե졼򸫤Ƴñ˺Ѥȥꥹñֹդɽ˵Ͽ
+ * ˥ե졼ऴȤΥꥹȤޡñID˼Ф. 
+ * μȽʣõ䥽ȤԤ鷺֤ǹԤ. 
+ * 
  * @param r [in] ǧ󥹥
  * @param nw [out] ñ콸Ǽ빽¤ΤؤΥݥ
  * @param hypo [in] Ÿʬʸ
@@ -321,6 +385,13 @@ pick_backtrellis_words(RecogProcess *r, NEXTWORD **nw, int oldnum, NODE *hypo, s
  * If the same words exists in the near frames, only the one nearest to the
  * specified frame will be chosen.
  * 
+ * Since trellis words on each frame are sorted by word ID, it first
+ * visits the frames in order of priority and records which trellis word
+ * is adopted for each word in a generation-stamped table, and then
+ * merges the per-frame lists to output the words in order of word ID.
+ * Gathering and de-duplication are done in linear time without any
+ * search or sort.
+ * 
  * @param r [in] recognition process instance
  * @param nw [out] pointer to hold the extracted words as list of next word candidates
  * @param hypo [in] partial sentence hypothesis from which the words will be expanded
@@ -335,16 +406,24 @@ get_backtrellis_words(RecogProcess *r, NEXTWORD **nw, NODE *hypo, short tm, shor
 {
   int num = 0;
   int t, t_step;
-  int oldnum=0;
+  int i, k, kmin, fnum;
+  int cnnum = 0;
+  WORD_ID w, wmin;
+  TRELLIS_ATOM *tre;
 
   BACKTRELLIS *bt;
+  StackDecode *dwrk;
   int lookup_range;
 
   if (tm < 0) return(0);
 
   bt = r->backtrellis;
+  dwrk = &(r->pass2);
   lookup_range = r->config->pass2.lookup_range;
 
+  /* õե졼ͥ¤٤ */
+  /* list the frames to look up in order of priority */
+  fnum = 0;
 #ifdef PREFER_CENTER_ON_TRELLIS_LOOKUP
   /* fix for 3.2 (01/10/18 by ri) */
   /* before and after (one near center frame has high priority) */
@@ -352,22 +431,12 @@ get_backtrellis_words(RecogProcess *r, NEXTWORD **nw, NODE *hypo, short tm, shor
     /* before or center */
     t = tm - t_step;
     if (t < 0 || t > bt->framelen - 1 || t >= t_end) continue;
-    num = pick_backtrellis_words(r, nw, oldnum, hypo, t);
-    if (num > oldnum) {
-      qsort(nw, num, sizeof(NEXTWORD *),
-	    (int (*)(const void *,const void *))compare_nw);
-      oldnum = num;
-    }
+    dwrk->nw_frame[fnum++] = t;
     if (t_step == 0) continue;	/* center */
     /* after */
     t = tm + t_step;
     if (t < 0 || t > bt->framelen - 1 || t >= t_end) continue;
-    num = pick_backtrellis_words(r, nw, oldnum, hypo, t);
-    if (num > oldnum) {
-      qsort(nw, num, sizeof(NEXTWORD *),
-	    (int (*)(const void *,const void *))compare_nw);
-      oldnum = num;
-    }
+    dwrk->nw_frame[fnum++] = t;
   }
 
 #else
@@ -375,25 +444,77 @@ get_backtrellis_words(RecogProcess *r, NEXTWORD **nw, NODE *hypo, short tm, shor
   /* before the center frame */
   for(t = tm; t >= tm - lookup_range; t--) {
     if (t < 0) break;
-    num = pick_backtrellis_words(r, nw, oldnum, hypo, t);
-    if (num > oldnum) {
-      qsort(nw, num, sizeof(NEXTWORD *),
-	    (int (*)(const void *,const void *))compare_nw);
-      oldnum = num;
-    }
+    dwrk->nw_frame[fnum++] = t;
   }
   /* after the center frame */
   for(t = tm + 1; t < tm + lookup_range; t++) {
     if (t > bt->framelen - 1) break;
     if (t >= t_end) break;
-    num = pick_backtrellis_words(r, nw, oldnum, hypo, t);
-    if (num > oldnum) {
-      qsort(nw, num, sizeof(NEXTWORD *),
-	    (int (*)(const void *,const void *))compare_nw);
-      oldnum = num;
-    }
+    dwrk->nw_frame[fnum++] = t;
   }
 #endif
+  if (fnum == 0) return(0);
+
+  /* ֹʤ */
+  /* proceed the generation */
+  if (++(dwrk->nw_gen) == 0) {
+    for(w=0;w<r->lm->winfo->num;w++) dwrk->nw_stamp[w] = 0;
+    dwrk->nw_gen = 1;
+  }
+
+  /* ͥ˥ե졼򸫤ơñ˺Ѥȥꥹñ.
+     WPAIR Ʊե졼Ʊñ줬ʣȤƬΤΤѤ
+     (ɤΤΤϸ next_word() Ф) */
+  /* visit frames in order of priority to determine the trellis word to be
+     adopted for each word.  With WPAIR, some words have the same word ID
+     with different previous word on a frame, so only the first one will
+     be opened (best word will be selected later by next_word()) */
+  for(k=0;k<fnum;k++) {
+    t = dwrk->nw_frame[k];
+    for (i=0;i<bt->num[t];i++) {
+      tre = bt->rw[t][i];
+#ifdef WORD_GRAPH
+      /* only words on the word graphs are expanded */
+      if (!tre->within_wordgraph) continue;
+#endif /* not WORD_GRAPH */
+      if (dwrk->nw_stamp[tre->wid] != dwrk->nw_gen) {
+	dwrk->nw_stamp[tre->wid] = dwrk->nw_gen;
+	dwrk->nw_owner[tre->wid] = tre;
+      }
+    }
+    dwrk->nw_pos[k] = 0;
+  }
+
+  /* set word contexts to cnword[] from 1 considering transparent words */
+  if (r->lm->ngram) {
+    cnnum = set_word_context(r, hypo);
+  }
+
+  /* ƥե졼ΥꥹȤޡơѤ줿ȥꥹñ
+     ñID˼Ф */
+  /* merge the lists on the frames, and extract the adopted trellis words
+     in order of word ID */
+  for(;;) {
+    kmin = -1;
+    wmin = WORD_INVALID;
+    for(k=0;k<fnum;k++) {
+      t = dwrk->nw_frame[k];
+      if (dwrk->nw_pos[k] >= bt->num[t]) continue;
+      w = bt->rw[t][dwrk->nw_pos[k]]->wid;
+      if (kmin == -1 || w < wmin) {
+	kmin = k;
+	wmin = w;
+      }
+    }
+    if (kmin == -1) break;
+    t = dwrk->nw_frame[kmin];
+    tre = bt->rw[t][dwrk->nw_pos[kmin]];
+    dwrk->nw_pos[kmin]++;
+    if (dwrk->nw_owner[wmin] != tre || dwrk->nw_stamp[wmin] != dwrk->nw_gen) continue;
+    set_nextword(r, nw[num], tre, hypo, cnnum);
+    /* j_printf("%d: %s added\n", num, winfo->wname[nw[num]->id]); */
+    num++;
+  }
 
   return num;
 }
@@ -432,7 +553,7 @@ limit_nw(NEXTWORD **nw, NODE *hypo, int num, WORD_INFO *winfo)
 
   /* <s>ϲŸʤ */
   /* no hypothesis will be generated after "<s>" */
-  if (hypo->seq[hypo->seqnum-1] == winfo->head_silwid) {
+  if (hypo->hist->word == winfo->head_silwid) {
     return(0);
   }
 
@@ -619,13 +740,13 @@ ngram_acceptable(NODE *hypo, RecogProcess *r)
   if (r->config->successive.enabled) {
     /* Ǹβ⤬裱ѥಾκǽñȰפʤФʤʤ */
     /* the last word should be equal to the first word on the best hypothesis on 1st pass */
-    if (hypo->seq[hypo->seqnum-1] == r->sp_break_2_end_word) {
+    if (hypo->hist->word == r->sp_break_2_end_word) {
       return TRUE;
     }
   } else {
     /* Ǹβ⤬ʸƬ̵ñǤʤФʤʤ */
     /* the last word should be head silence word */
-    if (hypo->seq[hypo->seqnum-1] == r->lm->winfo->head_silwid) {
+    if (hypo->hist->word == r->lm->winfo->head_silwid) {
       return TRUE;
     }
   }
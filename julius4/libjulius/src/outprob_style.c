@@ -30,7 +30,8 @@
  *
  * ޤ嵭 2  4 ξ֤ǤϡƥȤȼtriphoneѲ
  * ľñID ȤȤ˾֤Ȥ˥ե졼ñ̤ǥå夷Ƥ. ˤ
- * ׻̤ɤ. 
+ * ׻̤ɤ. åڹ¤ΤȤ̤ˡ񤴤Ȥ
+ * ΰ (wchmm->outcache) ݻ. 
  * </JA>
  * 
  * <EN>
@@ -61,7 +62,8 @@
  *
  *  The triphone transformation, that will be performed on the state
  *  of 2 and 4 above, will be cached on the tree lxicon by each state
- *  per frame, to suppress computation overhead.
+ *  per frame, to suppress computation overhead.  The cache is held in
+ *  the work area of each lexicon (wchmm->outcache), apart from the tree.
  *   
  * </EN>
  * 
@@ -84,12 +86,14 @@
 
 /** 
  * <JA>
- * Ƭȥ饤եѲѥåν
+ * Ƭȥ饤եѲѥåν. åΰ褬̤ݤ
+ * Фǳݤ. 
  * 
  * @param wchmm [i/o] ڹ¤
  * </JA>
  * <EN>
  * Initialize cache for triphone changing on every word head.
+ * The cache area will be allocated here if not yet.
  * 
  * @param wchmm [i/o] tree lexicon
  * </EN>
@@ -99,14 +103,14 @@
 void
 outprob_style_cache_init(WCHMM_INFO *wchmm)
 {
-  int n;
-  for(n=0;n<wchmm->n;n++) {
-    if (wchmm->state[n].out.state == NULL) continue;
-    if (wchmm->outstyle[n] == AS_RSET) {
-      (wchmm->state[n].out.rset)->cache.state = NULL;
-    } else if (wchmm->outstyle[n] == AS_LRSET) {
-      (wchmm->state[n].out.lrset)->cache.state = NULL;
-    }
+  int i;
+
+  if (wchmm->outcachelen < wchmm->outcachenum) {
+    wchmm->outcache = (OUTSTYLE_CACHE *)myrealloc(wchmm->outcache, sizeof(OUTSTYLE_CACHE) * wchmm->outcachenum);
+    wchmm->outcachelen = wchmm->outcachenum;
+  }
+  for(i=0;i<wchmm->outcachenum;i++) {
+    wchmm->outcache[i].cache.state = NULL;
   }
 }
 
@@ -205,7 +209,8 @@ lcdset_lookup_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID categor
 static void
 lcdset_register_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID category)
 {
-  WORD_ID c2, i, w;
+  WORD_ID i, w;
+  int c2;
   HMM_Logical *ltmp;
 
   int cnt_c, cnt_w, cnt_p;
@@ -218,8 +223,7 @@ lcdset_register_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID categ
     }
     cnt_c = cnt_w = cnt_p = 0;
     /* search for category that can connect after this category */
-    for(c2=0;c2<wchmm->dfa->term_num;c2++) {
-      if (! dfa_cp(wchmm->dfa, category, c2)) continue;
+    for(c2=dfa_cp_next(wchmm->dfa, category, 0);c2!=-1;c2=dfa_cp_next(wchmm->dfa, category, c2+1)) {
       /* for each word in the category, register triphone whose right context
 	 is the beginning phones  */
       for(i=0;i<wchmm->dfa->term.wnum[c2];i++) {
@@ -265,6 +269,35 @@ lcdset_register_with_category(WCHMM_INFO *wchmm, HMM_Logical *hmm, WORD_ID categ
  */
 void
 lcdset_register_with_category_all(WCHMM_INFO *wchmm)
+{
+  lcdset_register_with_category_append(wchmm, 0);
+}
+
+/** 
+ * <JA>
+ * λñʹߤñˤĤơñѥƥդ pseudo phone
+ * set . ʸˡɲä줿Ȥˡɲä줿ñˤĤƤΤ
+ * ΤѤ. ɲä줿ʸˡΥƥϴ¸Υƥ³
+ * ʤΤǡ¸ pseudo phone set Ѳʤ. 
+ * 
+ * @param wchmm [i/o] ڹ¤
+ * @param wbegin [in] оݤκǽñID
+ * </JA>
+ * <EN>
+ * Generate category-indexed pseudo phone sets for the words from
+ * @a wbegin in the dictionary.  This is used to generate them only for
+ * words of newly appended grammars.  The categories of an appended
+ * grammar never connect with existing categories, so the existing
+ * pseudo phone sets are not affected.
+ * 
+ * @param wchmm [i/o] tree lexicon
+ * @param wbegin [in] first word ID to be processed
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+lcdset_register_with_category_append(WCHMM_INFO *wchmm, int wbegin)
 {
   WORD_INFO *winfo;
   WORD_ID c1, w, w_prev;
@@ -275,13 +308,13 @@ lcdset_register_with_category_all(WCHMM_INFO *wchmm)
 
   /* (1) ñ콪üβǤˤĤ */
   /*     word end phone */
-  for(w=0;w<winfo->num;w++) {
+  for(w=wbegin;w<winfo->num;w++) {
     ltmp = winfo->wseq[w][winfo->wlen[w]-1];
     lcdset_register_with_category(wchmm, ltmp, winfo->wton[w]);
   }
   /* (2)ñξ, ԤñνüǤθ */
   /*    for one-phoneme word, possible left context should be also considered */
-  for(w=0;w<winfo->num;w++) {
+  for(w=wbegin;w<winfo->num;w++) {
     if (winfo->wlen[w] > 1) continue;
     for(c1=0;c1<wchmm->dfa->term_num;c1++) {
       if (! dfa_cp(wchmm->dfa, c1, winfo->wton[w])) continue;
@@ -367,6 +400,7 @@ outprob_style(WCHMM_INFO *wchmm, int node, int last_wid, int t, HTK_Param *param
   HMM_Logical *ohmm, *rhmm;
   RC_INFO *rset;
   LRC_INFO *lrset;
+  OUTSTYLE_CACHE *c;
   CD_Set *lcd;
   WORD_INFO *winfo = wchmm->winfo;
   HTK_HMM_INFO *hmminfo = wchmm->hmminfo;
@@ -386,8 +420,9 @@ outprob_style(WCHMM_INFO *wchmm, int node, int last_wid, int t, HTK_Param *param
     /* note in the beginning phone of word */
     /* depends on the last word hypothesis to compute the actual triphone */
     rset = wchmm->state[node].out.rset;
+    c = &(wchmm->outcache[rset->cid]);
     /* consult cache */
-    if (rset->cache.state == NULL || rset->lastwid_cache != last_wid) {
+    if (c->cache.state == NULL || c->lastwid_cache != last_wid) {
       /* cache miss...calculate */
       /* rset contains either defined biphone or pseudo biphone */
       if (last_wid != WORD_INVALID) {
@@ -420,24 +455,25 @@ outprob_style(WCHMM_INFO *wchmm, int node, int last_wid, int t, HTK_Param *param
       /* rhmm may be a pseudo phone */
       /* store to cache */
       if (rhmm->is_pseudo) {
-	rset->last_is_lset  = TRUE;
-	rset->cache.lset    = &(rhmm->body.pseudo->stateset[rset->state_loc]);
+	c->last_is_lset  = TRUE;
+	c->cache.lset    = &(rhmm->body.pseudo->stateset[rset->state_loc]);
       } else {
-	rset->last_is_lset  = FALSE;
-	rset->cache.state   = rhmm->body.defined->s[rset->state_loc];
+	c->last_is_lset  = FALSE;
+	c->cache.state   = rhmm->body.defined->s[rset->state_loc];
       }
-      rset->lastwid_cache = last_wid;
+      c->lastwid_cache = last_wid;
     }
     /* calculate outprob and return */
-    if (rset->last_is_lset) {
-      return(outprob_cd(wchmm->hmmwrk, t, rset->cache.lset, param));
+    if (c->last_is_lset) {
+      return(outprob_cd(wchmm->hmmwrk, t, c->cache.lset, param));
     } else {
-      return(outprob_state(wchmm->hmmwrk, t, rset->cache.state, param));
+      return(outprob_state(wchmm->hmmwrk, t, c->cache.state, param));
     }
   case AS_LRSET:
     /* node in word with only one phoneme --- both beginning and end */
     lrset = wchmm->state[node].out.lrset;
-    if (lrset->cache.state == NULL || lrset->lastwid_cache != last_wid) {
+    c = &(wchmm->outcache[lrset->cid]);
+    if (c->cache.state == NULL || c->lastwid_cache != last_wid) {
       /* cache miss...calculate */
       rhmm = lrset->hmm;
       /* lookup cdset for given left context (= last phoneme) */
@@ -461,28 +497,28 @@ outprob_style(WCHMM_INFO *wchmm, int node, int last_wid, int t, HTK_Param *param
 	lcd = lcdset_lookup_by_hmmname(hmminfo, rbuf);
       }
       if (lcd != NULL) {	/* found, set to cache */
-	lrset->last_is_lset  = TRUE;
-        lrset->cache.lset    = &(lcd->stateset[lrset->state_loc]);
-        lrset->lastwid_cache = last_wid;
+	c->last_is_lset  = TRUE;
+        c->cache.lset    = &(lcd->stateset[lrset->state_loc]);
+        c->lastwid_cache = last_wid;
       } else {
 	/* no relating lcdset found, falling to normal state */
 	if (rhmm->is_pseudo) {
-	  lrset->last_is_lset  = TRUE;
-	  lrset->cache.lset    = &(rhmm->body.pseudo->stateset[lrset->state_loc]);
-	  lrset->lastwid_cache = last_wid;
+	  c->last_is_lset  = TRUE;
+	  c->cache.lset    = &(rhmm->body.pseudo->stateset[lrset->state_loc]);
+	  c->lastwid_cache = last_wid;
 	} else {
-	  lrset->last_is_lset  = FALSE;
-	  lrset->cache.state   = rhmm->body.defined->s[lrset->state_loc];
-	  lrset->lastwid_cache = last_wid;
+	  c->last_is_lset  = FALSE;
+	  c->cache.state   = rhmm->body.defined->s[lrset->state_loc];
+	  c->lastwid_cache = last_wid;
 	}
       }
       /*printf("[%s->%s]\n", lrset->hmm->name, rhmm->name);*/
     }
     /* calculate outprob and return */
-    if (lrset->last_is_lset) {
-      return(outprob_cd(wchmm->hmmwrk, t, lrset->cache.lset, param));
+    if (c->last_is_lset) {
+      return(outprob_cd(wchmm->hmmwrk, t, c->cache.lset, param));
     } else {
-      return(outprob_state(wchmm->hmmwrk, t, lrset->cache.state, param));
+      return(outprob_state(wchmm->hmmwrk, t, c->cache.state, param));
     }
   default:
     /* should not happen */
@@ -532,6 +532,18 @@ mfc_module_init(MFCCCalc *mfcc, Recog *recog)
   mfcc->func.fv_pause      = (boolean (*)()) vecin_pause;
   mfcc->func.fv_terminate  = (boolean (*)()) vecin_terminate;
   mfcc->func.fv_input_name = (char * (*)()) vecin_input_name;
+  if (recog->jconf->input.vecin_shm) {
+    /* built-in shared memory input */
+    vecin_shm_set_name(recog->jconf->input.shm_name);
+    mfcc->func.fv_standby    = (boolean (*)()) vecin_shm_standby;
+    mfcc->func.fv_begin      = (boolean (*)()) vecin_shm_open;
+    mfcc->func.fv_read       = (int (*)(VECT *, int)) vecin_shm_read;
+    mfcc->func.fv_end        = (boolean (*)()) vecin_shm_close;
+    mfcc->func.fv_resume     = (boolean (*)()) vecin_shm_resume;
+    mfcc->func.fv_pause      = (boolean (*)()) vecin_shm_pause;
+    mfcc->func.fv_terminate  = (boolean (*)()) vecin_shm_terminate;
+    mfcc->func.fv_input_name = (char * (*)()) vecin_shm_input_name;
+  }
 
 #ifdef ENABLE_PLUGIN
   mfcc->plugin_source = recog->jconf->input.plugin_source;
@@ -566,7 +578,7 @@ mfc_module_set_header(MFCCCalc *mfcc, Recog *recog)
 #ifdef ENABLE_PLUGIN
   if (mfcc->plugin_source < 0) {
     /* no plugin, use the default functions */
-    func = vecin_get_configuration;
+    func = recog->jconf->input.vecin_shm ? vecin_shm_get_configuration : vecin_get_configuration;
   } else {
     func = (FUNC_INT) plugin_get_func(mfcc->plugin_source, "fvin_get_configuration");
     if (func == NULL) {
@@ -575,7 +587,7 @@ mfc_module_set_header(MFCCCalc *mfcc, Recog *recog)
     }
   }
 #else
-  func = vecin_get_configuration;
+  func = recog->jconf->input.vecin_shm ? vecin_shm_get_configuration : vecin_get_configuration;
 #endif
 
   /* vector length in unit */
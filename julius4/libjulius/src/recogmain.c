@@ -850,7 +850,10 @@ j_recognize_stream_core(Recog *recog)
       }
     }
     for(lm=recog->lmlist;lm;lm=lm->next) {
-      if (lm->lmtype == LM_DFA) lm->global_modified = FALSE;
+      if (lm->lmtype == LM_DFA) {
+	lm->global_modified = FALSE;
+	lm->global_rebuilt = FALSE;
+      }
     }
 
     ok_p = FALSE;
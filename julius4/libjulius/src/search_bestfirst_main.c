@@ -50,7 +50,6 @@
 /* declaration of local functions */
 static NODE *get_best_from_stack(NODE **start, int *stacknum);
 static int put_to_stack(NODE *new, NODE **start, NODE **bottom, int *stacknum, int stacksize);
-static void put_all_in_stack(NODE **start, int *stacknum, WORD_INFO *winfo);
 static void free_all_nodes(NODE *node);
 static void put_hypo_woutput(NODE *hypo, WORD_INFO *winfo);
 static void put_hypo_wname(NODE *hypo, WORD_INFO *winfo);
@@ -181,6 +180,242 @@ nw_expand(NEXTWORD **nwold, int *maxlen, NEXTWORD **root, int num)
 }
 
 
+/**********************************************************************/
+/********** ñ             ********************************/
+/********** Word history of hypothesis ********************************/
+/**********************************************************************/
+
+/** 
+ * <JA>
+ * ñΥ򻲾ȿ򸺤餷Ʋ. ȿ 0 ˤʤä
+ * ǼˤᤷľñΥˤĤƤƱͤ˽. 
+ * 
+ * @param s [i/o] 2ѥΥꥢ
+ * @param h [in] ñΥ
+ * </JA>
+ * <EN>
+ * Decrease the reference count of a word history cell.  A cell whose
+ * count becomes 0 is returned to the stocker, and the cell of the
+ * previous word is also processed in the same way.
+ * 
+ * @param s [i/o] work area for the 2nd pass
+ * @param h [in] word history cell
+ * </EN>
+ */
+static void
+wordhist_unref(StackDecode *s, WORDHIST *h)
+{
+  WORDHIST *p;
+
+  while (h != NULL) {
+    if (--(h->refcount) > 0) break;
+    p = h->prev;
+    h->prev = s->wordhist_stocker;
+    s->wordhist_stocker = h;
+    h = p;
+  }
+}
+
+/** 
+ * <JA>
+ *  @a src ñθñ @a w ɲäΤ @a dst 
+ * ñȤ. @a src ϥԡ줺ͭ. @a dst 
+ * @a src ƱǤ褤. 
+ * 
+ * @param dst [i/o] ñ򥻥åȤ벾
+ * @param src [in] Ȥʤ벾 (NULL ΤȤ @a w ΤߤȤʤ)
+ * @param w [in] ɲäñ
+ * </JA>
+ * <EN>
+ * Set the word history of @a dst to that of @a src followed by word @a w.
+ * The history of @a src is not copied but shared.  @a dst may be the same
+ * as @a src.
+ * 
+ * @param dst [i/o] hypothesis to set the word history
+ * @param src [in] source hypothesis (if NULL, the history will be only @a w)
+ * @param w [in] word to be appended
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+wordhist_push(NODE *dst, NODE *src, WORD_ID w)
+{
+  StackDecode *s;
+  WORDHIST *h;
+
+  s = &(dst->region->pass2);
+  if ((h = s->wordhist_stocker) != NULL) {
+    s->wordhist_stocker = h->prev;
+  } else {
+    h = (WORDHIST *)mymalloc(sizeof(WORDHIST));
+  }
+  h->word = w;
+  h->refcount = 1;
+  h->prev = (src != NULL) ? src->hist : NULL;
+  if (h->prev != NULL) {
+    h->prev->refcount++;
+    h->len = h->prev->len + 1;
+  } else {
+    h->len = 1;
+  }
+#ifdef CONFIDENCE_MEASURE
+#ifdef CM_MULTIPLE_ALPHA
+  memset(h->cmscore, 0, sizeof(LOGPROB) * 100);
+#else
+  h->cmscore = 0.0;
+#endif
+#endif
+  wordhist_unref(s, dst->hist);
+  dst->hist = h;
+  dst->seqnum = h->len;
+}
+
+/** 
+ * <JA>
+ *  @a src ñ @a dst ȶͭ. 
+ * 
+ * @param dst [i/o] ñ򥻥åȤ벾
+ * @param src [in] Ȥʤ벾
+ * </JA>
+ * <EN>
+ * Share the word history of hypothesis @a src with @a dst.
+ * 
+ * @param dst [i/o] hypothesis to set the word history
+ * @param src [in] source hypothesis
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+wordhist_share(NODE *dst, NODE *src)
+{
+  if (src->hist != NULL) src->hist->refcount++;
+  wordhist_unref(&(dst->region->pass2), dst->hist);
+  dst->hist = src->hist;
+  dst->seqnum = src->seqnum;
+}
+
+/** 
+ * <JA>
+ * ñ򤫤Ǹñ. 
+ * 
+ * @param node [i/o] 
+ * </JA>
+ * <EN>
+ * Remove the last word from the word history of a hypothesis.
+ * 
+ * @param node [i/o] hypothesis
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+wordhist_pop(NODE *node)
+{
+  WORDHIST *h;
+
+  h = node->hist;
+  if (h == NULL) return;
+  node->hist = h->prev;
+  if (node->hist != NULL) node->hist->refcount++;
+  wordhist_unref(&(node->region->pass2), h);
+  node->seqnum = (node->hist != NULL) ? node->hist->len : 0;
+}
+
+/** 
+ * <JA>
+ * ñؤλȤ. 
+ * 
+ * @param node [i/o] 
+ * </JA>
+ * <EN>
+ * Release the reference to the word history of a hypothesis.
+ * 
+ * @param node [i/o] hypothesis
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+wordhist_release(NODE *node)
+{
+  wordhist_unref(&(node->region->pass2), node->hist);
+  node->hist = NULL;
+  node->seqnum = 0;
+}
+
+/** 
+ * <JA>
+ * ñŸ. ¤ӤϲǤꡤ
+ * ǸǤǸñȤʤ. ֤ΰϥꥢǤꡤ
+ * θƤӽФǾ񤭤. 
+ * 
+ * @param node [in] 
+ * 
+ * @return ñ
+ * </JA>
+ * <EN>
+ * Expand the word history of a hypothesis to an array, in the order of
+ * expansion, the last element being the last word.  The returned area
+ * is a work area and will be overwritten by the next call.
+ * 
+ * @param node [in] hypothesis
+ * 
+ * @return array of the word sequence.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+WORD_ID *
+wordhist_to_array(NODE *node)
+{
+  StackDecode *s;
+  WORDHIST *h;
+
+  s = &(node->region->pass2);
+  if (s->seqbuflen < node->seqnum) {
+    s->seqbuflen = node->seqnum + MAXSEQNUM;
+    if (s->seqbuf == NULL) {
+      s->seqbuf = (WORD_ID *)mymalloc(sizeof(WORD_ID) * s->seqbuflen);
+    } else {
+      s->seqbuf = (WORD_ID *)myrealloc(s->seqbuf, sizeof(WORD_ID) * s->seqbuflen);
+    }
+  }
+  for (h = node->hist; h != NULL; h = h->prev) {
+    s->seqbuf[h->len - 1] = h->word;
+  }
+  return(s->seqbuf);
+}
+
+/** 
+ * <JA>
+ * ñΥγǼˤˤ. 
+ * 
+ * @param s [i/o] 2ѥΥꥢ
+ * </JA>
+ * <EN>
+ * Clear the stocker of word history cells.
+ * 
+ * @param s [i/o] work area for the 2nd pass
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+wordhist_clear_stocker(StackDecode *s)
+{
+  WORDHIST *h, *p;
+
+  h = s->wordhist_stocker;
+  while (h) {
+    p = h->prev;
+    free(h);
+    h = p;
+  }
+  s->wordhist_stocker = NULL;
+}
+
 /**********************************************************************/
 /********** ⥹å         ********************************/
 /********** Hypothesis stack operation ********************************/
@@ -223,43 +458,6 @@ get_best_from_stack(NODE **start, int *stacknum)
   }
 }
 
-/** 
- * <JA>
- * 벾⤬å˳Ǽ뤫ɤå. 
- * 
- * @param new [in] å벾
- * @param bottom [in] åΡɤؤΥݥ
- * @param stacknum [in] å˸߳ǼƤΡɿؤΥݥ
- * @param stacksize [in] åΥΡɿξ
- * 
- * @return åΥ¤ãƤʤΡɤ
- * 褱гǼȤ 0 򡤤ʳǤгǼǤʤȤ -1 
- * ֤. 
- * </JA>
- * <EN>
- * Check whether a hypothesis will be stored in the stack.
- * 
- * @param new [in] hypothesis to be checked
- * @param bottom [in] pointer to stack bottom node
- * @param stacknum [in] pointer to current stack size
- * @param stacksize [in] pointer to maximum stack size limit
- * 
- * @return 0 if it will be stored in the stack (in case @a stacknum <
- * @a stacksize or the score of @a new is better than bottom.  Otherwise
- * returns -1, which means it can not be pushed to the stack.
- * </EN>
- */
-static int
-can_put_to_stack(NODE *new, NODE **bottom, int *stacknum, int stacksize)
-{
-  /* stack size check */
-  if ((*stacknum + 1) > stacksize && (*bottom)->score >= new->score) {
-    /* new node is below the bottom: discard it */
-    return(-1);
-  }
-  return(0);
-}
-
 /** 
  * <JA>
  * å˿ʲǼ. 
@@ -360,30 +558,452 @@ put_to_stack(NODE *new, NODE **start, NODE **bottom, int *stacknum, int stacksiz
   return(0);
 }
 
+/** 
+ * <JA>
+ * å. 
+ * 
+ * @param start [i/o] åΥȥåץΡ
+ * </JA>
+ * <EN>
+ * Free all nodes in a stack.
+ * 
+ * @param start [i/o] stack top node
+ * </EN>
+ */
+static void
+free_all_nodes(NODE *start)
+{
+  NODE *tmp;
+  NODE *next;
+
+  tmp=start;
+  while(tmp) {
+    next=tmp->next;
+    free_node(tmp);
+    tmp=next;
+  }
+}
+
+/**********************************************************************/
+/********** ⥹å **********************************************/
+/********** hypothesis stack ******************************************/
+/**********************************************************************/
+
+/* The stack is kept as a score-sorted doubly linked list, or as a min-max
+   heap when the stack size is HYPOSTACK_HEAP_MIN or more.  The heap
+   gives each node an order value so that nodes with equal scores are
+   popped and dropped in the same order as the list. */
+
+/* pop the best node from the list */
+static NODE *
+hypo_list_pop_best(HYPOSTACK *s)
+{
+  NODE *tmp;
+
+  /* return top */
+  tmp = s->start;
+  if (s->start != NULL) {	/* delete it from stack */
+    s->start = s->start->next;
+    if (s->start != NULL) s->start->prev = NULL;
+    s->num--;
+  }
+  return(tmp);
+}
+
+/* insert a node into the list, keeping score order */
+static int
+hypo_list_put(HYPOSTACK *s, NODE *new)
+{
+  NODE *tmp;
+
+  /* stack size check */
+  if (s->num >= s->size) {
+    /* stack size overflow */
+    if (s->bottom->score < new->score) {
+      /* new node will be inserted in the stack: free the bottom */
+      tmp = s->bottom;
+      s->bottom->prev->next = NULL;
+      s->bottom = s->bottom->prev;
+      free_node(tmp);
+      s->num--;
+    } else {
+      /* new node is below the bottom: discard it */
+      free_node(new);
+      return(-1);
+    }
+  }
+  s->num++;
+
+  /* insert new node on edge */
+  if (s->start == NULL) {	/* no node in stack */
+    /* new node is the only node */
+    s->start = new;
+    s->bottom = new;
+    new->next = NULL;
+    new->prev = NULL;
+    return(0);
+  }
+  if (s->start->score <= new->score) {
+    /* insert on the top */
+    new->next = s->start;
+    new->next->prev = new;
+    s->start = new;
+    new->prev = NULL;
+    return(0);
+  }
+  if (s->bottom->score >= new->score) {
+    /* insert on the bottom */
+    new->prev = s->bottom;
+    new->prev->next = new;
+    s->bottom = new;
+    new->next = NULL;
+    return(0);
+  }
+
+  /* now the new node is between start and bottom */
+  if ((s->start->score + s->bottom->score) / 2 > new->score) {
+    /* search from bottom */
+    tmp = s->bottom;
+    while(tmp->score < new->score) tmp = tmp->prev;
+    new->prev = tmp;
+    new->next = tmp->next;
+    tmp->next->prev = new;
+    tmp->next = new;
+  } else {
+    /* search from start */
+    tmp = s->start;
+    while(tmp->score > new->score) tmp = tmp->next;
+    new->next = tmp;
+    new->prev = tmp->prev;
+    tmp->prev->next = new;
+    tmp->prev = new;
+  }
+  return(0);
+}
+
+/* index i (0 origin) is on a max level when its depth is even */
+static boolean
+hypo_heap_is_max_level(int i)
+{
+  int l;
+
+  for (l = 0, i++; i > 1; i >>= 1) l++;
+  return((l % 2 == 0) ? TRUE : FALSE);
+}
+
+/* TRUE if node at i comes before node at j in the list order */
+static boolean
+hypo_heap_before(HYPOSTACK *s, int i, int j)
+{
+  if (s->node[i]->score != s->node[j]->score) {
+    return((s->node[i]->score > s->node[j]->score) ? TRUE : FALSE);
+  }
+  return((s->order[i] < s->order[j]) ? TRUE : FALSE);
+}
+
+/* TRUE if node at i should be above node at j on a max (min) level */
+#define hypo_heap_above(s, i, j, max) ((max) ? hypo_heap_before(s, i, j) : hypo_heap_before(s, j, i))
+
+/* swap two nodes in the heap array */
+static void
+hypo_heap_swap(HYPOSTACK *s, int i, int j)
+{
+  NODE *tmp;
+  int o;
+
+  tmp = s->node[i];
+  s->node[i] = s->node[j];
+  s->node[j] = tmp;
+  o = s->order[i];
+  s->order[i] = s->order[j];
+  s->order[j] = o;
+}
+
+/* move node at i up along max levels (max == TRUE) or min levels */
+static void
+hypo_heap_bubble_up_level(HYPOSTACK *s, int i, boolean max)
+{
+  int gp;
+
+  while (i > 2) {
+    gp = ((i - 1) / 2 - 1) / 2;
+    if (! hypo_heap_above(s, i, gp, max)) break;
+    hypo_heap_swap(s, i, gp);
+    i = gp;
+  }
+}
+
+/* restore heap order after a node has been put at i */
+static void
+hypo_heap_bubble_up(HYPOSTACK *s, int i)
+{
+  int p;
+
+  if (i == 0) return;
+  p = (i - 1) / 2;
+  if (hypo_heap_is_max_level(i)) {
+    if (hypo_heap_before(s, p, i)) {
+      hypo_heap_swap(s, i, p);
+      hypo_heap_bubble_up_level(s, p, FALSE);
+    } else {
+      hypo_heap_bubble_up_level(s, i, TRUE);
+    }
+  } else {
+    if (hypo_heap_before(s, i, p)) {
+      hypo_heap_swap(s, i, p);
+      hypo_heap_bubble_up_level(s, p, TRUE);
+    } else {
+      hypo_heap_bubble_up_level(s, i, FALSE);
+    }
+  }
+}
+
+/* restore heap order after the node at i has been replaced */
+static void
+hypo_heap_trickle_down(HYPOSTACK *s, int i)
+{
+  boolean max;
+  int c, m, k, last;
+
+  max = hypo_heap_is_max_level(i);
+  for(;;) {
+    c = 2 * i + 1;
+    if (c >= s->num) break;
+    /* find the best (max) or worst (min) among children and grandchildren */
+    m = c;
+    last = 4 * i + 6;
+    if (last >= s->num) last = s->num - 1;
+    for (k = c + 1; k <= last; k++) {
+      if (k > c + 1 && k < 4 * i + 3) continue;
+      if (hypo_heap_above(s, k, m, max)) m = k;
+    }
+    if (! hypo_heap_above(s, m, i, max)) break;
+    hypo_heap_swap(s, i, m);
+    if (m <= c + 1) break;	/* child: done */
+    /* grandchild: the parent may need to be swapped */
+    k = (m - 1) / 2;
+    if (hypo_heap_above(s, k, m, max)) hypo_heap_swap(s, m, k);
+    i = m;
+  }
+}
+
+/* index of the worst node in the heap */
+static int
+hypo_heap_worst(HYPOSTACK *s)
+{
+  if (s->num <= 2) return(s->num - 1);
+  return(hypo_heap_before(s, 1, 2) ? 2 : 1);
+}
+
+/* pop the best node from the heap */
+static NODE *
+hypo_heap_pop_best(HYPOSTACK *s)
+{
+  NODE *tmp;
+
+  if (s->num == 0) return(NULL);
+  tmp = s->node[0];
+  s->num--;
+  if (s->num > 0) {
+    s->node[0] = s->node[s->num];
+    s->order[0] = s->order[s->num];
+    hypo_heap_trickle_down(s, 0);
+  }
+  return(tmp);
+}
+
+/* put a node into the heap, at the same order as the list among equal
+   scores */
+static int
+hypo_heap_put(HYPOSTACK *s, NODE *new)
+{
+  int w;
+  LOGPROB best, worst;
+
+  new->next = new->prev = NULL;
+  if (s->num >= s->size) {
+    /* stack size overflow */
+    w = hypo_heap_worst(s);
+    if (s->node[w]->score < new->score) {
+      /* new node will be inserted in the stack: free the bottom */
+      free_node(s->node[w]);
+      s->num--;
+      if (w < s->num) {
+	s->node[w] = s->node[s->num];
+	s->order[w] = s->order[s->num];
+	hypo_heap_trickle_down(s, w);
+      }
+    } else {
+      /* new node is below the bottom: discard it */
+      free_node(new);
+      return(-1);
+    }
+  }
+  /* the list puts new node before the equal ones when inserted on the
+     top or searched from the top, and after them otherwise */
+  if (s->num == 0) {
+    s->order[s->num] = ++(s->order_last);
+  } else {
+    best = s->node[0]->score;
+    worst = s->node[hypo_heap_worst(s)]->score;
+    if (best <= new->score) {
+      s->order[s->num] = --(s->order_first);
+    } else if (worst >= new->score || (best + worst) / 2 > new->score) {
+      s->order[s->num] = ++(s->order_last);
+    } else {
+      s->order[s->num] = --(s->order_first);
+    }
+  }
+  s->node[s->num] = new;
+  hypo_heap_bubble_up(s, s->num);
+  s->num++;
+  return(0);
+}
+
+/** 
+ * <JA>
+ * ⥹å. 
+ * 
+ * @param s [out] ⥹å
+ * @param stacksize [in] åΥΡɿξ
+ * @param heap [in] TRUE ʤ min-max ҡסFALSE ʤ饹ΥꥹȤݻ
+ * </JA>
+ * <EN>
+ * Initialize a hypothesis stack.
+ * 
+ * @param s [out] hypothesis stack
+ * @param stacksize [in] maximum number of nodes in the stack
+ * @param heap [in] TRUE to keep it as a min-max heap, FALSE as a
+ * score-sorted list
+ * </EN>
+ */
+void
+hypo_stack_init(HYPOSTACK *s, int stacksize, boolean heap)
+{
+  s->heap = heap;
+  s->size = stacksize;
+  s->num = 0;
+  s->start = s->bottom = NULL;
+  s->node = NULL;
+  s->order = NULL;
+  s->order_first = s->order_last = 0;
+  if (heap) {
+    s->node = (NODE **)mymalloc(sizeof(NODE *) * stacksize);
+    s->order = (int *)mymalloc(sizeof(int) * stacksize);
+  }
+}
+
+/** 
+ * <JA>
+ * åκಾФ. 
+ * 
+ * @param s [i/o] ⥹å
+ * 
+ * @return ФಾΥݥ󥿡åξ NULL ֤. 
+ * </JA>
+ * <EN>
+ * Pop the best hypothesis from the stack.
+ * 
+ * @param s [i/o] hypothesis stack
+ * 
+ * @return pointer to the popped hypothesis, or NULL if the stack is empty.
+ * </EN>
+ */
+NODE *
+hypo_stack_pop_best(HYPOSTACK *s)
+{
+  if (s->heap) return(hypo_heap_pop_best(s));
+  return(hypo_list_pop_best(s));
+}
+
+/** 
+ * <JA>
+ * 벾⤬å˳Ǽ뤫ɤå. 
+ * 
+ * @param s [in] ⥹å
+ * @param new [in] å벾
+ * 
+ * @return åΥ¤ãƤʤå
+ * 㥹褱гǼȤ 0 򡤤ʳǤ
+ * ǼǤʤȤ -1 ֤. 
+ * </JA>
+ * <EN>
+ * Check whether a hypothesis will be stored in the stack.
+ * 
+ * @param s [in] hypothesis stack
+ * @param new [in] hypothesis to be checked
+ * 
+ * @return 0 if it will be stored in the stack (in case the stack is not
+ * full or the score of @a new is better than the worst one).  Otherwise
+ * returns -1, which means it can not be pushed to the stack.
+ * </EN>
+ */
+int
+hypo_stack_can_put(HYPOSTACK *s, NODE *new)
+{
+  LOGPROB worst;
+
+  if (s->num < s->size) return(0);
+  worst = s->heap ? s->node[hypo_heap_worst(s)]->score : s->bottom->score;
+  if (worst >= new->score) {
+    /* new node is below the bottom: discard it */
+    return(-1);
+  }
+  return(0);
+}
+
+/** 
+ * <JA>
+ * å˿ʲǼ. åդξϺ㥹
+ * ؤ. 
+ * ǼǤʤä硤Ϳ줿 free_node() . 
+ * 
+ * @param s [i/o] ⥹å
+ * @param new [in] Ǽ벾
+ * 
+ * @return ǼǤ 0 򡤤Ǥʤä -1 ֤. 
+ * </JA>
+ * <EN>
+ * Push a new hypothesis into the stack.  If the stack is full, the
+ * worst hypothesis in the stack will be replaced.
+ * If not succeeded, the given new hypothesis will be freed by free_node().
+ * 
+ * @param s [i/o] hypothesis stack
+ * @param new [in] hypothesis to be pushed
+ * 
+ * @return 0 if succeded, or -1 if failed to push because of number
+ * limitation or too low score.
+ * </EN>
+ */
+int
+hypo_stack_put(HYPOSTACK *s, NODE *new)
+{
+  if (s->heap) return(hypo_heap_put(s, new));
+  return(hypo_list_put(s, new));
+}
+
 /** 
  * <JA>
  * åȤƽϤ. åȤϼ. (ǥХå)
  * 
- * @param start [i/o] åΥȥåץΡɤؤΥݥ
- * @param stacknum [i/o] å˸߳ǼƤΡɿؤΥݥ
+ * @param s [i/o] ⥹å
  * @param winfo [in] ñ켭
  * </JA>
  * <EN>
  * Output all nodes in the stack. All nodes will be lost (for debug).
  * 
- * @param start [i/o] pointer to stack top node
- * @param stacknum [i/o] pointer to current stack size
+ * @param s [i/o] hypothesis stack
  * @param winfo [in] word dictionary
  * </EN>
  */
 static void
-put_all_in_stack(NODE **start, int *stacknum, WORD_INFO *winfo)
+hypo_stack_put_all(HYPOSTACK *s, WORD_INFO *winfo)
 {
   NODE *ntmp;
-  
+
   jlog("DEBUG: hypotheses remained in global stack\n");
-  while ((ntmp = get_best_from_stack(start, stacknum)) != NULL) {
-    jlog("DEBUG: %3d: s=%f",*stacknum, ntmp->score);
+  while ((ntmp = hypo_stack_pop_best(s)) != NULL) {
+    jlog("DEBUG: %3d: s=%f", s->num, ntmp->score);
     put_hypo_woutput(ntmp, winfo);
     free_node(ntmp);
   }
@@ -391,31 +1011,34 @@ put_all_in_stack(NODE **start, int *stacknum, WORD_INFO *winfo)
 
 /** 
  * <JA>
- * å. 
+ * ⥹åȥåȤ. 
  * 
- * @param start [i/o] åΥȥåץΡ
+ * @param s [i/o] ⥹å
  * </JA>
  * <EN>
- * Free all nodes in a stack.
+ * Free all nodes in a hypothesis stack, and the stack itself.
  * 
- * @param start [i/o] stack top node
+ * @param s [i/o] hypothesis stack
  * </EN>
  */
-static void
-free_all_nodes(NODE *start)
+void
+hypo_stack_free(HYPOSTACK *s)
 {
-  NODE *tmp;
-  NODE *next;
+  int i;
 
-  tmp=start;
-  while(tmp) {
-    next=tmp->next;
-    free_node(tmp);
-    tmp=next;
+  if (s->heap) {
+    for (i = 0; i < s->num; i++) free_node(s->node[i]);
+    free(s->node);
+    free(s->order);
+  } else {
+    free_all_nodes(s->start);
   }
+  s->start = s->bottom = NULL;
+  s->node = NULL;
+  s->order = NULL;
+  s->num = s->size = 0;
 }
 
-
 #ifdef CONFIDENCE_MEASURE
 
 /**********************************************************************/
@@ -574,11 +1197,11 @@ cm_set_score(StackDecode *sd, NODE *node
 
 #ifdef CM_MULTIPLE_ALPHA
   for (j = 0, a = bgn; a <= end; a += step) {
-    node->cmscore[node->seqnum-1][j] = pow(10, a * (node->score - sd->cm_tmpbestscore)) / sd->cmsumlist[j];
+    node->hist->cmscore[j] = pow(10, a * (node->score - sd->cm_tmpbestscore)) / sd->cmsumlist[j];
     j++;
   }
 #else
-  node->cmscore[node->seqnum-1] = pow(10, sd->cm_alpha * (node->score - sd->cm_tmpbestscore)) / sd->cm_tmpsum;
+  node->hist->cmscore = pow(10, sd->cm_alpha * (node->score - sd->cm_tmpbestscore)) / sd->cm_tmpsum;
 #endif
 }
 
@@ -635,6 +1258,7 @@ static void
 cm_compute_from_nbest(StackDecode *sd, NODE *start, int stacknum, JCONF_SEARCH *jconf)
 {
   NODE *node;
+  WORDHIST *h;
   LOGPROB bestscore, sum, s;
   WORD_ID w;
   int i;
@@ -693,18 +1317,20 @@ cm_compute_from_nbest(StackDecode *sd, NODE *start, int stacknum, JCONF_SEARCH *
     /* compute word posteriori probabilities */
     i = 0;
     for (node = start; node != NULL; node = node->next) {
-      for (w=0;w<node->seqnum;w++) {
-	sd->wordcm[node->seq[w]] += sd->sentcm[i];
+      for (h=node->hist;h;h=h->prev) {
+	sd->wordcm[h->word] += sd->sentcm[i];
       }
       i++;
     }
     /* store the probabilities to node */
+    /* (cells shared among the sentences get the same value, since the
+       probability depends only on the word) */
     for (node = start; node != NULL; node = node->next) {
-      for (w=0;w<node->seqnum;w++) {
+      for (h=node->hist;h;h=h->prev) {
 #ifdef CM_MULTIPLE_ALPHA
-	node->cmscore[w][j] = sd->wordcm[node->seq[w]];
+	h->cmscore[j] = sd->wordcm[h->word];
 #else	
-	node->cmscore[w] = sd->wordcm[node->seq[w]];
+	h->cmscore = sd->wordcm[h->word];
 #endif
       }
     }
@@ -909,10 +1535,12 @@ segment_set_last_nword(NODE *hypo, RecogProcess *r)
 {
   int i;
   WORD_ID w;
+  WORD_ID *seq;
 
   if (r->sp_break_last_nword_allow_override) {
+    seq = wordhist_to_array(hypo);
     for(i=0;i<hypo->seqnum;i++) {
-      w = hypo->seq[i];
+      w = seq[i];
       if (w != r->sp_break_last_word
 	  && !is_sil(w, r)
 	  && !r->lm->winfo->is_transparent[w]
@@ -951,12 +1579,11 @@ segment_set_last_nword(NODE *hypo, RecogProcess *r)
 static void
 put_hypo_woutput(NODE *hypo, WORD_INFO *winfo)
 {
-  int i,w;
+  WORDHIST *h;
 
   if (hypo != NULL) {
-    for (i=hypo->seqnum-1;i>=0;i--) {
-      w = hypo->seq[i];
-      jlog(" %s", winfo->woutput[w]);
+    for (h=hypo->hist;h;h=h->prev) {
+      jlog(" %s", winfo->woutput[h->word]);
     }
   }
   jlog("\n");  
@@ -979,12 +1606,11 @@ put_hypo_woutput(NODE *hypo, WORD_INFO *winfo)
 static void
 put_hypo_wname(NODE *hypo, WORD_INFO *winfo)
 {
-  int i,w;
+  WORDHIST *h;
 
   if (hypo != NULL) {
-    for (i=hypo->seqnum-1;i>=0;i--) {
-      w = hypo->seq[i];
-      jlog(" %s", winfo->wname[w]);
+    for (h=hypo->hist;h;h=h->prev) {
+      jlog(" %s", winfo->wname[h->word]);
     }
   }
   jlog("\n");  
@@ -1007,18 +1633,17 @@ store_result_pass2(NODE *hypo, RecogProcess *r)
 {
   int i;
   Sentence *s;
+  WORDHIST *h;
 
   s = &(r->result.sent[r->result.sentnum]);
 
   s->word_num = hypo->seqnum;
-  for (i = 0; i < hypo->seqnum; i++) {
-    s->word[i] = hypo->seq[hypo->seqnum - 1 - i];
-  }
+  for (i = 0, h = hypo->hist; h != NULL; i++, h = h->prev) {
+    s->word[i] = h->word;
 #ifdef CONFIDENCE_MEASURE
-  for (i = 0; i < hypo->seqnum; i++) {
-    s->confidence[i] = hypo->cmscore[hypo->seqnum - 1 - i];
-  }
+    s->confidence[i] = h->cmscore;
 #endif
+  }
 
   s->score = hypo->score;
   s->score_lm = hypo->totallscore;
@@ -1032,7 +1657,7 @@ store_result_pass2(NODE *hypo, RecogProcess *r)
     /* output which grammar the hypothesis belongs to on multiple grammar */
     /* determine only by the last word */
     if (multigram_get_all_num(r->lm) > 0) {
-      s->gram_id = multigram_get_gram_from_category(r->lm->winfo->wton[hypo->seq[0]], r->lm);
+      s->gram_id = multigram_get_gram_from_category(r->lm->winfo->wton[wordhist_to_array(hypo)[0]], r->lm);
     } else {
       s->gram_id = 0;
     }
@@ -1155,28 +1780,18 @@ void
 pass2_finalize_on_no_result(RecogProcess *r, boolean use_1pass_as_final)
 {
   NODE *now;
-  int i, j;
+  int i;
 
   /* õ */
   /* search failed */
 
   /* make temporal hypothesis data from the result of previous 1st pass */
   now = newnode(r);
+  /* confidence scores are filled with null values */
   for (i=0;i<r->pass1_wnum;i++) {
-    now->seq[i] = r->pass1_wseq[r->pass1_wnum-1-i];
+    wordhist_push(now, now, r->pass1_wseq[r->pass1_wnum-1-i]);
   }
-  now->seqnum = r->pass1_wnum;
   now->score = r->pass1_score;
-#ifdef CONFIDENCE_MEASURE
-  /* fill in null values */
-#ifdef CM_MULTIPLE_ALPHA
-  for(j=0;j<jconf->annotate.cm_alpha_num;j++) {
-    for(i=0;i<now->seqnum;i++) now->cmscore[i][j] = 0.0;
-  }
-#else
-  for(i=0;i<now->seqnum;i++) now->cmscore[i] = 0.0;
-#endif
-#endif /* CONFIDENCE_MEASURE */
   
   if (r->lmtype == LM_PROB && r->config->successive.enabled) {
     /* if in sp segment mode, */
@@ -1234,10 +1849,8 @@ void
 wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 {
   /* ʸ⥹å */
-  /* hypothesis stack (double-linked list) */
-  int stacknum;			/* current stack size */
-  NODE *start = NULL;		/* top node */
-  NODE *bottom = NULL;		/* bottom node */
+  /* hypothesis stack (min-max heap) */
+  HYPOSTACK stack;
 
   /* ǧ̳Ǽå(̤Ϥؤä󽸤) */
   /* result sentence stack (found results will be stored here and then re-ordered) */
@@ -1272,6 +1885,11 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #ifdef GRAPHOUT_SEARCH
   int terminate_search_num = 0;
 #endif
+#ifdef PASS2_THREAD
+  /* for parallel expansion */
+  boolean expand_parallel;
+  int wbgn, wend;
+#endif
 
   /* local temporal parameter */
   int stacksize, ncan, maxhypo, peseqlen;
@@ -1317,10 +1935,19 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
   /* ׻Ѥΰ */
   /* malloc are for forward viterbi (scan_word()) */
   malloc_wordtrellis(r);		/* scan_wordΰ */
+#ifdef SCAN_CACHE
+  /* scan_word() η̤Υå */
+  /* prepare cache of scan_word() results */
+  scan_cache_init(r);
+#endif
+  if (r->lmtype == LM_PROB) {
+    /* N-gram ΨΥϤȤ˥ꥢ */
+    /* clear N-gram probability memo for each input */
+    ngram_memo_prepare(r->lm);
+  }
   /* ⥹å */
   /* initialize hypothesis stack */
-  start = bottom = NULL;
-  stacknum = 0;
+  hypo_stack_init(&stack, stacksize, (stacksize >= HYPOSTACK_HEAP_MIN) ? TRUE : FALSE);
   /* ̳Ǽå */
   /* initialize result stack */
   r_stacksize = ncan;
@@ -1333,6 +1960,12 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
   dwrk->genectr = 0;
   dwrk->pushctr = 0;
   dwrk->finishnum = 0;
+
+#ifdef PASS2_THREAD
+  /* N-gram ξϼñŸ˹Ԥ */
+  /* expand next words in parallel for N-gram */
+  expand_parallel = (r->lmtype == LM_PROB && dwrk->thread_num > 1) ? TRUE : FALSE;
+#endif
   
 #ifdef CM_SEARCH
   /* initialize local stack */
@@ -1402,7 +2035,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
     cm_store(dwrk, new);
 #else 
     /* put to stack */
-    if (put_to_stack(new, &start, &bottom, &stacknum, stacksize) != -1) {
+    if (hypo_stack_put(&stack, new) != -1) {
       dwrk->current = new;
       //callback_exec(CALLBACK_DEBUG_PASS2_PUSH, r);
       if (jconf->graph.enabled) {
@@ -1433,7 +2066,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 		 );
 #ifdef CM_SEARCH_LIMIT
-    if (new->cmscore[new->seqnum-1] < jconf->annotate.cm_cut_thres
+    if (new->hist->cmscore < jconf->annotate.cm_cut_thres
 #ifdef CM_SEARCH_LIMIT_AFTER
 	&& dwrk->finishnum > 0
 #endif
@@ -1443,7 +2076,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
     }
 #endif /* CM_SEARCH_LIMIT */
     
-    if (put_to_stack(new, &start, &bottom, &stacknum, stacksize) != -1) {
+    if (hypo_stack_put(&stack, new) != -1) {
       dwrk->current = new;
       //callback_exec(CALLBACK_DEBUG_PASS2_PUSH, r);
       if (r->graphout) {
@@ -1480,7 +2113,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #ifdef DEBUG
     jlog("DEBUG: get one hypothesis\n");
 #endif
-    now = get_best_from_stack(&start,&stacknum);
+    now = hypo_stack_pop_best(&stack);
     if (now == NULL) {  /* stack empty ---> õλ*/
       jlog("WARNING: %02d %s: hypothesis stack exhausted, terminate search now\n", r->config->id, r->config->name);
       jlog("STAT: %02d %s: %d sentences have been found\n", r->config->id, r->config->name, dwrk->finishnum);
@@ -1517,7 +2150,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
     }
     
 #ifdef CM_SEARCH_LIMIT_POP
-    if (now->cmscore[now->seqnum-1] < jconf->annotate.cm_cut_thres_pop) {
+    if (now->hist->cmscore < jconf->annotate.cm_cut_thres_pop) {
       free_node(now);
       continue;
     }
@@ -1542,7 +2175,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 
 #ifdef GRAPHOUT_DYNAMIC
       /* merge last word in popped hypo if possible */
-      wtmp = wordgraph_check_merge(now->prevgraph, &wordgraph_root, now->seq[now->seqnum-1], &merged_p, jconf);
+      wtmp = wordgraph_check_merge(now->prevgraph, &wordgraph_root, now->hist->word, &merged_p, jconf);
       if (wtmp != NULL) {		/* wtmp holds merged word */
 	dynamic_merged_num++;
 
@@ -1663,7 +2296,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
       jlog("WARNING: %02d %s: num of popped hypotheses reached the limit (%d)\n", r->config->id, r->config->name, maxhypo);
       /* (for debug) õԻˡå˻ĤäǤФ */
       /* (for debug) output all hypothesis remaining in the stack */
-      if (debug2_flag) put_all_in_stack(&start, &stacknum, r->lm->winfo);
+      if (debug2_flag) hypo_stack_put_all(&stack, r->lm->winfo);
       free_node(now);
       break;			/* end of search */
     }
@@ -1742,13 +2375,13 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 	jlog("DEBUG  This hypo itself was pushed with final score=%f\n", new->score);
       }
       new->endflag = TRUE;
-      if (put_to_stack(new, &start, &bottom, &stacknum, stacksize) != -1) {
+      if (hypo_stack_put(&stack, new) != -1) {
 	if (r->graphout) {
 	  if (new->score > LOG_ZERO) {
 	    new->lastcontext = now->prevgraph;
-	    new->prevgraph = wordgraph_assign(new->seq[new->seqnum-1],
+	    new->prevgraph = wordgraph_assign(new->hist->word,
 					      WORD_INVALID,
-					      (new->seqnum >= 2) ? new->seq[new->seqnum-2] : WORD_INVALID,
+					      (new->seqnum >= 2) ? new->hist->prev->word : WORD_INVALID,
 					      0,
 #ifdef GRAPHOUT_PRECISE_BOUNDARY
 					      /* wordend are shifted to the last */
@@ -1774,7 +2407,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 					      now->lscore,
 #ifdef CM_SEARCH
-					      new->cmscore[new->seqnum-1],
+					      new->hist->cmscore,
 #else
 					      LOG_ZERO,
 #endif
@@ -1851,6 +2484,9 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 	    );
 #endif
 
+#ifdef PASS2_THREAD
+    wbgn = wend = 0;
+#endif
     /* for each nextword, generate a new hypothesis */
     for (w = 0; w < nwnum; w++) {
       if (r->lmtype == LM_DFA) {
@@ -1859,7 +2495,22 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 	  continue;
 	}
       }
+#ifdef PASS2_THREAD
+      if (expand_parallel) {
+	/* μñ줴ȤˤޤȤ˲Ƥ */
+	/* generate new hypotheses in parallel for every batch of words */
+	if (w >= wend) {
+	  wbgn = w;
+	  wend = (w + PASS2_THREAD_BATCH < nwnum) ? w + PASS2_THREAD_BATCH : nwnum;
+	  next_word_parallel(now, &(nextword[wbgn]), wend - wbgn, param, r);
+	}
+	new = dwrk->expnode[w - wbgn];
+      } else {
+	new = newnode(r);
+      }
+#else
       new = newnode(r);
+#endif
 
       if (r->lmtype == LM_DFA) {
 
@@ -1907,7 +2558,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 	       ǺǸΥΥñ now_noise ä */
 	    /* now that score has been computed considering pause insertion,
 	       we can delete the last noise word from now_noise here */
-	    now_noise->seqnum--;
+	    wordhist_pop(now_noise);
 #endif
 	    now_noise_calced = TRUE;
 	  }
@@ -1951,6 +2602,9 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 	   N-gram ξϥΥ̰ʤ */
 	/* generate a new hypothesis 'new' from 'now'.
 	   pause insertion is treated as same as normal words in N-gram mode. */
+#ifdef PASS2_THREAD
+	if (! expand_parallel)	/* already generated */
+#endif
 	next_word(now, new, nextword[w], param, r);
 
       }
@@ -1970,7 +2624,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
       /* push the generated hypothesis 'new' to stack */
 
       /* stack overflow */
-      if (can_put_to_stack(new, &bottom, &stacknum, stacksize) == -1) {
+      if (hypo_stack_can_put(&stack, new) == -1) {
 	free_node(new);
 	continue;
       }
@@ -1978,9 +2632,9 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
       if (r->graphout) {
 	/* assign a word arc to the last fixed word */
 	new->lastcontext = now->prevgraph;
-	new->prevgraph = wordgraph_assign(new->seq[new->seqnum-2],
-					  new->seq[new->seqnum-1],
-					  (new->seqnum >= 3) ? new->seq[new->seqnum-3] : WORD_INVALID,
+	new->prevgraph = wordgraph_assign(new->hist->prev->word,
+					  new->hist->word,
+					  (new->seqnum >= 3) ? new->hist->prev->prev->word : WORD_INVALID,
 					  new->bestt + 1,
 #ifdef GRAPHOUT_PRECISE_BOUNDARY
 #ifdef PASS2_STRICT_IWCD
@@ -2010,16 +2664,16 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 					  now->lscore,
 #ifdef CM_SEARCH
-					  new->cmscore[new->seqnum-2],
+					  new->hist->prev->cmscore,
 #else
 					  LOG_ZERO,
 #endif
 					  r
 					  );
       }	/* recog->graphout */
-      put_to_stack(new, &start, &bottom, &stacknum, stacksize);
+      hypo_stack_put(&stack, new);
       if (debug2_flag) {
-	j = new->seq[new->seqnum-1];
+	j = new->hist->word;
 	jlog("DEBUG:  %15s [%15s](id=%5d)(%f) [%d-%d] pushed\n",winfo->wname[j], winfo->woutput[j], j, new->score, new->estimated_next_t + 1, new->bestt);
       }
       dwrk->current = new;
@@ -2047,7 +2701,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 		   );
 #ifdef CM_SEARCH_LIMIT
-      if (new->cmscore[new->seqnum-1] < jconf->annotate.cm_cut_thres
+      if (new->hist->cmscore < jconf->annotate.cm_cut_thres
 #ifdef CM_SEARCH_LIMIT_AFTER
 	  && dwrk->finishnum > 0
 #endif
@@ -2056,11 +2710,11 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 	continue;
       }
 #endif /* CM_SEARCH_LIMIT */
-      /*      j = new->seq[new->seqnum-1];
-	      printf("  %15s [%15s](id=%5d)(%f) [%d-%d] cm=%f\n",winfo->wname[j], winfo->woutput[j], j, new->score, new->estimated_next_t + 1, new->bestt, new->cmscore[new->seqnum-1]);*/
+      /*      j = new->hist->word;
+	      printf("  %15s [%15s](id=%5d)(%f) [%d-%d] cm=%f\n",winfo->wname[j], winfo->woutput[j], j, new->score, new->estimated_next_t + 1, new->bestt, new->hist->cmscore);*/
 
       /* stack overflow */
-      if (can_put_to_stack(new, &bottom, &stacknum, stacksize) == -1) {
+      if (hypo_stack_can_put(&stack, new) == -1) {
 	free_node(new);
 	continue;
       }
@@ -2069,9 +2723,9 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 
 	/* assign a word arc to the last fixed word */
 	new->lastcontext = now->prevgraph;
-	new->prevgraph = wordgraph_assign(new->seq[new->seqnum-2],
-					  new->seq[new->seqnum-1],
-					  (new->seqnum >= 3) ? new->seq[new->seqnum-3] : WORD_INVALID,
+	new->prevgraph = wordgraph_assign(new->hist->prev->word,
+					  new->hist->word,
+					  (new->seqnum >= 3) ? new->hist->prev->prev->word : WORD_INVALID,
 					  new->bestt + 1,
 #ifdef GRAPHOUT_PRECISE_BOUNDARY
 #ifdef PASS2_STRICT_IWCD
@@ -2099,7 +2753,7 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 #endif
 					  now->lscore,
 #ifdef CM_SEARCH
-					  new->cmscore[new->seqnum-2],
+					  new->hist->prev->cmscore,
 #else
 					  LOG_ZERO,
 #endif
@@ -2107,9 +2761,9 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
 					  );
       }	/* recog->graphout */
       
-      put_to_stack(new, &start, &bottom, &stacknum, stacksize);
+      hypo_stack_put(&stack, new);
       if (debug2_flag) {
-	j = new->seq[new->seqnum-1];
+	j = new->hist->word;
 	jlog("DEBUG:  %15s [%15s](id=%5d)(%f) [%d-%d] pushed\n",winfo->wname[j], winfo->woutput[j], j, new->score, new->estimated_next_t + 1, new->bestt);
       }
       dwrk->current = new;
@@ -2189,6 +2843,21 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
       jlog(" in %d\n", dwrk->popctr);
     }
 #endif
+#ifdef SCAN_CACHE
+    if (dwrk->scache != NULL) {
+      jlog("STAT: %02d %s: scan cache: %d hits in %d lookups (%.1f%%), %d frames saved, %d evicted\n",
+	   r->config->id, r->config->name,
+	   dwrk->scache_hit, dwrk->scache_lookup,
+	   (dwrk->scache_lookup > 0) ? (float)dwrk->scache_hit * 100.0 / (float)dwrk->scache_lookup : 0.0,
+	   dwrk->scache_saved_frames, dwrk->scache_evicted);
+    }
+#endif
+    if (r->lmtype == LM_PROB && r->lm->memo != NULL) {
+      jlog("STAT: %02d %s: N-gram memo: %d hits in %d lookups (%.1f%%)\n",
+	   r->config->id, r->config->name,
+	   r->lm->memo->hit, r->lm->memo->lookup,
+	   (r->lm->memo->lookup > 0) ? (float)r->lm->memo->hit * 100.0 / (float)r->lm->memo->lookup : 0.0);
+    }
   }
     
   if (dwrk->finishnum > 0 && r->graphout) {
@@ -2271,8 +2940,11 @@ wchmm_fbs(HTK_Param *param, RecogProcess *r, int cate_bgn, int cate_num)
   /* λ */
   /* finalize */
   nw_free(nextword, nwroot);
-  free_all_nodes(start);
+  hypo_stack_free(&stack);
   free_wordtrellis(dwrk);
+#ifdef SCAN_CACHE
+  scan_cache_free(r);
+#endif
 #ifdef SCAN_BEAM
   free(dwrk->framemaxscore);
 #endif
@@ -2310,7 +2982,30 @@ wchmm_fbs_prepare(RecogProcess *r)
   } else {
     dwrk->cnword = dwrk->cnwordrev = NULL;
   }
+  /* ñȥꥹμñ측Ѻȥꥢ */
+  /* malloc work area for next word lookup on word trellis */
+  if (r->lmtype == LM_PROB) {
+    dwrk->nw_stamp = (unsigned int *)mymalloc(sizeof(unsigned int) * r->lm->winfo->num);
+    memset(dwrk->nw_stamp, 0, sizeof(unsigned int) * r->lm->winfo->num);
+    dwrk->nw_gen = 0;
+    dwrk->nw_owner = (TRELLIS_ATOM **)mymalloc(sizeof(TRELLIS_ATOM *) * r->lm->winfo->num);
+    dwrk->nw_frame = (int *)mymalloc(sizeof(int) * (r->config->pass2.lookup_range * 2 + 1));
+    dwrk->nw_pos = (int *)mymalloc(sizeof(int) * (r->config->pass2.lookup_range * 2 + 1));
+  } else {
+    dwrk->nw_stamp = NULL;
+    dwrk->nw_owner = NULL;
+    dwrk->nw_frame = dwrk->nw_pos = NULL;
+  }
   dwrk->stocker_root = NULL;
+  dwrk->wordhist_stocker = NULL;
+  dwrk->framescore_stocker = NULL;
+  dwrk->seqbuf = NULL;
+  dwrk->seqbuflen = 0;
+#ifdef PASS2_THREAD
+  /* ŸѤΥåɤư */
+  /* start threads for parallel expansion */
+  next_word_thread_start(r);
+#endif
 #ifdef CONFIDENVE_MEASURE
 #ifdef CM_MULTIPLE_ALPHA
   dwrk->cmsumlist = NULL;
@@ -2349,6 +3044,24 @@ wchmm_fbs_free(RecogProcess *r)
     free(dwrk->cnwordrev);
     dwrk->cnword = dwrk->cnwordrev = NULL;
   }
+  if (r->lmtype == LM_PROB) {
+    free(dwrk->nw_stamp);
+    free(dwrk->nw_owner);
+    free(dwrk->nw_frame);
+    free(dwrk->nw_pos);
+    dwrk->nw_stamp = NULL;
+    dwrk->nw_owner = NULL;
+    dwrk->nw_frame = dwrk->nw_pos = NULL;
+  }
+#ifdef PASS2_THREAD
+  next_word_thread_end(r);
+#endif
+  clear_stocker(dwrk);
+  if (dwrk->seqbuf) {
+    free(dwrk->seqbuf);
+    dwrk->seqbuf = NULL;
+    dwrk->seqbuflen = 0;
+  }
 
 #ifdef CONFIDENVE_MEASURE
 #ifdef CM_MULTIPLE_ALPHA
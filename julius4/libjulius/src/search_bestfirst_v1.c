@@ -104,6 +104,10 @@
 
 #include <julius/julius.h>
 
+#ifdef PASS2_THREAD
+#include <pthread.h>
+#endif
+
 #ifndef PASS2_STRICT_IWCD
 
 #undef TCD			///< Define if want triphone debug messages
@@ -116,12 +120,109 @@
 #undef STOCKER_DEBUG
 
 #ifdef STOCKER_DEBUG
-static int stocked_num = 0;
-static int reused_num = 0;
-static int new_num = 0;
-static int request_num = 0;
+static THREAD_LOCAL int stocked_num = 0;
+static THREAD_LOCAL int reused_num = 0;
+static THREAD_LOCAL int new_num = 0;
+static THREAD_LOCAL int request_num = 0;
 #endif
 
+/** 
+ * <JA>
+ *  g_prev[] ؤλȤ. ȿ 0 ˤʤäΰ
+ * Ǽˤᤵ. 
+ * 
+ * @param node [i/o] Ρ
+ * </JA>
+ * <EN>
+ * Release the reference to g_prev[] of a hypothesis.  The buffer whose
+ * reference count becomes 0 is returned to the stocker.
+ * 
+ * @param node [i/o] hypothesis node
+ * </EN>
+ */
+static void
+release_g_prev(NODE *node)
+{
+  FRAMESCORE *f;
+
+  f = node->g_prev_buf;
+  if (f != NULL) {
+    if (--(f->refcount) == 0) {
+      f->next = node->region->pass2.framescore_stocker;
+      node->region->pass2.framescore_stocker = f;
+    }
+  }
+  node->g_prev_buf = NULL;
+  node->g_prev = NULL;
+}
+
+/** 
+ * <JA>
+ *  @a src  g_prev[]  @a dst ȶͭ. 
+ * 
+ * @param dst [i/o] ͭβ
+ * @param src [in] ͭβ
+ * </JA>
+ * <EN>
+ * Share g_prev[] of hypothesis @a src with @a dst.
+ * 
+ * @param dst [i/o] target hypothesis
+ * @param src [in] source hypothesis
+ * </EN>
+ */
+static void
+share_g_prev(NODE *dst, NODE *src)
+{
+  if (src->g_prev_buf != NULL) src->g_prev_buf->refcount++;
+  release_g_prev(dst);
+  dst->g_prev_buf = src->g_prev_buf;
+  dst->g_prev = src->g_prev;
+}
+
+/** 
+ * <JA>
+ *  g_prev[] 񤭴ǽˤ. ¾βȶͭƤ
+ * ʣޤ̵ LOG_ZERO ǽΰƤ. 
+ * 
+ * @param node [i/o] Ρ
+ * </JA>
+ * <EN>
+ * Make g_prev[] of a hypothesis writable.  If it is shared with other
+ * hypotheses it is duplicated, and if not assigned yet a new buffer
+ * initialized by LOG_ZERO is assigned.
+ * 
+ * @param node [i/o] hypothesis node
+ * </EN>
+ */
+static void
+own_g_prev(NODE *node)
+{
+  StackDecode *dwrk;
+  FRAMESCORE *f;
+  int peseqlen;
+  int t;
+
+  if (node->g_prev_buf != NULL && node->g_prev_buf->refcount == 1) return;
+
+  dwrk = &(node->region->pass2);
+  peseqlen = node->region->peseqlen;
+  if ((f = dwrk->framescore_stocker) != NULL) {
+    dwrk->framescore_stocker = f->next;
+  } else {
+    f = (FRAMESCORE *)mymalloc(sizeof(FRAMESCORE));
+    f->s = (LOGPROB *)mymalloc(sizeof(LOGPROB) * peseqlen);
+  }
+  f->refcount = 1;
+  if (node->g_prev_buf != NULL) {
+    memcpy(f->s, node->g_prev, sizeof(LOGPROB) * peseqlen);
+  } else {
+    for (t=0;t<peseqlen;t++) f->s[t] = LOG_ZERO;
+  }
+  release_g_prev(node);
+  node->g_prev_buf = f;
+  node->g_prev = f->s;
+}
+
 /** 
  * <JA>
  * Ρɤºݤ˥夫. 
@@ -140,7 +241,6 @@ free_node_exec(NODE *node)
   if (node == NULL) return;
 
   free(node->g);
-  if (node->g_prev != NULL) free(node->g_prev);
 #ifdef GRAPHOUT_PRECISE_BOUNDARY
   if (node->region->graphout) {
     free(node->wordend_frame);
@@ -177,6 +277,10 @@ free_node(NODE *node)
     }
   }
 
+  /* release shared word history and scores */
+  wordhist_release(node);
+  release_g_prev(node);
+
   /* save to stocker */
   node->next = node->region->pass2.stocker_root;
   node->region->pass2.stocker_root = node;
@@ -206,6 +310,7 @@ void
 clear_stocker(StackDecode *s)
 {
   NODE *node, *tmp;
+  FRAMESCORE *f, *ftmp;
   node = s->stocker_root;
   while(node) {
     tmp = node->next;
@@ -213,6 +318,15 @@ clear_stocker(StackDecode *s)
     node = tmp;
   }
   s->stocker_root = NULL;
+  f = s->framescore_stocker;
+  while(f) {
+    ftmp = f->next;
+    free(f->s);
+    free(f);
+    f = ftmp;
+  }
+  s->framescore_stocker = NULL;
+  wordhist_clear_stocker(s);
 
 #ifdef STOCKER_DEBUG
   jlog("DEBUG: %d times requested, %d times newly allocated, %d times reused\n", request_num, new_num, reused_num);
@@ -253,28 +367,15 @@ cpy_node(NODE *dst, NODE *src)
   dst->next = src->next;
   dst->prev = src->prev;
   memcpy(dst->g, src->g, sizeof(LOGPROB) * peseqlen);
-  memcpy(dst->seq, src->seq, sizeof(WORD_ID) * MAXSEQNUM);
-#ifdef CM_SEARCH
-#ifdef CM_MULTIPLE_ALPHA
-  {
-    int w;
-    for(w=0;w<src->seqnum;w++) {
-      memcpy(dst->cmscore[w], src->cmscore[w], sizeof(LOGPROB) * src->region->config->annotate.cm_alpha_num);
-    }
-  }     
-#else
-  memcpy(dst->cmscore, src->cmscore, sizeof(LOGPROB) * MAXSEQNUM);
-#endif
-#endif /* CM_SEARCH */
-  dst->seqnum = src->seqnum;
+  wordhist_share(dst, src);
   dst->score = src->score;
   dst->bestt = src->bestt;
   dst->estimated_next_t = src->estimated_next_t;
   dst->endflag = src->endflag;
   dst->state = src->state;
   dst->tre = src->tre;
-  if (src->g_prev != NULL) { // ccd_flag == TRUE
-    memcpy(dst->g_prev, src->g_prev, sizeof(LOGPROB) * peseqlen);
+  if (src->region->ccd_flag) {
+    share_g_prev(dst, src);
     dst->last_ph = src->last_ph;
     dst->last_ph_sp_attached = src->last_ph_sp_attached;
     dst->lscore = src->lscore;
@@ -343,11 +444,6 @@ newnode(RecogProcess *r)
     /* allocate new */
     tmp =(NODE *)mymalloc(sizeof(NODE));
     tmp->g = (LOGPROB *)mymalloc(sizeof(LOGPROB) * peseqlen);
-    if (r->ccd_flag) {
-      tmp->g_prev = (LOGPROB *)mymalloc(sizeof(LOGPROB) * peseqlen);
-    } else {
-      tmp->g_prev = NULL;
-    }
 
 #ifdef GRAPHOUT_PRECISE_BOUNDARY
     if (r->graphout) {
@@ -376,15 +472,14 @@ newnode(RecogProcess *r)
     }
   }
   tmp->endflag = FALSE;
+  tmp->hist = NULL;
   tmp->seqnum = 0;
   for(i=0;i<peseqlen;i++) {
     tmp->g[i] = LOG_ZERO;
   }
-  if (r->ccd_flag) {
-    for(i=0;i<peseqlen;i++) {
-      tmp->g_prev[i] = LOG_ZERO;
-    }
-  }
+  /* g_prev[] will be assigned at first write or shared from the source */
+  tmp->g_prev = NULL;
+  tmp->g_prev_buf = NULL;
   tmp->final_g = LOG_ZERO;
 #ifdef VISUALIZE
   tmp->popnode = NULL;
@@ -564,6 +659,392 @@ max_out_arc(HMM_Logical *l)
   return(get_max_out_arc(hmm_logical_trans(l), hmm_logical_state_num(l)));
 }
 
+#ifdef SCAN_CACHE
+
+/**********************************************************************/
+/************ ñ쥹̤Υå                ************/
+/************ Cache of word scan results                  ************/
+/**********************************************************************/
+
+/**
+ * <JA>
+ * åΥϥåͤ.
+ *
+ * @param word [in] ñID
+ * @param last_ph [in] ƥȲ
+ * @param startt [in] ϥե졼
+ *
+ * @return ϥå
+ * </JA>
+ * <EN>
+ * Compute hash value from the cache key.
+ *
+ * @param word [in] word ID
+ * @param last_ph [in] right context phone
+ * @param startt [in] start frame
+ *
+ * @return the hash value.
+ * </EN>
+ */
+static unsigned int
+scan_cache_hash(WORD_ID word, HMM_Logical *last_ph, int startt)
+{
+  unsigned int h;
+
+  h = (unsigned int)word * 2654435761u;
+  h ^= (unsigned int)((size_t)last_ph >> 4) * 40503u;
+  h ^= (unsigned int)startt * 97u;
+  return(h & (SCAN_CACHE_HASH_SIZE - 1));
+}
+
+/**
+ * <JA>
+ * ȥ LRU ꥹȤ鳰.
+ *
+ * @param dwrk [i/o] 2ѥѥꥢ
+ * @param e [in] ȥ
+ * </JA>
+ * <EN>
+ * Unlink an entry from the LRU list.
+ *
+ * @param dwrk [i/o] work area for 2nd pass
+ * @param e [in] entry
+ * </EN>
+ */
+static void
+scan_cache_lru_unlink(StackDecode *dwrk, SCANCACHE *e)
+{
+  if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+  else dwrk->scache_lru_head = e->lru_next;
+  if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+  else dwrk->scache_lru_tail = e->lru_prev;
+  e->lru_prev = e->lru_next = NULL;
+}
+
+/**
+ * <JA>
+ * ȥ LRU ꥹȤƬ (Ƕ) ֤.
+ *
+ * @param dwrk [i/o] 2ѥѥꥢ
+ * @param e [in] ȥ
+ * </JA>
+ * <EN>
+ * Put an entry at the head (most recently used) of the LRU list.
+ *
+ * @param dwrk [i/o] work area for 2nd pass
+ * @param e [in] entry
+ * </EN>
+ */
+static void
+scan_cache_lru_push(StackDecode *dwrk, SCANCACHE *e)
+{
+  e->lru_prev = NULL;
+  e->lru_next = dwrk->scache_lru_head;
+  if (dwrk->scache_lru_head) dwrk->scache_lru_head->lru_prev = e;
+  dwrk->scache_lru_head = e;
+  if (dwrk->scache_lru_tail == NULL) dwrk->scache_lru_tail = e;
+}
+
+/**
+ * <JA>
+ * ǤĹȤƤʤȥΤƤ.
+ *
+ * @param dwrk [i/o] 2ѥѥꥢ
+ * </JA>
+ * <EN>
+ * Discard the least recently used entry.
+ *
+ * @param dwrk [i/o] work area for 2nd pass
+ * </EN>
+ */
+static void
+scan_cache_evict(StackDecode *dwrk)
+{
+  SCANCACHE *e, **p;
+
+  e = dwrk->scache_lru_tail;
+  if (e == NULL) return;
+  scan_cache_lru_unlink(dwrk, e);
+  for (p = &(dwrk->scache[scan_cache_hash(e->word, e->last_ph, e->startt)]); *p != e; p = &((*p)->next));
+  *p = e->next;
+  dwrk->scache_bytes -= e->size;
+  dwrk->scache_evicted++;
+  free(e);
+}
+
+/**
+ * <JA>
+ * 2ѥγϻ˥󥭥å. "-scancache" 
+ * ꤵƤʤв⤷ʤ.
+ *
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Prepare scan cache at the beginning of the 2nd pass.  Does nothing
+ * if "-scancache" is not specified.
+ *
+ * @param r [i/o] recognition process instance
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+scan_cache_init(RecogProcess *r)
+{
+  StackDecode *dwrk;
+  int i;
+
+  dwrk = &(r->pass2);
+  dwrk->scache = NULL;
+  dwrk->scache_lru_head = dwrk->scache_lru_tail = NULL;
+  dwrk->scache_bytes = 0;
+  dwrk->scache_lookup = 0;
+  dwrk->scache_hit = 0;
+  dwrk->scache_saved_frames = 0;
+  dwrk->scache_evicted = 0;
+  /* exact hits are found only on grammar */
+  if (r->lmtype != LM_DFA || r->config->pass2.scan_cache_size <= 0) return;
+
+  dwrk->scache_maxbytes = (size_t)r->config->pass2.scan_cache_size * 1024 * 1024;
+  dwrk->scache = (SCANCACHE **)mymalloc(sizeof(SCANCACHE *) * SCAN_CACHE_HASH_SIZE);
+  for(i=0;i<SCAN_CACHE_HASH_SIZE;i++) dwrk->scache[i] = NULL;
+}
+
+/**
+ * <JA>
+ * 2ѥνλ˥󥭥å.
+ *
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Free scan cache at the end of the 2nd pass.
+ *
+ * @param r [i/o] recognition process instance
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+scan_cache_free(RecogProcess *r)
+{
+  StackDecode *dwrk;
+  SCANCACHE *e, *etmp;
+
+  dwrk = &(r->pass2);
+  if (dwrk->scache == NULL) return;
+  e = dwrk->scache_lru_head;
+  while (e) {
+    etmp = e->lru_next;
+    free(e);
+    e = etmp;
+  }
+  free(dwrk->scache);
+  dwrk->scache = NULL;
+  dwrk->scache_lru_head = dwrk->scache_lru_tail = NULL;
+  dwrk->scache_bytes = 0;
+}
+
+/**
+ * <JA>
+ * κǽñΥ̤򥭥å夫õ. ñ졦ƥ
+ * ǡϥե졼ࡦüե졼बפե졼
+ * ȥ֤. ٥פˤ޴ͤõ
+ * ѲΤǡ׻ե졼Υ٥פפɬפ.
+ * äƸĤä̤ scan_word() ¹ԤȴƱˤʤ.
+ *
+ * @param now [in] ʸ
+ * @param startt [in] ϥե졼
+ * @param r [i/o] ǧ󥹥
+ *
+ * @return Ĥäȥꡤʤ NULL
+ * </JA>
+ * <EN>
+ * Look up the scan result of the last word of a hypothesis from cache.
+ * An entry will be returned if its word, right context phone, start
+ * frame and estimated beginning frame are the same, and the initial
+ * scores are equal at all frames.  Since the pruning threshold by the
+ * score envelope changes while search, the envelope should also be the
+ * same at the computed frames.  Thus the found result is exactly the
+ * same as that of running scan_word().
+ *
+ * @param now [in] hypothesis
+ * @param startt [in] start frame
+ * @param r [i/o] recognition process instance
+ *
+ * @return the found entry, or NULL if not found.
+ * </EN>
+ */
+static SCANCACHE *
+scan_cache_lookup(NODE *now, int startt, RecogProcess *r)
+{
+  StackDecode *dwrk;
+  SCANCACHE *e;
+  LOGPROB *g;
+  int t;
+
+  dwrk = &(r->pass2);
+  g = dwrk->g;
+  dwrk->scache_lookup++;
+  for (e = dwrk->scache[scan_cache_hash(now->hist->word, now->last_ph, startt)]; e; e = e->next) {
+    if (e->word != now->hist->word
+	|| e->last_ph != now->last_ph
+	|| e->last_ph_sp_attached != now->last_ph_sp_attached
+	|| e->startt != startt
+	|| e->estimated_next_t != now->estimated_next_t) continue;
+    /* the LM score at the word boundary of backscan */
+    if (now->last_ph != NULL && e->lscore != now->lscore) continue;
+    for (t = startt; t >= 0; t--) {
+      if (g[t] != e->in[t]) break;
+    }
+    if (t >= 0) continue;
+#ifdef SCAN_BEAM
+    /* pruning thresholds at the computed frames */
+    for (t = startt; t >= e->endt; t--) {
+      if (dwrk->framemaxscore[t] != e->envl[t]) break;
+    }
+    if (t >= e->endt) continue;
+#endif
+    /* found */
+    scan_cache_lru_unlink(dwrk, e);
+    scan_cache_lru_push(dwrk, e);
+    return(e);
+  }
+  return(NULL);
+}
+
+/**
+ * <JA>
+ * åΥȥ꤫鲾Υ̤.
+ *
+ * @param e [in] ȥ
+ * @param now [i/o] ʸ
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Restore the scan result of a hypothesis from a cache entry.
+ *
+ * @param e [in] entry
+ * @param now [i/o] hypothesis
+ * @param r [i/o] recognition process instance
+ * </EN>
+ */
+static void
+scan_cache_restore(SCANCACHE *e, NODE *now, RecogProcess *r)
+{
+  int t;
+
+  for (t = e->startt; t >= 0; t--) now->g[t] = e->g[t];
+  if (e->g_prev) {
+    for (t = e->startt; t >= 0; t--) now->g_prev[t] = e->g_prev[t];
+  }
+#ifdef GRAPHOUT_PRECISE_BOUNDARY
+  if (e->wordend_frame) {
+    for (t = e->startt; t >= 0; t--) {
+      now->wordend_frame[t] = e->wordend_frame[t];
+      now->wordend_gscore[t] = e->wordend_gscore[t];
+    }
+  }
+#endif
+  if (r->am->hmminfo->multipath) now->final_g = e->final_g;
+  r->pass2.scache_hit++;
+  r->pass2.scache_saved_frames += e->startt - e->endt + 1;
+}
+
+/**
+ * <JA>
+ * κǽñΥ̤򥭥å˳Ǽ. ѥ꤬
+ * ¤ۤϺǤĹȤƤʤȥ꤫ΤƤ.
+ *
+ * @param now [in] Ѥߤʸ (last_ph Ϲ)
+ * @param startt [in] ϥե졼
+ * @param endt [in] ׻ǸΥե졼
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Store the scan result of the last word of a hypothesis to cache.  If
+ * the memory usage exceeds the limit, the least recently used entries
+ * will be discarded.
+ *
+ * @param now [in] scanned hypothesis (before updating last_ph)
+ * @param startt [in] start frame
+ * @param endt [in] last frame computed
+ * @param r [i/o] recognition process instance
+ * </EN>
+ */
+static void
+scan_cache_store(NODE *now, int startt, int endt, RecogProcess *r)
+{
+  StackDecode *dwrk;
+  SCANCACHE *e;
+  int len, t;
+  size_t size;
+  unsigned int h;
+  char *p;
+
+  dwrk = &(r->pass2);
+  len = startt + 1;
+  size = sizeof(SCANCACHE) + sizeof(LOGPROB) * len * 2;
+#ifdef SCAN_BEAM
+  size += sizeof(LOGPROB) * len;
+#endif
+  if (r->ccd_flag) size += sizeof(LOGPROB) * len;
+#ifdef GRAPHOUT_PRECISE_BOUNDARY
+  if (r->graphout) size += (sizeof(LOGPROB) + sizeof(short)) * len;
+#endif
+  if (size > dwrk->scache_maxbytes) return;
+  while (dwrk->scache_bytes + size > dwrk->scache_maxbytes) {
+    scan_cache_evict(dwrk);
+  }
+
+  e = (SCANCACHE *)mymalloc(size);
+  p = (char *)e + sizeof(SCANCACHE);
+  e->size = size;
+  e->word = now->hist->word;
+  e->last_ph = now->last_ph;
+  e->last_ph_sp_attached = now->last_ph_sp_attached;
+  e->startt = startt;
+  e->estimated_next_t = now->estimated_next_t;
+  e->endt = endt;
+  e->lscore = now->lscore;
+  e->in = (LOGPROB *)p; p += sizeof(LOGPROB) * len;
+  e->g = (LOGPROB *)p; p += sizeof(LOGPROB) * len;
+  for (t = 0; t < len; t++) {
+    e->in[t] = dwrk->g[t];
+    e->g[t] = now->g[t];
+  }
+#ifdef SCAN_BEAM
+  e->envl = (LOGPROB *)p; p += sizeof(LOGPROB) * len;
+  for (t = 0; t < len; t++) e->envl[t] = dwrk->framemaxscore[t];
+#endif
+  if (r->ccd_flag) {
+    e->g_prev = (LOGPROB *)p; p += sizeof(LOGPROB) * len;
+    for (t = 0; t < len; t++) e->g_prev[t] = now->g_prev[t];
+  } else {
+    e->g_prev = NULL;
+  }
+  e->wordend_frame = NULL;
+  e->wordend_gscore = NULL;
+#ifdef GRAPHOUT_PRECISE_BOUNDARY
+  if (r->graphout) {
+    e->wordend_gscore = (LOGPROB *)p; p += sizeof(LOGPROB) * len;
+    e->wordend_frame = (short *)p;
+    for (t = 0; t < len; t++) {
+      e->wordend_frame[t] = now->wordend_frame[t];
+      e->wordend_gscore[t] = now->wordend_gscore[t];
+    }
+  }
+#endif
+  e->final_g = r->am->hmminfo->multipath ? now->final_g : LOG_ZERO;
+
+  h = scan_cache_hash(e->word, e->last_ph, e->startt);
+  e->next = dwrk->scache[h];
+  dwrk->scache[h] = e;
+  scan_cache_lru_push(dwrk, e);
+  dwrk->scache_bytes += size;
+}
+
+#endif /* SCAN_CACHE */
+
 /** 
  * <JA>
  * Ǹ1ñȥꥹ׻ơʸ٤򹹿. 
@@ -605,6 +1086,9 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
   boolean node_exist_p;
   int tn;		       ///< Temporal pointer to current buffer
   int tl;		       ///< Temporal pointer to previous buffer
+#ifdef SCAN_CACHE
+  SCANCACHE *cached;	       ///< Cached result found for this scan
+#endif
 
   /* store global values to local for rapid access */
   WORD_INFO *winfo;
@@ -642,13 +1126,15 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
     /* if there are any last phone, enable backscan */
     if (now->last_ph == NULL) {
       /* initial score: now->g[] */
-      /* scan range: phones in now->seq[now->seqnum-1] */
+      /* scan range: phones in now->hist->word */
       back_rescan = FALSE;
     } else {
       /* initial score: now->g_prev[] (1-phone before)*/
-      /* scan range: phones in now->seq[now->seqnum-1] + now->last_ph */
+      /* scan range: phones in now->hist->word + now->last_ph */
       back_rescan = TRUE;
     }
+    /* g_prev[] will be updated in this scan */
+    own_g_prev(now);
   }
 #ifdef TCD
   if (now->last_ph != NULL) {
@@ -661,13 +1147,13 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
 
   /* scan ϰʬHMM */
   /* prepare HMM of the scan range */
-  word = now->seq[now->seqnum-1];
+  word = now->hist->word;
 
   if (ccd_flag) {
 
     if (back_rescan) {
       
-      /* scan range: phones in now->seq[now->seqnum-1] + now->last_ph */
+      /* scan range: phones in now->hist->word + now->last_ph */
       
       phmmlen = winfo->wlen[word] + 1;
       if (phmmlen > dwrk->phmmlen_max) {
@@ -772,7 +1258,7 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
       
     } else {			/* not backscan mode */
       
-      /* scan range: phones in now->seq[now->seqnum-1] */
+      /* scan range: phones in now->hist->word */
       
 #ifdef TCD
       jlog("DEBUG: scan(org):");
@@ -894,6 +1380,7 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
       }
     }
 #endif
+    endt = -1;			/* no frame has been scanned */
     goto end_of_scan;
   }
   startt = t;
@@ -910,6 +1397,22 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
 #endif
   }
 
+#ifdef SCAN_CACHE
+  /* Ʊñ졦ʸ̮ϥե졼ࡦ٥פΥ
+     ̤åˤСѤ */
+  /* if the result of scan with the same word, context, start frame,
+     initial scores and envelope is cached, reuse it */
+  if (dwrk->scache != NULL) {
+    cached = scan_cache_lookup(now, startt, r);
+    if (cached != NULL) {
+      scan_cache_restore(cached, now, r);
+      endt = cached->endt;
+      if (debug2_flag) jlog("DEBUG: scan cache hit: [%3d-%3d]\n", endt, startt);
+      goto end_of_cached_scan;
+    }
+  }
+#endif
+
   /* Хåեݥ󥿽 */
   tn = 0; tl = 1;
 
@@ -1279,6 +1782,15 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
     }
   }
   
+#ifdef SCAN_CACHE
+  /* ׻̤򥭥å˳Ǽ */
+  /* store the computed result to cache */
+  if (dwrk->scache != NULL && endt >= 0) {
+    scan_cache_store(now, startt, endt, r);
+  }
+ end_of_cached_scan:
+#endif
+  
   /*  backscan ΤξǼ */
   /* store data for next backscan */
   if (ccd_flag) {
@@ -1353,76 +1865,96 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
 
 /** 
  * <JA>
- * Ÿ˼ñ³ƿ. ññȥꥹ
- * ³ᡤ⥹׻. 
+ * ñ³βǤˤϳΨ׻. Ÿ
+ * ͭ HMMWork ¾Ʒ׻.
+ *
+ * @param newphone [in] ³βHMM
+ * @param t [in] ֥ե졼
+ * @param param [in] ϥѥ᡼
+ * @param r [in] ǧ󥹥
+ *
+ * @return ϳΨп
+ * </JA>
+ * <EN>
+ * Compute output probability of the phone at the connection point of
+ * the next word.  When expanding in parallel, the shared HMMWork is
+ * locked while computation.
+ *
+ * @param newphone [in] phone HMM at the connection point
+ * @param t [in] time frame
+ * @param param [in] input parameter vector
+ * @param r [in] recognition process instance
+ *
+ * @return the log output probability.
+ * </EN>
+ */
+static LOGPROB
+connect_outprob(HMM_Logical *newphone, int t, HTK_Param *param, RecogProcess *r)
+{
+  LOGPROB tmpp;
+
+#ifdef PASS2_THREAD
+  if (r->pass2.thread_num > 1) pthread_mutex_lock(&(r->pass2.outprob_mutex));
+#endif
+  if (newphone->is_pseudo) {
+    tmpp = outprob_cd(&(r->am->hmmwrk), t, &(newphone->body.pseudo->stateset[newphone->body.pseudo->state_num-2]), param);
+  } else {
+    tmpp = outprob_state(&(r->am->hmmwrk), t, newphone->body.defined->s[newphone->body.defined->state_num-2], param);
+  }
+#ifdef PASS2_THREAD
+  if (r->pass2.thread_num > 1) pthread_mutex_unlock(&(r->pass2.outprob_mutex));
+#endif
+
+  return(tmpp);
+}
+
+/**
+ * <JA>
+ * Ÿ˼ñ³ñ쥹ʤɤ򿷲
+ * Ѿ. Ǽˤ仲ȿʤɶͭ񤭴Τǡ
+ * Ÿᥤ󥹥åɤǽ˸ƤӽФ.
  * 
  * @param now [in] Ÿ
  * @param new [out] 줿⤬Ǽ
  * @param nword [in] ³뼡ñξ
- * @param param [in] ϥѥ᡼
  * @param r [in] ǧ󥹥
  *
+ * @return ³βHMM
  * </JA>
  * <EN>
- * Connect a new word to generate a next hypothesis.  The optimal connection
- * point and new sentence score of the new hypothesis will be estimated by
- * looking up the corresponding words on word trellis.
+ * Connect a new word to the source hypothesis and inherit or update
+ * word history, LM score and others.  Since this modifies shared data
+ * such as stockers and reference counts, this should be called
+ * sequentially from the main thread even when expanding in parallel.
  * 
  * @param now [in] source hypothesis
  * @param new [out] pointer to save the newly generated hypothesis
  * @param nword [in] next word to be connected
- * @param param [in] input parameter vector
  * @param r [in] recognition process instance
  * 
+ * @return the phone HMM at the connection point.
  * </EN>
- * @callgraph
- * @callergraph
  */
-void
-next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess *r)
+static HMM_Logical *
+next_word_link(NODE *now, NODE *new, NEXTWORD *nword, RecogProcess *r)
 {
-  int   t;
   HMM_Logical *newphone;
-  int lastword;
-  int   i;
-  LOGPROB tmpp;
-  LOGPROB a_value;
-  int   startt;
   int word;
-  LOGPROB totalscore;
-  TRELLIS_ATOM *tre;
-
-  BACKTRELLIS *backtrellis;
   WORD_INFO *winfo;
   HTK_HMM_INFO *hmminfo;
-  int peseqlen;
   boolean ccd_flag;
 
-  backtrellis = r->backtrellis;
   winfo = r->lm->winfo;
   hmminfo = r->am->hmminfo;
-  peseqlen = r->peseqlen;
   ccd_flag = r->ccd_flag;
 
   new->score = LOG_ZERO;
 
   word = nword->id;
-  lastword=now->seq[now->seqnum-1];
 
   /* ñ¤ӡDFAֹ桢쥹Ѿ */
   /* inherit and update word sequence, DFA state and total LM score */
-  for (i=0;i< now->seqnum;i++){	
-    new->seq[i] = now->seq[i];
-#ifdef CM_SEARCH
-#ifdef CM_MULTIPLE_ALPHA
-    memcpy(new->cmscore[i], now->cmscore[i], sizeof(LOGPROB) * r->config->annotate.cm_alpha_num);
-#else
-    new->cmscore[i] = now->cmscore[i];
-#endif
-#endif /* CM_SEARCH */
-  }
-  new->seq[i] = word;
-  new->seqnum = now->seqnum+1;
+  wordhist_push(new, now, word);
   new->state = nword->next_state;
   new->totallscore = now->totallscore + nword->lscore;
   if (hmminfo->multipath) new->final_g = now->final_g;
@@ -1452,11 +1984,10 @@ next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess
       new->last_ph_sp_attached = now->last_ph_sp_attached;
     }
     
-    /* backscan³ݥȤΥ g_prev[] 򥳥ԡ */
-    /* copy g_prev[] that are scores at backscan connection point */
-    for (t=0;t<peseqlen;t++) {
-      new->g_prev[t] = now->g_prev[t];
-    }
+    /* backscan³ݥȤΥ g_prev[] ͭ (񤭴ʣ) */
+    /* share g_prev[] that are scores at backscan connection point
+       (will be duplicated when written) */
+    share_g_prev(new, now);
     
   } else {			/* not triphone */
     
@@ -1469,6 +2000,57 @@ next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess
   /* ³ΨͿ */
   new->lscore = nword->lscore;
 
+  return(newphone);
+}
+
+/**
+ * <JA>
+ * next_word_link() ³ˤĤơññȥꥹ
+ * ³ᡤ⥹׻. 񤭴Τ
+ * ΤߤʤΤǡ˸ƤӽФ.
+ *
+ * @param now [in] Ÿ
+ * @param new [i/o] 줿
+ * @param nword [in] ³뼡ñξ
+ * @param newphone [in] ³βHMM
+ * @param param [in] ϥѥ᡼
+ * @param r [in] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Estimate the optimal connection point and sentence score of a new
+ * hypothesis linked by next_word_link(), by looking up the corresponding
+ * words on word trellis.  Since this modifies only the new hypothesis,
+ * it can be called in parallel.
+ *
+ * @param now [in] source hypothesis
+ * @param new [i/o] newly generated hypothesis
+ * @param nword [in] next word to be connected
+ * @param newphone [in] phone HMM at the connection point
+ * @param param [in] input parameter vector
+ * @param r [in] recognition process instance
+ * </EN>
+ */
+static void
+next_word_connect(NODE *now, NODE *new, NEXTWORD *nword, HMM_Logical *newphone, HTK_Param *param, RecogProcess *r)
+{
+  int   t;
+  int   i;
+  LOGPROB a_value;
+  int   startt;
+  int word;
+  LOGPROB totalscore;
+  TRELLIS_ATOM *tre;
+
+  BACKTRELLIS *backtrellis;
+  HTK_HMM_INFO *hmminfo;
+  int peseqlen;
+
+  backtrellis = r->backtrellis;
+  hmminfo = r->am->hmminfo;
+  peseqlen = r->peseqlen;
+
+  word = nword->id;
+
   if (! hmminfo->multipath) {
     /* a_value: ³ܳΨ */
     /* a_value: transition probability of connection point */
@@ -1511,16 +2093,11 @@ next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess
     /* ٤ƤΥե졼ˤ錄äƺõ */
     /* search for best trellis word throughout all frame */
     for(t = startt; t >= 0; t--) {
-      tre = bt_binsearch_atom(backtrellis, t, (WORD_ID) word);
+      tre = bt_lookup_atom(backtrellis, t, (WORD_ID) word);
       if (tre == NULL) continue;
       totalscore = new->g[t] + tre->backscore;
       if (! hmminfo->multipath) {
-	if (newphone->is_pseudo) {
-	  tmpp = outprob_cd(&(r->am->hmmwrk), t, &(newphone->body.pseudo->stateset[newphone->body.pseudo->state_num-2]), param);
-	} else {
-	  tmpp = outprob_state(&(r->am->hmmwrk), t, newphone->body.defined->s[newphone->body.defined->state_num-2], param);
-	}
-	totalscore += tmpp;
+	totalscore += connect_outprob(newphone, t, param, r);
       }
       if (new->score < totalscore) {
 	new->score = totalscore;
@@ -1539,16 +2116,11 @@ next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess
   /* search for best trellis word only around the estimated time */
   /* 1. search forward */
   for(t = (nword->tre)->endtime; t >= 0; t--) {
-    tre = bt_binsearch_atom(backtrellis, t, (WORD_ID) word);
+    tre = bt_lookup_atom(backtrellis, t, (WORD_ID) word);
     if (tre == NULL) break;	/* go to 2 if the trellis word disappear */
     totalscore = new->g[t] + tre->backscore;
     if (! hmminfo->multipath) {
-      if (newphone->is_pseudo) {
-	tmpp = outprob_cd(&(r->am->hmmwrk), t, &(newphone->body.pseudo->stateset[newphone->body.pseudo->state_num-2]), param);
-      } else {
-	tmpp = outprob_state(&(r->am->hmmwrk), t, newphone->body.defined->s[newphone->body.defined->state_num-2], param);
-      }
-      totalscore += tmpp;
+      totalscore += connect_outprob(newphone, t, param, r);
     }
     if (new->score < totalscore) {
       new->score = totalscore;
@@ -1559,16 +2131,11 @@ next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess
   }
   /* 2. search backward */
   for(t = (nword->tre)->endtime + 1; t <= startt; t++) {
-    tre = bt_binsearch_atom(backtrellis, t, (WORD_ID) word);
+    tre = bt_lookup_atom(backtrellis, t, (WORD_ID) word);
     if (tre == NULL) break;	/* end if the trellis word disapper */
     totalscore = new->g[t] + tre->backscore;
     if (! hmminfo->multipath) {
-      if (newphone->is_pseudo) {
-	tmpp = outprob_cd(&(r->am->hmmwrk), t, &(newphone->body.pseudo->stateset[newphone->body.pseudo->state_num-2]), param);
-      } else {
-	tmpp = outprob_state(&(r->am->hmmwrk), t, newphone->body.defined->s[newphone->body.defined->state_num-2], param);
-      }
-      totalscore += tmpp;
+      totalscore += connect_outprob(newphone, t, param, r);
     }
     if (new->score < totalscore) {
       new->score = totalscore;
@@ -1580,6 +2147,284 @@ next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess
 
 }
 
+/**
+ * <JA>
+ * Ÿ˼ñ³ƿ. ññȥꥹ
+ * ³ᡤ⥹׻.
+ *
+ * @param now [in] Ÿ
+ * @param new [out] 줿⤬Ǽ
+ * @param nword [in] ³뼡ñξ
+ * @param param [in] ϥѥ᡼
+ * @param r [in] ǧ󥹥
+ *
+ * </JA>
+ * <EN>
+ * Connect a new word to generate a next hypothesis.  The optimal connection
+ * point and new sentence score of the new hypothesis will be estimated by
+ * looking up the corresponding words on word trellis.
+ *
+ * @param now [in] source hypothesis
+ * @param new [out] pointer to save the newly generated hypothesis
+ * @param nword [in] next word to be connected
+ * @param param [in] input parameter vector
+ * @param r [in] recognition process instance
+ *
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+next_word(NODE *now, NODE *new,	NEXTWORD *nword, HTK_Param *param, RecogProcess *r)
+{
+  HMM_Logical *newphone;
+
+  newphone = next_word_link(now, new, nword, r);
+  next_word_connect(now, new, nword, newphone, param, r);
+}
+
+#ifdef PASS2_THREAD
+
+#define PASS2_THREAD_CHUNK 8	///< Number of words a thread takes at a time
+
+/**
+ * <JA>
+ * ߤΥ֤̤ñ줬ʤʤޤǡñ򾯤ļФ
+ * ³׻. mutex å֤ǸƤӽФ.
+ *
+ * @param r [in] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Take words from current job a few at a time and compute their
+ * connection points, until no word is left.  Should be called with
+ * the mutex locked.
+ *
+ * @param r [in] recognition process instance
+ * </EN>
+ */
+static void
+next_word_job_run(RecogProcess *r)
+{
+  StackDecode *dwrk;
+  int i, bgn, end;
+
+  dwrk = &(r->pass2);
+  while (dwrk->job_next < dwrk->job_num) {
+    bgn = dwrk->job_next;
+    end = bgn + PASS2_THREAD_CHUNK;
+    if (end > dwrk->job_num) end = dwrk->job_num;
+    dwrk->job_next = end;
+    dwrk->job_running++;
+    pthread_mutex_unlock(&(dwrk->mutex));
+    for(i = bgn; i < end; i++) {
+      next_word_connect(dwrk->job_src, dwrk->expnode[i], dwrk->job_nword[i], dwrk->expphone[i], dwrk->job_param, r);
+    }
+    pthread_mutex_lock(&(dwrk->mutex));
+    dwrk->job_running--;
+  }
+  if (dwrk->job_running == 0) pthread_cond_signal(&(dwrk->cond_done));
+}
+
+/**
+ * <JA>
+ * ŸΥåɤΥᥤؿ.
+ *
+ * @param arg [in] ǧ󥹥
+ *
+ * @return NULL
+ * </JA>
+ * <EN>
+ * Main function of worker threads for parallel expansion.
+ *
+ * @param arg [in] recognition process instance
+ *
+ * @return NULL.
+ * </EN>
+ */
+static void *
+next_word_worker(void *arg)
+{
+  RecogProcess *r;
+  StackDecode *dwrk;
+
+  r = (RecogProcess *)arg;
+  dwrk = &(r->pass2);
+
+  pthread_mutex_lock(&(dwrk->mutex));
+  for(;;) {
+    while (!dwrk->thread_quit && dwrk->job_next >= dwrk->job_num) {
+      pthread_cond_wait(&(dwrk->cond_job), &(dwrk->mutex));
+    }
+    if (dwrk->thread_quit) break;
+    next_word_job_run(r);
+  }
+  pthread_mutex_unlock(&(dwrk->mutex));
+
+  return NULL;
+}
+
+/**
+ * <JA>
+ * Ÿʣμñ򤽤줾³.
+ * ñηѾʤɤϥᥤ󥹥åɤǽ˹Ԥ³η׻Τߤ
+ * åɤʬô. 줿 r->pass2.expnode[] 
+ * @a nword ƱǳǼ. ̤ next_word() ˸Ƥ
+ * ƱǤ.
+ *
+ * @param now [in] Ÿ
+ * @param nword [in] ³뼡ñξ
+ * @param num [in] @a nword Ĺ
+ * @param param [in] ϥѥ᡼
+ * @param r [in] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Generate new hypotheses from a source hypothesis and each of the
+ * given next words in parallel.  Inheritance of word histories and
+ * others are done sequentially in the main thread, and only the
+ * connection point estimation is shared with the worker threads.  The
+ * generated hypotheses are stored in r->pass2.expnode[] in the same
+ * order as @a nword.  The result is identical to calling next_word()
+ * for each word in order.
+ *
+ * @param now [in] source hypothesis
+ * @param nword [in] list of next words to be connected
+ * @param num [in] length of @a nword
+ * @param param [in] input parameter vector
+ * @param r [in] recognition process instance
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+next_word_parallel(NODE *now, NEXTWORD **nword, int num, HTK_Param *param, RecogProcess *r)
+{
+  StackDecode *dwrk;
+  int i;
+
+  dwrk = &(r->pass2);
+
+  if (dwrk->expalloc < num) {
+    dwrk->expnode = (NODE **)myrealloc(dwrk->expnode, sizeof(NODE *) * num);
+    dwrk->expphone = (HMM_Logical **)myrealloc(dwrk->expphone, sizeof(HMM_Logical *) * num);
+    dwrk->expalloc = num;
+  }
+  for(i = 0; i < num; i++) {
+    dwrk->expnode[i] = newnode(r);
+    dwrk->expphone[i] = next_word_link(now, dwrk->expnode[i], nword[i], r);
+  }
+
+  pthread_mutex_lock(&(dwrk->mutex));
+  dwrk->job_src = now;
+  dwrk->job_nword = nword;
+  dwrk->job_param = param;
+  dwrk->job_num = num;
+  dwrk->job_next = 0;
+  pthread_cond_broadcast(&(dwrk->cond_job));
+  /* the main thread also works */
+  next_word_job_run(r);
+  while (dwrk->job_running > 0) {
+    pthread_cond_wait(&(dwrk->cond_done), &(dwrk->mutex));
+  }
+  pthread_mutex_unlock(&(dwrk->mutex));
+}
+
+/**
+ * <JA>
+ * ŸΤΥåɤư. åɿ
+ * "-pass2thread" ǻꤵ줿ǡᥤ󥹥åɤޤ.
+ *
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Start worker threads for parallel expansion.  The number of threads,
+ * including the main thread, is given by "-pass2thread".
+ *
+ * @param r [i/o] recognition process instance
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+next_word_thread_start(RecogProcess *r)
+{
+  StackDecode *dwrk;
+  int i, num;
+
+  dwrk = &(r->pass2);
+  dwrk->thread_num = 0;
+  dwrk->thread = NULL;
+  dwrk->expnode = NULL;
+  dwrk->expphone = NULL;
+  dwrk->expalloc = 0;
+
+  num = r->config->pass2.thread_num;
+  if (r->lmtype != LM_PROB || num <= 1) return;
+
+  pthread_mutex_init(&(dwrk->mutex), NULL);
+  pthread_mutex_init(&(dwrk->outprob_mutex), NULL);
+  pthread_cond_init(&(dwrk->cond_job), NULL);
+  pthread_cond_init(&(dwrk->cond_done), NULL);
+  dwrk->thread_quit = FALSE;
+  dwrk->job_num = dwrk->job_next = dwrk->job_running = 0;
+
+  dwrk->thread = (pthread_t *)mymalloc(sizeof(pthread_t) * (num - 1));
+  for(i = 0; i < num - 1; i++) {
+    if (pthread_create(&(dwrk->thread[i]), NULL, next_word_worker, r) != 0) {
+      jlog("WARNING: %02d %s: failed to create thread for 2nd pass, only %d threads will be used\n", r->config->id, r->config->name, i + 1);
+      break;
+    }
+  }
+  dwrk->thread_num = i + 1;
+}
+
+/**
+ * <JA>
+ * ŸΤΥåɤλ.
+ *
+ * @param r [i/o] ǧ󥹥
+ * </JA>
+ * <EN>
+ * Terminate worker threads for parallel expansion.
+ *
+ * @param r [i/o] recognition process instance
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+void
+next_word_thread_end(RecogProcess *r)
+{
+  StackDecode *dwrk;
+  int i;
+
+  dwrk = &(r->pass2);
+  if (dwrk->thread == NULL) return;
+
+  pthread_mutex_lock(&(dwrk->mutex));
+  dwrk->thread_quit = TRUE;
+  pthread_cond_broadcast(&(dwrk->cond_job));
+  pthread_mutex_unlock(&(dwrk->mutex));
+  for(i = 0; i < dwrk->thread_num - 1; i++) {
+    pthread_join(dwrk->thread[i], NULL);
+  }
+  free(dwrk->thread);
+  dwrk->thread = NULL;
+  pthread_mutex_destroy(&(dwrk->mutex));
+  pthread_mutex_destroy(&(dwrk->outprob_mutex));
+  pthread_cond_destroy(&(dwrk->cond_job));
+  pthread_cond_destroy(&(dwrk->cond_done));
+  if (dwrk->expnode) {
+    free(dwrk->expnode);
+    free(dwrk->expphone);
+    dwrk->expnode = NULL;
+    dwrk->expphone = NULL;
+    dwrk->expalloc = 0;
+  }
+  dwrk->thread_num = 0;
+}
+
+#endif /* PASS2_THREAD */
+
 /**********************************************************************/
 /**********                  ****************************/
 /********** Generate an initial hypothesis ****************************/
@@ -1629,8 +2474,7 @@ start_word(NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess *r)
   /* initialize data */
   word = nword->id;
   new->score = LOG_ZERO;
-  new->seqnum = 1;
-  new->seq[0] = word;
+  wordhist_push(new, NULL, word);
 
   new->state = nword->next_state;
   new->totallscore = nword->lscore;
@@ -1646,7 +2490,7 @@ start_word(NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess *r)
   new->g[peseqlen-1] = nword->lscore;
   
   for (t=peseqlen-1; t>=0; t--) {
-    tre = bt_binsearch_atom(backtrellis, t, word);
+    tre = bt_lookup_atom(backtrellis, t, word);
     if (tre != NULL) {
       if (r->graphout) {
 	new->bestt = peseqlen-1;
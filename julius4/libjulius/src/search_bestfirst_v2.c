@@ -77,10 +77,10 @@
 #undef STOCKER_DEBUG
 
 #ifdef STOCKER_DEBUG
-static int stocked_num = 0;
-static int reused_num = 0;
-static int new_num = 0;
-static int request_num = 0;
+static THREAD_LOCAL int stocked_num = 0;
+static THREAD_LOCAL int reused_num = 0;
+static THREAD_LOCAL int new_num = 0;
+static THREAD_LOCAL int request_num = 0;
 #endif
 
 /** 
@@ -134,6 +134,9 @@ free_node(NODE *node)
     }
   }
 
+  /* release shared word history */
+  wordhist_release(node);
+
   /* save to stocker */
   node->next = node->region->pass2.stocker_root;
   node->region->pass2.stocker_root = node;
@@ -170,6 +173,7 @@ clear_stocker(StackDecode *s)
     node = tmp;
   }
   s->stocker_root = NULL;
+  wordhist_clear_stocker(s);
 
 #ifdef STOCKER_DEBUG
   jlog("DEBUG: %d times requested, %d times newly allocated, %d times reused\n", request_num, new_num, reused_num);
@@ -210,20 +214,7 @@ cpy_node(NODE *dst, NODE *src)
   dst->next = src->next;
   dst->prev = src->prev;
   memcpy(dst->g, src->g, sizeof(LOGPROB) * peseqlen);
-  memcpy(dst->seq, src->seq, sizeof(WORD_ID) * MAXSEQNUM);
-#ifdef CM_SEARCH
-#ifdef CM_MULTIPLE_ALPHA
-  {
-    int w;
-    for(w=0;w<src->seqnum;w++) {
-      memcpy(dst->cmscore[w], src->cmscore[w], sizeof(LOGPROB) * src->region->config->annotate.cm_alpha_num);
-    }
-  }     
-#else
-  memcpy(dst->cmscore, src->cmscore, sizeof(LOGPROB) * MAXSEQNUM);
-#endif
-#endif /* CM_SEARCH */
-  dst->seqnum = src->seqnum;
+  wordhist_share(dst, src);
   dst->score = src->score;
   dst->bestt = src->bestt;
   dst->estimated_next_t = src->estimated_next_t;
@@ -318,6 +309,7 @@ newnode(RecogProcess *r)
     tmp->totallscore = LOG_ZERO;
   }
   tmp->endflag = FALSE;
+  tmp->hist = NULL;
   tmp->seqnum = 0;
   for(i = 0; i < peseqlen; i++) {
     tmp->g[i] = LOG_ZERO;
@@ -838,7 +830,7 @@ do_viterbi_next_word(NODE *now, NODE *new, HMM_Logical *lastphone, boolean sp, H
        If the length is more than 1, the now->g[] keeps the values of the
        scan result till the previous phone, so make initial value
        considering last transition probability. */
-    if (r->lm->winfo->wlen[now->seq[now->seqnum-1]] > 1) {
+    if (r->lm->winfo->wlen[now->hist->word] > 1) {
       n = hmm_logical_state_num(lastphone);
       a_value = (hmm_logical_trans(lastphone))->a[n-2][n-1];
       for(t=0; t<peseqlen-1; t++) dwrk->g[t] = now->g[t+1] + a_value;
@@ -943,7 +935,7 @@ scan_word(NODE *now, HTK_Param *param, RecogProcess *r)
   /* with triphone, modify the tail phone of the last word according to the
      previous word, and do not compute the head phone here (that will be
      computed later in next_word() */
-  word = now->seq[now->seqnum-1];
+  word = now->hist->word;
   
 #ifdef TCD
     jlog("DEBUG: w=");
@@ -1141,7 +1133,7 @@ next_word(NODE *now, NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess
   ccd_flag = r->ccd_flag;
 
   word = nword->id;
-  lastword = now->seq[now->seqnum-1];
+  lastword = now->hist->word;
 
   /* lastphone (ľñƬ)  */
   /* prepare lastphone (head phone of previous word) */
@@ -1182,18 +1174,7 @@ next_word(NODE *now, NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess
   /* ñ¤ӡDFAֹ桢쥹 new طѾ */
   /* inherit and update word sequence, DFA state and total LM score to 'new' */
   new->score = LOG_ZERO;
-  for (i=0;i< now->seqnum;i++){
-    new->seq[i] = now->seq[i];
-#ifdef CM_SEARCH
-#ifdef CM_MULTIPLE_ALPHA
-    memcpy(new->cmscore[i], now->cmscore[i], sizeof(LOGPROB) * r->config->annotate.cm_alpha_num);
-#else
-    new->cmscore[i] = now->cmscore[i];
-#endif
-#endif /* CM_SEARCH */
-  }
-  new->seq[i] = word;
-  new->seqnum = now->seqnum+1;
+  wordhist_push(new, now, word);
   new->state = nword->next_state;
   new->totallscore = now->totallscore + nword->lscore;
   if (ccd_flag) {
@@ -1253,7 +1234,7 @@ next_word(NODE *now, NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess
     /* ٤ƤΥե졼ˤ錄äƺõ */
     /* search for best trellis word throughout all frame */
     for(t = startt; t >= 0; t--) {
-      tre = bt_binsearch_atom(backtrellis, t, (WORD_ID) word);
+      tre = bt_lookup_atom(backtrellis, t, (WORD_ID) word);
       if (tre == NULL) continue;
       totalscore = new->g[t] + tre->backscore;
       if (! hmminfo->multipath) {
@@ -1283,7 +1264,7 @@ next_word(NODE *now, NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess
   /* search for best trellis word only around the estimated time */
   /* 1. search forward */
   for(t = (nword->tre)->endtime; t >= 0; t--) {
-    tre = bt_binsearch_atom(backtrellis, t, (WORD_ID) word);
+    tre = bt_lookup_atom(backtrellis, t, (WORD_ID) word);
     if (tre == NULL) break;	/* go to 2 if the trellis word disappear */
     totalscore = new->g[t] + tre->backscore;
     if (! hmminfo->multipath) {
@@ -1303,7 +1284,7 @@ next_word(NODE *now, NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess
   }
   /* 2. search bckward */
   for(t = (nword->tre)->endtime + 1; t <= startt; t++) {
-    tre = bt_binsearch_atom(backtrellis, t, (WORD_ID) word);
+    tre = bt_lookup_atom(backtrellis, t, (WORD_ID) word);
     if (tre == NULL) break;	/* end if the trellis word disapper */
     totalscore = new->g[t] + tre->backscore;
     if (! hmminfo->multipath) {
@@ -1379,8 +1360,7 @@ start_word(NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess *r)
   /* initialize data */
   word = nword->id;
   new->score = LOG_ZERO;
-  new->seqnum = 1;
-  new->seq[0] = word;
+  wordhist_push(new, NULL, word);
 
   new->state = nword->next_state;
   new->totallscore = nword->lscore;
@@ -1397,7 +1377,7 @@ start_word(NODE *new, NEXTWORD *nword, HTK_Param *param, RecogProcess *r)
   new->g[peseqlen-1] = nword->lscore;
   
   for (t=peseqlen-1; t>=0; t--) {
-    tre = bt_binsearch_atom(backtrellis, t, word);
+    tre = bt_lookup_atom(backtrellis, t, word);
     if (tre != NULL) {
       if (r->graphout) {
 	new->bestt = peseqlen-1;
@@ -77,9 +77,13 @@ wchmm_new()
   w->dfa = NULL;
   w->winfo = NULL;
   w->malloc_root = NULL;
+  w->share_src = NULL;
 #ifdef PASS1_IWCD
   w->lcdset_category_root = NULL;
   w->lcdset_mroot = NULL;
+  w->outcachenum = 0;
+  w->outcache = NULL;
+  w->outcachelen = 0;
 #endif /* PASS1_IWCD */
   w->wrk.out_from_len = 0;
   /* reset user function entry point */
@@ -88,6 +92,61 @@ wchmm_new()
   return w;
 }
 
+/** 
+ * <JA>
+ * ¸ڹ¤ڤƤͭ뿷ڹ¤.
+ * ڤƤϻȤΤߤʣ줺õѤκΰΤߤ
+ * դ. ڤƤϤ򻲾ȤǸμ񤬲
+ * Ȥ˲.
+ * 
+ * @param src [in] ͭڹ¤
+ * 
+ * @return ˳դ줿ڹ¤ؤΥݥ
+ * </JA>
+ * <EN>
+ * Create a new tree lexicon that shares the tree with an existing one.
+ * The tree data are only referred to and not copied, and only the work
+ * areas for search are newly allocated.  The tree data will be freed
+ * when the last lexicon that refers to them is freed.
+ * 
+ * @param src [in] tree lexicon to share the tree with
+ * 
+ * @return pointer to the newly allocated tree lexicon.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+WCHMM_INFO *
+wchmm_new_shared(WCHMM_INFO *src)
+{
+  WCHMM_INFO *w;
+
+  w = (WCHMM_INFO *)mymalloc(sizeof(WCHMM_INFO));
+  memcpy(w, src, sizeof(WCHMM_INFO));
+  /* always refer to the owner of the tree data */
+  if (src->share_src != NULL) src = src->share_src;
+  w->share_src = src;
+  j_model_ref(src);
+
+  /* work areas are held per lexicon */
+  w->hmmwrk = NULL;
+  memset(&(w->lmcache), 0, sizeof(LM_PROB_CACHE));
+#ifdef PASS1_IWCD
+  w->outcache = NULL;
+  w->outcachelen = 0;
+#endif
+  w->wrk.out_from_len = 0;
+  if (w->hmminfo->multipath) {
+    w->wrk.out_from = (int *)mymalloc(sizeof(int) * w->winfo->maxwn);
+    w->wrk.out_from_next = (int *)mymalloc(sizeof(int) * w->winfo->maxwn);
+    w->wrk.out_a = (LOGPROB *)mymalloc(sizeof(LOGPROB) * w->winfo->maxwn);
+    w->wrk.out_a_next = (LOGPROB *)mymalloc(sizeof(LOGPROB) * w->winfo->maxwn);
+    w->wrk.out_from_len = w->winfo->maxwn;
+  }
+
+  return w;
+}
+
 /** 
  * <JA>
  * ڹ¤Ƥ. 
@@ -130,6 +189,7 @@ wchmm_init(WCHMM_INFO *wchmm)
   }
 #ifdef PASS1_IWCD
   wchmm->outstyle = (unsigned char *)mymalloc(sizeof(unsigned char)*wchmm->maxwcn);
+  wchmm->outcachenum = 0;
 #endif
 #ifdef UNIGRAM_FACTORING
   wchmm->start2isolate = NULL;
@@ -145,6 +205,7 @@ wchmm_init(WCHMM_INFO *wchmm)
   }
 
   wchmm->n = 0;
+  wchmm->wordnum = 0;
 }
 
 /** 
@@ -203,7 +264,9 @@ wchmm_extend_startnode(WCHMM_INFO *wchmm)
  * @param w [in] ڹ¤
  * </JA>
  * <EN>
- * Free all data in a tree lexicon.
+ * Free all data in a tree lexicon.  When the tree data are shared with
+ * other lexicons, only the work areas are freed here and the tree data
+ * will be freed with the last lexicon.
  * 
  * @param w [in] tree lexicon
  * </EN>
@@ -214,6 +277,32 @@ void
 wchmm_free(WCHMM_INFO *w)
 {
   int i;
+  WCHMM_INFO *src;
+
+  /* work areas of this lexicon */
+  if (w->wrk.out_from_len != 0) {
+    free(w->wrk.out_from);
+    free(w->wrk.out_from_next);
+    free(w->wrk.out_a);
+    free(w->wrk.out_a_next);
+    w->wrk.out_from_len = 0;
+  }
+#ifdef PASS1_IWCD
+  if (w->outcache != NULL) {
+    free(w->outcache);
+    w->outcache = NULL;
+    w->outcachelen = 0;
+  }
+#endif
+  if (w->share_src != NULL) {
+    /* tree data belong to the source lexicon */
+    src = w->share_src;
+    free(w);
+    w = src;
+  }
+  /* tree data are still in use by other lexicons */
+  if (j_model_unref(w) == FALSE) return;
+
   /* wchmm->state[i].ac malloced by mybmalloc2() */
   /* wchmm->offset[][] malloced by mybmalloc2() */
 #ifdef PASS1_IWCD
@@ -250,13 +339,6 @@ wchmm_free(WCHMM_INFO *w)
 #ifdef PASS1_IWCD
   if (w->category_tree) lcdset_remove_with_category_all(w);
 #endif /* PASS1_IWCD */
-  if (w->wrk.out_from_len != 0) {
-    free(w->wrk.out_from);
-    free(w->wrk.out_from_next);
-    free(w->wrk.out_a);
-    free(w->wrk.out_a_next);
-    w->wrk.out_from_len = 0;
-  }
   free(w);
 }
 
@@ -386,6 +468,42 @@ wchmm_sort_idx_by_category(WORD_INFO *winfo, WORD_ID *windex, WORD_ID len)
 {
   qsort_reentrant(windex, len, sizeof(WORD_ID), (int (*)(const void *, const void *, void *))compare_category, winfo);
 }
+
+/** 
+ * <JA>
+ * ñID windex[0..len-1] 򥫥ƥIDǥȤ
+ * ƥƥǤΤʤӤǥȤ. 
+ * 
+ * @param winfo [in] ñ켭
+ * @param windex [i/o] ñIDΥǥåǥȤ
+ * @param len [in] @a windex ǿ
+ * </JA>
+ * <EN>
+ * Sort word IDs in windex[0..len-1] by their category ID, and then
+ * sort the words in each category by their phoneme sequence.
+ * 
+ * @param winfo [in] tree lexicon
+ * @param windex [i/o] index sequence of word IDs, (will be sorted in this function)
+ * @param len [in] number of elements in @a windex
+ * </EN>
+ */
+static void
+wchmm_sort_idx_by_category_wseq(WORD_INFO *winfo, WORD_ID *windex, WORD_ID len)
+{
+  int i, last_i, last_cate;
+
+  wchmm_sort_idx_by_category(winfo, windex, len);
+  last_i = 0;
+  last_cate = winfo->wton[windex[0]];
+  for(i = 1;i<len;i++) {
+    if (winfo->wton[windex[i]] != last_cate) {
+      wchmm_sort_idx_by_wseq(winfo, windex, last_i, i - last_i);
+      last_cate = winfo->wton[windex[i]];
+      last_i = i;
+    }
+  }
+  wchmm_sort_idx_by_wseq(winfo, windex, last_i, len - last_i);
+}
   
 
 /**********************************************************************/
@@ -764,11 +882,13 @@ wchmm_duplicate_state(WCHMM_INFO *wchmm, int node, int word) /* source node, new
       /* duplicate RC_INFO because it has its own cache */
       rcnew = (RC_INFO *)mybmalloc2(sizeof(RC_INFO), &(wchmm->malloc_root));
       memcpy(rcnew, wchmm->state[n_src].out.rset, sizeof(RC_INFO));
+      rcnew->cid = wchmm->outcachenum++;
       wchmm->state[n].out.rset = rcnew;
     } else if (wchmm->outstyle[n] == AS_LRSET) {
       /* duplicate LRC_INFO because it has its own cache */
       lrcnew = (LRC_INFO *)mybmalloc2(sizeof(LRC_INFO), &(wchmm->malloc_root));
       memcpy(lrcnew, wchmm->state[n_src].out.lrset, sizeof(LRC_INFO));
+      lrcnew->cid = wchmm->outcachenum++;
       wchmm->state[n].out.lrset = lrcnew;
     } else {
       /* share same info, simply copy the pointer */
@@ -863,12 +983,15 @@ wchmm_duplicate_state(WCHMM_INFO *wchmm, int node, int word) /* source node, new
  * <EN>
  * Scan the whole lexicon tree to find already registered homophones, and
  * make word-end nodes of the found homophones isolated from others.
+ * Only the words from @a wbegin are examined, which should not share
+ * nodes with the words before it.
  * 
  * @param wchmm [i/o] tree lexicon
+ * @param wbegin [in] first word ID to be examined
  * </EN>
  */
 static int
-wchmm_duplicate_leafnode(WCHMM_INFO *wchmm)
+wchmm_duplicate_leafnode(WCHMM_INFO *wchmm, int wbegin)
 {
   int w, nlast, n, narc, narc_model;
   boolean *dupw;		/* node marker */
@@ -881,7 +1004,7 @@ wchmm_duplicate_leafnode(WCHMM_INFO *wchmm)
   dupw = (boolean *)mymalloc(sizeof(boolean) * nlast);
   for(n=0;n<nlast;n++) dupw[n] = FALSE;	/* initialize all marker */
 
-  for (w=0;w<wchmm->winfo->num;w++) {
+  for (w=wbegin;w<wchmm->winfo->num;w++) {
     n = wchmm->wordend[w];
     if (dupw[n]) {		/* if already marked (2nd time or later */
       wchmm_duplicate_state(wchmm, n, w); dupcount++; /* duplicate */
@@ -1098,6 +1221,7 @@ wchmm_add_word(WCHMM_INFO *wchmm, int word, int matchlen, int matchword, boolean
 	      wchmm->state[ntmp].out.lrset = (LRC_INFO *)mybmalloc2(sizeof(LRC_INFO), &(wchmm->malloc_root));
 	      (wchmm->state[ntmp].out.lrset)->hmm       = ltmp;
 	      (wchmm->state[ntmp].out.lrset)->state_loc = k;
+	      (wchmm->state[ntmp].out.lrset)->cid       = wchmm->outcachenum++;
 	      if (wchmm->category_tree) {
 		(wchmm->state[ntmp].out.lrset)->category  = wchmm->winfo->wton[word];
 	      }
@@ -1106,6 +1230,7 @@ wchmm_add_word(WCHMM_INFO *wchmm, int word, int matchlen, int matchword, boolean
 	      wchmm->state[ntmp].out.rset = (RC_INFO *)mybmalloc2(sizeof(RC_INFO), &(wchmm->malloc_root));
 	      (wchmm->state[ntmp].out.rset)->hmm       = ltmp;
 	      (wchmm->state[ntmp].out.rset)->state_loc = k;
+	      (wchmm->state[ntmp].out.rset)->cid       = wchmm->outcachenum++;
 	    } else if (j == wchmm->winfo->wlen[word] - 1) { /* last phone of a word */
 	      wchmm->outstyle[ntmp] = AS_LSET;
 	      wchmm->state[ntmp].out.lset = &(lcd->stateset[k]);
@@ -1400,16 +1525,17 @@ wchmm_add_word(WCHMM_INFO *wchmm, int word, int matchlen, int matchword, boolean
  * state. (non multipath)
  * 
  * @param wchmm [i/o] tree lexicon
+ * @param wbegin [in] first word ID to be processed
  * </EN>
  */
 static void
-wchmm_calc_wordend_arc(WCHMM_INFO *wchmm)
+wchmm_calc_wordend_arc(WCHMM_INFO *wchmm, int wbegin)
 {
   WORD_ID w;
   HTK_HMM_Trans *tr;
   LOGPROB a;
 
-  for (w=0;w<wchmm->winfo->num;w++) {
+  for (w=wbegin;w<wchmm->winfo->num;w++) {
     tr = hmm_logical_trans(wchmm->winfo->wseq[w][wchmm->winfo->wlen[w]-1]);
     a = tr->a[tr->statenum-2][tr->statenum-1];
     wchmm->wordend_a[w] = a;
@@ -1676,12 +1802,13 @@ build_wchmm(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 
   if (! wchmm->hmminfo->multipath) {
     /* Ʊ첻ǷñƱΤ leaf node 2Ųƶ̤ */
-    num_duplicated = wchmm_duplicate_leafnode(wchmm);
+    num_duplicated = wchmm_duplicate_leafnode(wchmm, 0);
     jlog("STAT:  %d leaf nodes are made unshared\n", num_duplicated);
     
     /* ñνü鳰ؤܳΨƤ */
-    wchmm_calc_wordend_arc(wchmm);
+    wchmm_calc_wordend_arc(wchmm, 0);
   }
+  wchmm->wordnum = wchmm->winfo->num;
 
   /* wchmmå */
   check_wchmm(wchmm);
@@ -1805,20 +1932,7 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
   if (wchmm->category_tree && wchmm->lmtype == LM_DFA) {
 
     /* sort by category -> sort by word ID in each category */
-    wchmm_sort_idx_by_category(wchmm->winfo, windex, wchmm->winfo->num);
-    {
-      int last_cate;
-      last_i = 0;
-      last_cate = wchmm->winfo->wton[windex[0]];
-      for(i = 1;i<wchmm->winfo->num;i++) {
-	if (wchmm->winfo->wton[windex[i]] != last_cate) {
-	  wchmm_sort_idx_by_wseq(wchmm->winfo, windex, last_i, i - last_i);
-	  last_cate = wchmm->winfo->wton[windex[i]];
-	  last_i = i;
-	}
-      }
-      wchmm_sort_idx_by_wseq(wchmm->winfo, windex, last_i, wchmm->winfo->num - last_i);
-    }
+    wchmm_sort_idx_by_category_wseq(wchmm->winfo, windex, wchmm->winfo->num);
 
   } else {
 
@@ -1922,17 +2036,18 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
   } else {
     /* duplicate leaf nodes of homophone/embedded words */
     jlog("STAT: lexicon size: %d", wchmm->n);
-    num_duplicated = wchmm_duplicate_leafnode(wchmm);
+    num_duplicated = wchmm_duplicate_leafnode(wchmm, 0);
     jlog("+%d=%d\n", num_duplicated, wchmm->n);
   }
 
   if (! wchmm->hmminfo->multipath) {
     /* calculate transition probability of word end node to outside */
-    wchmm_calc_wordend_arc(wchmm);
+    wchmm_calc_wordend_arc(wchmm, 0);
   }
 
   /* check wchmm coherence (internal debug) */
   check_wchmm(wchmm);
+  wchmm->wordnum = wchmm->winfo->num;
 
   /* make successor list for all branch nodes for N-gram factoring */
   if (!wchmm->category_tree) {
@@ -2024,6 +2139,7 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
       }
       if (c > 0) jlog("STAT: %9d bytes: wchmm->out (RC_INFO / LRC_INFO)\n", c);
     }
+    if (wchmm->outcachenum > 0) jlog("STAT: %9d bytes: wchmm->outcache[] (per instance)\n", wchmm->outcachenum * sizeof(OUTSTYLE_CACHE));
 #endif
     if (!wchmm->category_tree) {
       int c = 0;
@@ -2063,6 +2179,124 @@ build_wchmm2(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
 
 }
 
+/** 
+ * <JA>
+ * ۺѤߤڹ¤ˡθ弭ɲä줿ñɲä. 
+ * ¸ʬϺƹۤʤ. ʸˡȤ˥ƥ꤬ʬ륫ƥ
+ * (ʸˡǧ) ѤǤꡤɲäñϴ¸ñȥΡɤͭʤ. 
+ * ɲñϥƥ硦˥Ȥ build_wchmm2() 
+ * Ʊɲä. 
+ * 
+ * @param wchmm [i/o] ۺѤߤڹ¤
+ * @param lmconf [in] ǥ(LM)ѥ᡼
+ * 
+ * @return  TRUE, Ի FALSE ֤. 
+ * </JA>
+ * <EN>
+ * Add words appended to the dictionary after the tree lexicon was built,
+ * without rebuilding the existing part.  This is only for the category
+ * tree of grammar recognition, where the words of an appended grammar
+ * never share nodes with the existing words.  The new words are sorted
+ * by category and phoneme sequence, and added in the same way as
+ * build_wchmm2().
+ * 
+ * @param wchmm [i/o] tree lexicon already built
+ * @param lmconf [in] language model (LM) configuration parameters
+ * 
+ * @return TRUE on success, FALSE on failure.
+ * </EN>
+ * @callgraph
+ * @callergraph
+ */
+boolean
+build_wchmm_append(WCHMM_INFO *wchmm, JCONF_LM *lmconf)
+{
+  int i, j, last_i;
+  int wbegin, wnum;
+  int num_duplicated;
+  WORD_ID *windex;
+  WORD_INFO *winfo;
+  boolean ok_p;
+  boolean ret;
+
+  winfo = wchmm->winfo;
+  if (!wchmm->category_tree || wchmm->lmtype != LM_DFA) {
+    jlog("ERROR: wchmm: incremental lexicon update is only for grammar\n");
+    return FALSE;
+  }
+  wbegin = wchmm->wordnum;
+  wnum = winfo->num - wbegin;
+  if (wnum <= 0) return TRUE;
+
+  ok_p = TRUE;
+
+  jlog("STAT: Appending %d words to HMM lexicon tree\n", wnum);
+
+#ifdef PASS1_IWCD
+#ifndef USE_OLD_IWCD
+  if (wchmm->ccd_flag) {
+    /* make category-indexed cdset for the new words */
+    lcdset_register_with_category_append(wchmm, wbegin);
+  }
+#endif
+#endif /* PASS1_IWCD */
+
+  /* expand per-word area */
+  wchmm->offset = (int **)myrealloc(wchmm->offset, sizeof(int *) * winfo->num);
+  wchmm->wordend = (int *)myrealloc(wchmm->wordend, sizeof(int) * winfo->num);
+  if (wchmm->hmminfo->multipath) {
+    wchmm->wordbegin = (int *)myrealloc(wchmm->wordbegin, sizeof(int) * winfo->num);
+    if (wchmm->wrk.out_from_len < winfo->maxwn) {
+      wchmm->wrk.out_from = (int *)myrealloc(wchmm->wrk.out_from, sizeof(int) * winfo->maxwn);
+      wchmm->wrk.out_from_next = (int *)myrealloc(wchmm->wrk.out_from_next, sizeof(int) * winfo->maxwn);
+      wchmm->wrk.out_a = (LOGPROB *)myrealloc(wchmm->wrk.out_a, sizeof(LOGPROB) * winfo->maxwn);
+      wchmm->wrk.out_a_next = (LOGPROB *)myrealloc(wchmm->wrk.out_a_next, sizeof(LOGPROB) * winfo->maxwn);
+      wchmm->wrk.out_from_len = winfo->maxwn;
+    }
+  } else {
+    wchmm->wordend_a = (LOGPROB *)myrealloc(wchmm->wordend_a, sizeof(LOGPROB) * winfo->num);
+  }
+
+  /* sort the new words by category and phone sequence */
+  windex = (WORD_ID *)mymalloc(sizeof(WORD_ID) * wnum);
+  for(i=0;i<wnum;i++) windex[i] = wbegin + i;
+  wchmm_sort_idx_by_category_wseq(winfo, windex, wnum);
+
+  /* add the new words to lexicon tree */
+  last_i = WORD_INVALID;
+  for (j=0;j<wnum;j++) {
+    i = windex[j];
+    if (last_i == WORD_INVALID || winfo->wton[i] != winfo->wton[last_i]) {
+      ret = wchmm_add_word(wchmm, i, 0, 0, lmconf->enable_iwsp);
+    } else {
+      ret = wchmm_add_word(wchmm, i, wchmm_check_match(winfo, i, last_i), last_i, lmconf->enable_iwsp);
+    }
+    if (ret == FALSE) {
+      jlog("ERROR: wchmm: failed to add word #%d to lexicon tree\n", i);
+      ok_p = FALSE;
+    }
+    last_i = i;
+  }
+  free(windex);
+
+  if (wchmm->hmminfo->multipath) {
+    jlog("STAT: lexicon size: %d nodes\n", wchmm->n);
+  } else {
+    /* duplicate leaf nodes of homophone/embedded words */
+    jlog("STAT: lexicon size: %d", wchmm->n);
+    num_duplicated = wchmm_duplicate_leafnode(wchmm, wbegin);
+    jlog("+%d=%d\n", num_duplicated, wchmm->n);
+    /* calculate transition probability of word end node to outside */
+    wchmm_calc_wordend_arc(wchmm, wbegin);
+  }
+
+  /* check wchmm coherence (internal debug) */
+  check_wchmm(wchmm);
+  wchmm->wordnum = winfo->num;
+
+  return ok_p;
+}
+
 
 /** 
  * <JA>
@@ -49,7 +49,8 @@ enum {
   SP_NETAUDIO,			///< Live NetAudio/DatLink input
   SP_STDIN,			///< Standard input
   SP_MFCMODULE,			///< parameter module
-  SP_OUTPROBFILE
+  SP_OUTPROBFILE,		///< HTK outprob vector file
+  SP_SHM			///< Shared memory ring buffer
 };
 
 /// Input device
@@ -127,6 +128,15 @@ typedef struct {
   int level;		///< Maximum absolute value of waveform signal in the zerocross buffer
 } ZEROCROSS;
 
+/**
+ * Work area for DC offset removal
+ * 
+ */
+typedef struct {
+  int zlen;			///< Current recorded length for DC offset estimation
+  float zmean;			///< Current mean
+} ZMEAN;
+
 #define ZC_UNDEF 2			///< Undefined mark for zerocross
 #define ZC_POSITIVE 1		///< Positive mark used for zerocross
 #define ZC_NEGATIVE -1		///< Negative mark used for zerocross
@@ -210,6 +220,13 @@ boolean adin_tcpip_send_terminate();
 boolean adin_tcpip_send_resume();
 char *adin_tcpip_input_name();
 
+/* adin/adin_shm.c */
+boolean adin_shm_standby(int freq, void *arg);
+boolean adin_shm_begin(char *pathname);
+boolean adin_shm_end();
+int adin_shm_read(SP16 *buf, int sampnum);
+char *adin_shm_input_name();
+
 /* adin/zc-e.c */
 void init_count_zc_e(ZEROCROSS *zc, int length);
 void reset_count_zc_e(ZEROCROSS *zc, int c_trigger, int c_length, int c_offset);
@@ -218,8 +235,8 @@ int count_zc_e(ZEROCROSS *zc, SP16 *buf,int step);
 void zc_copy_buffer(ZEROCROSS *zc, SP16 *newbuf, int *len);
 
 /* adin/zmean.c */
-void zmean_reset();
-void sub_zmean(SP16 *speech, int samplenum);
+void zmean_reset(ZMEAN *z);
+void sub_zmean(ZMEAN *z, SP16 *speech, int samplenum);
 
 /* adin/ds48to16.c */
 DS_BUFFER *ds48to16_new();
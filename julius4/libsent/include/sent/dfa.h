@@ -48,6 +48,13 @@
 
 #define DFA_CP_MINSTEP 20	///< Minimum initial CP data size per category
 
+/// Maximum memory size in bytes of the category-pair bit matrix.  If the square of the number of categories exceeds it, only the sorted cp lists are used.  Set to 0 to disable the bit matrix
+#define DFA_CP_BITMATRIX_MAXBYTES 4194304
+
+typedef unsigned int CPBIT;	///< Word type of the category-pair bit matrix
+#define CPBIT_SHIFT 5		///< log2 of the number of bits in a CPBIT
+#define CPBIT_MASK 31		///< Mask to get bit position in a CPBIT
+
 #define INITIAL_S 0x10000000	///< Status flag mask specifying an initial state
 #define ACCEPT_S  0x00000001	///< Status flag mask specifying an accept state
 
@@ -88,6 +95,8 @@ typedef struct {
   int *cp_end;	///< Store constraint whether @c c can appear at end of sentence
   int cp_end_len;		///< Length of cp_end
   int cp_end_alloclen;		///< Allocated length of cp_end
+  CPBIT *cpbit;			///< Bit matrix of @a cp as @c [c1 * cpbit_rowlen + (c2 >> CPBIT_SHIFT)], NULL if not used
+  int cpbit_rowlen;		///< Number of CPBIT words per row of cpbit
   TERM_INFO term;		///< Information of terminal symbols (category)
   boolean *is_sp;		///< TRUE if the category contains only \a sp word
   WORD_ID sp_id;		///< Word ID of short pause word
@@ -125,6 +134,7 @@ void free_dfa_cp(DFA_INFO *dfa);
 void dfa_cp_output_rawdata(FILE *fp, DFA_INFO *dfa);
 void dfa_cp_count_size(DFA_INFO *dfa, unsigned long *size_ret, unsigned long *allocsize_ret);
 boolean dfa_cp_append(DFA_INFO *dfa, DFA_INFO *src, int offset);
+int dfa_cp_next(DFA_INFO *dfa, int i, int j);
 
 #include <sent/vocabulary.h>
 boolean make_dfa_voca_ref(DFA_INFO *dinfo, WORD_INFO *winfo);
@@ -120,6 +120,40 @@ typedef unsigned short NNID_LOWER; ///< N-gram entry ID (24bit: lower bit)
 #define NNID_INVALID_UPPER 255	///< Value to indicate no id at NNID_UPPER (24bit)
 #define NNID_MAX_24 16711679        ///< Allowed maximum number of id (255*65536-1) (24bit)
 
+typedef unsigned char NGRAM_QUANT; ///< Quantized probability (index to codebook)
+#define NGRAM_QUANT_LEVELS 256	///< Number of codebook entries for quantized probabilities
+
+/**
+ * Bit-packed array of unsigned integers with fixed bit width.
+ * 32 entries occupy just @a width words.
+ * 
+ */
+typedef struct {
+  int width;			///< Bit width of an entry (0 to 32)
+  NNID len;			///< Length of @a body in words
+  unsigned int *body;		///< Packed entries
+} NGRAM_BITARRAY;
+
+/// Interval of sampled positions in the upper bits of Elias-Fano sequence, in power of 2
+#define NGRAM_EF_SAMPLE_SHIFT 6
+
+/**
+ * Monotone non-decreasing sequence coded by Elias-Fano coding.  Each
+ * value is split into lower @a lowbit bits stored in a bit-packed array,
+ * and the upper bits stored in unary code as a bit vector.
+ * 
+ */
+typedef struct {
+  NNID num;			///< Number of values
+  int lowbit;			///< Bit width of the lower part
+  NGRAM_BITARRAY low;		///< Lower part of values
+  NNID highlen;			///< Length of @a high in words
+  unsigned int *high;		///< Upper part of values in unary code
+  int sampleshift;		///< Interval of @a sample in power of 2
+  NNID samplenum;		///< Length of @a sample
+  NNID *sample;			///< Position of every (2^@a sampleshift)-th 1 bit in @a high
+} NGRAM_EF;
+
 /// Default word string of beginning-of-sentence word
 #define BEGIN_WORD_DEFAULT "<s>"
 /// Default word string of end-of-sentence word
@@ -152,8 +186,23 @@ typedef struct {
   NNID_UPPER *nnid2ctid_upper;	///< Index to map tuple ID of this m-gram to valid context id (upper 8bit)
   NNID_LOWER *nnid2ctid_lower;	///< Index to map tuple ID of this m-gram to valid context id (upper 16bit)
 
+  NGRAM_QUANT *prob_q;		///< Quantized @a prob, used instead of @a prob when not NULL
+  LOGPROB *prob_cb;		///< Codebook for @a prob_q
+  NGRAM_QUANT *bo_wt_q;		///< Quantized @a bo_wt, used instead of @a bo_wt when not NULL
+  LOGPROB *bo_wt_cb;		///< Codebook for @a bo_wt_q
+
+  NGRAM_EF *bgn_ef;		///< Elias-Fano coded beginning IDs of tuple sets, used instead of @a bgn and @a num when not NULL
+  NGRAM_BITARRAY *nnid2wid_packed; ///< Bit-packed @a nnid2wid, used instead of it when not NULL
+
 } NGRAM_TUPLE_INFO;
 
+/// Get log probability of a tuple from NGRAM_TUPLE_INFO, decoding quantized value if needed
+#define NGRAM_PROB(T,ID) ((T)->prob_q ? (T)->prob_cb[(T)->prob_q[ID]] : (T)->prob[ID])
+/// Get back-off weight of a context from NGRAM_TUPLE_INFO, decoding quantized value if needed
+#define NGRAM_BO_WT(T,ID) ((T)->bo_wt_q ? (T)->bo_wt_cb[(T)->bo_wt_q[ID]] : (T)->bo_wt[ID])
+/// Get word ID of a tuple from NGRAM_TUPLE_INFO, extracting bit-packed value if needed
+#define NGRAM_WID(T,ID) ((T)->nnid2wid_packed ? (WORD_ID)ngram_bitarray_get((T)->nnid2wid_packed, ID) : (T)->nnid2wid[ID])
+
 /**
  * @brief Main N-gram structure
  *
@@ -181,12 +230,22 @@ typedef struct __ngram_info__ {
   /* for pass1 */
   LOGPROB *bo_wt_1;		///< back-off weights for 2-gram on 1st pass
   LOGPROB *p_2;			///< 2-gram prob for the 1st pass
+  NGRAM_QUANT *p_2_q;		///< Quantized @a p_2, used instead of @a p_2 when not NULL
+  LOGPROB *p_2_cb;		///< Codebook for @a p_2_q
   LOGPROB (*bigram_prob)(struct __ngram_info__ *, WORD_ID, WORD_ID); ///< Pointer of a function to compite bigram probability on the 1st pass.  See bi_prob_func_set() for details
 
   BMALLOC_BASE *mroot;		///< Pointer for block memory allocation for lookup index
 
+  void *mmap_base;		///< Top of the mapped bingram file when arrays are directly mapped from the file, or NULL
+  size_t mmap_len;		///< Length of the mapped area in bytes
+
+  int read_thread_num;		///< Number of threads to parse ARPA file (0: number of CPUs, 1: no thread)
+
 } NGRAM_INFO;
 
+/// Get 2-gram prob for the 1st pass from NGRAM_INFO, decoding quantized value if needed
+#define NGRAM_P_2(N,ID) ((N)->p_2_q ? (N)->p_2_cb[(N)->p_2_q[ID]] : (N)->p_2[ID])
+
 
 /* Definitions for binary N-gram */
 
@@ -196,6 +255,14 @@ typedef struct __ngram_info__ {
 #define BINGRAM_IDSTR_V4 "julius_bingram_v4"
 /// Header string to identify version of bingram (v5: >= rev.4.0)
 #define BINGRAM_IDSTR_V5 "julius_bingram_v5"
+/// Header string to identify version of bingram (v6: v5 with section alignment for memory mapping)
+#define BINGRAM_IDSTR_V6 "julius_bingram_v6"
+/// Header string to identify version of bingram (v7: v6 with quantized probabilities)
+#define BINGRAM_IDSTR_V7 "julius_bingram_v7"
+/// Header string to identify version of bingram (v8: v7 with succinct tuple index)
+#define BINGRAM_IDSTR_V8 "julius_bingram_v8"
+/// Byte alignment of each array section in v6 bingram
+#define BINGRAM_SECTION_ALIGN 4096
 /// Bingram header size in bytes
 #define BINGRAM_HDSIZE 512
 /// Bingram header info string to identify the unit byte (head)
@@ -233,8 +300,17 @@ void bi_prob_func_set(NGRAM_INFO *ndata);
 boolean ngram_read_arpa(FILE *fp, NGRAM_INFO *ndata, boolean addition);
 boolean ngram_read_bin(FILE *fp, NGRAM_INFO *ndata);
 boolean ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *header_str);
+boolean ngram_write_bin_mmap(FILE *fp, NGRAM_INFO *ndata, char *header_str);
+boolean ngram_bin_mappable(char *filename);
+boolean ngram_read_bin_mmap(char *filename, NGRAM_INFO *ndata);
 
 boolean ngram_compact_context(NGRAM_INFO *ndata, int n);
+boolean ngram_quantize(NGRAM_INFO *ndata);
+boolean ngram_is_quantized(NGRAM_INFO *ndata);
+boolean ngram_pack_index(NGRAM_INFO *ndata);
+boolean ngram_is_packed(NGRAM_INFO *ndata);
+unsigned int ngram_bitarray_get(NGRAM_BITARRAY *b, NNID id);
+boolean ngram_ef_range(NGRAM_EF *ef, NNID id, NNID *bgn, NNID *num);
 
 void ngram_make_lookup_tree(NGRAM_INFO *ndata);
 WORD_ID ngram_lookup_word(NGRAM_INFO *ndata, char *wordstr);
@@ -242,6 +318,7 @@ WORD_ID make_ngram_ref(NGRAM_INFO *, char *);
 
 NGRAM_INFO *ngram_info_new();
 void ngram_info_free(NGRAM_INFO *ngram);
+void ngram_info_unmap(NGRAM_INFO *ngram);
 boolean init_ngram_bin(NGRAM_INFO *ndata, char *ngram_file);
 boolean init_ngram_arpa(NGRAM_INFO *ndata, char *ngram_file, int dir);
 boolean init_ngram_arpa_additional(NGRAM_INFO *ndata, char *bigram_file);
@@ -0,0 +1,173 @@
+/**
+ * @file   shmring.h
+ *
+ * <JA>
+ * @brief  ͭ󥰥ХåեϤ˴ؤ
+ *
+ * ƱۥȾ¦ץ POSIX ͭ˲ǡޤ
+ * ħ̥٥ȥ񤭹ߡJulius ɤ߹ࡥͭ
+ * إåȥ󥰥Хåեʤ롥¦ȼ¦ϥإåɤ߹ߡ
+ * 񤭹֤߰ΤߤȤꤹΤǡ󥯤ե졼ऴȤ
+ * ƥॳ;ʬʥԡפǤ롥¾Ԥɬפ
+ * ȤϡإåΥץֶͭޥեԤ¾
+ * </JA>
+ * <EN>
+ * @brief  Definitions for shared memory ring buffer input
+ *
+ * A producer on the same host writes audio samples or feature vectors
+ * to a POSIX shared memory segment, and Julius reads them from it.  The
+ * segment holds a header and a ring buffer.  The producer and the
+ * consumer exchange only the read / write positions in the header, so
+ * no system call and no extra copy is needed for each chunk or frame.
+ * When one side has to wait for the other, it sleeps on a process-shared
+ * semaphore in the header, and the other side wakes it up.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#ifndef __SENT_SHMRING__
+#define __SENT_SHMRING__
+
+#include <sent/stddefs.h>
+
+#ifdef HAVE_SEM_TIMEDWAIT
+#include <semaphore.h>
+#define HAVE_SHMRING_SEM	///< Wait on semaphores instead of polling
+#endif
+
+/// Default name of the shared memory segment
+#define SHMRING_NAME "/julius"
+
+/// Magic number to tell that the segment is ready
+#define SHMRING_MAGIC 0x4a534852
+/// Version of the segment layout
+#define SHMRING_VERSION 2
+/// Maximum number of segment marks not yet read
+#define SHMRING_MARKNUM 64
+/// Interval of polling the ring in microseconds, when semaphore is not available
+#define SHMRING_POLL_USEC 1000
+/// Maximum time to sleep on a semaphore before checking the ring again, in microseconds
+#define SHMRING_SEM_WAIT_USEC 100000
+/// Default time for the producer to wait for the consumer in msec
+#define SHMRING_TIMEOUT_MSEC 10000
+
+/// Index of semaphore on which the consumer waits for data
+#define SHMRING_READER 0
+/// Index of semaphore on which the producer waits for space
+#define SHMRING_WRITER 1
+
+/// Return value of shmring_read() on end of segment
+#define SHMRING_SEGMENT -3
+/// Return value of shmring_read() on end of stream
+#define SHMRING_EOF -1
+/// Return value of shmring_read() on error
+#define SHMRING_ERROR -2
+
+/**
+ * Configuration of the data in the ring, set by the producer.
+ *
+ */
+typedef struct {
+  int sfreq;			///< Sampling rate for audio (Hz)
+  int veclen;			///< Vector length for feature vectors
+  int fshift;			///< Frame shift in msec for feature vectors
+  int outprob_p;		///< 1 if the vectors are outprob vectors
+} SHMRING_CONF;
+
+/**
+ * Semaphore in the segment.  The size is fixed regardless of the
+ * platform, so that the layout of the header does not change.
+ *
+ */
+typedef union {
+#ifdef HAVE_SHMRING_SEM
+  sem_t sem;			///< Process-shared semaphore
+#endif
+  char pad[64];			///< Padding to fix the size
+} SHMRING_SEM;
+
+/**
+ * Header at the top of the shared memory segment.  The positions are
+ * total number of units written / read, and wrap around at 2^32.
+ *
+ */
+typedef struct {
+  volatile unsigned int magic;	///< SHMRING_MAGIC when ready
+  unsigned int version;		///< SHMRING_VERSION
+  unsigned int unitsize;	///< Bytes per unit (sample or vector)
+  unsigned int unitnum;		///< Ring size in units (power of 2)
+  SHMRING_CONF conf;		///< Data configuration
+  volatile unsigned int wpos;	///< Write position (by producer)
+  volatile unsigned int rpos;	///< Read position (by consumer)
+  volatile unsigned int mark_w;	///< Number of segment marks written
+  volatile unsigned int mark_r;	///< Number of segment marks read
+  volatile unsigned int mark[SHMRING_MARKNUM]; ///< Positions of end of segment
+  volatile unsigned int closed;	///< 1 when the producer has finished
+  unsigned int sem_p;		///< 1 if @a sem are initialized
+  volatile unsigned int waiting[2]; ///< 1 while the consumer / producer is going to sleep on @a sem
+  SHMRING_SEM sem[2];		///< Semaphores to wake up the consumer / producer
+} SHMRING_HEADER;
+
+/**
+ * Shared memory ring buffer opened in this process.
+ *
+ */
+typedef struct {
+  char *name;			///< Name of the segment
+  int fd;			///< File descriptor of the segment
+  size_t len;			///< Length of the segment in bytes
+  SHMRING_HEADER *h;		///< Header at the top of the segment
+  char *data;			///< Ring buffer
+  unsigned int unitsize;	///< Bytes per unit, fixed at create / open
+  unsigned int unitnum;		///< Ring size in units, fixed at create / open
+  int timeout_msec;		///< Time for the producer to wait for the consumer, -1 for no limit
+} SHMRING;
+
+/**
+ * @def SHMRING_BARRIER
+ * Memory barrier to order the data and positions seen by the other side.
+ */
+#if defined(__GNUC__)
+#define SHMRING_BARRIER() __sync_synchronize()
+#else
+#define SHMRING_BARRIER()
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* net/shmring.c */
+SHMRING *shmring_create(char *name, int unitsize, int unitnum, SHMRING_CONF *conf, int timeout_msec);
+SHMRING *shmring_open(char *name);
+void shmring_close(SHMRING *r, boolean remove_p);
+int shmring_write(SHMRING *r, void *data, int num);
+boolean shmring_mark_segment(SHMRING *r);
+void shmring_finish(SHMRING *r);
+int shmring_read(SHMRING *r, void *data, int maxnum, int wait_msec);
+
+/* anlz/vecin_shm.c */
+void vecin_shm_set_name(char *name);
+boolean vecin_shm_standby();
+boolean vecin_shm_open();
+int vecin_shm_get_configuration(int opcode);
+int vecin_shm_read(float *vecbuf, int veclen);
+boolean vecin_shm_close();
+boolean vecin_shm_terminate();
+boolean vecin_shm_pause();
+boolean vecin_shm_resume();
+char *vecin_shm_input_name();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SENT_SHMRING__ */
@@ -143,6 +143,19 @@ typedef unsigned char boolean;
 #define F_OK 0
 #endif
 
+/**
+ * Storage class for work areas of input functions, which should be held
+ * per thread to run multiple engine instances on separate threads.
+ * 
+ */
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(HAVE_PTHREAD) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
 /* some macros */
 #undef max
 #undef min
@@ -48,6 +48,9 @@
 /// Default port number of feature server (vecin_net)
 #define         VECINNET_PORT 5531
 
+/// Maximum number of frames in a message to feature server (vecin_net)
+#define         VECINNET_MAXFRAMES 1024
+
 /// Default Host/unit name for NetAudio/DatLink input
 #define         NETAUDIO_DEVNAME "localhost:0"
 
@@ -56,6 +59,29 @@
 /// Interval time between retry in seconds
 #define		CONNECTION_RETRY_INTERVAL 2 /* sec. */
 
+/**
+ * @name Audio codecs on adinnet
+ *
+ * Codec IDs and packet definitions for compressed audio transfer on
+ * adinnet.  See net/adinnet_codec.c for details.
+ *
+ */
+/*@{*/
+#define ADINNET_CODEC_PCM  0	///< 16bit linear PCM (default)
+#define ADINNET_CODEC_ULAW 1	///< G.711 mu-law
+#define ADINNET_CODEC_ALAW 2	///< G.711 A-law
+#define ADINNET_CODEC_LPC  3	///< Lossless linear prediction with Rice coding
+#define ADINNET_CODEC_NUM  4	///< Number of codecs
+/// Maximum number of samples in a compressed packet
+#define ADINNET_CODEC_BLOCK 4096
+/// Length of codec request packet (odd, to be distinguished from PCM data)
+#define ADINNET_CODEC_REQLEN 5
+/// Length of codec reply packet
+#define ADINNET_CODEC_REPLEN 2
+/// Time to wait for codec reply from server in seconds
+#define ADINNET_CODEC_TIMEOUT 3
+/*@}*/
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -71,6 +97,15 @@ int make_connection(char *hostname, int port_num);
 int make_connection_unix(char *address);
 int close_socket(int sd);
 void cleanup_socket();
+/* net/adinnet_codec.c */
+int adinnet_codec_lookup(char *name);
+char *adinnet_codec_name(int codec);
+int adinnet_codec_maxbytes(int codec, int num);
+int adinnet_encode(int codec, SP16 *in, int num, unsigned char *out);
+int adinnet_decode(int codec, unsigned char *in, int len, SP16 *out, int maxnum);
+int adinnet_codec_request(int sd, int codec);
+boolean adinnet_codec_is_request(char *buf, int len, int *codec);
+boolean adinnet_codec_reply(int sd, int codec);
 
 /* vecin_net.c */
 boolean vecin_standby();
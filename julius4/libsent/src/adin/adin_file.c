@@ -50,6 +50,12 @@
  * When compiled with libsndfile support, the functions in adin_sndfile.c
  * is used for file input instead of functions below.
  *
+ * On systems with mmap(), a regular input file is mapped to memory after
+ * its header is parsed, and the samples are copied directly from the
+ * mapped area to the buffer given by the caller, without stdio buffering.
+ * Byte swapping is done only when the byte order of the file differs from
+ * the machine.
+ *
  * In this file, assume sizeof(int)=4, sizeof(short)=2
  * </EN>
  *
@@ -70,23 +76,37 @@
 #include <sent/stddefs.h>
 #include <sent/speech.h>
 #include <sent/adin.h>
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
-static FILE *gfp;		///< File pointer of current input file
-static boolean wav_p;		///< TRUE if input is WAVE file, FALSE if RAW file
-static int maxlen;		///< Number of samples, described in the header of WAVE file
-static int nowlen;		///< Current number of read samples
+/* Status of the current input stream is kept per thread, so that
+   engine instances running in separate threads can read files
+   independently.  Settings given at adin_*_standby() are shared. */
+static THREAD_LOCAL FILE *gfp;		///< File pointer of current input file
+static THREAD_LOCAL boolean wav_p;		///< TRUE if input is WAVE file, FALSE if RAW file
+static THREAD_LOCAL int maxlen;		///< Number of samples, described in the header of WAVE file
+static THREAD_LOCAL int nowlen;		///< Current number of read samples
 /**
  * When file input, the first 4 bytes of the file are read at first to
  * identify whether it is WAVE file format.  This work area is used to
  * keep back the 4 bytes if the input is actually a RAW format.
  */
-static SP16 pre_data[2];
-static boolean has_pre;		///< TRUE if pre_data is available
+static THREAD_LOCAL SP16 pre_data[2];
+static THREAD_LOCAL boolean has_pre;		///< TRUE if pre_data is available
 
 static unsigned int sfreq;	///< Sampling frequency in Hz, specified by adin_standby()
 
-static char speechfilename[MAXPATHLEN];	///< Buffer to hold input file name
-static char *stdin_buf = NULL;
+static THREAD_LOCAL char speechfilename[MAXPATHLEN];	///< Buffer to hold input file name
+static THREAD_LOCAL char *stdin_buf = NULL;
+#ifdef HAVE_MMAP
+static THREAD_LOCAL char *map_base = NULL; ///< Mapped area of current input file, NULL if not mapped
+static THREAD_LOCAL size_t map_len;	///< Length of the mapped area
+static THREAD_LOCAL char *map_data;	///< Beginning of samples in the mapped area
+#endif
 
 /* read .wav data with endian conversion */
 /* (all .wav datas are in little endian) */
@@ -230,6 +250,54 @@ setup_wav(FILE *fp)
   return TRUE;
 }
 
+#ifdef HAVE_MMAP
+/** 
+ * @brief  Map the opened input file to memory.
+ *
+ * The samples will be read from the mapped area instead of @a fp.
+ * The file position of @a fp should be at the beginning of samples for
+ * WAVE file.  If the file is not a regular file or cannot be mapped,
+ * it will be read by stdio as usual.
+ * 
+ * @param fp [in] File pointer
+ * 
+ * @return TRUE if mapped, FALSE if not.
+ */
+static boolean
+adin_file_map(FILE *fp)
+{
+  struct stat st;
+  long offset;
+  size_t len;
+  void *p;
+
+  if (fstat(fileno(fp), &st) < 0 || !S_ISREG(st.st_mode)) return FALSE;
+  if (wav_p) {
+    if ((offset = ftell(fp)) < 0) return FALSE;
+  } else {
+    /* raw file: samples from the top, including the pre-read ones */
+    offset = 0;
+  }
+  if (st.st_size <= offset) return FALSE;
+  p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+  if (p == MAP_FAILED) return FALSE;
+#ifdef MADV_SEQUENTIAL
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+#endif
+  map_base = (char *)p;
+  map_len = st.st_size;
+  map_data = map_base + offset;
+
+  /* the samples should not exceed the end of file */
+  len = (st.st_size - offset) / sizeof(SP16);
+  if (!wav_p || maxlen > len) maxlen = len;
+  nowlen = 0;
+  has_pre = FALSE;
+
+  return TRUE;
+}
+#endif
+
 /** 
  * @brief  Open input file
  *
@@ -288,6 +356,14 @@ adin_file_open(char *filename)	/* NULL for standard input */
     has_pre = TRUE;
   }
 
+#ifdef HAVE_MMAP
+  if (filename != NULL && adin_file_map(fp)) {
+    /* the mapped area remains after closing */
+    fclose(fp);
+    fp = NULL;
+  }
+#endif
+
   gfp = fp;
 
   return(TRUE);
@@ -303,6 +379,13 @@ adin_file_close()
 {
   FILE *fp;
 
+#ifdef HAVE_MMAP
+  if (map_base != NULL) {
+    munmap(map_base, map_len);
+    map_base = NULL;
+    return TRUE;
+  }
+#endif
   fp = gfp;
   if (fclose(fp) != 0) {
     jlog("Error: adin_file: failed to close file\n");
@@ -414,6 +497,16 @@ adin_file_read(SP16 *buf, int sampnum)
 
   fp = gfp;
   
+#ifdef HAVE_MMAP
+  if (map_base != NULL) {
+    /* copy from the mapped area */
+    cnt = maxlen - nowlen;
+    if (cnt <= 0) return -1; /* EOF */
+    if (cnt > sampnum) cnt = sampnum;
+    memcpy(buf, map_data + nowlen * sizeof(SP16), cnt * sizeof(SP16));
+    nowlen += cnt;
+  } else
+#endif
   if (wav_p) {
     cnt = fread(buf, sizeof(SP16), sampnum, fp);
     if (cnt == 0) {
@@ -0,0 +1,171 @@
+/**
+ * @file   adin_shm.c
+ *
+ * <JA>
+ * @brief  ͭϡƱۥȤץβ
+ *
+ * ƱۥȾץ POSIX ͭΥ󥰥Хåե
+ * 񤭹ǡɤ߹٥ؿǤǡμϤ
+ * 󥰥Хåեɤ߹ߡ񤭹֤߰ιΤߤǹԤΤǡ
+ * adinnet Τ褦ʥ󥯤ȤΥƥॳ䥳ԡޤ
+ * 󥰥Хåեη net/shmring.c 򻲾ȤƤ
+ *
+ * ϻˤץͭޤԤޤ
+ * ץ֤νΤ϶֤ڤꡤ
+ * ϤνΤƤΥǡɤ߽ϤĤơ
+ * ζ꤬ͭΤԤޤ
+ *
+ * ǡ 16bit, Υ, ޥΥХȥȤޤ
+ * ¦Υץ󥰥졼Ȥ Julius Ȱפɬפޤ
+ * </JA>
+ * <EN>
+ * @brief  Audio input from a producer process on the same host
+ *
+ * Low level I/O functions for audio input from a producer process on the
+ * same host via a ring buffer on POSIX shared memory.  Data are passed
+ * only by updating the read / write positions of the ring buffer, so
+ * there is no system call nor copy for each chunk as in adinnet.  See
+ * net/shmring.c for the ring buffer.
+ *
+ * At the beginning, it waits until the producer creates the shared
+ * memory segment.  When the producer marks end of segment, the input will
+ * be segmented there.  When the producer tells end of input and all data
+ * has been read, the input is closed and it waits for the next segment
+ * to be created.
+ *
+ * The samples should be 16bit, monaural, in machine byte order.  The
+ * sampling rate of the producer should be the same as Julius.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/adin.h>
+#include <sent/shmring.h>
+
+static char *shm_name = NULL;	///< Name of the shared memory segment
+static int shm_sfreq;		///< Required sampling rate
+static THREAD_LOCAL SHMRING *ring = NULL; ///< Current ring buffer
+
+/**
+ * Initialize as shared memory input.
+ *
+ * @param freq [in] required sampling frequency
+ * @param arg [in] name of the shared memory segment
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+adin_shm_standby(int freq, void *arg)
+{
+  if (shm_name != NULL) free(shm_name);
+  shm_name = strcpy((char *)mymalloc(strlen((char *)arg) + 1), (char *)arg);
+  shm_sfreq = freq;
+
+  jlog("Stat: adin_shm: ready for input from \"%s\"\n", shm_name);
+
+  return TRUE;
+}
+
+/**
+ * Wait for a producer to create the shared memory segment and begin
+ * audio input stream.
+ *
+ * @param pathname [in] path name to open or NULL for default
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+adin_shm_begin(char *pathname)
+{
+  jlog("Stat: adin_shm: waiting for producer...\n");
+  if ((ring = shmring_open(shm_name)) == NULL) {
+    return FALSE;
+  }
+  if (ring->unitsize != sizeof(SP16)) {
+    jlog("Error: adin_shm: \"%s\" is not audio data (unit size = %d)\n", shm_name, ring->unitsize);
+    shmring_close(ring, FALSE);
+    ring = NULL;
+    return FALSE;
+  }
+  if (ring->h->conf.sfreq != shm_sfreq) {
+    jlog("Warning: adin_shm: sampling rate of producer (%dHz) differs from required (%dHz)\n", ring->h->conf.sfreq, shm_sfreq);
+  }
+  jlog("Stat: adin_shm: attached\n");
+
+  return TRUE;
+}
+
+/**
+ * End recording and detach from the segment.  The segment is removed if
+ * the producer has finished.  Otherwise the next input will attach to
+ * it again and continue reading.
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+adin_shm_end()
+{
+  if (ring == NULL) return TRUE;
+
+  if (ring->h->closed) {
+    shmring_close(ring, TRUE);
+    jlog("Stat: adin_shm: producer finished, detached\n");
+  } else {
+    shmring_close(ring, FALSE);
+    jlog("Stat: adin_shm: detached\n");
+  }
+  ring = NULL;
+
+  return TRUE;
+}
+
+/**
+ * Try to read @a sampnum samples and returns actual sample num recorded.
+ * This waits for data at most 10 msec.
+ *
+ * @param buf [out] samples obtained in this function
+ * @param sampnum [in] wanted number of samples to be read
+ *
+ * @return actural number of read samples, -1 if end of input, -3 if end
+ * of segment, -2 if error.
+ */
+int
+adin_shm_read(SP16 *buf, int sampnum)
+{
+  int ret;
+
+  ret = shmring_read(ring, buf, sampnum, 10);
+  switch(ret) {
+  case SHMRING_SEGMENT:
+    return -3;
+  case SHMRING_EOF:
+    return -1;
+  case SHMRING_ERROR:
+    return -2;
+  }
+  return ret;
+}
+
+/**
+ *
+ * Function to return current input source device name
+ *
+ * @return string of current input device name.
+ *
+ */
+char *
+adin_shm_input_name()
+{
+  return(shm_name);
+}
+
+/* end of file */
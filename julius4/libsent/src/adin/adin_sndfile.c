@@ -81,11 +81,11 @@
 #include <sndfile.h>
 
 static int sfreq;		///< Required sampling frequency in Hz
-static SF_INFO sinfo;		///< Wavefile information
-static SNDFILE *sp;		///< File handler
+static THREAD_LOCAL SF_INFO sinfo;		///< Wavefile information
+static THREAD_LOCAL SNDFILE *sp;		///< File handler
 static boolean from_file;	///< TRUE if reading filename from listfile
 static FILE *fp_list;		///< File pointer used for the listfile
-static char speechfilename[MAXPATHLEN];	///< Buffer to hold input file name
+static THREAD_LOCAL char speechfilename[MAXPATHLEN];	///< Buffer to hold input file name
 
 /// Check if the file format is 16bit, monoral.
 static boolean
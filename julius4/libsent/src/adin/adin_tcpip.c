@@ -16,6 +16,10 @@
  * ¾˥ͥåȥǲǡȤꤹˡȤ, Linux Ǥ
  * EsounD Ȥˡޤadin_esd.c 
  *
+ * 饤Ȥ³ľ˰׵ᤷ硤ʹߤβǡ
+ * 沽ޤ (-law, A-law, ĵհ)
+ * ܺ٤ net/adinnet_codec.c 򻲾ȤƤ
+ *
  * @attention ¦ȥ饤¦ǥץ󥰥졼
  * פɬפޤ³ξԴ֤ǥåϹԤޤ
  *
@@ -36,6 +40,10 @@
  * "EsounD" is an another method of obtaining audio input from network
  * on Linux.  See adin_esd.c for details.
  *
+ * When the client requests a codec just after connection, the following
+ * audio data will be decoded by the codec (mu-law, A-law or lossless).
+ * See net/adinnet_codec.c for details.
+ *
  * @attention The sampling rate setting on both side (server and client)
  * should be the same.  They will not be checked when connected.
  *
@@ -58,9 +66,19 @@
 #include <sent/stddefs.h>
 #include <sent/adin.h>
 #include <sent/tcpip.h>
+#include <time.h>
 
 static int adinnet_sd = -1;	///< Listen socket for adinserv
-static int adinnet_asd = -1;	///< Accept socket for adinserv
+static THREAD_LOCAL int adinnet_asd = -1;	///< Accept socket for adinserv
+
+static THREAD_LOCAL int codec = ADINNET_CODEC_PCM; ///< Codec of current connection
+static THREAD_LOCAL unsigned char *codec_buf = NULL; ///< Received encoded data
+static THREAD_LOCAL SP16 *pend_buf = NULL; ///< Decoded samples to be returned
+static THREAD_LOCAL int pend_len = 0;	///< Number of samples in @a pend_buf
+static THREAD_LOCAL int pend_pos = 0;	///< Next sample to return in @a pend_buf
+static THREAD_LOCAL unsigned long codec_samples; ///< Total decoded samples
+static THREAD_LOCAL unsigned long codec_bytes; ///< Total received bytes
+static THREAD_LOCAL clock_t codec_clock; ///< Total CPU time for decoding
 
 #ifdef FORK_ADINNET
 static pid_t child;		/* child process ID (0 if myself is child) */
@@ -133,6 +151,12 @@ adin_tcpip_begin(char *pathname)
     jlog("Stat: adin_tcpip: connected\n");
 #endif /* FORK_ADINNET */
 
+  /* PCM until a codec is requested by the client */
+  codec = ADINNET_CODEC_PCM;
+  pend_len = pend_pos = 0;
+  codec_samples = codec_bytes = 0;
+  codec_clock = 0;
+
   return TRUE;
 }
 
@@ -150,6 +174,9 @@ adin_tcpip_begin(char *pathname)
 boolean
 adin_tcpip_end()
 {
+    if (codec != ADINNET_CODEC_PCM && codec_samples > 0) {
+      jlog("Stat: adin_tcpip: %s: %lu samples in %lu bytes (%.1f%%), decode %.1f msec (%.1f nsec/sample)\n", adinnet_codec_name(codec), codec_samples, codec_bytes, (float)codec_bytes * 100.0 / (codec_samples * sizeof(SP16)), (float)codec_clock * 1000.0 / CLOCKS_PER_SEC, (float)codec_clock * 1.0e9 / CLOCKS_PER_SEC / codec_samples);
+    }
     /* end of connection */
     close_socket(adinnet_asd);
 #ifdef FORK_ADINNET
@@ -172,6 +199,9 @@ adin_tcpip_end()
  * marker from the client.  If data below zero length has been received,
  * it means the client has finished the overall input stream transmission and
  * want to disconnect.
+ *
+ * When a codec is in use, a received packet is decoded at once and the
+ * samples not returned yet are kept for the next call.
  * 
  * @param buf [out] samples obtained in this function
  * @param sampnum [in] wanted number of samples to be read
@@ -185,6 +215,17 @@ adin_tcpip_read(SP16 *buf, int sampnum)
   fd_set rfds;
   struct timeval tv;
   int status;
+  int req;
+  clock_t c;
+
+  /* return decoded samples left from the last packet */
+  if (pend_pos < pend_len) {
+    cnt = pend_len - pend_pos;
+    if (cnt > sampnum) cnt = sampnum;
+    memcpy(buf, &(pend_buf[pend_pos]), cnt * sizeof(SP16));
+    pend_pos += cnt;
+    return cnt;
+  }
 
   /* check if some commands are waiting in queue */
   FD_ZERO(&rfds);
@@ -196,6 +237,26 @@ adin_tcpip_read(SP16 *buf, int sampnum)
     jlog("Error: adin_tcpip: failed to poll socket\n");
     return -2;			/* error return */
   }
+  if (status > 0 && codec != ADINNET_CODEC_PCM) {
+    /* read one encoded packet and decode it */
+    ret = rd(adinnet_asd, (char *)codec_buf, &cnt, adinnet_codec_maxbytes(codec, ADINNET_CODEC_BLOCK));
+    if (ret == 0) return -3;
+    if (ret < 0) return -1;
+    c = clock();
+    pend_len = adinnet_decode(codec, codec_buf, cnt, pend_buf, ADINNET_CODEC_BLOCK);
+    codec_clock += clock() - c;
+    if (pend_len < 0) {
+      jlog("Error: adin_tcpip: failed to decode %s data\n", adinnet_codec_name(codec));
+      pend_len = 0;
+      return -2;
+    }
+    codec_samples += pend_len;
+    codec_bytes += cnt;
+    cnt = (pend_len < sampnum) ? pend_len : sampnum;
+    memcpy(buf, pend_buf, cnt * sizeof(SP16));
+    pend_pos = cnt;
+    return cnt;
+  }
   if (status > 0) {		/* there are some data */
     /* read one data segment, leave rest even if any for avoid blocking */
     ret = rd(adinnet_asd, (char *)buf, &cnt, sampnum * sizeof(SP16));
@@ -207,6 +268,23 @@ adin_tcpip_read(SP16 *buf, int sampnum)
       /* end of input, mark */
       return -1;
     }
+    if (adinnet_codec_is_request((char *)buf, cnt, &req)) {
+      /* codec request from client */
+      if (req < 0 || req >= ADINNET_CODEC_NUM) req = ADINNET_CODEC_PCM;
+      if (adinnet_codec_reply(adinnet_asd, req) == FALSE) {
+	jlog("Error: adin_tcpip: failed to reply codec to client\n");
+	return -2;
+      }
+      if (req != ADINNET_CODEC_PCM) {
+	if (codec_buf == NULL) {
+	  codec_buf = (unsigned char *)mymalloc(adinnet_codec_maxbytes(ADINNET_CODEC_LPC, ADINNET_CODEC_BLOCK));
+	  pend_buf = (SP16 *)mymalloc(sizeof(SP16) * ADINNET_CODEC_BLOCK);
+	}
+      }
+      codec = req;
+      jlog("Stat: adin_tcpip: client requested codec \"%s\"\n", adinnet_codec_name(codec));
+      return 0;
+    }
   } else {			/* time out, no data */
     cnt = 0;
   }
@@ -249,7 +327,7 @@ adin_tcpip_send_resume()
   fd_set rfds;
   struct timeval tv;
   int status;
-  static char *tmpbuf = NULL;
+  static THREAD_LOCAL char *tmpbuf = NULL;
 
   /* check if some commands are waiting in queue */
   count = 0;
@@ -272,6 +350,7 @@ adin_tcpip_send_resume()
   if (count > 0) {
     jlog("Stat: %d samples transfered while pause are flushed\n", count);
   }
+  pend_len = pend_pos = 0;
     
   /* send resume command to adinnet client */
   com = '1';
@@ -90,7 +90,7 @@ static boolean
 load_filter(DS_FILTER *f, char *coeffile)
 {
   FILE *fp;
-  static char buf[512];
+  char buf[512];
   int i;
  
   /* read the filter coefficients */
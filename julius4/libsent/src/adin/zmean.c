@@ -40,18 +40,16 @@
 
 #include <sent/adin.h>
 
-static int zlen = 0;		///< Current recorded length for DC offset estimation
-static float zmean = 0.0;	///< Current mean
-
 /** 
  * Reset status.
  * 
+ * @param z [out] work area for DC offset removal
  */
 void
-zmean_reset()
+zmean_reset(ZMEAN *z)
 {
-  zlen = 0;
-  zmean = 0.0;
+  z->zlen = 0;
+  z->zmean = 0.0;
 }
 
 /** 
@@ -62,27 +60,28 @@ zmean_reset()
  * whole input is used to estimate the zero mean.  Otherwise, the zero mean
  * will continue to be updated until the read length exceed ZMEANSAMPLES.
  * 
+ * @param z [i/o] work area for DC offset removal
  * @param speech [I/O] input speech data, will be subtracted by DC offset.
  * @param samplenum [in] length of above.
  * 
  */
 void
-sub_zmean(SP16 *speech, int samplenum)
+sub_zmean(ZMEAN *z, SP16 *speech, int samplenum)
 {
   int i;
   float d, sum;
 
-  if (zlen < ZMEANSAMPLES) {
+  if (z->zlen < ZMEANSAMPLES) {
     /* update zmean */
-    sum = zmean * zlen;
+    sum = z->zmean * z->zlen;
     for (i=0;i<samplenum;i++) {
       sum += speech[i];
     }
-    zlen += samplenum;
-    zmean = sum / (float)zlen;
+    z->zlen += samplenum;
+    z->zmean = sum / (float)z->zlen;
   }
   for (i=0;i<samplenum;i++) {
-    d = (float)speech[i] - zmean;
+    d = (float)speech[i] - z->zmean;
     /* clip overflow */
     if (d < -32768.0) d = -32768.0;
     if (d > 32767.0) d = 32767.0;
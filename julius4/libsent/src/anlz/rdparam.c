@@ -45,7 +45,7 @@
 #include <sent/htk_param.h>
 #include <sys/types.h>
 
-static boolean needswap;	///< TRUE if need byte-swapping
+static THREAD_LOCAL boolean needswap;	///< TRUE if need byte-swapping
 
 /** 
  * Read binary data from a file pointer, with byte swapping.
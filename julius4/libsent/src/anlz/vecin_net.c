@@ -3,6 +3,14 @@
  * 
  * @brief  Feature input from network
  *
+ * A client connects to VECINNET_PORT and sends messages, each of which
+ * is a 4-byte length followed by a body of that length.  The first
+ * message is the configuration header.  Then vectors follow: the
+ * length of a message should be N times the vector size, and the
+ * message carries N successive frames (1 <= N <= VECINNET_MAXFRAMES).
+ * Sending frames in blocks saves system calls and protocol overhead
+ * per frame, for both feature vectors and outprob vectors.  A length of
+ * 0 marks end of segment, and a negative length marks end of stream.
  *
  * $Revision: 1.1 $
  * 
@@ -40,7 +48,11 @@
 #define LRD_ERROR 3
 
 static int vecin_sd = -1;	///< Listening socket
-static int vecin_asd = -1;	///< Accepted  socket
+static THREAD_LOCAL int vecin_asd = -1;	///< Accepted  socket
+static THREAD_LOCAL float *vecin_queue = NULL; ///< Received vectors not read yet
+static THREAD_LOCAL int vecin_queue_alloc = 0; ///< Allocated length of vecin_queue
+static THREAD_LOCAL int vecin_queue_num = 0; ///< Number of vectors in vecin_queue
+static THREAD_LOCAL int vecin_queue_cur = 0; ///< Next vector to read in vecin_queue
 
 typedef struct {
   int veclen;		      ///< (4 byte)Vector length of an input
@@ -51,34 +63,72 @@ typedef struct {
 ConfigurationHeader conf;
 
 /************************************************************************/
-int
-local_read_data(int sd, void *buf, int bytes)
+/**
+ * Receive bytes from socket until all of them has been read.
+ *
+ * @param sd [in] socket descriptor
+ * @param buf [out] buffer to store the data
+ * @param bytes [in] number of bytes to read
+ *
+ * @return TRUE on success, FALSE on error or disconnection.
+ */
+static boolean
+local_recv(int sd, void *buf, int bytes)
 {
-  int len;
   int ret;
   int toread, offset;
 
-  /* get header */
-  toread = sizeof(int);
+  toread = bytes;
   offset = 0;
   while (toread > 0) {
-    ret = recv(sd, ((char *)&len) + offset, toread, 0);
-    if (ret < 0) {
-      /* error */
-      jlog("Error: vecin_net: failed to read length data %d/%d\n", offset, sizeof(int));
-      return LRD_ERROR;
+    ret = recv(sd, ((char *)buf) + offset, toread, 0);
+    if (ret <= 0) {
+      /* error or disconnected */
+      return FALSE;
     }
     toread -= ret;
     offset += ret;
   }
-  if (len == 0) {
+  return TRUE;
+}
+
+/**
+ * Read a length header of next message.
+ *
+ * @param sd [in] socket descriptor
+ * @param len [out] length of the message body
+ *
+ * @return LRD_NOERROR when a message body follows, LRD_ENDOFSEGMENT or
+ * LRD_ENDOFSTREAM on the marks, or LRD_ERROR on error.
+ */
+static int
+local_read_header(int sd, int *len)
+{
+  if (local_recv(sd, len, sizeof(int)) == FALSE) {
+    jlog("Error: vecin_net: failed to read length data\n");
+    return LRD_ERROR;
+  }
+  if (*len == 0) {
     /* end of segment mark */
     return LRD_ENDOFSEGMENT;
   }
-  if (len < 0) {
+  if (*len < 0) {
     /* end of input, mark */
     return LRD_ENDOFSTREAM;
   }
+  return LRD_NOERROR;
+}
+
+int
+local_read_data(int sd, void *buf, int bytes)
+{
+  int len;
+  int ret;
+
+  /* get header */
+  if ((ret = local_read_header(sd, &len)) != LRD_NOERROR) {
+    return ret;
+  }
 
   if (len != bytes) {
     jlog("Error: vecin_net: protocol error: length not match: %d, %d\n", bytes, len);
@@ -86,22 +136,60 @@ local_read_data(int sd, void *buf, int bytes)
   }
 
   /* get body */
-  toread = len;
-  offset = 0;
-  while (toread > 0) {
-    ret = recv(sd, ((char *)buf) + offset, toread, 0);
-    if (ret < 0) {
-      /* error */
-      jlog("Error: vecin_net: failed to read data: %d / %d\n", offset, len);
-      return LRD_ERROR;
-    }
-    toread -= ret;
-    offset += ret;
+  if (local_recv(sd, buf, len) == FALSE) {
+    jlog("Error: vecin_net: failed to read data: %d bytes\n", len);
+    return LRD_ERROR;
   }
   
   return LRD_NOERROR;
 }
 
+/**
+ * Receive next message of vectors into the local queue.  A message may
+ * hold multiple frames: its length should be a multiple of the vector
+ * size, and the number of frames is given by the length.  A message of
+ * one frame is the same as the original protocol.
+ *
+ * @param sd [in] socket descriptor
+ * @param veclen [in] vector length
+ *
+ * @return LRD_NOERROR when vectors are queued, LRD_ENDOFSEGMENT or
+ * LRD_ENDOFSTREAM on the marks, or LRD_ERROR on error.
+ */
+static int
+local_read_frames(int sd, int veclen)
+{
+  int len, bytes, num;
+  int ret;
+
+  /* get header */
+  if ((ret = local_read_header(sd, &len)) != LRD_NOERROR) {
+    return ret;
+  }
+
+  bytes = sizeof(float) * veclen;
+  num = len / bytes;
+  if (len % bytes != 0 || num > VECINNET_MAXFRAMES) {
+    jlog("Error: vecin_net: protocol error: length %d is not 1 - %d vectors of %d bytes\n", len, VECINNET_MAXFRAMES, bytes);
+    return LRD_ERROR;
+  }
+  if (vecin_queue_alloc < num * veclen) {
+    if (vecin_queue != NULL) free(vecin_queue);
+    vecin_queue_alloc = num * veclen;
+    vecin_queue = (float *)mymalloc(sizeof(float) * vecin_queue_alloc);
+  }
+
+  /* get body */
+  if (local_recv(sd, vecin_queue, len) == FALSE) {
+    jlog("Error: vecin_net: failed to read data: %d bytes\n", len);
+    return LRD_ERROR;
+  }
+  vecin_queue_num = num;
+  vecin_queue_cur = 0;
+
+  return LRD_NOERROR;
+}
+
 
 /************************************************************************/
 
@@ -249,7 +337,18 @@ vecin_read(float *vecbuf, int veclen)
     return ADIN_ERROR;
   }
 
-  ret = local_read_data(vecin_asd, vecbuf, sizeof(float) * veclen);
+  if (vecin_queue_cur < vecin_queue_num) {
+    /* serve from the vectors received in a message */
+    memcpy(vecbuf, &(vecin_queue[vecin_queue_cur * veclen]), sizeof(float) * veclen);
+    vecin_queue_cur++;
+    return(ADIN_NOERROR);
+  }
+
+  ret = local_read_frames(vecin_asd, veclen);
+  if (ret == LRD_NOERROR) {
+    memcpy(vecbuf, vecin_queue, sizeof(float) * veclen);
+    vecin_queue_cur = 1;
+  }
 
   switch(ret) {
   case LRD_ENDOFSEGMENT:	/* received an end of segment */
@@ -290,6 +389,7 @@ vecin_close()
   /* end of connection */
   close_socket(vecin_asd);
   vecin_asd = -1;
+  vecin_queue_num = vecin_queue_cur = 0;
 
   jlog("Stat: vecin_net: connection closed\n");
 
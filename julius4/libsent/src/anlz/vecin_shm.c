@@ -0,0 +1,241 @@
+/**
+ * @file   vecin_shm.c
+ *
+ * @brief  Feature input from shared memory
+ *
+ * Feature vectors or outprob vectors are read from a ring buffer on
+ * POSIX shared memory, written by a producer process on the same host.
+ * A unit of the ring is one vector, and the vector length, frame shift
+ * and vector type are given in the header of the segment instead of
+ * the configuration header of vecin_net.c.  Reading a vector is a copy
+ * from the shared memory, without system call.  See net/shmring.c for
+ * the ring buffer.
+ *
+ */
+
+/**
+ * feature input functions
+ *
+ * Required:
+ *   - vecin_shm_standby()
+ *   - vecin_shm_open()
+ *   - vecin_shm_get_configuration()
+ *   - vecin_shm_read()
+ *   - vecin_shm_close()
+ *   - vecin_shm_terminate()
+ *   - vecin_shm_pause()
+ *   - vecin_shm_resume()
+ *   - vecin_shm_input_name()
+ *
+ */
+
+#include <sent/stddefs.h>
+#include <sent/shmring.h>
+
+/// Return code of vecin_shm_read()
+#define ADIN_NOERROR 0
+#define ADIN_EOF -1
+#define ADIN_ERROR -2
+#define ADIN_SEGMENT -3
+
+static char *shm_name = NULL;	///< Name of the shared memory segment
+static THREAD_LOCAL SHMRING *ring = NULL; ///< Current ring buffer
+
+/************************************************************************/
+
+/**
+ * @brief  Set name of the shared memory segment
+ *
+ * This should be called before vecin_shm_standby().
+ *
+ * @param name [in] name of the segment
+ */
+void
+vecin_shm_set_name(char *name)
+{
+  if (shm_name != NULL) free(shm_name);
+  shm_name = strcpy((char *)mymalloc(strlen(name) + 1), name);
+}
+
+/**
+ * @brief  Initialize input device (required)
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+vecin_shm_standby()
+{
+  if (shm_name == NULL) vecin_shm_set_name(SHMRING_NAME);
+  ring = NULL;
+
+  jlog("Stat: vecin_shm: ready for input from \"%s\"\n", shm_name);
+
+  return TRUE;
+}
+
+/**
+ * @brief  Open an input (required)
+ *
+ * Wait for a producer to create the shared memory segment.
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+vecin_shm_open()
+{
+  if (ring != NULL) {
+    vecin_shm_close();
+  }
+  jlog("Stat: vecin_shm: waiting for producer...\n");
+  if ((ring = shmring_open(shm_name)) == NULL) {
+    return FALSE;
+  }
+  if (ring->h->conf.veclen <= 0 || ring->unitsize != sizeof(float) * ring->h->conf.veclen) {
+    jlog("Error: vecin_shm: \"%s\" is not vector data (unit size = %d, veclen = %d)\n", shm_name, ring->unitsize, ring->h->conf.veclen);
+    shmring_close(ring, FALSE);
+    ring = NULL;
+    return FALSE;
+  }
+  jlog("Stat: vecin_shm: attached\n");
+
+  return TRUE;
+}
+
+/**
+ * @brief  Return configuration parameters for this input (required)
+ *
+ * The same as vecin_get_configuration() in vecin_net.c.
+ *
+ * @param opcode [in] requested operation code
+ *
+ * @return values required for the opcode.
+ */
+int
+vecin_shm_get_configuration(int opcode)
+{
+  if (ring == NULL) {
+    jlog("Error: vecin_shm: vecin_shm_get_configuration() called without input\n");
+    return 0;
+  }
+  switch(opcode) {
+  case 0:		   /* return number of elements in a vector */
+    return(ring->h->conf.veclen);
+  case 1:/* return msec per frame */
+    return(ring->h->conf.fshift);
+  case 2:/* return parameter type specification in HTK format */
+    /* return 0xffff to disable checking */
+    return(0xffff);
+  case 3:/* return 0 if feature vector input, 1 if outprob vector input */
+    return(ring->h->conf.outprob_p ? 1 : 0);
+  }
+  return 0;
+}
+
+/**
+ * @brief  Read a vector from input (required)
+ *
+ * This blocks until a vector comes.
+ *
+ * @param vecbuf [out] store a vector obtained in this function
+ * @param veclen [in] vector length
+ *
+ * @return 0 on success, ADIN_EOF on end of stream, ADIN_SEGMENT on end
+ * of segment, or ADIN_ERROR on error.
+ */
+int
+vecin_shm_read(float *vecbuf, int veclen)
+{
+  int ret;
+
+  if (ring == NULL) {
+    jlog("Error: vecin_shm: vecin_shm_read() called without input\n");
+    return ADIN_ERROR;
+  }
+  if (ring->unitsize != sizeof(float) * veclen) {
+    jlog("Error: vecin_shm: vector length %d does not match unit size %d\n", veclen, ring->unitsize);
+    return ADIN_ERROR;
+  }
+
+  ret = shmring_read(ring, vecbuf, 1, -1);
+
+  switch(ret) {
+  case SHMRING_SEGMENT:		/* received an end of segment */
+    jlog("Stat: vecin_shm: received end of segment\n");
+    return ADIN_SEGMENT;
+  case SHMRING_EOF:		/* received an end of stream */
+    jlog("Stat: vecin_shm: received end of stream\n");
+    return ADIN_EOF;
+  case SHMRING_ERROR:		/* some error has occured */
+    jlog("Error: vecin_shm: error in receiving data\n");
+    return ADIN_ERROR;
+  }
+
+  return(ADIN_NOERROR);			/* success */
+}
+
+/**
+ * @brief  Close the current input (required)
+ *
+ * Detach from the segment, and remove it if the producer has finished.
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+vecin_shm_close()
+{
+  if (ring == NULL) return TRUE;
+
+  shmring_close(ring, ring->h->closed ? TRUE : FALSE);
+  ring = NULL;
+
+  jlog("Stat: vecin_shm: detached\n");
+
+  return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief  A hook for Termination request (optional)
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+vecin_shm_terminate()
+{
+  return TRUE;
+}
+
+/**
+ * @brief  A hook for Pause request (optional)
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+vecin_shm_pause()
+{
+  return TRUE;
+}
+
+/**
+ * @brief  A hook for Resume request (optional)
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+vecin_shm_resume()
+{
+  return TRUE;
+}
+
+/**
+ * @brief  A function to return current device name for information (optional)
+ *
+ * @return pointer to the device name string
+ */
+char *
+vecin_shm_input_name()
+{
+  return(shm_name);
+}
+/* end of file */
@@ -25,7 +25,7 @@
 #include <sent/speech.h>
 
 /// Total number of samples written to the file.
-static int totallen;
+static THREAD_LOCAL int totallen;
 
 /** 
  * Write speech data in little endian.
@@ -5,6 +5,12 @@
  * @brief  ƥؤΥؿӥ
  *
  * ƥΥݡӥƥ֤³βݤ֤ؿǤ
+ *
+ * ƥϳƥƥꤴȤ˸³륫ƥΥȺѤߥꥹȤ
+ * ݻ롥˲äơƥ2Υӥåȿ
+ * DFA_CP_BITMATRIX_MAXBYTES ʲξϡƱƤΥӥåȹ
+ * ³ȽӥåȻȤΤߤǹԤӥåȹʸˡɲû
+ * dfa_cp_append() Ǻĥ롥
  * </JA>
  * 
  * <EN>
@@ -13,6 +19,13 @@
  * Functions to allocate memory for category-pair constraint, and functions
  * to return whether the given category pairs can be connected or not are
  * defined here.
+ *
+ * The category-pair constraint is held as sorted lists of categories
+ * that can follow each category.  In addition, when the square of the
+ * number of categories in bits does not exceed DFA_CP_BITMATRIX_MAXBYTES,
+ * a bit matrix of the same content is built, and connection checks are
+ * done by a single bit lookup.  The bit matrix is built and extended in
+ * dfa_cp_append() when a grammar is appended.
  * </EN>
  * 
  * @author Akinobu LEE
@@ -92,11 +105,59 @@ dfa_cp(DFA_INFO *dfa, int i, int j)
 {
   int loc;
 
+  if (dfa->cpbit != NULL) {
+    return((dfa->cpbit[i * dfa->cpbit_rowlen + (j >> CPBIT_SHIFT)] >> (j & CPBIT_MASK)) & 1 ? TRUE : FALSE);
+  }
   /*return(dfa->cp[i][j]);*/
   //return((dfa->cp[i][j>>3] & cp_table[j&7]) ? TRUE : FALSE);
   return(cp_find(dfa->cp[i], dfa->cplen[i], j, &loc) != -1 ? TRUE : FALSE);
 }
 
+/** 
+ * Return the next category that can follow the given category.  All
+ * the successors of category @a i can be enumerated by calling this
+ * with @a j = 0 at first and then with the last result + 1.  On the bit
+ * matrix, words with no bit are skipped at once.
+ * 
+ * @param dfa [in] DFA grammar holding category pair matrix
+ * @param i [in] category id of left word
+ * @param j [in] category id from which to look for the right word
+ * 
+ * @return the smallest category id not less than @a j that can follow
+ * @a i, or -1 if none.
+ */
+int
+dfa_cp_next(DFA_INFO *dfa, int i, int j)
+{
+  CPBIT *row;
+  CPBIT w;
+  int k, loc;
+
+  if (j >= dfa->term_num) return -1;
+  if (dfa->cpbit != NULL) {
+    row = &(dfa->cpbit[i * dfa->cpbit_rowlen]);
+    k = j >> CPBIT_SHIFT;
+    /* drop bits below j on the first word */
+    w = row[k] >> (j & CPBIT_MASK);
+    if (w == 0) {
+      for(k++;k<dfa->cpbit_rowlen;k++) {
+	if (row[k] != 0) break;
+      }
+      if (k >= dfa->cpbit_rowlen) return -1;
+      j = k << CPBIT_SHIFT;
+      w = row[k];
+    }
+    while ((w & 1) == 0) {
+      w >>= 1;
+      j++;
+    }
+    return j;
+  }
+  cp_find(dfa->cp[i], dfa->cplen[i], j, &loc);
+  if (loc >= dfa->cplen[i]) return -1;
+  return(dfa->cp[i][loc]);
+}
+
 /** 
  * Return whether the category can be appear at the beginning of sentence.
  * 
@@ -200,6 +261,14 @@ void
 set_dfa_cp(DFA_INFO *dfa, int i, int j, boolean value)
 {
   int loc;
+
+  if (dfa->cpbit != NULL) {
+    if (value) {
+      dfa->cpbit[i * dfa->cpbit_rowlen + (j >> CPBIT_SHIFT)] |= (CPBIT)1 << (j & CPBIT_MASK);
+    } else {
+      dfa->cpbit[i * dfa->cpbit_rowlen + (j >> CPBIT_SHIFT)] &= ~((CPBIT)1 << (j & CPBIT_MASK));
+    }
+  }
   if (value) {
     /* add j to cp list of i */
     if (cp_find(dfa->cp[i], dfa->cplen[i], j, &loc) == -1) { /* not exist */
@@ -274,6 +343,8 @@ void
 init_dfa_cp(DFA_INFO *dfa)
 {
   dfa->cp = NULL;
+  dfa->cpbit = NULL;
+  dfa->cpbit_rowlen = 0;
 }
 
 /** 
@@ -304,6 +375,49 @@ malloc_dfa_cp(DFA_INFO *dfa, int term_num, int size)
   dfa->cp_end_len = 0;
 }
 
+/** 
+ * Build the category-pair bit matrix from the cp lists, or extend it
+ * for newly appended categories.  The rows before @a from are copied
+ * from the current matrix, and the rest are built from the cp lists.
+ * If the matrix size exceeds DFA_CP_BITMATRIX_MAXBYTES, the matrix will
+ * be released and only the cp lists are used.
+ * 
+ * @param dfa [i/o] DFA grammar holding category pair matrix
+ * @param from [in] first category whose row should be built
+ */
+static void
+cp_bit_update(DFA_INFO *dfa, int from)
+{
+  CPBIT *newbit;
+  int rowlen;
+  int i, j;
+
+  rowlen = (dfa->term_num + CPBIT_MASK) >> CPBIT_SHIFT;
+  if (dfa->term_num == 0 || (unsigned long)sizeof(CPBIT) * rowlen * dfa->term_num > DFA_CP_BITMATRIX_MAXBYTES) {
+    if (dfa->cpbit != NULL) {
+      free(dfa->cpbit);
+      dfa->cpbit = NULL;
+      dfa->cpbit_rowlen = 0;
+    }
+    return;
+  }
+  if (dfa->cpbit == NULL) from = 0;
+
+  newbit = (CPBIT *)mymalloc(sizeof(CPBIT) * rowlen * dfa->term_num);
+  memset(newbit, 0, sizeof(CPBIT) * rowlen * dfa->term_num);
+  for(i=0;i<from;i++) {
+    memcpy(&(newbit[i * rowlen]), &(dfa->cpbit[i * dfa->cpbit_rowlen]), sizeof(CPBIT) * dfa->cpbit_rowlen);
+  }
+  for(i=from;i<dfa->term_num;i++) {
+    for(j=0;j<dfa->cplen[i];j++) {
+      newbit[i * rowlen + (dfa->cp[i][j] >> CPBIT_SHIFT)] |= (CPBIT)1 << (dfa->cp[i][j] & CPBIT_MASK);
+    }
+  }
+  if (dfa->cpbit != NULL) free(dfa->cpbit);
+  dfa->cpbit = newbit;
+  dfa->cpbit_rowlen = rowlen;
+}
+
 /** 
  * Append a categori-pair matrix to another.
  * This function assumes that other grammar information has been already
@@ -350,6 +464,7 @@ dfa_cp_append(DFA_INFO *dfa, DFA_INFO *src, int offset)
     dfa->cp_end_alloclen = size;
     memcpy(dfa->cp_end, src->cp_end, sizeof(int) * src->cp_end_len);
     dfa->cp_end_len = src->cp_end_len;
+    cp_bit_update(dfa, 0);
     return TRUE;
   }
   /* expand index */
@@ -384,6 +499,9 @@ dfa_cp_append(DFA_INFO *dfa, DFA_INFO *src, int offset)
   }
   dfa->cp_end_len += src->cp_end_len;
 
+  /* extend bit matrix for the new categories */
+  cp_bit_update(dfa, offset);
+
   return TRUE;
 }
 
@@ -406,6 +524,11 @@ free_dfa_cp(DFA_INFO *dfa)
     free(dfa->cp);
     dfa->cp = NULL;
   }
+  if (dfa->cpbit != NULL) {
+    free(dfa->cpbit);
+    dfa->cpbit = NULL;
+    dfa->cpbit_rowlen = 0;
+  }
 }
 
 void
@@ -451,6 +574,11 @@ dfa_cp_count_size(DFA_INFO *dfa, unsigned long *size_ret, unsigned long *allocsi
 
   allocsize += (sizeof(int *) + sizeof(int) + sizeof(int)) * dfa->term_num;
 
+  if (dfa->cpbit != NULL) {
+    size += sizeof(CPBIT) * dfa->cpbit_rowlen * dfa->term_num;
+    allocsize += sizeof(CPBIT) * dfa->cpbit_rowlen * dfa->term_num;
+  }
+
   *size_ret = size;
   *allocsize_ret = allocsize;
 }
@@ -42,6 +42,9 @@ print_dfa_info(FILE *fp, DFA_INFO *dinfo)
   
   dfa_cp_count_size(dinfo, &size, &allocsize);
   fprintf(fp, "      category-pair matrix: %ld bytes (%ld bytes allocated)\n", size, allocsize);
+  if (dinfo->cpbit != NULL) {
+    fprintf(fp, "      category-pair bit matrix: %ld bytes\n", (unsigned long)sizeof(CPBIT) * dinfo->cpbit_rowlen * dinfo->term_num);
+  }
 }
 
 /** 
@@ -0,0 +1,585 @@
+/**
+ * @file   adinnet_codec.c
+ *
+ * <JA>
+ * @brief  adinnet ץȥβ
+ *
+ * adinnet 벻ǡ沽沽Ԥ
+ * 16bit ˥ PCM () ΤۤG.711 -law / A-law (8bit/sample) ȡ
+ * ĵհ̤θ그ͽ¬ĺ Rice 沽ѤǤ롥
+ *
+ * ̤ϥ饤Ȥ³κǽ׵᤹롥׵ѥåȤĹ
+ * (ADINNET_CODEC_REQLEN Х) Ƭ 4 ХȤ 0 Ǥꡤ
+ * 16bit PCM ΥǡȤƼ뤳ȤϤʤФϱѥå
+ * (ADINNET_CODEC_REPLEN Х) ǻѤ沽֤
+ * ǤΥФϱ֤ʤΤǡ饤Ȥϰָ PCM 
+ * ԤΤȤ׵ѥåȤϵǥФǤ 2 ץ̵
+ * ư롥
+ *
+ * ̻ 1 ѥåȤϺ ADINNET_CODEC_BLOCK ץǡ
+ * ƥѥåȤñȤǤ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Audio compression on the adinnet protocol
+ *
+ * Functions to encode and decode audio data sent via adinnet.
+ * In addition to 16bit linear PCM (default), G.711 mu-law / A-law
+ * (8bit/sample) and a lossless codec, fixed linear prediction residual
+ * with Rice coding, are available.
+ *
+ * The client requests a codec at the beginning of a connection.  The
+ * request packet has odd length (ADINNET_CODEC_REQLEN bytes) with the
+ * first 4 bytes being zero, so it will never be taken as 16bit PCM data.
+ * The server answers the codec to be used by a reply packet
+ * (ADINNET_CODEC_REPLEN bytes).  Old servers do not reply, so the client
+ * will send in PCM after a time out.  Old servers take the request
+ * packet as 2 samples of silence.
+ *
+ * A packet of compressed codecs holds at most ADINNET_CODEC_BLOCK samples,
+ * and each packet can be decoded by itself.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/tcpip.h>
+
+/// Names of codecs, indexed by codec ID
+static char *codec_name[ADINNET_CODEC_NUM] = {"pcm", "ulaw", "alaw", "lpc"};
+
+/// Length of unary part to escape to raw value in Rice coding
+#define RICE_ESC 24
+/// Bits of raw value in Rice coding (enough for residual of 16bit samples)
+#define RICE_RAWBITS 18
+/// Maximum Rice parameter
+#define RICE_MAXK 16
+/// Maximum prediction order
+#define LPC_MAXORDER 2
+
+/**
+ * Look up codec ID from its name.
+ *
+ * @param name [in] codec name
+ *
+ * @return the codec ID, or -1 if not found.
+ */
+int
+adinnet_codec_lookup(char *name)
+{
+  int i;
+
+  for(i=0;i<ADINNET_CODEC_NUM;i++) {
+    if (strmatch(name, codec_name[i])) return i;
+  }
+  return -1;
+}
+
+/**
+ * Return name of a codec.
+ *
+ * @param codec [in] codec ID
+ *
+ * @return the name string.
+ */
+char *
+adinnet_codec_name(int codec)
+{
+  if (codec < 0 || codec >= ADINNET_CODEC_NUM) return "unknown";
+  return(codec_name[codec]);
+}
+
+/**
+ * Return maximum length of encoded data.
+ *
+ * @param codec [in] codec ID
+ * @param num [in] number of samples
+ *
+ * @return maximum length in bytes.
+ */
+int
+adinnet_codec_maxbytes(int codec, int num)
+{
+  switch(codec) {
+  case ADINNET_CODEC_ULAW:
+  case ADINNET_CODEC_ALAW:
+    return num;
+  case ADINNET_CODEC_LPC:
+    /* header, warm-up samples and residuals of (RICE_ESC + RICE_RAWBITS) bits at most */
+    return 5 + LPC_MAXORDER * 2 + (num * (RICE_ESC + RICE_RAWBITS) + 7) / 8;
+  }
+  return num * sizeof(SP16);
+}
+
+/**********************************************************************/
+/* G.711 mu-law / A-law */
+
+/**
+ * Convert a 16bit linear sample to mu-law.
+ *
+ * @param x [in] sample
+ *
+ * @return mu-law code.
+ */
+static unsigned char
+linear2ulaw(int x)
+{
+  int mask, seg;
+
+  x >>= 2;
+  if (x < 0) {
+    x = -x;
+    mask = 0x7F;
+  } else {
+    mask = 0xFF;
+  }
+  if (x > 8159) x = 8159;
+  x += 0x21;
+  /* segment number: 0 for up to 0x3F, 7 for up to 0x1FFF */
+  for(seg = 0; seg < 8; seg++) {
+    if (x < (0x40 << seg)) break;
+  }
+  if (seg >= 8) return((unsigned char)(0x7F ^ mask));
+  return((unsigned char)(((seg << 4) | ((x >> (seg + 1)) & 0x0F)) ^ mask));
+}
+
+/**
+ * Convert a mu-law code to 16bit linear sample.
+ *
+ * @param u [in] mu-law code
+ *
+ * @return the sample.
+ */
+static SP16
+ulaw2linear(unsigned char u)
+{
+  int t;
+
+  u = ~u;
+  t = ((u & 0x0F) << 3) + 0x84;
+  t <<= (u & 0x70) >> 4;
+  return((SP16)((u & 0x80) ? (0x84 - t) : (t - 0x84)));
+}
+
+/**
+ * Convert a 16bit linear sample to A-law.
+ *
+ * @param x [in] sample
+ *
+ * @return A-law code.
+ */
+static unsigned char
+linear2alaw(int x)
+{
+  int mask, seg, aval;
+
+  x >>= 3;
+  if (x >= 0) {
+    mask = 0xD5;
+  } else {
+    mask = 0x55;
+    x = -x - 1;
+  }
+  /* segment number: 0 for up to 0x1F, 7 for up to 0xFFF */
+  for(seg = 0; seg < 8; seg++) {
+    if (x < (0x20 << seg)) break;
+  }
+  if (seg >= 8) return((unsigned char)(0x7F ^ mask));
+  aval = seg << 4;
+  if (seg < 2) {
+    aval |= (x >> 1) & 0x0F;
+  } else {
+    aval |= (x >> seg) & 0x0F;
+  }
+  return((unsigned char)(aval ^ mask));
+}
+
+/**
+ * Convert an A-law code to 16bit linear sample.
+ *
+ * @param a [in] A-law code
+ *
+ * @return the sample.
+ */
+static SP16
+alaw2linear(unsigned char a)
+{
+  int t, seg;
+
+  a ^= 0x55;
+  t = (a & 0x0F) << 4;
+  seg = (a & 0x70) >> 4;
+  switch(seg) {
+  case 0:
+    t += 8;
+    break;
+  case 1:
+    t += 0x108;
+    break;
+  default:
+    t += 0x108;
+    t <<= seg - 1;
+  }
+  return((SP16)((a & 0x80) ? t : -t));
+}
+
+/**********************************************************************/
+/* lossless: fixed linear prediction residual with Rice coding */
+
+/**
+ * Work area for bit stream.
+ *
+ */
+typedef struct {
+  unsigned char *p;		///< Current byte pointer
+  unsigned char *end;		///< End of data (for reading)
+  unsigned int acc;		///< Bit accumulator
+  int nbit;			///< Number of bits in @a acc
+} BITSTREAM;
+
+/**
+ * Write bits to bit stream.
+ *
+ * @param b [i/o] bit stream
+ * @param v [in] value
+ * @param n [in] number of bits to write (up to 24)
+ */
+static void
+put_bits(BITSTREAM *b, unsigned int v, int n)
+{
+  b->acc = (b->acc << n) | (v & ((1U << n) - 1));
+  b->nbit += n;
+  while (b->nbit >= 8) {
+    b->nbit -= 8;
+    *(b->p++) = (unsigned char)(b->acc >> b->nbit);
+  }
+  b->acc &= (1U << b->nbit) - 1;
+}
+
+/**
+ * Read bits from bit stream.
+ *
+ * @param b [i/o] bit stream
+ * @param n [in] number of bits to read (up to 24)
+ * @param v [out] value
+ *
+ * @return TRUE on success, FALSE if reached end of data.
+ */
+static boolean
+get_bits(BITSTREAM *b, int n, unsigned int *v)
+{
+  while (b->nbit < n) {
+    if (b->p >= b->end) return FALSE;
+    b->acc = (b->acc << 8) | *(b->p++);
+    b->nbit += 8;
+  }
+  b->nbit -= n;
+  *v = (b->acc >> b->nbit) & ((1U << n) - 1);
+  b->acc &= (1U << b->nbit) - 1;
+  return TRUE;
+}
+
+/**
+ * Compute prediction residual.
+ *
+ * @param x [in] samples
+ * @param i [in] sample index, should be equal to or larger than @a order
+ * @param order [in] prediction order
+ *
+ * @return the residual.
+ */
+static int
+residual(SP16 *x, int i, int order)
+{
+  switch(order) {
+  case 1: return(x[i] - x[i-1]);
+  case 2: return(x[i] - 2 * x[i-1] + x[i-2]);
+  }
+  return(x[i]);
+}
+
+/**
+ * Encode samples by the lossless codec.  The prediction order and Rice
+ * parameter that give the smallest residual are chosen for each packet.
+ *
+ * @param in [in] samples
+ * @param num [in] number of samples
+ * @param out [out] encoded data
+ *
+ * @return the length of encoded data in bytes.
+ */
+static int
+encode_lpc(SP16 *in, int num, unsigned char *out)
+{
+  BITSTREAM b;
+  unsigned long sum[LPC_MAXORDER+1];
+  unsigned int u, q;
+  int e, i, order, k;
+
+  /* choose prediction order by the sum of absolute residuals */
+  for(order=0;order<=LPC_MAXORDER;order++) {
+    sum[order] = 0;
+    for(i=LPC_MAXORDER;i<num;i++) {
+      e = residual(in, i, order);
+      sum[order] += (e < 0) ? -e : e;
+    }
+  }
+  order = 0;
+  for(i=1;i<=LPC_MAXORDER;i++) if (sum[i] < sum[order]) order = i;
+  if (order > num) order = num;
+  /* Rice parameter from the mean of the mapped residuals */
+  k = 0;
+  if (num > order) {
+    while (k < RICE_MAXK && ((unsigned long)(num - order) << (k + 1)) <= sum[order] * 2) k++;
+  }
+
+  /* header: order and parameter, number of samples, warm-up samples */
+  out[0] = (unsigned char)((order << 5) | k);
+  out[1] = num & 0xff;
+  out[2] = (num >> 8) & 0xff;
+  out[3] = (num >> 16) & 0xff;
+  out[4] = (num >> 24) & 0xff;
+  b.p = &(out[5]);
+  for(i=0;i<order;i++) {
+    *(b.p++) = in[i] & 0xff;
+    *(b.p++) = (in[i] >> 8) & 0xff;
+  }
+  b.acc = 0;
+  b.nbit = 0;
+
+  /* residuals */
+  for(i=order;i<num;i++) {
+    e = residual(in, i, order);
+    u = (e < 0) ? ((unsigned int)(-e) << 1) - 1 : (unsigned int)e << 1;
+    q = u >> k;
+    if (q < RICE_ESC) {
+      /* q ones and a zero, then lower k bits */
+      put_bits(&b, (1U << (q + 1)) - 2, q + 1);
+      if (k > 0) put_bits(&b, u, k);
+    } else {
+      /* escape: RICE_ESC ones, then raw value */
+      put_bits(&b, (1U << RICE_ESC) - 1, RICE_ESC);
+      put_bits(&b, u, RICE_RAWBITS);
+    }
+  }
+  if (b.nbit > 0) *(b.p++) = (unsigned char)(b.acc << (8 - b.nbit));
+
+  return(b.p - out);
+}
+
+/**
+ * Decode data of the lossless codec.
+ *
+ * @param in [in] encoded data
+ * @param len [in] length of @a in in bytes
+ * @param out [out] decoded samples
+ * @param maxnum [in] maximum number of samples to be stored in @a out
+ *
+ * @return the number of decoded samples, or -1 on error.
+ */
+static int
+decode_lpc(unsigned char *in, int len, SP16 *out, int maxnum)
+{
+  BITSTREAM b;
+  unsigned int u, bit;
+  int order, k, num, q, i, e;
+
+  if (len < 5) return -1;
+  order = in[0] >> 5;
+  k = in[0] & 0x1f;
+  num = in[1] | (in[2] << 8) | (in[3] << 16) | (in[4] << 24);
+  if (order > LPC_MAXORDER || k > RICE_MAXK || num < order || num > maxnum) return -1;
+  if (len < 5 + order * 2) return -1;
+  b.p = &(in[5]);
+  b.end = in + len;
+  for(i=0;i<order;i++) {
+    out[i] = (SP16)(b.p[0] | (b.p[1] << 8));
+    b.p += 2;
+  }
+  b.acc = 0;
+  b.nbit = 0;
+
+  for(i=order;i<num;i++) {
+    /* unary part */
+    for(q=0;q<RICE_ESC;q++) {
+      if (get_bits(&b, 1, &bit) == FALSE) return -1;
+      if (bit == 0) break;
+    }
+    if (q < RICE_ESC) {
+      u = q << k;
+      if (k > 0) {
+	if (get_bits(&b, k, &bit) == FALSE) return -1;
+	u |= bit;
+      }
+    } else {
+      if (get_bits(&b, RICE_RAWBITS, &u) == FALSE) return -1;
+    }
+    e = (u & 1) ? -(int)((u + 1) >> 1) : (int)(u >> 1);
+    switch(order) {
+    case 1: e += out[i-1]; break;
+    case 2: e += 2 * out[i-1] - out[i-2]; break;
+    }
+    out[i] = (SP16)e;
+  }
+
+  return num;
+}
+
+/**********************************************************************/
+
+/**
+ * Encode samples.
+ *
+ * @param codec [in] codec ID
+ * @param in [in] samples in machine byte order
+ * @param num [in] number of samples, should not exceed ADINNET_CODEC_BLOCK
+ * @param out [out] encoded data, should have adinnet_codec_maxbytes() bytes
+ *
+ * @return the length of encoded data in bytes.
+ */
+int
+adinnet_encode(int codec, SP16 *in, int num, unsigned char *out)
+{
+  int i;
+
+  switch(codec) {
+  case ADINNET_CODEC_ULAW:
+    for(i=0;i<num;i++) out[i] = linear2ulaw(in[i]);
+    return num;
+  case ADINNET_CODEC_ALAW:
+    for(i=0;i<num;i++) out[i] = linear2alaw(in[i]);
+    return num;
+  case ADINNET_CODEC_LPC:
+    return(encode_lpc(in, num, out));
+  }
+  memcpy(out, in, num * sizeof(SP16));
+#ifdef WORDS_BIGENDIAN
+  swap_sample_bytes((SP16 *)out, num);
+#endif
+  return(num * sizeof(SP16));
+}
+
+/**
+ * Decode data to samples.
+ *
+ * @param codec [in] codec ID
+ * @param in [in] encoded data
+ * @param len [in] length of @a in in bytes
+ * @param out [out] decoded samples in machine byte order
+ * @param maxnum [in] maximum number of samples to be stored in @a out
+ *
+ * @return the number of decoded samples, or -1 on error.
+ */
+int
+adinnet_decode(int codec, unsigned char *in, int len, SP16 *out, int maxnum)
+{
+  int i;
+
+  switch(codec) {
+  case ADINNET_CODEC_ULAW:
+    if (len > maxnum) return -1;
+    for(i=0;i<len;i++) out[i] = ulaw2linear(in[i]);
+    return len;
+  case ADINNET_CODEC_ALAW:
+    if (len > maxnum) return -1;
+    for(i=0;i<len;i++) out[i] = alaw2linear(in[i]);
+    return len;
+  case ADINNET_CODEC_LPC:
+    return(decode_lpc(in, len, out, maxnum));
+  }
+  len /= sizeof(SP16);
+  if (len > maxnum) return -1;
+  memcpy(out, in, len * sizeof(SP16));
+#ifdef WORDS_BIGENDIAN
+  swap_sample_bytes(out, len);
+#endif
+  return len;
+}
+
+/**********************************************************************/
+/* negotiation */
+
+/**
+ * Request a codec to adinnet server (client side).  It sends a request
+ * packet and waits for the reply for ADINNET_CODEC_TIMEOUT seconds.
+ *
+ * @param sd [in] socket connected to the server
+ * @param codec [in] codec ID to request
+ *
+ * @return the codec ID accepted by the server, ADINNET_CODEC_PCM if
+ * the server does not support it, or -1 on error.
+ */
+int
+adinnet_codec_request(int sd, int codec)
+{
+  char buf[ADINNET_CODEC_REQLEN];
+  fd_set rfds;
+  struct timeval tv;
+  int len, ret;
+
+  memset(buf, 0, ADINNET_CODEC_REQLEN);
+  buf[ADINNET_CODEC_REQLEN-1] = (char)codec;
+  if (wt(sd, buf, ADINNET_CODEC_REQLEN) < 0) return -1;
+
+  FD_ZERO(&rfds);
+  FD_SET(sd, &rfds);
+  tv.tv_sec = ADINNET_CODEC_TIMEOUT;
+  tv.tv_usec = 0;
+  ret = select(sd+1, &rfds, NULL, NULL, &tv);
+  if (ret < 0) return -1;
+  if (ret == 0) {
+    jlog("Warning: adinnet_codec: no reply from server, use %s\n", codec_name[ADINNET_CODEC_PCM]);
+    return ADINNET_CODEC_PCM;
+  }
+  if (rd(sd, buf, &len, ADINNET_CODEC_REPLEN) < 0) return -1;
+  if (len != ADINNET_CODEC_REPLEN || buf[0] != 'C' || buf[1] < 0 || buf[1] >= ADINNET_CODEC_NUM) {
+    jlog("Warning: adinnet_codec: unexpected reply from server, use %s\n", codec_name[ADINNET_CODEC_PCM]);
+    return ADINNET_CODEC_PCM;
+  }
+  return(buf[1]);
+}
+
+/**
+ * Check if the received data is a codec request packet (server side).
+ *
+ * @param buf [in] received data
+ * @param len [in] length of @a buf in bytes
+ * @param codec [out] requested codec ID
+ *
+ * @return TRUE if the data is a request packet, FALSE if not.
+ */
+boolean
+adinnet_codec_is_request(char *buf, int len, int *codec)
+{
+  if (len != ADINNET_CODEC_REQLEN) return FALSE;
+  if (buf[0] != 0 || buf[1] != 0 || buf[2] != 0 || buf[3] != 0) return FALSE;
+  *codec = buf[4];
+  return TRUE;
+}
+
+/**
+ * Reply the codec to be used to adinnet client (server side).
+ *
+ * @param sd [in] socket connected to the client
+ * @param codec [in] codec ID
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+adinnet_codec_reply(int sd, int codec)
+{
+  char buf[ADINNET_CODEC_REPLEN];
+
+  buf[0] = 'C';
+  buf[1] = (char)codec;
+  if (wt(sd, buf, ADINNET_CODEC_REPLEN) < 0) return FALSE;
+  return TRUE;
+}
@@ -119,11 +119,11 @@ ready_as_server(int port_num)
 int
 accept_from(int sd)
 {
-  static struct sockaddr_in from;
+  struct sockaddr_in from;
 #ifdef HAVE_SOCKLEN_T
-  static socklen_t nbyte;
+  socklen_t nbyte;
 #else  
-  static int nbyte;
+  int nbyte;
 #endif /* HAVE_SOCKLEN_T */
   int asd;
 
@@ -164,8 +164,8 @@ accept_from(int sd)
 int
 make_connection(char *hostname, int port_num)
 {
-  static struct hostent *hp;
-  static struct sockaddr_in	sin;
+  struct hostent *hp;
+  struct sockaddr_in	sin;
   int sd;
   int trynum;
 
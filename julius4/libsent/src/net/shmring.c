@@ -0,0 +1,596 @@
+/**
+ * @file   shmring.c
+ *
+ * <JA>
+ * @brief  ͭ󥰥Хåե
+ *
+ * ƱۥȾΥץ֤ǲǡħ̥٥ȥϤΡ
+ * POSIX ͭñԡñԤΥ󥰥Хåե
+ * ¦ shmring_create() Ƕͭƥǡ񤭹ߡ
+ * ¦ (Julius)  shmring_open() ³ƥǡɤ߹ࡥ
+ * ξԤɤ߹֤߰Ƚ񤭹֤߰Τߤ򹹿礦Τǡǡ
+ * ֤ϥƥॳʤǥǡϤ롥Хåեޤ
+ * դΤȤϡإåΥץֶͭޥե˵ޤ
+ * ԤġޥեȤʤĶǤûֳ֤ǥݡ󥰤롥
+ * ¦ϡ¦ɤ߹ߤʤʤϥॢȤ롥
+ *
+ * ¦϶֤ν shmring_mark_segment() ǡϤν
+ * shmring_finish() Τ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Shared memory ring buffer
+ *
+ * Single-producer single-consumer ring buffer on POSIX shared memory, to
+ * pass audio samples or feature vectors between processes on the same
+ * host.  The producer creates a segment by shmring_create() and writes
+ * data to it, and the consumer (Julius) attaches to it by shmring_open()
+ * and reads the data.  They only update the read and write positions
+ * each other, so data can be passed without system calls while data
+ * exists.  When the buffer is empty or full, the waiting side sleeps on
+ * a process-shared semaphore in the header until the other side wakes
+ * it up.  Where the semaphore is not available, it polls the buffer at
+ * a short interval instead.  The producer gives up when the consumer
+ * does not read for a given time.
+ *
+ * The producer tells end of segment by shmring_mark_segment(), and end of
+ * input by shmring_finish().
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/shmring.h>
+
+#ifdef HAVE_SHM_OPEN
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+
+/// Interval of polling for a new segment in microseconds
+#define ATTACH_POLL_USEC 100000
+
+/**
+ * Return elapsed time since the given time in msec.
+ *
+ * @param start [in] start time
+ *
+ * @return elapsed time in msec.
+ */
+static long
+elapsed_msec(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return((now.tv_sec - start->tv_sec) * 1000L + (now.tv_usec - start->tv_usec) / 1000);
+}
+
+/**
+ * Tell the other side that this side is going to sleep.  The caller
+ * should check the ring again before sleeping if this returns TRUE,
+ * since the other side may have updated it before seeing the flag.
+ *
+ * @param r [in] ring buffer
+ * @param who [in] SHMRING_READER or SHMRING_WRITER
+ *
+ * @return TRUE if the flag is newly set.
+ */
+static boolean
+shmring_announce(SHMRING *r, int who)
+{
+#ifdef HAVE_SHMRING_SEM
+  if (r->h->sem_p && r->h->waiting[who] == 0) {
+    r->h->waiting[who] = 1;
+    SHMRING_BARRIER();
+    return TRUE;
+  }
+#endif
+  return FALSE;
+}
+
+/**
+ * Sleep until woken up by the other side.  To recover from a lost
+ * wakeup, it sleeps at most SHMRING_SEM_WAIT_USEC at a time.  Without
+ * semaphore, it sleeps for SHMRING_POLL_USEC.
+ *
+ * @param r [in] ring buffer
+ * @param who [in] SHMRING_READER or SHMRING_WRITER
+ * @param msec [in] maximum time to sleep in msec, or -1 for no limit
+ */
+static void
+shmring_sleep(SHMRING *r, int who, long msec)
+{
+#ifdef HAVE_SHMRING_SEM
+  struct timespec ts;
+  long usec;
+
+  if (r->h->sem_p) {
+    usec = SHMRING_SEM_WAIT_USEC;
+    if (msec >= 0 && msec * 1000 < usec) usec = msec * 1000;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += (usec % 1000000) * 1000;
+    ts.tv_sec += usec / 1000000 + ts.tv_nsec / 1000000000;
+    ts.tv_nsec %= 1000000000;
+    /* the caller checks the ring again on timeout or signal */
+    sem_timedwait(&(r->h->sem[who].sem), &ts);
+    return;
+  }
+#endif
+  usleep(SHMRING_POLL_USEC);
+}
+
+/**
+ * Wake up the other side if it is sleeping.  This should be called
+ * after the positions are updated.
+ *
+ * @param r [in] ring buffer
+ * @param who [in] side to wake up, SHMRING_READER or SHMRING_WRITER
+ */
+static void
+shmring_wake(SHMRING *r, int who)
+{
+#ifdef HAVE_SHMRING_SEM
+  SHMRING_BARRIER();
+  if (r->h->waiting[who]) {
+    r->h->waiting[who] = 0;
+    sem_post(&(r->h->sem[who].sem));
+  }
+#endif
+}
+
+/**
+ * Map a shared memory segment.
+ *
+ * @param name [in] name of the segment
+ * @param fd [in] file descriptor of the segment, closed on failure
+ * @param len [in] length of the segment
+ *
+ * @return the ring buffer, or NULL on failure.
+ */
+static SHMRING *
+shmring_map(char *name, int fd, size_t len)
+{
+  SHMRING *r;
+  void *p;
+
+  p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    jlog("Error: shmring: failed to map \"%s\"\n", name);
+    close(fd);
+    return NULL;
+  }
+  r = (SHMRING *)mymalloc(sizeof(SHMRING));
+  r->name = strcpy((char *)mymalloc(strlen(name) + 1), name);
+  r->fd = fd;
+  r->len = len;
+  r->h = (SHMRING_HEADER *)p;
+  r->data = (char *)p + sizeof(SHMRING_HEADER);
+  r->timeout_msec = -1;
+
+  return r;
+}
+
+/**
+ * Check if a segment of the name holds data of a finished producer that
+ * has not been read yet.
+ *
+ * @param name [in] name of the segment
+ *
+ * @return TRUE if unread data remains.
+ */
+static boolean
+shmring_pending(char *name)
+{
+  SHMRING_HEADER *h;
+  struct stat st;
+  boolean ret;
+  int fd;
+
+  if ((fd = shm_open(name, O_RDONLY, 0)) < 0) return FALSE;
+  ret = FALSE;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SHMRING_HEADER)) {
+    h = (SHMRING_HEADER *)mmap(NULL, sizeof(SHMRING_HEADER), PROT_READ, MAP_SHARED, fd, 0);
+    if ((void *)h != MAP_FAILED) {
+      if (h->magic == SHMRING_MAGIC && h->closed
+	  && (h->rpos != h->wpos || h->mark_r != h->mark_w)) {
+	ret = TRUE;
+      }
+      munmap((void *)h, sizeof(SHMRING_HEADER));
+    }
+  }
+  close(fd);
+
+  return ret;
+}
+
+/**
+ * Create a new shared memory segment (producer side).  If the previous
+ * producer has finished but its data has not been read yet, this waits
+ * for the consumer to read them all.  Then the old segment of the same
+ * name is removed.
+ *
+ * @param name [in] name of the segment, should begin with '/'
+ * @param unitsize [in] bytes per unit
+ * @param unitnum [in] ring size in units, rounded up to power of 2
+ * @param conf [in] data configuration to be told to the consumer
+ * @param timeout_msec [in] time to wait for the consumer in msec, or -1
+ * for no limit.  It applies here and in shmring_write() and
+ * shmring_mark_segment().
+ *
+ * @return the ring buffer, or NULL on failure.
+ */
+SHMRING *
+shmring_create(char *name, int unitsize, int unitnum, SHMRING_CONF *conf, int timeout_msec)
+{
+  SHMRING *r;
+  size_t len;
+  int fd, n;
+  struct timeval start;
+
+  for(n=1;n<unitnum;n<<=1);
+  len = sizeof(SHMRING_HEADER) + (size_t)unitsize * n;
+
+  if (shmring_pending(name)) {
+    jlog("Stat: shmring: waiting for \"%s\" to be read...\n", name);
+    gettimeofday(&start, NULL);
+    while (shmring_pending(name)) {
+      if (timeout_msec >= 0 && elapsed_msec(&start) >= timeout_msec) {
+	jlog("Error: shmring: \"%s\" was not read for %d msec\n", name, timeout_msec);
+	return NULL;
+      }
+      usleep(ATTACH_POLL_USEC);
+    }
+  }
+  shm_unlink(name);
+  if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) {
+    jlog("Error: shmring: failed to create \"%s\"\n", name);
+    return NULL;
+  }
+  if (ftruncate(fd, len) < 0) {
+    jlog("Error: shmring: failed to allocate %lu bytes for \"%s\"\n", (unsigned long)len, name);
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  if ((r = shmring_map(name, fd, len)) == NULL) {
+    shm_unlink(name);
+    return NULL;
+  }
+  r->h->version = SHMRING_VERSION;
+  r->h->unitsize = r->unitsize = unitsize;
+  r->h->unitnum = r->unitnum = n;
+  memcpy(&(r->h->conf), conf, sizeof(SHMRING_CONF));
+  r->h->wpos = r->h->rpos = 0;
+  r->h->mark_w = r->h->mark_r = 0;
+  r->h->closed = 0;
+  r->h->waiting[SHMRING_READER] = r->h->waiting[SHMRING_WRITER] = 0;
+  r->h->sem_p = 0;
+#ifdef HAVE_SHMRING_SEM
+  if (sem_init(&(r->h->sem[SHMRING_READER].sem), 1, 0) == 0) {
+    if (sem_init(&(r->h->sem[SHMRING_WRITER].sem), 1, 0) == 0) {
+      r->h->sem_p = 1;
+    } else {
+      sem_destroy(&(r->h->sem[SHMRING_READER].sem));
+    }
+  }
+  if (r->h->sem_p == 0) {
+    jlog("Warning: shmring: failed to init semaphore, poll the ring instead\n");
+  }
+#endif
+  r->timeout_msec = timeout_msec;
+  /* tell the consumer that the segment is ready */
+  SHMRING_BARRIER();
+  r->h->magic = SHMRING_MAGIC;
+
+  return r;
+}
+
+/**
+ * Attach to a shared memory segment (consumer side).  This function
+ * blocks until a producer creates a new segment of the name.  A segment
+ * whose data has all been read after the producer finished is skipped.
+ *
+ * @param name [in] name of the segment
+ *
+ * @return the ring buffer, or NULL on failure.
+ */
+SHMRING *
+shmring_open(char *name)
+{
+  SHMRING *r;
+  SHMRING_HEADER *h;
+  struct stat st;
+  int fd;
+
+  for(;;usleep(ATTACH_POLL_USEC)) {
+    if ((fd = shm_open(name, O_RDWR, 0)) < 0) continue;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SHMRING_HEADER)) {
+      /* being created */
+      close(fd);
+      continue;
+    }
+    if ((r = shmring_map(name, fd, st.st_size)) == NULL) return NULL;
+    h = r->h;
+    if (h->magic != SHMRING_MAGIC) {
+      /* not ready yet */
+      shmring_close(r, FALSE);
+      continue;
+    }
+    SHMRING_BARRIER();
+    if (h->version != SHMRING_VERSION || h->unitsize == 0 || h->unitnum == 0
+	|| (h->unitnum & (h->unitnum - 1)) != 0
+	|| sizeof(SHMRING_HEADER) + (size_t)h->unitsize * h->unitnum > r->len) {
+      jlog("Error: shmring: \"%s\" is not a valid segment\n", name);
+      shmring_close(r, FALSE);
+      return NULL;
+    }
+    /* keep the checked sizes, not to trust the header afterwards */
+    r->unitsize = h->unitsize;
+    r->unitnum = h->unitnum;
+    if (h->closed && h->rpos == h->wpos && h->mark_r == h->mark_w) {
+      /* already consumed, wait for the next one */
+      shmring_close(r, FALSE);
+      continue;
+    }
+    break;
+  }
+
+  return r;
+}
+
+/**
+ * Detach from a shared memory segment.
+ *
+ * @param r [in] ring buffer
+ * @param remove_p [in] TRUE to remove the segment if it is still the one
+ * of the name
+ */
+void
+shmring_close(SHMRING *r, boolean remove_p)
+{
+  struct stat st1, st2;
+  int fd;
+
+  if (remove_p) {
+    /* do not remove a new segment created by the next producer */
+    if ((fd = shm_open(r->name, O_RDONLY, 0)) >= 0) {
+      if (fstat(fd, &st1) == 0 && fstat(r->fd, &st2) == 0
+	  && st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino) {
+	shm_unlink(r->name);
+      }
+      close(fd);
+    }
+  }
+  munmap((void *)r->h, r->len);
+  close(r->fd);
+  free(r->name);
+  free(r);
+}
+
+/**
+ * Wait for the consumer to read (producer side).
+ *
+ * @param r [in] ring buffer
+ * @param start [i/o] time when the wait began, set at the first call
+ * @param waited_p [i/o] FALSE at the first call, then TRUE
+ *
+ * @return FALSE if the consumer has not read for the timeout.
+ */
+static boolean
+shmring_wait_reader(SHMRING *r, struct timeval *start, boolean *waited_p)
+{
+  long msec, left;
+
+  if (*waited_p == FALSE) {
+    gettimeofday(start, NULL);
+    *waited_p = TRUE;
+  }
+  left = -1;
+  if (r->timeout_msec >= 0) {
+    msec = elapsed_msec(start);
+    if (msec >= r->timeout_msec) {
+      jlog("Error: shmring: \"%s\" was not read for %d msec\n", r->name, r->timeout_msec);
+      return FALSE;
+    }
+    left = r->timeout_msec - msec;
+  }
+  shmring_sleep(r, SHMRING_WRITER, left);
+
+  return TRUE;
+}
+
+/**
+ * Write data to the ring (producer side).  This blocks while the ring
+ * is full.  If the consumer does not read any data while the timeout
+ * given to shmring_create(), it gives up.
+ *
+ * @param r [in] ring buffer
+ * @param data [in] data to write
+ * @param num [in] number of units to write
+ *
+ * @return the number of written units, less than @a num on timeout.
+ */
+int
+shmring_write(SHMRING *r, void *data, int num)
+{
+  SHMRING_HEADER *h;
+  unsigned int used, space, pos, n, n1;
+  int done;
+  struct timeval start;
+  boolean waited_p;
+
+  h = r->h;
+  done = 0;
+  waited_p = FALSE;
+  while (done < num) {
+    /* the positions are in the shared memory: clamp to the ring size */
+    used = h->wpos - h->rpos;
+    space = (used < r->unitnum) ? r->unitnum - used : 0;
+    if (space == 0) {
+      if (shmring_announce(r, SHMRING_WRITER)) continue;
+      if (shmring_wait_reader(r, &start, &waited_p) == FALSE) break;
+      continue;
+    }
+    /* the consumer has read, restart the timer */
+    waited_p = FALSE;
+    SHMRING_BARRIER();
+    n = num - done;
+    if (n > space) n = space;
+    pos = h->wpos & (r->unitnum - 1);
+    n1 = r->unitnum - pos;
+    if (n1 > n) n1 = n;
+    memcpy(r->data + (size_t)pos * r->unitsize, (char *)data + (size_t)done * r->unitsize, (size_t)n1 * r->unitsize);
+    if (n > n1) {
+      memcpy(r->data, (char *)data + (size_t)(done + n1) * r->unitsize, (size_t)(n - n1) * r->unitsize);
+    }
+    SHMRING_BARRIER();
+    h->wpos += n;
+    done += n;
+    shmring_wake(r, SHMRING_READER);
+  }
+
+  return done;
+}
+
+/**
+ * Mark end of segment at the current write position (producer side).
+ * This blocks while too many marks are not read.
+ *
+ * @param r [in] ring buffer
+ *
+ * @return TRUE on success, FALSE if the consumer did not read the marks
+ * within the timeout.
+ */
+boolean
+shmring_mark_segment(SHMRING *r)
+{
+  SHMRING_HEADER *h;
+  struct timeval start;
+  boolean waited_p;
+
+  h = r->h;
+  waited_p = FALSE;
+  while (h->mark_w - h->mark_r >= SHMRING_MARKNUM) {
+    if (shmring_announce(r, SHMRING_WRITER)) continue;
+    if (shmring_wait_reader(r, &start, &waited_p) == FALSE) return FALSE;
+  }
+  h->mark[h->mark_w % SHMRING_MARKNUM] = h->wpos;
+  SHMRING_BARRIER();
+  h->mark_w++;
+  shmring_wake(r, SHMRING_READER);
+
+  return TRUE;
+}
+
+/**
+ * Tell end of input (producer side).
+ *
+ * @param r [in] ring buffer
+ */
+void
+shmring_finish(SHMRING *r)
+{
+  SHMRING_BARRIER();
+  r->h->closed = 1;
+  shmring_wake(r, SHMRING_READER);
+}
+
+/**
+ * Read data from the ring (consumer side).  Data after an end of segment
+ * mark will be returned at the next call.
+ *
+ * @param r [in] ring buffer
+ * @param data [out] buffer to store the read data
+ * @param maxnum [in] maximum number of units to read
+ * @param wait_msec [in] time to wait for data in msec, or -1 to wait until
+ * any data comes
+ *
+ * @return the number of read units, 0 if no data came within the time,
+ * SHMRING_SEGMENT on end of segment, or SHMRING_EOF on end of input.
+ */
+int
+shmring_read(SHMRING *r, void *data, int maxnum, int wait_msec)
+{
+  SHMRING_HEADER *h;
+  unsigned int avail, pos, m, n, n1, closed;
+  struct timeval start;
+  long msec;
+
+  h = r->h;
+  if (wait_msec >= 0) gettimeofday(&start, NULL);
+  for(;;) {
+    /* the positions are final if closed */
+    closed = h->closed;
+    SHMRING_BARRIER();
+    /* the positions are in the shared memory: clamp to the ring size */
+    avail = h->wpos - h->rpos;
+    if (avail > r->unitnum) avail = r->unitnum;
+    if (h->mark_r != h->mark_w) {
+      m = h->mark[h->mark_r % SHMRING_MARKNUM];
+      if (m == h->rpos) {
+	h->mark_r++;
+	shmring_wake(r, SHMRING_WRITER);
+	return SHMRING_SEGMENT;
+      }
+      if (m - h->rpos < avail) avail = m - h->rpos;
+    }
+    if (avail > 0) break;
+    if (closed) return SHMRING_EOF;
+    msec = -1;
+    if (wait_msec >= 0) {
+      msec = wait_msec - elapsed_msec(&start);
+      if (msec <= 0) return 0;
+    }
+    if (shmring_announce(r, SHMRING_READER)) continue;
+    shmring_sleep(r, SHMRING_READER, msec);
+  }
+
+  n = (avail < (unsigned int)maxnum) ? avail : (unsigned int)maxnum;
+  pos = h->rpos & (r->unitnum - 1);
+  n1 = r->unitnum - pos;
+  if (n1 > n) n1 = n;
+  memcpy(data, r->data + (size_t)pos * r->unitsize, (size_t)n1 * r->unitsize);
+  if (n > n1) {
+    memcpy((char *)data + (size_t)n1 * r->unitsize, r->data, (size_t)(n - n1) * r->unitsize);
+  }
+  SHMRING_BARRIER();
+  h->rpos += n;
+  shmring_wake(r, SHMRING_WRITER);
+
+  return n;
+}
+
+#else  /* ~HAVE_SHM_OPEN */
+
+SHMRING *
+shmring_create(char *name, int unitsize, int unitnum, SHMRING_CONF *conf, int timeout_msec)
+{
+  jlog("Error: shmring: shared memory is not supported in this build\n");
+  return NULL;
+}
+SHMRING *
+shmring_open(char *name)
+{
+  jlog("Error: shmring: shared memory is not supported in this build\n");
+  return NULL;
+}
+void shmring_close(SHMRING *r, boolean remove_p) {}
+int shmring_write(SHMRING *r, void *data, int num) { return -1; }
+boolean shmring_mark_segment(SHMRING *r) { return FALSE; }
+void shmring_finish(SHMRING *r) {}
+int shmring_read(SHMRING *r, void *data, int maxnum, int wait_msec) { return SHMRING_ERROR; }
+
+#endif /* HAVE_SHM_OPEN */
+
+/* end of file */
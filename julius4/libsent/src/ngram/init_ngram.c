@@ -36,6 +36,19 @@ boolean
 init_ngram_bin(NGRAM_INFO *ndata, char *bin_ngram_file)
 {
   FILE *fp;
+
+  if (ngram_bin_mappable(bin_ngram_file)) {
+    /* map the file directly to memory */
+    jlog("Stat: init_ngram: mapping binary n-gram from %s\n", bin_ngram_file);
+    if (ngram_read_bin_mmap(bin_ngram_file, ndata) == FALSE) {
+      jlog("Error: init_ngram: failed to map \"%s\"\n", bin_ngram_file);
+      return FALSE;
+    }
+    /* set default unknown (=OOV) word id */
+    set_default_unknown_id(ndata);
+    jlog("Stat: init_ngram: finished mapping n-gram\n");
+    return TRUE;
+  }
   
   jlog("Stat: init_ngram: reading in binary n-gram from %s\n", bin_ngram_file);
   if ((fp = fopen_readfile(bin_ngram_file)) == NULL) {
@@ -44,7 +44,7 @@ search_ngram_core(NGRAM_INFO *ndata, int n, NNID nid_prev, WORD_ID wkey)
 {
   NGRAM_TUPLE_INFO *t, *tprev;
   NNID nnid;
-  NNID left,right,mid;
+  NNID left,right,mid,len;
   NNID x;
 
   if (ndata->bigram_index_reversed && n == 2) {
@@ -65,25 +65,29 @@ search_ngram_core(NGRAM_INFO *ndata, int n, NNID nid_prev, WORD_ID wkey)
   } else {
     nnid = nid_prev;
   }
-  if (t->is24bit) {
-    left = t->bgn_upper[nnid];
-    if (left == NNID_INVALID_UPPER) return (NNID_INVALID);
-    left = (left << 16) + (NNID)(t->bgn_lower[nnid]);
+  if (t->bgn_ef) {
+    if (ngram_ef_range(t->bgn_ef, nnid, &left, &right) == FALSE) return (NNID_INVALID);
+    right += left - 1;
   } else {
-    left = t->bgn[nnid];
-    if (left == NNID_INVALID) return (NNID_INVALID);
-  }
-  right = left + t->num[nnid] - 1;
-
-  while(left < right) {
-    mid = (left + right) / 2;
-    if (t->nnid2wid[mid] < wkey) {
-      left = mid + 1;
+    if (t->is24bit) {
+      left = t->bgn_upper[nnid];
+      if (left == NNID_INVALID_UPPER) return (NNID_INVALID);
+      left = (left << 16) + (NNID)(t->bgn_lower[nnid]);
     } else {
-      right = mid;
+      left = t->bgn[nnid];
+      if (left == NNID_INVALID) return (NNID_INVALID);
     }
+    right = left + t->num[nnid] - 1;
   }
-  if (t->nnid2wid[left] == wkey) {
+
+  /* binary search without branch: find the last entry <= wkey */
+  len = right - left + 1;
+  while(len > 1) {
+    mid = len / 2;
+    left += (NGRAM_WID(t, left + mid) <= wkey) ? mid : 0;
+    len -= mid;
+  }
+  if (NGRAM_WID(t, left) == wkey) {
     return (left);
   } else {
     return (NNID_INVALID);
@@ -195,9 +199,9 @@ ngram_prob(NGRAM_INFO *ndata, int n, WORD_ID *w)
       }
       /* return back-off likelihood */
 #ifdef ADEBUG
-      printf("back: %f + %f\n", t->bo_wt[bid], p);
+      printf("back: %f + %f\n", NGRAM_BO_WT(t, bid), p);
 #endif
-      return(t->bo_wt[bid] + p);
+      return(NGRAM_BO_WT(t, bid) + p);
     } else {
       /* previous context not found, fallback to (n-1)-gram */
       return(p);
@@ -205,7 +209,7 @@ ngram_prob(NGRAM_INFO *ndata, int n, WORD_ID *w)
   }
   /* n-gram found */
   /* trigram exist */
-  p = ndata->d[n-1].prob[next];
+  p = NGRAM_PROB(&(ndata->d[n-1]), next);
   if (w[n-1] == ndata->unk_id) p -= ndata->unk_num_log;
 
 #ifdef ADEBUG
@@ -250,23 +254,28 @@ search_bigram(NGRAM_INFO *ndata, WORD_ID w_context, WORD_ID w)
 {
   /* do binary search to find bigram entry */
   /* assume ct_compaction and is24bit is FALSE on 2-gram */
-  NNID left,right,mid;		/* n2 */
+  NNID left,right,mid,len;	/* n2 */
   NGRAM_TUPLE_INFO *t;
 
   t = &(ndata->d[1]);
 
-  if ((left = t->bgn[w_context]) == NNID_INVALID) /* has no bigram */
-    return (NNID_INVALID);
-  right = left + t->num[w_context] - 1;
-  while(left < right) {
-    mid = (left + right) / 2;
-    if (t->nnid2wid[mid] < w) {
-      left = mid + 1;
-    } else {
-      right = mid;
-    }
+  if (t->bgn_ef) {
+    if (ngram_ef_range(t->bgn_ef, w_context, &left, &right) == FALSE) /* has no bigram */
+      return (NNID_INVALID);
+    right += left - 1;
+  } else {
+    if ((left = t->bgn[w_context]) == NNID_INVALID) /* has no bigram */
+      return (NNID_INVALID);
+    right = left + t->num[w_context] - 1;
+  }
+  /* binary search without branch: find the last entry <= w */
+  len = right - left + 1;
+  while(len > 1) {
+    mid = len / 2;
+    left += (NGRAM_WID(t, left + mid) <= w) ? mid : 0;
+    len -= mid;
   }
-  if (t->nnid2wid[left] == w) {
+  if (NGRAM_WID(t, left) == w) {
     return (left);
   } else {
     return (NNID_INVALID);
@@ -293,7 +302,7 @@ bi_prob_normal(NGRAM_INFO *ndata, WORD_ID w1, WORD_ID w2)
   /* index is LR */
   /* prob is in main N-gram area */
   if ((n2 = search_bigram(ndata, w1, w2)) != NNID_INVALID) {
-    prob = ndata->d[1].prob[n2];
+    prob = NGRAM_PROB(&(ndata->d[1]), n2);
   } else {
     prob = ndata->d[0].bo_wt[w1] + ndata->d[0].prob[w2];
   }
@@ -325,7 +334,7 @@ bi_prob_additional_oldbin(NGRAM_INFO *ndata, WORD_ID w1, WORD_ID w2)
   /* index is LR */
   /* prob is in additional N-gram area */
   if ((n2 = search_bigram(ndata, w1, w2)) != NNID_INVALID) {
-    prob = ndata->p_2[n2];
+    prob = NGRAM_P_2(ndata, n2);
   } else {
     prob = ndata->bo_wt_1[w1] + ndata->d[0].prob[w2];
   }
@@ -356,7 +365,7 @@ bi_prob_additional(NGRAM_INFO *ndata, WORD_ID w1, WORD_ID w2)
   /* index is RL */
   /* prob is in additional N-gram area */
   if ((n2 = search_bigram(ndata, w2, w1)) != NNID_INVALID) {
-    prob = ndata->p_2[n2];
+    prob = NGRAM_P_2(ndata, n2);
   } else {
     prob = ndata->bo_wt_1[w1] + ndata->d[0].prob[w2];
   }
@@ -389,7 +398,7 @@ bi_prob_compute(NGRAM_INFO *ndata, WORD_ID w1, WORD_ID w2)
   /* no additional N-gram, compute it directly */
   /* get p(w1|w2) */
   if ((n2 = search_bigram(ndata, w2, w1)) != NNID_INVALID) {
-    prob = ndata->d[1].prob[n2];
+    prob = NGRAM_PROB(&(ndata->d[1]), n2);
   } else {
     prob = ndata->d[0].bo_wt[w2] + ndata->d[0].prob[w1];
   }
@@ -24,6 +24,9 @@
 
 #include <sent/stddefs.h>
 #include <sent/ngram2.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 /** 
  * Allocate a new N-gram structure.
@@ -41,8 +44,13 @@ ngram_info_new()
   new->d = NULL;
   new->bo_wt_1 = NULL;
   new->p_2 = NULL;
+  new->p_2_q = NULL;
+  new->p_2_cb = NULL;
   new->bos_eos_swap = FALSE;
   new->mroot = NULL;
+  new->mmap_base = NULL;
+  new->mmap_len = 0;
+  new->read_thread_num = 0;
 
   return(new);
 }
@@ -58,11 +66,95 @@ free_ngram_tuple(NGRAM_TUPLE_INFO *t)
   }
   if (t->num) free(t->num);
   if (t->nnid2wid) free(t->nnid2wid);
-  free(t->prob);
+  if (t->prob) free(t->prob);
   if (t->bo_wt) free(t->bo_wt);
   if (t->nnid2ctid_upper) free(t->nnid2ctid_upper);
   if (t->nnid2ctid_lower) free(t->nnid2ctid_lower);
+  if (t->prob_q) free(t->prob_q);
+  if (t->prob_cb) free(t->prob_cb);
+  if (t->bo_wt_q) free(t->bo_wt_q);
+  if (t->bo_wt_cb) free(t->bo_wt_cb);
+  if (t->bgn_ef) {
+    free(t->bgn_ef->low.body);
+    free(t->bgn_ef->high);
+    free(t->bgn_ef->sample);
+    free(t->bgn_ef);
+  }
+  if (t->nnid2wid_packed) {
+    free(t->nnid2wid_packed->body);
+    free(t->nnid2wid_packed);
+  }
+}
+
+#ifdef HAVE_MMAP
+/** 
+ * Free an area unless it is on the mapped file.
+ * 
+ * @param ndata [in] N-gram data
+ * @param p [in] area to free
+ */
+static void
+free_unmapped(NGRAM_INFO *ndata, void *p)
+{
+  if (p == NULL) return;
+  if ((char *)p >= (char *)ndata->mmap_base && (char *)p < (char *)ndata->mmap_base + ndata->mmap_len) return;
+  free(p);
+}
+#endif
+
+/** 
+ * Release N-gram data set up on a mapped bingram file, and unmap the
+ * file.  The data is left empty with @a mmap_base cleared, so it can
+ * be freed by ngram_info_free() afterwards.  Nothing is done if the
+ * data is not on a mapped file.
+ * 
+ * @param ndata [i/o] N-gram data
+ */
+void
+ngram_info_unmap(NGRAM_INFO *ndata)
+{
+#ifdef HAVE_MMAP
+  int i;
+
+  if (ndata->mmap_base == NULL) return;
+  /* word names and arrays are on the mapped area, except for
+     quantized or packed ones made after mapping */
+  if (ndata->wname) free(ndata->wname);
+  free_unmapped(ndata, ndata->p_2_q);
+  free_unmapped(ndata, ndata->p_2_cb);
+  if (ndata->d) {
+    for(i=0;i<ndata->n;i++) {
+      free_unmapped(ndata, ndata->d[i].prob_q);
+      free_unmapped(ndata, ndata->d[i].prob_cb);
+      free_unmapped(ndata, ndata->d[i].bo_wt_q);
+      free_unmapped(ndata, ndata->d[i].bo_wt_cb);
+      if (ndata->d[i].bgn_ef) {
+	free_unmapped(ndata, ndata->d[i].bgn_ef->low.body);
+	free_unmapped(ndata, ndata->d[i].bgn_ef->high);
+	free_unmapped(ndata, ndata->d[i].bgn_ef->sample);
+	free(ndata->d[i].bgn_ef);
+      }
+      if (ndata->d[i].nnid2wid_packed) {
+	free_unmapped(ndata, ndata->d[i].nnid2wid_packed->body);
+	free(ndata->d[i].nnid2wid_packed);
+      }
+    }
+    free(ndata->d);
+  }
+  if (ndata->mroot) mybfree2(&(ndata->mroot));
+  munmap(ndata->mmap_base, ndata->mmap_len);
+  ndata->wname = NULL;
+  ndata->d = NULL;
+  ndata->bo_wt_1 = NULL;
+  ndata->p_2 = NULL;
+  ndata->p_2_q = NULL;
+  ndata->p_2_cb = NULL;
+  ndata->mroot = NULL;
+  ndata->mmap_base = NULL;
+  ndata->mmap_len = 0;
+#endif
 }
+
 /** 
  * Free N-gram data.
  * 
@@ -74,6 +166,14 @@ ngram_info_free(NGRAM_INFO *ndata)
   int i;
   WORD_ID w;
 
+#ifdef HAVE_MMAP
+  if (ndata->mmap_base) {
+    ngram_info_unmap(ndata);
+    free(ndata);
+    return;
+  }
+#endif
+
   /* bin test only */
   /* free word names */
   if (ndata->from_bin) {
@@ -92,6 +192,8 @@ ngram_info_free(NGRAM_INFO *ndata)
   /* free 2-gram for the 1st pass */
   if (ndata->bo_wt_1) free(ndata->bo_wt_1);
   if (ndata->p_2) free(ndata->p_2);
+  if (ndata->p_2_q) free(ndata->p_2_q);
+  if (ndata->p_2_cb) free(ndata->p_2_cb);
   /* free n-gram */
   if (ndata->d) {
     for(i=0;i<ndata->n;i++) {
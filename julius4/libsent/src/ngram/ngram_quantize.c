@@ -0,0 +1,233 @@
+/** 
+ * @file   ngram_quantize.c
+ * 
+ * <JA>
+ * @brief  N-gram ΨȥХåշ̻Ҳ
+ * 
+ * 2-gram ʾγ N-gram ˤĤơΨȥХåշ򤽤줾
+ * 256 Ĥɽͤĥɥ֥å 8bit ̻Ҳ롥ͤ
+ * ¤٤٤˶ڤäͤ 1  k-means 
+ * ɽͤ롥ۤʤͤ 256 İʲξϸʤɽ롥
+ * 1-gram ̻Ҳʤ
+ * </JA>
+ * 
+ * <EN>
+ * @brief  Quantization of N-gram probabilities and back-off weights
+ * 
+ * For each N-gram of 2-gram and up, probabilities and back-off weights
+ * are quantized to 8bit index to a codebook of 256 values per array.
+ * The codebook is computed by one-dimensional k-means, starting from
+ * equal-frequency partitions of the sorted values.  If there are not
+ * more than 256 distinct values, they are kept without loss.
+ * 1-gram will not be quantized.
+ * </EN>
+ * 
+ * @author Julius project team
+ * 
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/ngram2.h>
+
+/// Number of k-means iterations for codebook estimation
+#define QUANT_ITERATION 10
+
+/** 
+ * qsort callback to sort values in ascending order.
+ * 
+ * @param a [in] element 1
+ * @param b [in] element 2
+ * 
+ * @return -1, 0 or 1 as the comparison result.
+ */
+static int
+compare_logprob(LOGPROB *a, LOGPROB *b)
+{
+  if (*a < *b) return -1;
+  if (*a > *b) return 1;
+  return 0;
+}
+
+/** 
+ * Find nearest codebook entry of a value.
+ * 
+ * @param cb [in] codebook sorted in ascending order
+ * @param len [in] length of @a cb
+ * @param x [in] value to be quantized
+ * 
+ * @return the index of the nearest entry.
+ */
+static NGRAM_QUANT
+quant_nearest(LOGPROB *cb, int len, LOGPROB x)
+{
+  int left, right, mid;
+
+  /* find the first entry whose upper boundary is above x */
+  left = 0;
+  right = len - 1;
+  while (left < right) {
+    mid = (left + right) / 2;
+    if ((cb[mid] + cb[mid+1]) * 0.5 < x) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return((NGRAM_QUANT)left);
+}
+
+/** 
+ * Quantize an array of values.
+ * 
+ * @param src [in] values to be quantized
+ * @param num [in] number of values
+ * @param cb_ret [out] newly allocated codebook of NGRAM_QUANT_LEVELS entries
+ * @param q_ret [out] newly allocated array of quantized values
+ * @param name [in] name of the array for message
+ */
+static void
+quant_array(LOGPROB *src, NNID num, LOGPROB **cb_ret, NGRAM_QUANT **q_ret, char *name)
+{
+  LOGPROB *sorted, *cb;
+  NGRAM_QUANT *q;
+  double *sum;
+  NNID *cnt;
+  NNID i, j, bgn, end;
+  int k, len, iter;
+  LOGPROB d, maxerr;
+  double toterr;
+
+  /* sort the values */
+  sorted = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), num);
+  memcpy(sorted, src, sizeof(LOGPROB) * num);
+  qsort(sorted, num, sizeof(LOGPROB), (int (*)(const void *, const void *))compare_logprob);
+
+  cb = (LOGPROB *)mymalloc(sizeof(LOGPROB) * NGRAM_QUANT_LEVELS);
+
+  /* count distinct values */
+  len = 0;
+  for(i=0;i<num;i++) {
+    if (i == 0 || sorted[i] != sorted[i-1]) {
+      if (len >= NGRAM_QUANT_LEVELS) break;
+      cb[len++] = sorted[i];
+    }
+  }
+  if (i < num) {
+    /* more distinct values than the codebook size: estimate codebook */
+    sum = (double *)mymalloc(sizeof(double) * NGRAM_QUANT_LEVELS);
+    cnt = (NNID *)mymalloc(sizeof(NNID) * NGRAM_QUANT_LEVELS);
+    /* initial codebook from equal-frequency partitions */
+    len = NGRAM_QUANT_LEVELS;
+    for(k=0;k<len;k++) {
+      bgn = (NNID)((double)num * k / len);
+      end = (NNID)((double)num * (k + 1) / len);
+      sum[k] = 0.0;
+      for(i=bgn;i<end;i++) sum[k] += sorted[i];
+      cb[k] = (end > bgn) ? sum[k] / (end - bgn) : sorted[bgn];
+    }
+    /* k-means: values are sorted, so each cluster is an interval */
+    for(iter=0;iter<QUANT_ITERATION;iter++) {
+      for(k=0;k<len;k++) {
+	sum[k] = 0.0;
+	cnt[k] = 0;
+      }
+      k = 0;
+      for(i=0;i<num;i++) {
+	while (k < len - 1 && (cb[k] + cb[k+1]) * 0.5 < sorted[i]) k++;
+	sum[k] += sorted[i];
+	cnt[k]++;
+      }
+      for(k=0;k<len;k++) {
+	if (cnt[k] > 0) cb[k] = sum[k] / cnt[k];
+      }
+      /* keep ascending order */
+      qsort(cb, len, sizeof(LOGPROB), (int (*)(const void *, const void *))compare_logprob);
+    }
+    free(cnt);
+    free(sum);
+  }
+  /* fill the rest */
+  for(k=len;k<NGRAM_QUANT_LEVELS;k++) cb[k] = cb[len-1];
+  free(sorted);
+
+  /* encode */
+  q = (NGRAM_QUANT *)mymalloc_big(sizeof(NGRAM_QUANT), num);
+  maxerr = 0.0;
+  toterr = 0.0;
+  for(j=0;j<num;j++) {
+    q[j] = quant_nearest(cb, len, src[j]);
+    d = cb[q[j]] - src[j];
+    if (d < 0.0) d = -d;
+    if (maxerr < d) maxerr = d;
+    toterr += d;
+  }
+  jlog("Stat: ngram_quantize: %s: %d levels, error avg=%f max=%f\n", name, len, toterr / num, maxerr);
+
+  *cb_ret = cb;
+  *q_ret = q;
+}
+
+/** 
+ * Quantize probabilities and back-off weights of N-gram.  The original
+ * arrays will be freed unless they are on a mapped file.  1-gram will
+ * not be quantized.
+ * 
+ * @param ndata [i/o] N-gram data
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+ngram_quantize(NGRAM_INFO *ndata)
+{
+  int n;
+  NGRAM_TUPLE_INFO *t;
+  char buf[64];
+
+  for(n=1;n<ndata->n;n++) {
+    t = &(ndata->d[n]);
+    if (t->prob != NULL && t->totalnum > 0) {
+      sprintf(buf, "%d-gram prob", n+1);
+      quant_array(t->prob, t->totalnum, &(t->prob_cb), &(t->prob_q), buf);
+      if (ndata->mmap_base == NULL) free(t->prob);
+      t->prob = NULL;
+    }
+    if (t->bo_wt != NULL && t->context_num > 0) {
+      sprintf(buf, "%d-gram bo_wt", n+1);
+      quant_array(t->bo_wt, t->context_num, &(t->bo_wt_cb), &(t->bo_wt_q), buf);
+      if (ndata->mmap_base == NULL) free(t->bo_wt);
+      t->bo_wt = NULL;
+    }
+  }
+  if (ndata->p_2 != NULL && ndata->d[1].totalnum > 0) {
+    quant_array(ndata->p_2, ndata->d[1].totalnum, &(ndata->p_2_cb), &(ndata->p_2_q), "LR 2-gram prob");
+    if (ndata->mmap_base == NULL) free(ndata->p_2);
+    ndata->p_2 = NULL;
+  }
+
+  return TRUE;
+}
+
+/** 
+ * Check if the N-gram data has quantized values.
+ * 
+ * @param ndata [in] N-gram data
+ * 
+ * @return TRUE if quantized, FALSE if not.
+ */
+boolean
+ngram_is_quantized(NGRAM_INFO *ndata)
+{
+  int n;
+
+  if (ndata->p_2_q) return TRUE;
+  for(n=0;n<ndata->n;n++) {
+    if (ndata->d[n].prob_q || ndata->d[n].bo_wt_q) return TRUE;
+  }
+  return FALSE;
+}
@@ -6,6 +6,10 @@
  *
  * ARPAN-gramեѤ硤2-gram ȵո 3-gram 
  * 줾̡Υե뤫ɤ߹ߤޤ
+ *
+ * 2-gram ʾγƥϰԿĤޤȤɤ߹ߡ
+ * ͤѴñIDθʣåɤ˹Ԥä塤
+ * νN-gram˳Ǽޤ
  * </JA>
  * 
  * <EN>
@@ -13,6 +17,11 @@
  *
  * When N-gram data is given in ARPA format, both 2-gram file and
  * reverse 3-gram file should be specified.
+ *
+ * Each section of 2-gram and up is read by a chunk of lines.  The
+ * conversion of values and word ID lookup are done in parallel by
+ * threads, and then the entries are stored to the N-gram in the
+ * original order.
  * </EN>
  *
  * @sa ngram2.h
@@ -36,10 +45,318 @@
 
 #include <sent/stddefs.h>
 #include <sent/ngram2.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 static char buf[800];			///< Local buffer for reading
 static char pbuf[800];			///< Local buffer for error string 
 
+/// Maximum number of N-gram lines to be read and parsed at a time
+#define ARPA_CHUNK_LINES 65536
+/// Size of text buffer to hold the N-gram lines read at a time
+#define ARPA_CHUNK_BYTES 4194304
+/// Maximum number of threads to parse N-gram lines
+#define ARPA_THREAD_MAX 8
+/// Minimum number of lines per thread to parse in parallel
+#define ARPA_THREAD_MIN_LINES 1024
+
+/* parse status of a line */
+#define ARPA_LINE_OK 0		///< Parsed, without back-off weight
+#define ARPA_LINE_BOWT 1	///< Parsed, with back-off weight
+#define ARPA_LINE_NOWORD 2	///< A word does not exist in 1-gram
+#define ARPA_LINE_BROKEN 3	///< Failed to parse
+
+/**
+ * N-gram lines read from file at a time, and their parsed values.
+ * The lines are parsed in parallel, and then stored to the N-gram
+ * in the original order.
+ */
+typedef struct {
+  NGRAM_INFO *ndata;		///< N-gram to look up word IDs
+  int n;			///< Number of words in a line
+  int num;			///< Number of lines
+  char *pool;			///< Text buffer holding the lines
+  int used;			///< Used bytes in @a pool
+  int *pos;			///< Beginning of each line in @a pool
+  LOGPROB *prob;		///< Parsed probability of each line
+  LOGPROB *bowt;		///< Parsed back-off weight of each line
+  WORD_ID *w;			///< Parsed word IDs of each line [line * n]
+  char *stat;			///< Parse status of each line (ARPA_LINE_*)
+  int *errpos;			///< Position of the unknown word in @a pool
+} ARPA_CHUNK;
+
+#ifdef HAVE_PTHREAD
+/**
+ * Range of lines to be parsed by a thread.
+ */
+typedef struct {
+  ARPA_CHUNK *c;		///< Chunk to be parsed
+  int bgn;			///< First line
+  int end;			///< Last line + 1
+} ARPA_WORKER;
+#endif
+
+/** 
+ * Get the number of threads to parse N-gram lines.
+ * 
+ * @param ndata [in] N-gram data
+ * 
+ * @return the number of threads.
+ */
+static int
+arpa_thread_num(NGRAM_INFO *ndata)
+{
+#ifdef HAVE_PTHREAD
+  int num;
+
+  num = ndata->read_thread_num;
+  if (num <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+    num = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    num = 1;
+#endif
+  }
+  if (num < 1) num = 1;
+  if (num > ARPA_THREAD_MAX) num = ARPA_THREAD_MAX;
+  return(num);
+#else
+  return(1);
+#endif
+}
+
+/** 
+ * Allocate a chunk to read N-gram lines.
+ * 
+ * @param ndata [in] N-gram data
+ * @param n [in] number of words in a line
+ * 
+ * @return the newly allocated chunk.
+ */
+static ARPA_CHUNK *
+arpa_chunk_new(NGRAM_INFO *ndata, int n)
+{
+  ARPA_CHUNK *c;
+
+  c = (ARPA_CHUNK *)mymalloc(sizeof(ARPA_CHUNK));
+  c->ndata = ndata;
+  c->n = n;
+  c->num = 0;
+  c->used = 0;
+  c->pool = (char *)mymalloc(ARPA_CHUNK_BYTES);
+  c->pos = (int *)mymalloc(sizeof(int) * ARPA_CHUNK_LINES);
+  c->prob = (LOGPROB *)mymalloc(sizeof(LOGPROB) * ARPA_CHUNK_LINES);
+  c->bowt = (LOGPROB *)mymalloc(sizeof(LOGPROB) * ARPA_CHUNK_LINES);
+  c->w = (WORD_ID *)mymalloc(sizeof(WORD_ID) * n * ARPA_CHUNK_LINES);
+  c->stat = (char *)mymalloc(sizeof(char) * ARPA_CHUNK_LINES);
+  c->errpos = (int *)mymalloc(sizeof(int) * ARPA_CHUNK_LINES);
+
+  return(c);
+}
+
+/** 
+ * Free a chunk.
+ * 
+ * @param c [in] chunk
+ */
+static void
+arpa_chunk_free(ARPA_CHUNK *c)
+{
+  free(c->errpos);
+  free(c->stat);
+  free(c->w);
+  free(c->bowt);
+  free(c->prob);
+  free(c->pos);
+  free(c->pool);
+  free(c);
+}
+
+/** 
+ * Read N-gram lines to a chunk until the chunk gets full or the
+ * section ends.  When the section ends, the next section header
+ * is left in @a buf.
+ * 
+ * @param fp [in] file pointer
+ * @param c [out] chunk to store the lines
+ * 
+ * @return TRUE if more lines may follow, or FALSE if the section ended.
+ */
+static boolean
+arpa_chunk_read(FILE *fp, ARPA_CHUNK *c)
+{
+  char *p;
+
+  c->num = 0;
+  c->used = 0;
+  while (c->num < ARPA_CHUNK_LINES && c->used + sizeof(buf) <= ARPA_CHUNK_BYTES) {
+    p = &(c->pool[c->used]);
+    if (getl(p, sizeof(buf), fp) == NULL) {
+      buf[0] = '\0';
+      return FALSE;
+    }
+    if (p[0] == '\\') {
+      strcpy(buf, p);
+      return FALSE;
+    }
+    c->pos[c->num++] = c->used;
+    c->used += strlen(p) + 1;
+  }
+  return TRUE;
+}
+
+/** 
+ * Get the next token in a string, like strtok() with DELM.  Unlike
+ * strtok(), it is reentrant and leaves the string untouched: the token
+ * is copied to @a tok.
+ * 
+ * @param p [i/o] current position, will be moved after the token
+ * @param tok [out] buffer to store the token, should be as long as @a buf
+ * 
+ * @return @a tok, or NULL if no more token.
+ */
+static char *
+arpa_token(char **p, char *tok)
+{
+  char *s;
+  int len;
+
+  s = *p;
+  while (*s != '\0' && strchr(DELM, *s) != NULL) s++;
+  len = 0;
+  while (s[len] != '\0' && strchr(DELM, s[len]) == NULL) {
+    tok[len] = s[len];
+    len++;
+  }
+  tok[len] = '\0';
+  *p = s + len;
+  return((len > 0) ? tok : NULL);
+}
+
+/** 
+ * Parse lines in a chunk: probability, word IDs and back-off weight.
+ * 
+ * @param c [i/o] chunk
+ * @param bgn [in] first line to parse
+ * @param end [in] last line to parse + 1
+ */
+static void
+arpa_parse_lines(ARPA_CHUNK *c, int bgn, int end)
+{
+  int i, k;
+  char *p, *s;
+  WORD_ID *w;
+  char tok[sizeof(buf)];
+
+  for(i=bgn;i<end;i++) {
+    p = &(c->pool[c->pos[i]]);
+    w = &(c->w[i * c->n]);
+    if ((s = arpa_token(&p, tok)) == NULL) {
+      c->stat[i] = ARPA_LINE_BROKEN;
+      continue;
+    }
+    c->prob[i] = (LOGPROB)atof(s);
+    for(k=0;k<c->n;k++) {
+      c->errpos[i] = p - c->pool;
+      if ((s = arpa_token(&p, tok)) == NULL) {
+	c->stat[i] = ARPA_LINE_BROKEN;
+	break;
+      }
+      if ((w[k] = ngram_lookup_word(c->ndata, s)) == WORD_INVALID) {
+	c->stat[i] = ARPA_LINE_NOWORD;
+	break;
+      }
+    }
+    if (k < c->n) continue;
+    if ((s = arpa_token(&p, tok)) != NULL) {
+      c->bowt[i] = (LOGPROB)atof(s);
+      c->stat[i] = ARPA_LINE_BOWT;
+    } else {
+      c->stat[i] = ARPA_LINE_OK;
+    }
+  }
+}
+
+#ifdef HAVE_PTHREAD
+/** 
+ * Thread function to parse a range of lines.
+ * 
+ * @param arg [in] range of lines (ARPA_WORKER)
+ * 
+ * @return NULL.
+ */
+static void *
+arpa_parse_thread(void *arg)
+{
+  ARPA_WORKER *a = (ARPA_WORKER *)arg;
+
+  arpa_parse_lines(a->c, a->bgn, a->end);
+  return NULL;
+}
+#endif
+
+/** 
+ * Parse all lines in a chunk, dividing them to threads.  Parsing only
+ * reads the word index tree, so the threads need no lock.
+ * 
+ * @param c [i/o] chunk
+ * @param thread_num [in] number of threads
+ */
+static void
+arpa_chunk_parse(ARPA_CHUNK *c, int thread_num)
+{
+#ifdef HAVE_PTHREAD
+  pthread_t th[ARPA_THREAD_MAX];
+  ARPA_WORKER a[ARPA_THREAD_MAX];
+  boolean running[ARPA_THREAD_MAX];
+  int k;
+
+  if (thread_num > c->num / ARPA_THREAD_MIN_LINES) {
+    thread_num = c->num / ARPA_THREAD_MIN_LINES;
+  }
+  if (thread_num > 1) {
+    for(k=0;k<thread_num;k++) {
+      a[k].c = c;
+      a[k].bgn = (int)((double)c->num * k / thread_num);
+      a[k].end = (int)((double)c->num * (k + 1) / thread_num);
+    }
+    /* the first range is parsed by this thread */
+    for(k=1;k<thread_num;k++) {
+      running[k] = (pthread_create(&(th[k]), NULL, arpa_parse_thread, &(a[k])) == 0) ? TRUE : FALSE;
+    }
+    arpa_parse_lines(c, a[0].bgn, a[0].end);
+    for(k=1;k<thread_num;k++) {
+      if (running[k]) {
+	pthread_join(th[k], NULL);
+      } else {
+	arpa_parse_lines(c, a[k].bgn, a[k].end);
+      }
+    }
+    return;
+  }
+#endif
+  arpa_parse_lines(c, 0, c->num);
+}
+
+/** 
+ * Get the word that was not found in 1-gram at a line in a chunk.
+ * 
+ * @param c [in] chunk
+ * @param i [in] line
+ * 
+ * @return the word, stored in @a pbuf.
+ */
+static char *
+arpa_chunk_errword(ARPA_CHUNK *c, int i)
+{
+  char *p;
+
+  p = &(c->pool[c->errpos[i]]);
+  return(arpa_token(&p, pbuf));
+}
+
 
 /** 
  * Set number of N-gram entries, for reading the first LR 2-gram.
@@ -266,58 +583,57 @@ add_unigram(FILE *fp, NGRAM_INFO *ndata)
 static boolean
 add_bigram(FILE *fp, NGRAM_INFO *ndata)
 {
-  WORD_ID w[2], wtmp;
-  LOGPROB prob;
+  WORD_ID *w, wtmp;
   NNID bi_count = 0;
   NNID n2;
   boolean ok_p = TRUE;
-  char *s;
+  boolean more;
+  ARPA_CHUNK *c;
+  int l, thread_num;
 
   ndata->p_2 = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), ndata->d[1].totalnum);
-
-  while (getl(buf, sizeof(buf), fp) != NULL && buf[0] != '\\') {
-    strcpy(pbuf, buf);
-    if ( ++bi_count % 100000 == 0) {
-      jlog("Stat: ngram_read_arpa: 2-gram read %lu (%d%%)\n", bi_count, bi_count * 100 / ndata->d[1].totalnum);
-    }
-    if ((s = strtok(buf, DELM)) == NULL) {
-      jlog("Error: ngram_read_arpa: 2-gram: failed to parse, corrupted or invalid data?\n");
-      return FALSE;
-    }
-    prob = (LOGPROB)atof(s);
-    if ((s = strtok(NULL, DELM)) == NULL) {
-      jlog("Error: ngram_read_arpa: 2-gram: failed to parse, corrupted or invalid data?\n");
-      return FALSE;
-    }
-    w[0] = ngram_lookup_word(ndata, s);
-    if (w[0] == WORD_INVALID) {
-      jlog("Error: ngram_read_arpa: 2-gram #%lu: \"%s\": \"%s\" not exist in 1-gram\n", bi_count, pbuf, s);
-      ok_p = FALSE;
-      continue;
-    }
-    if ((s = strtok(NULL, DELM)) == NULL) {
-      jlog("Error: ngram_read_arpa: 2-gram: failed to parse, corrupted or invalid data?\n");
-      return FALSE;
-    }
-    w[1] = ngram_lookup_word(ndata, s);
-    if (w[1] == WORD_INVALID) {
-      jlog("Error: ngram_read_arpa: 2-gram #%lu: \"%s\": \"%s\" not exist in 1-gram\n", bi_count, pbuf, s);
-      ok_p = FALSE;
-      continue;
-    }
-    if (ndata->dir == DIR_RL) {
-      /* word order should be reversed */
-      wtmp = w[0];
-      w[0] = w[1];
-      w[1] = wtmp;
-    }
-    n2 = search_ngram(ndata, 2, w);
-    if (n2 == NNID_INVALID) {
-      jlog("Warning: ngram_read_arpa: 2-gram #%d: \"%s\": (%s,%s) not exist in LR 2-gram (ignored)\n", n2+1, pbuf, ndata->wname[w[0]], ndata->wname[w[1]]);
-    } else {
-      ndata->p_2[n2] = prob;
+  /* entries missing in LR 2-gram should not be left uninitialized */
+  for(n2=0;n2<ndata->d[1].totalnum;n2++) ndata->p_2[n2] = 0.0;
+
+  c = arpa_chunk_new(ndata, 2);
+  thread_num = arpa_thread_num(ndata);
+
+  do {
+    /* read lines and parse them in parallel */
+    more = arpa_chunk_read(fp, c);
+    arpa_chunk_parse(c, thread_num);
+    /* store them in order */
+    for(l=0;l<c->num;l++) {
+      if ( ++bi_count % 100000 == 0) {
+	jlog("Stat: ngram_read_arpa: 2-gram read %lu (%d%%)\n", bi_count, bi_count * 100 / ndata->d[1].totalnum);
+      }
+      if (c->stat[l] == ARPA_LINE_BROKEN) {
+	jlog("Error: ngram_read_arpa: 2-gram: failed to parse, corrupted or invalid data?\n");
+	arpa_chunk_free(c);
+	return FALSE;
+      }
+      if (c->stat[l] == ARPA_LINE_NOWORD) {
+	jlog("Error: ngram_read_arpa: 2-gram #%lu: \"%s\": \"%s\" not exist in 1-gram\n", bi_count, &(c->pool[c->pos[l]]), arpa_chunk_errword(c, l));
+	ok_p = FALSE;
+	continue;
+      }
+      w = &(c->w[l * 2]);
+      if (ndata->dir == DIR_RL) {
+	/* word order should be reversed */
+	wtmp = w[0];
+	w[0] = w[1];
+	w[1] = wtmp;
+      }
+      n2 = search_ngram(ndata, 2, w);
+      if (n2 == NNID_INVALID) {
+	jlog("Warning: ngram_read_arpa: 2-gram #%d: \"%s\": (%s,%s) not exist in LR 2-gram (ignored)\n", n2+1, &(c->pool[c->pos[l]]), ndata->wname[w[0]], ndata->wname[w[1]]);
+      } else {
+	ndata->p_2[n2] = c->prob[l];
+      }
     }
-  }
+  } while (more);
+
+  arpa_chunk_free(c);
 
   if (ok_p == TRUE) {
     jlog("Stat: ngram_read_arpa: 2-gram read %lu end\n", bi_count);
@@ -338,21 +654,21 @@ set_ngram(FILE *fp, NGRAM_INFO *ndata, int n)
   NNID i;
   WORD_ID *w;
   WORD_ID *w_last;
-  LOGPROB p, bowt;
   NNID nnid;
   NNID cid, cid_last;
   boolean ok_p = TRUE;
-  char *s;
   NGRAM_TUPLE_INFO *t;
   NGRAM_TUPLE_INFO *tprev;
   NNID ntmp;
+  ARPA_CHUNK *c;
+  boolean more;
+  int l, thread_num;
 
   if (n < 2) {
     jlog("Error: ngram_read_arpa: unable to process 1-gram\n");
     return FALSE;
   }
 
-  w = (WORD_ID *)mymalloc(sizeof(WORD_ID) * n);
   w_last = (WORD_ID *)mymalloc(sizeof(WORD_ID) * n);
 
   t = &(ndata->d[n-1]);
@@ -389,125 +705,123 @@ set_ngram(FILE *fp, NGRAM_INFO *ndata, int n)
   cid = cid_last = NNID_INVALID;
   for(i=0;i<n;i++) w_last[i] = WORD_INVALID;
 
+  c = arpa_chunk_new(ndata, n);
+  thread_num = arpa_thread_num(ndata);
+
   /* read in N-gram */
-  for (;;) {
-    if (getl(buf, sizeof(buf), fp) == NULL || buf[0] == '\\') break;
-    strcpy(pbuf, buf);
-    if ( nnid % 100000 == 0) {
-      jlog("Stat: ngram_read_arpa: %d-gram read %d (%d%%)\n", n, nnid, nnid * 100 / t->totalnum);
-    }
+  do {
+    /* read lines and parse them in parallel */
+    more = arpa_chunk_read(fp, c);
+    arpa_chunk_parse(c, thread_num);
+
+    /* store them in order */
+    for(l=0;l<c->num;l++) {
+      if ( nnid % 100000 == 0) {
+	jlog("Stat: ngram_read_arpa: %d-gram read %d (%d%%)\n", n, nnid, nnid * 100 / t->totalnum);
+      }
 
-    /* N-gram probability */
-    if ((s = strtok(buf, DELM)) == NULL) {
-      jlog("Error: ngram_read_arpa: %d-gram: failed to parse, corrupted or invalid data?\n", n);
-      free(w_last); free(w);
-      return FALSE;
-    }
-    p = (LOGPROB)atof(s);
-    /* read in context word and lookup the ID */
-    for(i=0;i<n;i++) {
-      if ((s = strtok(NULL, DELM)) == NULL) {
+      if (c->stat[l] == ARPA_LINE_BROKEN) {
 	jlog("Error: ngram_read_arpa: %d-gram: failed to parse, corrupted or invalid data?\n", n);
-	free(w_last); free(w);
+	arpa_chunk_free(c); free(w_last);
 	return FALSE;
       }
-      if ((w[i] = ngram_lookup_word(ndata, s)) == WORD_INVALID) {
-	jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": \"%s\" not exist in %d-gram\n", n, nnid+1, pbuf, s, n);
+      if (c->stat[l] == ARPA_LINE_NOWORD) {
+	jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": \"%s\" not exist in %d-gram\n", n, nnid+1, &(c->pool[c->pos[l]]), arpa_chunk_errword(c, l), n);
 	ok_p = FALSE;
-	break;
+	continue;
       }
-      /* increment nnid_bgn and nnid_num if context word changed */
-    }
-    if (i < n) continue;	/* error out */
-
-    /* detect context entry change at this line */
-    for(i=0;i<n-1;i++) {
-      if (w[i] != w_last[i]) break;
-    }
-    if (i < n-1) {		/* context changed here */
-      /* find new entry point */
-      cid = search_ngram(ndata, n-1, w);
-      if (cid == NNID_INVALID) {	/* no context */
-        //jlog("Warning: ngram_read_arpa: %d-gram #%d: \"%s\": context (%s,%s) not exist in %d-gram (ignored)\n", n, nnid+1, pbuf, ndata->wname[w_m], ndata->wname[w_r], n-1);
-        jlog("Warning: ngram_read_arpa: %d-gram #%d: \"%s\": context (",
-	     n, nnid+1, pbuf);
-	for(i=0;i<n-1;i++) {
-	  jlog(" %s", ndata->wname[w[i]]);
-	}
-        jlog(") not exist in %d-gram (ignored)\n", n-1);
-	ok_p = FALSE;
-        continue;
+      w = &(c->w[l * n]);
+
+      /* detect context entry change at this line */
+      for(i=0;i<n-1;i++) {
+	if (w[i] != w_last[i]) break;
       }
-      if (cid_last != NNID_INVALID) {
-	/* close last entry */
+      if (i < n-1) {		/* context changed here */
+	/* find new entry point */
+	cid = search_ngram(ndata, n-1, w);
+	if (cid == NNID_INVALID) {	/* no context */
+	  //jlog("Warning: ngram_read_arpa: %d-gram #%d: \"%s\": context (%s,%s) not exist in %d-gram (ignored)\n", n, nnid+1, pbuf, ndata->wname[w_m], ndata->wname[w_r], n-1);
+	  jlog("Warning: ngram_read_arpa: %d-gram #%d: \"%s\": context (",
+	       n, nnid+1, &(c->pool[c->pos[l]]));
+	  for(i=0;i<n-1;i++) {
+	    jlog(" %s", ndata->wname[w[i]]);
+	  }
+	  jlog(") not exist in %d-gram (ignored)\n", n-1);
+	  ok_p = FALSE;
+	  continue;
+	}
+	if (cid_last != NNID_INVALID) {
+	  /* close last entry */
+	  if (t->is24bit) {
+	    ntmp = ((NNID)(t->bgn_upper[cid_last]) << 16) + (NNID)(t->bgn_lower[cid_last]);
+	  } else {
+	    ntmp = t->bgn[cid_last];
+	  }
+	  t->num[cid_last] = nnid - ntmp;
+	}
+	/* the next context word should be an new entry */
 	if (t->is24bit) {
-	  ntmp = ((NNID)(t->bgn_upper[cid_last]) << 16) + (NNID)(t->bgn_lower[cid_last]);
+	  if (t->bgn_upper[cid] != NNID_INVALID_UPPER) {
+	    jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": word order is not the same as 1-gram\n", n, nnid+1, &(c->pool[c->pos[l]]));
+	    arpa_chunk_free(c); free(w_last);
+	    return FALSE;
+	  }
+	  ntmp = nnid & 0xffff;
+	  t->bgn_lower[cid] = ntmp;
+	  ntmp = nnid >> 16;
+	  t->bgn_upper[cid] = ntmp;
 	} else {
-	  ntmp = t->bgn[cid_last];
+	  if (t->bgn[cid] != NNID_INVALID) {
+	    jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": word order is not the same as 1-gram\n", n, nnid+1, &(c->pool[c->pos[l]]));
+	    arpa_chunk_free(c); free(w_last);
+	    return FALSE;
+	  }
+	  t->bgn[cid] = nnid;
 	}
-	t->num[cid_last] = nnid - ntmp;
+
+	cid_last = cid;
+	w_last[n-1] = WORD_INVALID;
       }
-      /* the next context word should be an new entry */
-      if (t->is24bit) {
-	if (t->bgn_upper[cid] != NNID_INVALID_UPPER) {
-	  jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": word order is not the same as 1-gram\n", n, nnid+1, pbuf);
-	  free(w_last); free(w);
-	  return FALSE;
+
+      /* store the probabilities of the target word */
+      if (w[n-1] == w_last[n-1]) {
+	jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": duplicated entry\n", n, nnid+1, &(c->pool[c->pos[l]]));
+	ok_p = FALSE;
+	continue;
+      } else if (w_last[n-1] != WORD_INVALID && w[n-1] < w_last[n-1]) {
+	jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": word order is not the same as 1-gram\n", n, nnid+1, &(c->pool[c->pos[l]]));
+	arpa_chunk_free(c); free(w_last);
+	return FALSE;
+      }
+
+      /* if the 2-gram has back-off entries, store them here */
+      if (c->stat[l] == ARPA_LINE_BOWT) {
+	if (t->bo_wt == NULL) {
+	  t->bo_wt = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), t->totalnum);
+	  for(i=0;i<nnid;i++) t->bo_wt[i] = 0.0;
 	}
-	ntmp = nnid & 0xffff;
-	t->bgn_lower[cid] = ntmp;
-	ntmp = nnid >> 16;
-	t->bgn_upper[cid] = ntmp;
+	t->bo_wt[nnid] = c->bowt[l];
       } else {
-	if (t->bgn[cid] != NNID_INVALID) {
-	  jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": word order is not the same as 1-gram\n", n, nnid+1, pbuf);
-	  free(w_last); free(w);
-	  return FALSE;
-	}
-	t->bgn[cid] = nnid;
+	if (t->bo_wt != NULL) t->bo_wt[nnid] = 0.0;
       }
 
-      cid_last = cid;
-      w_last[n-1] = WORD_INVALID;
-    }
+      /* store the entry info */
+      t->nnid2wid[nnid] = w[n-1];
+      t->prob[nnid] = c->prob[l];
 
-    /* store the probabilities of the target word */
-    if (w[n-1] == w_last[n-1]) {
-      jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": duplicated entry\n", n, nnid+1, pbuf);
-      ok_p = FALSE;
-      continue;
-    } else if (w_last[n-1] != WORD_INVALID && w[n-1] < w_last[n-1]) {
-      jlog("Error: ngram_read_arpa: %d-gram #%d: \"%s\": word order is not the same as 1-gram\n", n, nnid+1, pbuf);
-      free(w_last); free(w);
-      return FALSE;
-    }
+      nnid++;
+      for(i=0;i<n;i++) w_last[i] = w[i];
 
-    /* if the 2-gram has back-off entries, store them here */
-    if ((s = strtok(NULL, DELM)) != NULL) {
-      bowt = (LOGPROB) atof(s);
-      if (t->bo_wt == NULL) {
-	t->bo_wt = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), t->totalnum);
-	for(i=0;i<nnid;i++) t->bo_wt[i] = 0.0;
+      /* check total num */
+      if (nnid > t->totalnum) {
+	jlog("Error: ngram_read_arpa: %d-gram: read num (%d) not match the header value (%d)\n", n, nnid, t->totalnum);
+	arpa_chunk_free(c); free(w_last);
+	return FALSE;
       }
-      t->bo_wt[nnid] = bowt;
-    } else {
-      if (t->bo_wt != NULL) t->bo_wt[nnid] = 0.0;
     }
+  } while (more);
 
-    /* store the entry info */
-    t->nnid2wid[nnid] = w[n-1];
-    t->prob[nnid] = p;
-
-    nnid++;
-    for(i=0;i<n;i++) w_last[i] = w[i];
-
-    /* check total num */
-    if (nnid > t->totalnum) {
-      jlog("Error: ngram_read_arpa: %d-gram: read num (%d) not match the header value (%d)\n", n, nnid, t->totalnum);
-      free(w_last); free(w);
-      return FALSE;
-    }
-  }
+  arpa_chunk_free(c);
   
   /* set the last entry */
   if (t->is24bit) {
@@ -523,7 +837,7 @@ set_ngram(FILE *fp, NGRAM_INFO *ndata, int n)
     jlog("Stat: ngram_read_arpa: %d-gram read %d end\n", n, nnid);
   }
 
-  free(w_last); free(w);
+  free(w_last);
   return ok_p;
 }
 
@@ -656,6 +970,10 @@ ngram_read_arpa(FILE *fp, NGRAM_INFO *ndata, boolean addition)
     }
     jlog("Stat: ngram_read_arpa: reading 1-gram part...\n");
     if (set_unigram(fp, ndata) == FALSE) return FALSE;
+
+    if (arpa_thread_num(ndata) > 1) {
+      jlog("Stat: ngram_read_arpa: parsing N-gram lines with %d threads\n", arpa_thread_num(ndata));
+    }
     
     i = 2;
     while(i <= n) {
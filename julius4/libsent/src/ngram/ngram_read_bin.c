@@ -60,6 +60,13 @@
 
 #include <sent/stddefs.h>
 #include <sent/ngram2.h>
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 static int file_version;  ///< N-gram format version of the file
 static boolean need_swap; ///< TRUE if need byte swap
@@ -67,6 +74,9 @@ static boolean need_swap; ///< TRUE if need byte swap
 static boolean need_conv;	///< TRUE if need conversion of word ID from 2 bytes to 4 bytes
 static boolean words_int_retry = FALSE; ///< TRUE if retrying with conversion
 #endif
+static size_t rdcount;	  ///< Number of bytes already read from the top of file
+static char *map_base = NULL; ///< Top of the mapped file when reading from memory-mapped file
+static size_t map_len;	  ///< Length of the mapped file
 
 /**
  * 
@@ -86,10 +96,18 @@ static boolean
 rdnfunc(FILE *fp, void *buf, size_t unitbyte, size_t unitnum)
 {
   size_t tmp;
-  if ((tmp = myfread(buf, unitbyte, unitnum, fp)) < unitnum) {
+  if (map_base) {
+    /* read from the mapped file */
+    if (rdcount + unitbyte * unitnum > map_len) {
+      jlog("Error: ngram_read_bin: failed to read %d bytes\n", unitbyte*unitnum);
+      return FALSE;
+    }
+    memcpy(buf, map_base + rdcount, unitbyte * unitnum);
+  } else if ((tmp = myfread(buf, unitbyte, unitnum, fp)) < unitnum) {
     jlog("Error: ngram_read_bin: failed to read %d bytes\n", unitbyte*unitnum);
     return FALSE;
   }
+  rdcount += unitbyte * unitnum;
   if (need_swap) {
     if (unitbyte != 1) {
       swap_bytes(buf, unitbyte, unitnum);
@@ -98,6 +116,61 @@ rdnfunc(FILE *fp, void *buf, size_t unitbyte, size_t unitnum)
   return TRUE;
 }
 
+/** 
+ * Skip padding bytes until the next section boundary (v6 and later).
+ * 
+ * @param fp [in] file pointer
+ */
+static boolean
+rdn_align(FILE *fp)
+{
+  char buf[BINGRAM_SECTION_ALIGN];
+  size_t len;
+
+  if (file_version < 6) return TRUE;
+  len = (BINGRAM_SECTION_ALIGN - rdcount % BINGRAM_SECTION_ALIGN) % BINGRAM_SECTION_ALIGN;
+  if (len > 0) {
+    rdn(fp, buf, 1, len);
+  }
+  return TRUE;
+}
+
+/** 
+ * Read an array section.  When reading from a mapped file, the
+ * array is not copied and the pointer to the mapped area is returned.
+ * Otherwise a new area is allocated and the data is read into it.
+ * 
+ * @param fp [in] file pointer
+ * @param unitbyte [in] unit size in bytes
+ * @param unitnum [in] number of unit to read.
+ * 
+ * @return pointer to the array, or NULL on error.
+ */
+static void *
+rdn_array(FILE *fp, size_t unitbyte, size_t unitnum)
+{
+  void *p;
+
+  if (rdn_align(fp) == FALSE) return NULL;
+  if (map_base) {
+    /* zero-copy: just point to the mapped area */
+    if (rdcount + unitbyte * unitnum > map_len) {
+      jlog("Error: ngram_read_bin: failed to read %d bytes\n", unitbyte*unitnum);
+      return NULL;
+    }
+    p = map_base + rdcount;
+    rdcount += unitbyte * unitnum;
+    return p;
+  }
+  p = mymalloc_big(unitbyte, unitnum);
+  if (rdnfunc(fp, p, unitbyte, unitnum) == FALSE) {
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+#define rdn_arr(P,A,B,C) if ((P = rdn_array(A,B,C)) == NULL) return FALSE
+
 #ifdef WORDS_INT
 /** 
  * Binary read function with byte swap and word id conversion
@@ -133,6 +206,134 @@ rdn_wordid_func(FILE *fp, void *buf, int unitnum, boolean need_conv)
 }
 #endif
 
+/** 
+ * Read an array section of word IDs, with word id conversion if needed.
+ * 
+ * @param fp [in] file pointer
+ * @param unitnum [in] number of unit to read.
+ * 
+ * @return pointer to the array, or NULL on error.
+ */
+static WORD_ID *
+rdn_wordid_array(FILE *fp, size_t unitnum)
+{
+#ifdef WORDS_INT
+  WORD_ID *p;
+
+  if (need_conv) {
+    if (rdn_align(fp) == FALSE) return NULL;
+    p = (WORD_ID *)mymalloc_big(sizeof(WORD_ID), unitnum);
+    if (rdn_wordid_func(fp, p, unitnum, need_conv) == FALSE) {
+      free(p);
+      return NULL;
+    }
+    return p;
+  }
+#endif
+  return((WORD_ID *)rdn_array(fp, sizeof(WORD_ID), unitnum));
+}
+#define rdn_wordid_arr(P,A,B) if ((P = rdn_wordid_array(A,B)) == NULL) return FALSE
+
+/** 
+ * Read an array section of log probabilities.  On v7 and later,
+ * the section begins with a flag that tells whether the values are
+ * quantized, in which case the codebook and the quantized values are
+ * read instead.
+ * 
+ * @param fp [in] file pointer
+ * @param unitnum [in] number of unit to read.
+ * @param p [out] the read array, or NULL if quantized
+ * @param cb [out] the read codebook, or NULL if not quantized
+ * @param q [out] the read quantized array, or NULL if not quantized
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+rdn_prob(FILE *fp, size_t unitnum, LOGPROB **p, LOGPROB **cb, NGRAM_QUANT **q)
+{
+  int i;
+
+  *p = NULL;
+  *cb = NULL;
+  *q = NULL;
+  i = 0;
+  if (file_version >= 7) {
+    rdn(fp, &i, sizeof(int), 1);
+  }
+  if (i == 1) {
+    rdn_arr(*cb, fp, sizeof(LOGPROB), NGRAM_QUANT_LEVELS);
+    rdn_arr(*q, fp, sizeof(NGRAM_QUANT), unitnum);
+  } else {
+    rdn_arr(*p, fp, sizeof(LOGPROB), unitnum);
+  }
+  return TRUE;
+}
+#define rdn_prob_arr(A,B,P,C,Q) if (rdn_prob(A,B,P,C,Q) == FALSE) return FALSE
+
+/** 
+ * Read a bit-packed array (v8 and later).
+ * 
+ * @param fp [in] file pointer
+ * @param b [out] bit-packed array to store the read data
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+rdn_bitarray(FILE *fp, NGRAM_BITARRAY *b)
+{
+  rdn(fp, &(b->width), sizeof(int), 1);
+  rdn(fp, &(b->len), sizeof(NNID), 1);
+  rdn_arr(b->body, fp, sizeof(unsigned int), b->len);
+  return TRUE;
+}
+
+/** 
+ * Read tuple index of an m-gram.  On v8 and later, the section begins
+ * with a flag that tells whether the index is in succinct form, in
+ * which case the Elias-Fano coded beginning IDs and the bit-packed word
+ * IDs are read instead of the plain arrays.
+ * 
+ * @param fp [in] file pointer
+ * @param t [out] m-gram tuple data to store the index
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+rdn_index(FILE *fp, NGRAM_TUPLE_INFO *t)
+{
+  int i;
+  NGRAM_EF *ef;
+
+  i = 0;
+  if (file_version >= 8) {
+    rdn(fp, &i, sizeof(int), 1);
+  }
+  if (i == 1) {
+    ef = (NGRAM_EF *)mymalloc(sizeof(NGRAM_EF));
+    t->bgn_ef = ef;
+    rdn(fp, &(ef->num), sizeof(NNID), 1);
+    rdn(fp, &(ef->lowbit), sizeof(int), 1);
+    if (rdn_bitarray(fp, &(ef->low)) == FALSE) return FALSE;
+    rdn(fp, &(ef->highlen), sizeof(NNID), 1);
+    rdn_arr(ef->high, fp, sizeof(unsigned int), ef->highlen);
+    rdn(fp, &(ef->sampleshift), sizeof(int), 1);
+    rdn(fp, &(ef->samplenum), sizeof(NNID), 1);
+    rdn_arr(ef->sample, fp, sizeof(NNID), ef->samplenum);
+    t->nnid2wid_packed = (NGRAM_BITARRAY *)mymalloc(sizeof(NGRAM_BITARRAY));
+    if (rdn_bitarray(fp, t->nnid2wid_packed) == FALSE) return FALSE;
+  } else {
+    if (t->is24bit) {
+      rdn_arr(t->bgn_upper, fp, sizeof(NNID_UPPER), t->bgnlistlen);
+      rdn_arr(t->bgn_lower, fp, sizeof(NNID_LOWER), t->bgnlistlen);
+    } else {
+      rdn_arr(t->bgn, fp, sizeof(NNID), t->bgnlistlen);
+    }
+    rdn_wordid_arr(t->num, fp, t->bgnlistlen);
+    rdn_wordid_arr(t->nnid2wid, fp, t->totalnum);
+  }
+  return TRUE;
+}
+
 /** 
  * Check header to see whether the version matches.
  * 
@@ -162,6 +363,18 @@ check_header(FILE *fp)
     /* bingram file made by JuliusLib-4 and later */
     file_version = 5;
     p += strlen(BINGRAM_IDSTR_V5) + 1;
+  } else if (strnmatch(p, BINGRAM_IDSTR_V6, strlen(BINGRAM_IDSTR_V6))) {
+    /* bingram file for memory mapping, made by mkbingram -mmap */
+    file_version = 6;
+    p += strlen(BINGRAM_IDSTR_V6) + 1;
+  } else if (strnmatch(p, BINGRAM_IDSTR_V7, strlen(BINGRAM_IDSTR_V7))) {
+    /* bingram file with quantized probabilities, made by mkbingram -quantize */
+    file_version = 7;
+    p += strlen(BINGRAM_IDSTR_V7) + 1;
+  } else if (strnmatch(p, BINGRAM_IDSTR_V8, strlen(BINGRAM_IDSTR_V8))) {
+    /* bingram file with succinct tuple index, made by mkbingram -pack */
+    file_version = 8;
+    p += strlen(BINGRAM_IDSTR_V8) + 1;
   } else {
     /* not a bingram file */
     jlog("Error: ngram_read_bin: invalid header\n");
@@ -236,6 +449,17 @@ check_header(FILE *fp)
   return TRUE;
 }
 
+/** 
+ * Read N-gram body of v5 and later.  On v6 and later, each array section
+ * is aligned to BINGRAM_SECTION_ALIGN bytes from the top of file.  On v7,
+ * the probabilities and back-off weights may be quantized.  On v8, the
+ * tuple index may be in succinct form.
+ * 
+ * @param fp [in] file pointer
+ * @param ndata [out] N-gram data to store the read data
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
 static boolean
 ngram_read_bin_v5(FILE *fp, NGRAM_INFO *ndata)
 {
@@ -263,8 +487,7 @@ ngram_read_bin_v5(FILE *fp, NGRAM_INFO *ndata)
 
   /* read wname */
   rdn(fp, &len, sizeof(int), 1);
-  w = mymalloc(len);
-  rdn(fp, w, 1, len);
+  rdn_arr(w, fp, 1, len);
   /* assign... */
   ndata->wname = (char **)mymalloc(sizeof(char *) * ndata->max_word_num);
   ndata->wname[0] = NULL;
@@ -291,27 +514,7 @@ ngram_read_bin_v5(FILE *fp, NGRAM_INFO *ndata)
     rdn(fp, &(t->context_num), sizeof(NNID), 1);
 
     if (n > 0) {
-      if (t->is24bit) {
-	t->bgn_upper = (NNID_UPPER *)mymalloc_big(sizeof(NNID_UPPER), t->bgnlistlen);
-	rdn(fp, t->bgn_upper, sizeof(NNID_UPPER), t->bgnlistlen);
-	t->bgn_lower = (NNID_LOWER *)mymalloc_big(sizeof(NNID_LOWER), t->bgnlistlen);
-	rdn(fp, t->bgn_lower, sizeof(NNID_LOWER), t->bgnlistlen);
-      } else {
-	t->bgn = (NNID *)mymalloc_big(sizeof(NNID), t->bgnlistlen);
-	rdn(fp, t->bgn, sizeof(NNID), t->bgnlistlen);
-      }
-      t->num = (WORD_ID *)mymalloc_big(sizeof(WORD_ID), t->bgnlistlen);
-#ifdef WORDS_INT
-      rdn_wordid(fp, t->num, t->bgnlistlen, need_conv);
-#else
-      rdn(fp, t->num, sizeof(WORD_ID), t->bgnlistlen);
-#endif
-      t->nnid2wid = (WORD_ID *)mymalloc_big(sizeof(WORD_ID), t->totalnum);
-#ifdef WORDS_INT
-      rdn_wordid(fp, t->nnid2wid, t->totalnum, need_conv);
-#else
-      rdn(fp, t->nnid2wid, sizeof(WORD_ID), t->totalnum);
-#endif
+      if (rdn_index(fp, t) == FALSE) return FALSE;
     } else {
       t->bgn_upper = NULL;
       t->bgn_lower = NULL;
@@ -321,22 +524,18 @@ ngram_read_bin_v5(FILE *fp, NGRAM_INFO *ndata)
       t->nnid2wid = NULL;
     }
 
-    t->prob = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), t->totalnum);
-    rdn(fp, t->prob, sizeof(LOGPROB), t->totalnum);
+    rdn_prob_arr(fp, t->totalnum, &(t->prob), &(t->prob_cb), &(t->prob_q));
 
     rdn(fp, &i, sizeof(int), 1);
     if (i == 1) {
-      t->bo_wt = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), t->context_num);
-      rdn(fp, t->bo_wt, sizeof(LOGPROB), t->context_num);
+      rdn_prob_arr(fp, t->context_num, &(t->bo_wt), &(t->bo_wt_cb), &(t->bo_wt_q));
     } else {
       t->bo_wt = NULL;
     }
     rdn(fp, &i, sizeof(int), 1);
     if (i == 1) {
-      t->nnid2ctid_upper = (NNID_UPPER *)mymalloc_big(sizeof(NNID_UPPER), t->totalnum);
-      t->nnid2ctid_lower = (NNID_LOWER *)mymalloc_big(sizeof(NNID_LOWER), t->totalnum);
-      rdn(fp, t->nnid2ctid_upper, sizeof(NNID_UPPER), t->totalnum);
-      rdn(fp, t->nnid2ctid_lower, sizeof(NNID_LOWER), t->totalnum);
+      rdn_arr(t->nnid2ctid_upper, fp, sizeof(NNID_UPPER), t->totalnum);
+      rdn_arr(t->nnid2ctid_lower, fp, sizeof(NNID_LOWER), t->totalnum);
     } else {
       t->nnid2ctid_upper = NULL;
       t->nnid2ctid_lower = NULL;
@@ -344,16 +543,14 @@ ngram_read_bin_v5(FILE *fp, NGRAM_INFO *ndata)
   }
   rdn(fp, &i, sizeof(int), 1);
   if (i == 1) {
-    ndata->bo_wt_1 = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), ndata->d[0].context_num);
-    rdn(fp, ndata->bo_wt_1, sizeof(LOGPROB), ndata->d[0].context_num);
+    rdn_arr(ndata->bo_wt_1, fp, sizeof(LOGPROB), ndata->d[0].context_num);
   } else {
     ndata->bo_wt_1 = NULL;
   }
   rdn(fp, &i, sizeof(int), 1);
   if (i == 1) {
     jlog("Stat: ngram_read_bin_v5: reading additional LR 2-gram\n");
-    ndata->p_2 = (LOGPROB *)mymalloc_big(sizeof(LOGPROB), ndata->d[1].totalnum);
-    rdn(fp, ndata->p_2, sizeof(LOGPROB), ndata->d[1].totalnum);
+    rdn_prob_arr(fp, ndata->d[1].totalnum, &(ndata->p_2), &(ndata->p_2_cb), &(ndata->p_2_q));
   } else {
     ndata->p_2 = NULL;
   }
@@ -613,6 +810,7 @@ ngram_read_bin(FILE *fp, NGRAM_INFO *ndata)
 #endif
   
   ndata->from_bin = TRUE;
+  rdcount = 0;
 
   /* check initial header */
   if (check_header(fp) == FALSE) return FALSE;
@@ -655,3 +853,120 @@ ngram_read_bin(FILE *fp, NGRAM_INFO *ndata)
   return TRUE;
 }
 
+/** 
+ * Check whether a binary N-gram file can be directly mapped to memory.
+ * It should be a v6 or later bingram with the same word ID size and byte
+ * order as the running machine, and not compressed.
+ * 
+ * @param filename [in] file name of the binary N-gram
+ * 
+ * @return TRUE if the file can be mapped, FALSE if not.
+ */
+boolean
+ngram_bin_mappable(char *filename)
+{
+#ifdef HAVE_MMAP
+  FILE *fp;
+  char buf[BINGRAM_HDSIZE], str[BINGRAM_HDSIZE];
+
+  if ((fp = fopen(filename, "rb")) == NULL) return FALSE;
+  if (fread(buf, 1, BINGRAM_HDSIZE, fp) < BINGRAM_HDSIZE) {
+    fclose(fp);
+    return FALSE;
+  }
+  fclose(fp);
+  sprintf(str, "%s\n%s%s %s%s\n", BINGRAM_IDSTR_V6, BINGRAM_SIZESTR_HEAD, BINGRAM_SIZESTR_BODY, BINGRAM_BYTEORDER_HEAD, BINGRAM_NATURAL_BYTEORDER);
+  if (strnmatch(buf, str, strlen(str))) return TRUE;
+  sprintf(str, "%s\n%s%s %s%s\n", BINGRAM_IDSTR_V7, BINGRAM_SIZESTR_HEAD, BINGRAM_SIZESTR_BODY, BINGRAM_BYTEORDER_HEAD, BINGRAM_NATURAL_BYTEORDER);
+  if (strnmatch(buf, str, strlen(str))) return TRUE;
+  sprintf(str, "%s\n%s%s %s%s\n", BINGRAM_IDSTR_V8, BINGRAM_SIZESTR_HEAD, BINGRAM_SIZESTR_BODY, BINGRAM_BYTEORDER_HEAD, BINGRAM_NATURAL_BYTEORDER);
+  if (strnmatch(buf, str, strlen(str))) return TRUE;
+#endif
+  return FALSE;
+}
+
+/** 
+ * Map a binary N-gram file to memory and set up N-gram data on it.
+ * The arrays in the N-gram data directly point to the mapped area,
+ * so processes that map the same file share one physical copy of it.
+ * The file is mapped privately, so modification to the data will not
+ * be written back to the file.  The file should be checked by
+ * ngram_bin_mappable() beforehand.
+ * 
+ * @param filename [in] file name of the binary N-gram
+ * @param ndata [out] N-gram data to store the read data
+ * 
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+ngram_read_bin_mmap(char *filename, NGRAM_INFO *ndata)
+{
+#ifdef HAVE_MMAP
+  int fd;
+  struct stat st;
+  void *p;
+  boolean ret;
+
+  if ((fd = open(filename, O_RDONLY)) < 0) {
+    jlog("Error: ngram_read_bin_mmap: failed to open \"%s\"\n", filename);
+    return FALSE;
+  }
+  if (fstat(fd, &st) < 0) {
+    jlog("Error: ngram_read_bin_mmap: failed to stat \"%s\"\n", filename);
+    close(fd);
+    return FALSE;
+  }
+  p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    jlog("Error: ngram_read_bin_mmap: failed to map \"%s\"\n", filename);
+    return FALSE;
+  }
+
+  /* the mapped area will be released at ngram_info_free() */
+  ndata->mmap_base = p;
+  ndata->mmap_len = st.st_size;
+
+  ndata->from_bin = TRUE;
+  map_base = p;
+  map_len = st.st_size;
+  rdcount = 0;
+#ifdef WORDS_INT
+  words_int_retry = FALSE;
+#endif
+  ret = check_header(NULL);
+  if (ret == TRUE) {
+    jlog("Stat: ngram_read_bin_mmap: file version: %d\n", file_version);
+    if (file_version < 6 || need_swap
+#ifdef WORDS_INT
+	|| need_conv
+#endif
+	) {
+      jlog("Error: ngram_read_bin_mmap: not a mappable bingram\n");
+      ret = FALSE;
+    }
+  }
+  if (ret == TRUE) {
+    ret = ngram_read_bin_v5(NULL, ndata);
+  }
+  map_base = NULL;
+  if (ret == FALSE) {
+    /* release the partly set up data and the mapped area */
+    ngram_info_unmap(ndata);
+    return FALSE;
+  }
+  jlog("Stat: ngram_read_bin_mmap: mapped %lu bytes (%.1f MB)\n", (unsigned long)ndata->mmap_len, ndata->mmap_len / 1048576.0);
+
+  /* make word search tree for later lookup */
+  jlog("Stat: ngram_read_bin_mmap: making entry name index\n");
+  ngram_make_lookup_tree(ndata);
+
+  bi_prob_func_set(ndata);
+
+  return TRUE;
+#else
+  jlog("Error: ngram_read_bin_mmap: memory mapping is not supported on this system\n");
+  return FALSE;
+#endif
+}
+
@@ -0,0 +1,392 @@
+/**
+ * @file   ngram_succinct.c
+ *
+ * <JA>
+ * @brief  N-gram ץ륤ǥåδʷɽ
+ *
+ * 2-gram ʾγ N-gram ˤĤơʸ̮ȤΥץ볫ϰ (bgn) 
+ * ץ (num) ñĴȤ Elias-Fano ɽ롥
+ * ޤƥץñID (nnid2wid) å˱ӥå
+ * ͤƳǼ롥 mkbingram Ǻ졤v8 
+ * Хʥ N-gram ¸롥õ ngram_ef_range() 
+ * NGRAM_WID() ǸͤФ
+ * </JA>
+ *
+ * <EN>
+ * @brief  Succinct representation of N-gram tuple index
+ *
+ * For each N-gram of 2-gram and up, the beginning tuple ID (bgn) and
+ * the number of tuples (num) of each context are coded together as
+ * a monotone sequence by Elias-Fano coding.  The word IDs of tuples
+ * (nnid2wid) are also bit-packed with the width required for the
+ * vocabulary.  They are made by mkbingram and saved in v8 binary N-gram.
+ * On search, the original values are extracted by ngram_ef_range() and
+ * NGRAM_WID().
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <sent/stddefs.h>
+#include <sent/ngram2.h>
+
+/** 
+ * Count number of 1 bits in a word.
+ *
+ * @param x [in] word
+ *
+ * @return the number of 1 bits.
+ */
+static int
+bit_count(unsigned int x)
+{
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f;
+  return((x * 0x01010101) >> 24);
+}
+
+/** 
+ * Get position of the lowest 1 bit in a word.
+ *
+ * @param x [in] word, should not be 0
+ *
+ * @return the bit position from 0 to 31.
+ */
+static int
+bit_lowest(unsigned int x)
+{
+  static const int tbl[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+  };
+  return(tbl[((x & (~x + 1)) * 0x077cb531) >> 27]);
+}
+
+/** 
+ * Get the location of an entry in a bit-packed array.  Since 32 entries
+ * of width w occupy just w words, the location can be computed without
+ * overflow of the bit position.
+ *
+ * @param b [in] bit-packed array
+ * @param id [in] entry index
+ * @param off_ret [out] bit offset in the word
+ *
+ * @return the word index.
+ */
+static NNID
+bitarray_loc(NGRAM_BITARRAY *b, NNID id, int *off_ret)
+{
+  NNID x;
+
+  x = (id & 31) * b->width;
+  *off_ret = x & 31;
+  return((id >> 5) * b->width + (x >> 5));
+}
+
+/** 
+ * Allocate a bit-packed array.
+ *
+ * @param b [out] bit-packed array to set up
+ * @param width [in] bit width of an entry
+ * @param num [in] number of entries
+ */
+static void
+bitarray_alloc(NGRAM_BITARRAY *b, int width, NNID num)
+{
+  b->width = width;
+  b->len = ((num + 31) / 32) * width + 1;
+  b->body = (unsigned int *)mymalloc_big(sizeof(unsigned int), b->len);
+  memset(b->body, 0, sizeof(unsigned int) * b->len);
+}
+
+/** 
+ * Store a value to a bit-packed array.
+ *
+ * @param b [i/o] bit-packed array
+ * @param id [in] entry index
+ * @param v [in] value, should be within the bit width
+ */
+static void
+bitarray_set(NGRAM_BITARRAY *b, NNID id, unsigned int v)
+{
+  NNID i;
+  int off;
+
+  if (b->width == 0) return;
+  i = bitarray_loc(b, id, &off);
+  b->body[i] |= v << off;
+  if (off + b->width > 32) b->body[i+1] |= v >> (32 - off);
+}
+
+/** 
+ * Get a value from a bit-packed array.
+ *
+ * @param b [in] bit-packed array
+ * @param id [in] entry index
+ *
+ * @return the value.
+ */
+unsigned int
+ngram_bitarray_get(NGRAM_BITARRAY *b, NNID id)
+{
+  NNID i;
+  int off;
+  unsigned int v;
+
+  if (b->width == 0) return 0;
+  i = bitarray_loc(b, id, &off);
+  v = b->body[i] >> off;
+  if (off + b->width > 32) v |= b->body[i+1] << (32 - off);
+  if (b->width < 32) v &= (1U << b->width) - 1;
+  return v;
+}
+
+/** 
+ * Find the position of the i-th 1 bit in the upper bits of Elias-Fano
+ * sequence, starting from the sampled position.
+ *
+ * @param ef [in] Elias-Fano sequence
+ * @param id [in] rank of the 1 bit to find (from 0)
+ *
+ * @return the bit position.
+ */
+static NNID
+ef_select(NGRAM_EF *ef, NNID id)
+{
+  NNID pos, i;
+  int r, c;
+  unsigned int x;
+
+  pos = ef->sample[id >> ef->sampleshift];
+  r = id & ((1 << ef->sampleshift) - 1);
+  i = pos >> 5;
+  x = ef->high[i] & (0xffffffff << (pos & 31));
+  while (r >= (c = bit_count(x))) {
+    r -= c;
+    x = ef->high[++i];
+  }
+  while (r-- > 0) x &= x - 1;
+  return((i << 5) + bit_lowest(x));
+}
+
+/** 
+ * Find the position of the next 1 bit in the upper bits of Elias-Fano
+ * sequence.
+ *
+ * @param ef [in] Elias-Fano sequence
+ * @param pos [in] current bit position
+ *
+ * @return the bit position of the next 1 bit after @a pos.
+ */
+static NNID
+ef_next(NGRAM_EF *ef, NNID pos)
+{
+  NNID i;
+  unsigned int x;
+
+  pos++;
+  i = pos >> 5;
+  x = ef->high[i] & (0xffffffff << (pos & 31));
+  while (x == 0) x = ef->high[++i];
+  return((i << 5) + bit_lowest(x));
+}
+
+/** 
+ * Get the tuple range of a context from Elias-Fano coded index.  The
+ * sequence holds the beginning tuple ID of each context, and one more
+ * value at the end for the total number of tuples, so the range of
+ * a context is given by the difference of two adjacent values.
+ *
+ * @param ef [in] Elias-Fano coded beginning IDs
+ * @param id [in] context ID
+ * @param bgn [out] beginning tuple ID of the context
+ * @param num [out] number of tuples of the context
+ *
+ * @return TRUE if the context has tuples, or FALSE if not.
+ */
+boolean
+ngram_ef_range(NGRAM_EF *ef, NNID id, NNID *bgn, NNID *num)
+{
+  NNID pos, x;
+
+  pos = ef_select(ef, id);
+  x = ((pos - id) << ef->lowbit) | ngram_bitarray_get(&(ef->low), id);
+  *bgn = x;
+  pos = ef_next(ef, pos);
+  x = ((pos - id - 1) << ef->lowbit) | ngram_bitarray_get(&(ef->low), id + 1);
+  *num = x - *bgn;
+  return(*num > 0 ? TRUE : FALSE);
+}
+
+/** 
+ * Encode a monotone non-decreasing sequence by Elias-Fano coding.
+ *
+ * @param x [in] values
+ * @param num [in] number of values
+ *
+ * @return newly allocated Elias-Fano sequence, or NULL if it cannot be
+ * encoded within the range of NNID.
+ */
+static NGRAM_EF *
+ef_new(NNID *x, NNID num)
+{
+  NGRAM_EF *ef;
+  NNID i, u, highbits, pos;
+
+  u = x[num-1];
+  ef = (NGRAM_EF *)mymalloc(sizeof(NGRAM_EF));
+  ef->num = num;
+  ef->lowbit = 0;
+  while (ef->lowbit < 31 && (u >> (ef->lowbit + 1)) >= num) ef->lowbit++;
+  if ((u >> ef->lowbit) >= NNID_MAX - num) {
+    free(ef);
+    return NULL;
+  }
+  highbits = (u >> ef->lowbit) + num;
+  ef->highlen = highbits / 32 + 1;
+  ef->high = (unsigned int *)mymalloc_big(sizeof(unsigned int), ef->highlen);
+  memset(ef->high, 0, sizeof(unsigned int) * ef->highlen);
+  ef->sampleshift = NGRAM_EF_SAMPLE_SHIFT;
+  ef->samplenum = ((num - 1) >> ef->sampleshift) + 1;
+  ef->sample = (NNID *)mymalloc_big(sizeof(NNID), ef->samplenum);
+  bitarray_alloc(&(ef->low), ef->lowbit, num);
+
+  for(i=0;i<num;i++) {
+    pos = (x[i] >> ef->lowbit) + i;
+    ef->high[pos >> 5] |= 1U << (pos & 31);
+    if ((i & ((1 << ef->sampleshift) - 1)) == 0) ef->sample[i >> ef->sampleshift] = pos;
+    if (ef->lowbit > 0) bitarray_set(&(ef->low), i, x[i] & ((1U << ef->lowbit) - 1));
+  }
+
+  return ef;
+}
+
+/** 
+ * Convert tuple index of an m-gram to succinct form.
+ *
+ * @param ndata [i/o] N-gram data
+ * @param n [in] N-gram order to convert (2 <= n <= N)
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+pack_tuple(NGRAM_INFO *ndata, int n)
+{
+  NGRAM_TUPLE_INFO *t;
+  NNID *x;
+  NNID i, bgn, running;
+  WORD_ID maxwid;
+  int width;
+
+  t = &(ndata->d[n-1]);
+
+  /* set beginning ID of each context, and the total at the end */
+  x = (NNID *)mymalloc_big(sizeof(NNID), t->bgnlistlen + 1);
+  running = 0;
+  for(i=0;i<t->bgnlistlen;i++) {
+    x[i] = running;
+    if (t->is24bit) {
+      if (t->bgn_upper[i] == NNID_INVALID_UPPER) continue;
+      bgn = ((NNID)t->bgn_upper[i] << 16) + (NNID)t->bgn_lower[i];
+    } else {
+      if (t->bgn[i] == NNID_INVALID) continue;
+      bgn = t->bgn[i];
+    }
+    if (bgn != running) {
+      jlog("Error: ngram_pack_index: %d-gram tuples are not ordered by context\n", n);
+      free(x);
+      return FALSE;
+    }
+    running += t->num[i];
+  }
+  x[t->bgnlistlen] = running;
+  if (running != t->totalnum) {
+    jlog("Error: ngram_pack_index: %d-gram index does not cover all tuples (%u != %u)\n", n, running, t->totalnum);
+    free(x);
+    return FALSE;
+  }
+  if ((t->bgn_ef = ef_new(x, t->bgnlistlen + 1)) == NULL) {
+    jlog("Error: ngram_pack_index: %d-gram index too large\n", n);
+    free(x);
+    return FALSE;
+  }
+  free(x);
+
+  /* bit-pack word IDs */
+  maxwid = 0;
+  for(i=0;i<t->totalnum;i++) {
+    if (maxwid < t->nnid2wid[i]) maxwid = t->nnid2wid[i];
+  }
+  width = 0;
+  while (width < 32 && ((unsigned int)maxwid >> width) != 0) width++;
+  t->nnid2wid_packed = (NGRAM_BITARRAY *)mymalloc(sizeof(NGRAM_BITARRAY));
+  bitarray_alloc(t->nnid2wid_packed, width, t->totalnum);
+  for(i=0;i<t->totalnum;i++) {
+    bitarray_set(t->nnid2wid_packed, i, t->nnid2wid[i]);
+  }
+
+  jlog("Stat: ngram_pack_index: %d-gram: %d+%d bits/context, %d bits/word\n", n, t->bgn_ef->lowbit, 2, width);
+
+  /* release the original index, unless it is on a mapped file */
+  if (ndata->mmap_base == NULL) {
+    if (t->bgn_upper) free(t->bgn_upper);
+    if (t->bgn_lower) free(t->bgn_lower);
+    if (t->bgn) free(t->bgn);
+    free(t->num);
+    free(t->nnid2wid);
+  }
+  t->bgn_upper = NULL;
+  t->bgn_lower = NULL;
+  t->bgn = NULL;
+  t->num = NULL;
+  t->nnid2wid = NULL;
+
+  return TRUE;
+}
+
+/** 
+ * Convert tuple index of 2-gram and up to succinct form: the beginning
+ * IDs and numbers of tuples are coded by Elias-Fano coding, and the word
+ * IDs are bit-packed.
+ *
+ * @param ndata [i/o] N-gram data
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+boolean
+ngram_pack_index(NGRAM_INFO *ndata)
+{
+  int n;
+
+  for(n=2;n<=ndata->n;n++) {
+    if (ndata->d[n-1].bgn_ef != NULL) continue;
+    if (pack_tuple(ndata, n) == FALSE) return FALSE;
+  }
+  return TRUE;
+}
+
+/** 
+ * Check if the N-gram data has succinct tuple index.
+ *
+ * @param ndata [in] N-gram data
+ *
+ * @return TRUE if packed, FALSE if not.
+ */
+boolean
+ngram_is_packed(NGRAM_INFO *ndata)
+{
+  int n;
+
+  for(n=0;n<ndata->n;n++) {
+    if (ndata->d[n].bgn_ef) return TRUE;
+  }
+  return FALSE;
+}
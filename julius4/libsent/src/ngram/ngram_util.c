@@ -39,7 +39,11 @@ get_ngram_tuple_bytes(NGRAM_TUPLE_INFO *t)
   unsigned int size, unit;
 
   size = 0;
-  if (t->num != NULL) {		/* other than 1-gram */
+  if (t->bgn_ef != NULL) {	/* succinct index */
+    size += sizeof(unsigned int) * (t->bgn_ef->low.len + t->bgn_ef->highlen);
+    size += sizeof(NNID) * t->bgn_ef->samplenum;
+    size += sizeof(unsigned int) * t->nnid2wid_packed->len;
+  } else if (t->num != NULL) {	/* other than 1-gram */
     /* bgn */
     if (t->is24bit) {
       unit = sizeof(NNID_UPPER) + sizeof(NNID_LOWER);
@@ -51,19 +55,28 @@ get_ngram_tuple_bytes(NGRAM_TUPLE_INFO *t)
     size += unit * t->bgnlistlen;
   }
   /* prob */
-  unit = sizeof(LOGPROB);
+  if (t->prob_q) {
+    unit = sizeof(NGRAM_QUANT);
+    size += sizeof(LOGPROB) * NGRAM_QUANT_LEVELS;
+  } else {
+    unit = sizeof(LOGPROB);
+  }
   /* nnid2wid */
   if (t->nnid2wid) unit += sizeof(WORD_ID);
   size += unit * t->totalnum;
 
-  if (t->bo_wt) {
+  if (t->bo_wt || t->bo_wt_q) {
     if (t->ct_compaction) {
       /* nnid2ctid */
       unit = sizeof(NNID_UPPER) + sizeof(NNID_LOWER);
       size += unit * t->totalnum;
     }
     /* bo_wt */
-    size += sizeof(LOGPROB) * t->context_num;
+    if (t->bo_wt_q) {
+      size += sizeof(NGRAM_QUANT) * t->context_num + sizeof(LOGPROB) * NGRAM_QUANT_LEVELS;
+    } else {
+      size += sizeof(LOGPROB) * t->context_num;
+    }
   }
 
   return size;
@@ -99,15 +112,25 @@ print_ngram_info(FILE *fp, NGRAM_INFO *ndata)
   fprintf(fp, "\t    wordset size = %d\n", ndata->max_word_num);
   for(i=0;i<ndata->n;i++) {
     fprintf(fp, "\t  %d-gram entries = %10lu  (%5.1f MB)", i+1, (long unsigned int)ndata->d[i].totalnum, get_ngram_tuple_bytes(&(ndata->d[i])) / 1048576.0);
-    if (ndata->d[i].bo_wt != NULL && ndata->d[i].totalnum != ndata->d[i].context_num) {
+    if ((ndata->d[i].bo_wt != NULL || ndata->d[i].bo_wt_q != NULL) && ndata->d[i].totalnum != ndata->d[i].context_num) {
       fprintf(fp, " (%d%% are valid contexts)", ndata->d[i].context_num * 100 / ndata->d[i].totalnum);
     }
+    if (ndata->d[i].prob_q != NULL || ndata->d[i].bo_wt_q != NULL) {
+      fprintf(fp, " (quantized)");
+    }
+    if (ndata->d[i].bgn_ef != NULL) {
+      fprintf(fp, " (packed)");
+    }
     fprintf(fp, "\n");
   }
 
   if (ndata->bo_wt_1) {
-    fprintf(fp, "\tLR 2-gram entries= %10lu  (%5.1f MB)\n", (long unsigned int)ndata->d[1].totalnum,
-	    (sizeof(LOGPROB) * ndata->d[1].totalnum + sizeof(LOGPROB) * ndata->d[0].context_num) / 1048576.0);
+    fprintf(fp, "\tLR 2-gram entries= %10lu  (%5.1f MB)", (long unsigned int)ndata->d[1].totalnum,
+	    ((ndata->p_2_q ? sizeof(NGRAM_QUANT) : sizeof(LOGPROB)) * ndata->d[1].totalnum + sizeof(LOGPROB) * ndata->d[0].context_num) / 1048576.0);
+    if (ndata->p_2_q) {
+      fprintf(fp, " (quantized)");
+    }
+    fprintf(fp, "\n");
   }
   fprintf(fp, "\t           pass1 = ");
   if (ndata->dir == DIR_RL) {
@@ -54,8 +54,10 @@
 #include <sent/ngram2.h>
 
 static boolean need_swap; ///< TRUE if need byte swap
+static int write_version; ///< Format version to write (5, 6 or 7)
 
 #define wrt(A,B,C,D) if (wrtfunc(A,B,C,D) == FALSE) return FALSE
+#define wrt_arr(A,B,C,D) if (wrt_align(A) == FALSE || wrtfunc(A,B,C,D) == FALSE) return FALSE
 
 static unsigned int count;
 void
@@ -95,28 +97,135 @@ wrtfunc(FILE *fp, void *buf, size_t unitbyte, size_t unitnum)
   return TRUE;
 }
 
+/** 
+ * Write padding bytes until the next section boundary (v6).
+ * 
+ * @param fp [in] file pointer
+ */
+static boolean
+wrt_align(FILE *fp)
+{
+  char buf[BINGRAM_SECTION_ALIGN];
+  unsigned int len;
+
+  if (write_version < 6) return TRUE;
+  len = (BINGRAM_SECTION_ALIGN - count % BINGRAM_SECTION_ALIGN) % BINGRAM_SECTION_ALIGN;
+  if (len > 0) {
+    memset(buf, 0, len);
+    wrt(fp, buf, 1, len);
+  }
+  return TRUE;
+}
+
+/** 
+ * Write an array section of log probabilities.  On v7, a flag is
+ * written first to tell whether the values are quantized, and the
+ * codebook and the quantized values follow if quantized.
+ * 
+ * @param fp [in] file pointer
+ * @param p [in] array of values, or NULL if quantized
+ * @param cb [in] codebook of the quantized values
+ * @param q [in] quantized values, or NULL if not quantized
+ * @param unitnum [in] number of values
+ */
+static boolean
+wrt_prob(FILE *fp, LOGPROB *p, LOGPROB *cb, NGRAM_QUANT *q, size_t unitnum)
+{
+  int i;
+
+  if (write_version >= 7) {
+    i = (q != NULL) ? 1 : 0;
+    wrt(fp, &i, sizeof(int), 1);
+  }
+  if (q != NULL) {
+    wrt_arr(fp, cb, sizeof(LOGPROB), NGRAM_QUANT_LEVELS);
+    wrt_arr(fp, q, sizeof(NGRAM_QUANT), unitnum);
+  } else {
+    wrt_arr(fp, p, sizeof(LOGPROB), unitnum);
+  }
+  return TRUE;
+}
+#define wrt_prob_arr(A,B,C,D,E) if (wrt_prob(A,B,C,D,E) == FALSE) return FALSE
+
+/** 
+ * Write a bit-packed array (v8).
+ * 
+ * @param fp [in] file pointer
+ * @param b [in] bit-packed array
+ */
+static boolean
+wrt_bitarray(FILE *fp, NGRAM_BITARRAY *b)
+{
+  wrt(fp, &(b->width), sizeof(int), 1);
+  wrt(fp, &(b->len), sizeof(NNID), 1);
+  wrt_arr(fp, b->body, sizeof(unsigned int), b->len);
+  return TRUE;
+}
+
+/** 
+ * Write tuple index of an m-gram.  On v8, a flag is written first to
+ * tell whether the index is in succinct form, and the Elias-Fano coded
+ * beginning IDs and the bit-packed word IDs follow if so.
+ * 
+ * @param fp [in] file pointer
+ * @param t [in] m-gram tuple data
+ */
+static boolean
+wrt_index(FILE *fp, NGRAM_TUPLE_INFO *t)
+{
+  int i;
+  NGRAM_EF *ef;
+
+  if (write_version >= 8) {
+    i = (t->bgn_ef != NULL) ? 1 : 0;
+    wrt(fp, &i, sizeof(int), 1);
+  }
+  if (t->bgn_ef != NULL) {
+    ef = t->bgn_ef;
+    wrt(fp, &(ef->num), sizeof(NNID), 1);
+    wrt(fp, &(ef->lowbit), sizeof(int), 1);
+    if (wrt_bitarray(fp, &(ef->low)) == FALSE) return FALSE;
+    wrt(fp, &(ef->highlen), sizeof(NNID), 1);
+    wrt_arr(fp, ef->high, sizeof(unsigned int), ef->highlen);
+    wrt(fp, &(ef->sampleshift), sizeof(int), 1);
+    wrt(fp, &(ef->samplenum), sizeof(NNID), 1);
+    wrt_arr(fp, ef->sample, sizeof(NNID), ef->samplenum);
+    if (wrt_bitarray(fp, t->nnid2wid_packed) == FALSE) return FALSE;
+  } else {
+    if (t->is24bit) {
+      wrt_arr(fp, t->bgn_upper, sizeof(NNID_UPPER), t->bgnlistlen);
+      wrt_arr(fp, t->bgn_lower, sizeof(NNID_LOWER), t->bgnlistlen);
+    } else {
+      wrt_arr(fp, t->bgn, sizeof(NNID), t->bgnlistlen);
+    }
+    wrt_arr(fp, t->num, sizeof(WORD_ID), t->bgnlistlen);
+    wrt_arr(fp, t->nnid2wid, sizeof(WORD_ID), t->totalnum);
+  }
+  return TRUE;
+}
+
 /** 
  * Write header information, with identifier string.
  * 
  * @param fp [in] file pointer
  * @param str [in] user header string (any string within BINGRAM_HDSIZE
  * bytes is allowed)
- * @param version [in] file format version id
+ * @param idstr [in] file format version id string
  */
 static boolean
-write_header(FILE *fp, char *str)
+write_header(FILE *fp, char *str, char *idstr)
 {
   char buf[BINGRAM_HDSIZE];
   int i, totallen;
 
   for(i=0;i<BINGRAM_HDSIZE;i++) buf[i] = EOF;
-  totallen = strlen(BINGRAM_IDSTR_V5) + 1 + strlen(BINGRAM_SIZESTR_HEAD) + strlen(BINGRAM_SIZESTR_BODY) + 1 + strlen(BINGRAM_BYTEORDER_HEAD) + strlen(BINGRAM_NATURAL_BYTEORDER) + 1 + strlen(str);
+  totallen = strlen(idstr) + 1 + strlen(BINGRAM_SIZESTR_HEAD) + strlen(BINGRAM_SIZESTR_BODY) + 1 + strlen(BINGRAM_BYTEORDER_HEAD) + strlen(BINGRAM_NATURAL_BYTEORDER) + 1 + strlen(str);
   if (totallen >= BINGRAM_HDSIZE) {
     jlog("Warning: write_bingram: header too long, last will be truncated\n");
     i = strlen(str) - (totallen - BINGRAM_HDSIZE);
     str[i] = '\0';
   }
-  sprintf(buf, "%s\n%s%s %s%s\n%s", BINGRAM_IDSTR_V5, BINGRAM_SIZESTR_HEAD, BINGRAM_SIZESTR_BODY, BINGRAM_BYTEORDER_HEAD, BINGRAM_NATURAL_BYTEORDER, str);
+  sprintf(buf, "%s\n%s%s %s%s\n%s", idstr, BINGRAM_SIZESTR_HEAD, BINGRAM_SIZESTR_BODY, BINGRAM_BYTEORDER_HEAD, BINGRAM_NATURAL_BYTEORDER, str);
   wrt(fp, buf, 1, BINGRAM_HDSIZE);
 
   return TRUE;
@@ -128,11 +237,12 @@ write_header(FILE *fp, char *str)
  * @param fp [in] file pointer
  * @param ndata [in] N-gram data to write
  * @param headerstr [in] user header string
+ * @param version [in] format version to write (5 to 8)
  * 
  * @return TRUE on success, FALSE on failure
  */
-boolean
-ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
+static boolean
+write_ngram_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr, int version)
 {
   int i,n;
   unsigned int len;
@@ -142,7 +252,21 @@ ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
   reset_wrt_counter();
 
   /* write initial header */
-  if (write_header(fp, headerstr) == FALSE) return FALSE;
+  write_version = version;
+  switch(version) {
+  case 5:
+    if (write_header(fp, headerstr, BINGRAM_IDSTR_V5) == FALSE) return FALSE;
+    break;
+  case 6:
+    if (write_header(fp, headerstr, BINGRAM_IDSTR_V6) == FALSE) return FALSE;
+    break;
+  case 7:
+    if (write_header(fp, headerstr, BINGRAM_IDSTR_V7) == FALSE) return FALSE;
+    break;
+  case 8:
+    if (write_header(fp, headerstr, BINGRAM_IDSTR_V8) == FALSE) return FALSE;
+    break;
+  }
 
   /* swap not needed any more */
   need_swap = FALSE;
@@ -166,6 +290,7 @@ ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
     wlen += strlen(ndata->wname[i]) + 1;
   }
   wrt(fp, &wlen, sizeof(int), 1);
+  if (wrt_align(fp) == FALSE) return FALSE;
   for(i=0;i<ndata->max_word_num;i++) {
     wrt(fp, ndata->wname[i], 1, strlen(ndata->wname[i]) + 1); /* include \0 */
   }
@@ -179,20 +304,13 @@ ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
     wrt(fp, &(t->bgnlistlen), sizeof(NNID), 1);
     wrt(fp, &(t->context_num), sizeof(NNID), 1);
     if (n > 0) {
-      if (t->is24bit) {
-	wrt(fp, t->bgn_upper, sizeof(NNID_UPPER), t->bgnlistlen);
-	wrt(fp, t->bgn_lower, sizeof(NNID_LOWER), t->bgnlistlen);
-      } else {
-	wrt(fp, t->bgn, sizeof(NNID), t->bgnlistlen);
-      }
-      wrt(fp, t->num, sizeof(WORD_ID), t->bgnlistlen);
-      wrt(fp, t->nnid2wid, sizeof(WORD_ID), t->totalnum);
+      if (wrt_index(fp, t) == FALSE) return FALSE;
     }
-    wrt(fp, t->prob, sizeof(LOGPROB), t->totalnum);
-    if (t->bo_wt) {
+    wrt_prob_arr(fp, t->prob, t->prob_cb, t->prob_q, t->totalnum);
+    if (t->bo_wt || t->bo_wt_q) {
       i = 1;
       wrt(fp, &i, sizeof(int), 1);
-      wrt(fp, t->bo_wt, sizeof(LOGPROB), t->context_num);
+      wrt_prob_arr(fp, t->bo_wt, t->bo_wt_cb, t->bo_wt_q, t->context_num);
     } else {
       i = 0;
       wrt(fp, &i, sizeof(int), 1);
@@ -200,8 +318,8 @@ ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
     if (t->nnid2ctid_upper) {
       i = 1;
       wrt(fp, &i, sizeof(int), 1);
-      wrt(fp, t->nnid2ctid_upper, sizeof(NNID_UPPER), t->totalnum);
-      wrt(fp, t->nnid2ctid_lower, sizeof(NNID_LOWER), t->totalnum);
+      wrt_arr(fp, t->nnid2ctid_upper, sizeof(NNID_UPPER), t->totalnum);
+      wrt_arr(fp, t->nnid2ctid_lower, sizeof(NNID_LOWER), t->totalnum);
     } else {
       i = 0;
       wrt(fp, &i, sizeof(int), 1);
@@ -213,15 +331,15 @@ ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
   if (ndata->bo_wt_1) {
     i = 1;
     wrt(fp, &i, sizeof(int), 1);
-    wrt(fp, ndata->bo_wt_1, sizeof(LOGPROB), ndata->d[0].context_num);
+    wrt_arr(fp, ndata->bo_wt_1, sizeof(LOGPROB), ndata->d[0].context_num);
   } else {
     i = 0;
     wrt(fp, &i, sizeof(int), 1);
   }
-  if (ndata->p_2) {
+  if (ndata->p_2 || ndata->p_2_q) {
     i = 1;
     wrt(fp, &i, sizeof(int), 1);
-    wrt(fp, ndata->p_2, sizeof(LOGPROB), ndata->d[1].totalnum);
+    wrt_prob_arr(fp, ndata->p_2, ndata->p_2_cb, ndata->p_2_q, ndata->d[1].totalnum);
   } else {
     i = 0;
     wrt(fp, &i, sizeof(int), 1);
@@ -231,3 +349,57 @@ ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
   jlog("Stat: ngram_write_bin: wrote %lu bytes (%.1f MB)\n", len, len / 1048576.0);
   return TRUE;
 }
+
+/** 
+ * Write a whole N-gram data in binary format (v5).
+ * 
+ * @param fp [in] file pointer
+ * @param ndata [in] N-gram data to write
+ * @param headerstr [in] user header string
+ * 
+ * @return TRUE on success, FALSE on failure
+ */
+boolean
+ngram_write_bin(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
+{
+  if (ngram_is_quantized(ndata)) {
+    jlog("Error: ngram_write_bin: quantized N-gram cannot be written in v5 format\n");
+    return FALSE;
+  }
+  if (ngram_is_packed(ndata)) {
+    jlog("Error: ngram_write_bin: packed N-gram cannot be written in v5 format\n");
+    return FALSE;
+  }
+  return(write_ngram_bin(fp, ndata, headerstr, 5));
+}
+
+/** 
+ * Write a whole N-gram data in binary format for memory mapping (v6).
+ * Each array section is aligned to BINGRAM_SECTION_ALIGN bytes, so
+ * that Julius on the machine of the same byte order and word ID size
+ * can map the file directly to memory without copying.  If the N-gram
+ * has been quantized by ngram_quantize(), it will be written in v7
+ * format, which holds the quantized values and their codebooks.  If the
+ * tuple index has been packed by ngram_pack_index(), it will be written
+ * in v8 format.
+ * 
+ * @param fp [in] file pointer
+ * @param ndata [in] N-gram data to write
+ * @param headerstr [in] user header string
+ * 
+ * @return TRUE on success, FALSE on failure
+ */
+boolean
+ngram_write_bin_mmap(FILE *fp, NGRAM_INFO *ndata, char *headerstr)
+{
+  int version;
+
+  if (ngram_is_packed(ndata)) {
+    version = 8;
+  } else if (ngram_is_quantized(ndata)) {
+    version = 7;
+  } else {
+    version = 6;
+  }
+  return(write_ngram_bin(fp, ndata, headerstr, version));
+}
@@ -24,36 +24,59 @@
 
 #include <sent/stddefs.h>
 #include <sent/hmm.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #define TBLSIZE 500000		///< Table size (precision depends on this)
 #define VRANGE 15               ///< Must be larger than -LOG_ADDMIN
 #define TMAG 33333.3333         ///< TBLSIZE / VRANGE
 
 static LOGPROB tbl[TBLSIZE];    ///< Table of @f$\log (1+e^x)@f$
+#ifdef HAVE_PTHREAD
+static pthread_once_t tbl_once = PTHREAD_ONCE_INIT; ///< To build tbl only once among threads
+#else
 static boolean built_tbl = FALSE;///< TRUE after tbl has built
+#endif
+
+/** 
+ * Fill in the table.
+ * 
+ */
+static void
+build_log_tbl()
+{
+  LOGPROB f;
+  int i;
+
+  jlog("Stat: addlog: generating addlog table (size = %d kB)\n", (TBLSIZE * sizeof(LOGPROB)) / 1024);
+  for (i=0;i<TBLSIZE;i++){
+    f = - ((float)VRANGE * (float)i / (float)TBLSIZE);
+    tbl[i] = log(1 + exp(f));
+    /*if (i < 10 || i > TBLSIZE - 10) j_printf("%f: %d(%f)\n", f, i, tbl[i]);*/
+  }
+  jlog("Stat: addlog: addlog table generated\n");
+}
 
 /** 
  * @brief  Generate a value tables of @f$\log (1+e^x)@f$.
  *
  * @f$x@f$ is from 0 to (- VRANGE), and table size is TBLSIZE.
+ * The table is built only once in a process, and other threads calling
+ * this at the same time wait for it.
  * 
  */
 void
 make_log_tbl()
 {
-  LOGPROB f;
-  int i;
-
+#ifdef HAVE_PTHREAD
+  pthread_once(&tbl_once, build_log_tbl);
+#else
   if (built_tbl == FALSE) {
-    jlog("Stat: addlog: generating addlog table (size = %d kB)\n", (TBLSIZE * sizeof(LOGPROB)) / 1024);
-    for (i=0;i<TBLSIZE;i++){
-      f = - ((float)VRANGE * (float)i / (float)TBLSIZE);
-      tbl[i] = log(1 + exp(f));
-      /*if (i < 10 || i > TBLSIZE - 10) j_printf("%f: %d(%f)\n", f, i, tbl[i]);*/
-    }
-    jlog("Stat: addlog: addlog table generated\n");
+    build_log_tbl();
     built_tbl = TRUE;
   }
+#endif
 }
 
 /** 
@@ -151,8 +151,8 @@ myfrewind(FILE *fp)
 /* use external "gzip" via pipe */
 /* can read only one file at a time */
 
-static boolean isopen = FALSE;	///< TRUE if a file is now opened
-static FILE *zcat_pipe = NULL; ///< File pointer of the gzip pipe 
+static THREAD_LOCAL boolean isopen = FALSE;	///< TRUE if a file is now opened
+static THREAD_LOCAL FILE *zcat_pipe = NULL; ///< File pointer of the gzip pipe 
 
 /** 
  * Guess if the file is compressed or not, only by its filename suffix.
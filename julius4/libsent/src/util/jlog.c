@@ -80,13 +80,14 @@ void
 jlog(char *fmt, ...)
 {
   va_list ap;
+  FILE *fp;
 
-  if (initialized == FALSE) {
-    outdev = stdout;
-  } else if (outdev == NULL) return;
+  /* not write to the global here, since called from multiple threads */
+  fp = (initialized == FALSE) ? stdout : outdev;
+  if (fp == NULL) return;
   
   va_start(ap,fmt);
-  vfprintf(outdev, fmt, ap);
+  vfprintf(fp, fmt, ap);
   va_end(ap);
 
   return;
@@ -102,9 +103,10 @@ jlog(char *fmt, ...)
 int
 jlog_flush()
 {
-  if (initialized == FALSE) {
-    outdev = stdout;
-  } else if (outdev == NULL) return 0;
-  return(fflush(outdev));
+  FILE *fp;
+
+  fp = (initialized == FALSE) ? stdout : outdev;
+  if (fp == NULL) return 0;
+  return(fflush(fp));
 }
 
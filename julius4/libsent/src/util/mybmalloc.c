@@ -38,8 +38,15 @@
 #undef DEBUG			/* output debug message */
 
 #include <sent/stddefs.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
+#ifdef HAVE_PTHREAD
+static pthread_once_t mybmalloc_once = PTHREAD_ONCE_INIT; ///< To initialize only once among threads
+#else
 static boolean mybmalloc_initialized = FALSE; ///< TRUE if mybmalloc has already initialized
+#endif
 static unsigned int pagesize;		///< Page size for memoly allocation
 static unsigned int blocksize;  ///< Block size in bytes
 static int align;		///< Allocation alignment size in bytes
@@ -69,7 +76,9 @@ mybmalloc_set_param()
   align_mask = ~(align - 1);	/* assume power or 2 */
   //jlog("Stat: mybmalloc: pagesize=%d blocksize=%d align=%d (bytes)\n", (int)pagesize, blocksize, align);
   
+#ifndef HAVE_PTHREAD
   mybmalloc_initialized = TRUE;
+#endif
 }
 
 /** 
@@ -86,7 +95,12 @@ mybmalloc2(unsigned int size, BMALLOC_BASE **list)
   void *allocated;
   BMALLOC_BASE *new;
 
-  if (!mybmalloc_initialized) mybmalloc_set_param();  /* initialize if not yet */
+  /* initialize if not yet */
+#ifdef HAVE_PTHREAD
+  pthread_once(&mybmalloc_once, mybmalloc_set_param);
+#else
+  if (!mybmalloc_initialized) mybmalloc_set_param();
+#endif
   /* malloc segment should be aligned to a word boundary */
   size = (size + align - 1) & align_mask;
   if (*list == NULL || (*list)->now + size >= (*list)->end) {
@@ -37,7 +37,8 @@
 
 /** 
  * Generic function to extract tokens from strings, with quotation handling.
- * The usage is as the same as strtok.
+ * The usage is as the same as strtok.  The current position is held
+ * per thread, so threads can parse strings independently.
  * 
  * @param str [i/o] source string, or NULL when this is a continuous call from previous call.  Will be truncated in this function.
  * @param delim [in] string to specify the delimiters.
@@ -50,8 +51,9 @@
 char *
 mystrtok_quotation(char *str, char *delim, int left_paren, int right_paren, int mode)
 {
-  static char *buf;		/* target string buffer */
-  static char *pos;		/* current pointer position */
+  /* the state is kept per thread */
+  static THREAD_LOCAL char *buf;	/* target string buffer */
+  static THREAD_LOCAL char *pos;	/* current pointer position */
   char *p;
   char *from;
   int c;
@@ -52,6 +52,10 @@ usage(char *s)
   printf("    -d bingramfile  Julius binary N-gram file input\n");
   printf("    -c from to      convert character code\n");
   printf("    -swap           swap \"%s\" and \"%s\"\n", BEGIN_WORD_DEFAULT, END_WORD_DEFAULT);
+  printf("    -mmap           output in v6 format for memory mapping\n");
+  printf("    -quantize       quantize 2-gram and up to 8bit (v7 format)\n");
+  printf("    -pack           pack tuple index in succinct form (v8 format)\n");
+  printf("    -thread num     threads to read ARPA file (0: number of CPUs)\n");
   printf("\n      When both \"-nlr\" and \"-nrl\" are specified, \n");
   printf("      Julius will use the BACKWARD N-gram as main LM\n");
   printf("      and use the forward 2-gram only at the 1st pass\n");
@@ -72,6 +76,10 @@ main(int argc, char *argv[])
   char *from_code, *to_code, *buf;
   boolean charconv_enabled = FALSE;
   boolean force_swap = FALSE;
+  boolean mmap_format = FALSE;
+  boolean quantize = FALSE;
+  boolean pack = FALSE;
+  int thread_num = 0;
   WORD_ID w;
 
   binfile = lrfile = rlfile = outfile = NULL;
@@ -130,6 +138,19 @@ main(int argc, char *argv[])
 	charconv_enabled = TRUE;
       } else if (argv[i][1] == 's') {
 	force_swap = TRUE;
+      } else if (argv[i][1] == 'm') {
+	mmap_format = TRUE;
+      } else if (argv[i][1] == 'q') {
+	quantize = TRUE;
+      } else if (argv[i][1] == 'p') {
+	pack = TRUE;
+      } else if (argv[i][1] == 't') {
+	if (++i >= argc) {
+	  printf("Error: no argument for option \"%s\"\n", argv[i-1]);
+	  usage(argv[0]);
+	  return -1;
+	}
+	thread_num = atoi(argv[i]);
       }
     } else {
       if (outfile == NULL) {
@@ -187,6 +208,7 @@ main(int argc, char *argv[])
   }
 
   ngram = ngram_info_new();
+  ngram->read_thread_num = thread_num;
   if (binfile) {
     /* read in bingram */
     if (init_ngram_bin(ngram, binfile) == FALSE) return -1;
@@ -205,6 +227,21 @@ main(int argc, char *argv[])
     }
   }
 
+  if (quantize) {
+    /* quantize probabilities and back-off weights */
+    if (ngram_quantize(ngram) == FALSE) {
+      fprintf(stderr, "failed to quantize N-gram\n");
+      return -1;
+    }
+  }
+  if (pack) {
+    /* pack tuple index in succinct form */
+    if (ngram_pack_index(ngram) == FALSE) {
+      fprintf(stderr, "failed to pack N-gram index\n");
+      return -1;
+    }
+  }
+
   print_ngram_info(stdout, ngram);
   
   if (charconv_enabled == TRUE) {
@@ -227,10 +264,30 @@ main(int argc, char *argv[])
     fprintf(stderr, "failed to open \"%s\"\n", outfile);
     return -1;
   }
-  printf("\nWriting in v5 format to \"%s\"...\n", outfile);
-  if (ngram_write_bin(fp, ngram, header) == FALSE){/* failed */
-    fprintf(stderr, "failed to write \"%s\"\n",outfile);
-    return -1;
+  if (ngram_is_packed(ngram)) {
+    printf("\nWriting in v8 format to \"%s\"...\n", outfile);
+    if (ngram_write_bin_mmap(fp, ngram, header) == FALSE){/* failed */
+      fprintf(stderr, "failed to write \"%s\"\n",outfile);
+      return -1;
+    }
+  } else if (ngram_is_quantized(ngram)) {
+    printf("\nWriting in v7 format to \"%s\"...\n", outfile);
+    if (ngram_write_bin_mmap(fp, ngram, header) == FALSE){/* failed */
+      fprintf(stderr, "failed to write \"%s\"\n",outfile);
+      return -1;
+    }
+  } else if (mmap_format) {
+    printf("\nWriting in v6 format to \"%s\"...\n", outfile);
+    if (ngram_write_bin_mmap(fp, ngram, header) == FALSE){/* failed */
+      fprintf(stderr, "failed to write \"%s\"\n",outfile);
+      return -1;
+    }
+  } else {
+    printf("\nWriting in v5 format to \"%s\"...\n", outfile);
+    if (ngram_write_bin(fp, ngram, header) == FALSE){/* failed */
+      fprintf(stderr, "failed to write \"%s\"\n",outfile);
+      return -1;
+    }
   }
   fclose_writefile(fp);
 
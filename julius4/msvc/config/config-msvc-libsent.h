@@ -70,6 +70,9 @@
 /* Define if you have sleep function  */
 #undef HAVE_SLEEP
 
+/* Define if you have mmap function  */
+#undef HAVE_MMAP
+
 /* Define if you have iconv function */
 #undef HAVE_ICONV
 
@@ -0,0 +1,305 @@
+/**
+ * @file   mtstress.c
+ *
+ * <JA>
+ * @brief  ǥͭʣ󥹥󥹤Υåǧθ
+ *
+ * j_create_instance_shared() ǥǥͭ󥸥󥤥󥹥󥹤
+ * ʣ줾̥åɤƱϤ򷫤֤ǧ롥
+ * ƥåɤη̤1ĤΥ󥹥󥹤༡ǧ̤Ӥ
+ * ۤʤΤХ顼Ȥ롥libjulius  ThreadSanitizer դ
+ * ӥɤƼ¹ԤС󥹥󥹴֤Υǡ⸡ФǤ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Check of threaded recognition on instances sharing models
+ *
+ * This creates engine instances sharing models by
+ * j_create_instance_shared(), and lets each of them recognize the same
+ * inputs repeatedly in a separate thread.  The results of each thread
+ * are compared with those of serial recognition on one instance, and
+ * any difference is reported as an error.  When libjulius is built with
+ * ThreadSanitizer, data races among instances are also detected.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/juliuslib.h>
+#include <pthread.h>
+
+/**
+ * Recognition results of an instance for the current input.
+ *
+ */
+typedef struct {
+  char *buf;			///< Result string
+  int len;			///< Length of the string
+  int alloced;			///< Allocated size of @a buf
+  int interim;			///< Number of progressive outputs on the 1st pass
+} RESULT_BUF;
+
+/**
+ * Work area of a thread.
+ *
+ */
+typedef struct {
+  int id;			///< Thread number
+  Recog *recog;			///< Engine instance
+  RESULT_BUF res;		///< Results of the current input
+  int done;			///< Number of recognized inputs
+  int mismatch;			///< Number of inputs whose result differs
+  pthread_t thread;		///< Thread
+} WORKER;
+
+static char **fname;		///< Input file names
+static int fnum;		///< Number of input files
+static char **ref;		///< Results of serial recognition
+static int rounds = 3;		///< Number of times to recognize the inputs per thread
+
+/* append a string to the result */
+static void
+res_append(RESULT_BUF *b, char *s)
+{
+  int len;
+
+  len = strlen(s);
+  if (b->len + len + 1 > b->alloced) {
+    b->alloced = b->len + len + 1 + 256;
+    b->buf = (char *)myrealloc(b->buf, b->alloced);
+  }
+  strcpy(&(b->buf[b->len]), s);
+  b->len += len;
+}
+
+/* callback to count progressive outputs */
+static void
+count_interim(Recog *recog, void *data)
+{
+  ((RESULT_BUF *)data)->interim++;
+}
+
+/* callback to store the results */
+static void
+store_result(Recog *recog, void *data)
+{
+  RESULT_BUF *b;
+  RecogProcess *r;
+  Sentence *s;
+  WORD_INFO *winfo;
+  char tmp[256];
+  int i, j;
+
+  b = (RESULT_BUF *)data;
+  for(r=recog->process_list;r;r=r->next) {
+    if (! r->live) continue;
+    snprintf(tmp, 256, "[%s] status=%d interim=%d\n", r->config->name, r->result.status, b->interim);
+    res_append(b, tmp);
+    if (r->result.status < 0) continue;
+    winfo = r->lm->winfo;
+    for(i=0;i<r->result.sentnum;i++) {
+      s = &(r->result.sent[i]);
+      snprintf(tmp, 256, "sentence%d:", i + 1);
+      res_append(b, tmp);
+      for(j=0;j<s->word_num;j++) {
+	res_append(b, " ");
+	res_append(b, winfo->woutput[s->word[j]]);
+      }
+      snprintf(tmp, 256, "\nscore%d: %f\n", i + 1, s->score);
+      res_append(b, tmp);
+    }
+  }
+}
+
+/**
+ * Recognize an input file and return the results.
+ *
+ * @param recog [in] engine instance
+ * @param b [i/o] result buffer registered to the callbacks of @a recog
+ * @param file [in] input file name
+ *
+ * @return the result string, which tells an error if the input could
+ * not be recognized.
+ */
+static char *
+recognize(Recog *recog, RESULT_BUF *b, char *file)
+{
+  int ret;
+
+  b->len = 0;
+  b->interim = 0;
+  res_append(b, "");
+  if (j_open_stream(recog, file) != 0) {
+    res_append(b, "error in opening input\n");
+    return(b->buf);
+  }
+  do {
+    ret = j_recognize_stream(recog);
+  } while (ret == 1);
+  if (ret != 0) res_append(b, "error in recognition\n");
+  return(b->buf);
+}
+
+static void
+worker_setup(WORKER *w, int id, Recog *recog)
+{
+  w->id = id;
+  w->recog = recog;
+  memset(&(w->res), 0, sizeof(RESULT_BUF));
+  w->done = w->mismatch = 0;
+  callback_add(recog, CALLBACK_RESULT_PASS1_INTERIM, count_interim, &(w->res));
+  callback_add(recog, CALLBACK_RESULT, store_result, &(w->res));
+}
+
+/* main function of a thread: recognize all inputs for the rounds */
+static void *
+worker_main(void *arg)
+{
+  WORKER *w;
+  char *s;
+  int i, k;
+
+  w = (WORKER *)arg;
+  for(i=0;i<rounds * fnum;i++) {
+    /* start at a different input on each thread */
+    k = (i + w->id) % fnum;
+    s = recognize(w->recog, &(w->res), fname[k]);
+    if (strcmp(s, ref[k]) != 0) {
+      fprintf(stderr, "thread %d: result of %s differs from serial run\n", w->id, fname[k]);
+      fprintf(stderr, "%s", s);
+      w->mismatch++;
+    }
+    w->done++;
+  }
+  return NULL;
+}
+
+static boolean
+read_list(char *listfile)
+{
+  FILE *fp;
+  char buf[MAXPATHLEN];
+  int maxnum;
+
+  if ((fp = fopen(listfile, "r")) == NULL) {
+    fprintf(stderr, "cannot open inputlist \"%s\"\n", listfile);
+    return FALSE;
+  }
+  fnum = 0;
+  maxnum = 100;
+  fname = (char **)mymalloc(sizeof(char *) * maxnum);
+  while (getl_fp(buf, MAXPATHLEN, fp) != NULL) {
+    if (buf[0] == '\0' || buf[0] == '#') continue;
+    if (fnum >= maxnum) {
+      maxnum *= 2;
+      fname = (char **)myrealloc(fname, sizeof(char *) * maxnum);
+    }
+    fname[fnum++] = strcpy((char *)mymalloc(strlen(buf) + 1), buf);
+  }
+  fclose(fp);
+  if (fnum == 0) {
+    fprintf(stderr, "no input in \"%s\"\n", listfile);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void
+usage(char *s)
+{
+  fprintf(stderr, "usage: %s [-threads N] [-rounds N] Julius options...\n", s);
+  fprintf(stderr, "  -threads N    number of threads (4)\n");
+  fprintf(stderr, "  -rounds N     times to recognize the inputs per thread (3)\n");
+  fprintf(stderr, "Julius options should have \"-input rawfile\" or \"-input mfcfile\" and \"-filelist\"\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  Jconf *jconf;
+  Recog *base;
+  WORKER serial, *w;
+  int threadnum = 4;
+  int i, argstart, mismatch, done;
+  char *s;
+
+  for(argstart=1;argstart<argc;argstart++) {
+    if (strmatch(argv[argstart], "-threads") && argstart + 1 < argc) {
+      threadnum = atoi(argv[++argstart]);
+    } else if (strmatch(argv[argstart], "-rounds") && argstart + 1 < argc) {
+      rounds = atoi(argv[++argstart]);
+    } else {
+      break;
+    }
+  }
+  if (argstart >= argc || threadnum < 1 || rounds < 1) usage(argv[0]);
+  /* pass the rest to Julius, keeping argv[0] */
+  argv[argstart - 1] = argv[0];
+  if ((jconf = j_config_load_args_new(argc - argstart + 1, &(argv[argstart - 1]))) == NULL) return 1;
+  if ((jconf->input.speech_input != SP_RAWFILE && jconf->input.speech_input != SP_MFCFILE)
+      || jconf->input.inputlist_filename == NULL) {
+    usage(argv[0]);
+  }
+  if (read_list(jconf->input.inputlist_filename) == FALSE) return 1;
+
+  /* base instance for serial run */
+  if ((base = j_create_instance_from_jconf(jconf)) == NULL) return 1;
+  worker_setup(&serial, 0, base);
+  if (j_adin_init(base) == FALSE) return 1;
+  /* instances sharing models with the base */
+  w = (WORKER *)mymalloc(sizeof(WORKER) * threadnum);
+  for(i=0;i<threadnum;i++) {
+    if ((w[i].recog = j_create_instance_shared(base)) == NULL) return 1;
+    worker_setup(&(w[i]), i, w[i].recog);
+    if (j_adin_init(w[i].recog) == FALSE) return 1;
+  }
+  /* the log is not needed from here */
+  jlog_set_output(NULL);
+
+  /* serial run on the base instance */
+  ref = (char **)mymalloc(sizeof(char *) * fnum);
+  for(i=0;i<fnum;i++) {
+    s = recognize(base, &(serial.res), fname[i]);
+    ref[i] = strcpy((char *)mymalloc(strlen(s) + 1), s);
+  }
+
+  /* parallel run */
+  for(i=0;i<threadnum;i++) {
+    if (pthread_create(&(w[i].thread), NULL, worker_main, &(w[i])) != 0) {
+      perror("pthread_create");
+      return 1;
+    }
+  }
+  mismatch = done = 0;
+  for(i=0;i<threadnum;i++) {
+    pthread_join(w[i].thread, NULL);
+    mismatch += w[i].mismatch;
+    done += w[i].done;
+  }
+
+  printf("%d threads x %d inputs x %d rounds: %d recognized, %d differ from serial run\n", threadnum, fnum, rounds, done, mismatch);
+
+  for(i=0;i<threadnum;i++) {
+    j_recog_free(w[i].recog);
+    if (w[i].res.buf) free(w[i].res.buf);
+  }
+  free(w);
+  j_recog_free(base);
+  if (serial.res.buf) free(serial.res.buf);
+  for(i=0;i<fnum;i++) {
+    free(ref[i]);
+    free(fname[i]);
+  }
+  free(ref);
+  free(fname);
+
+  return(mismatch > 0 ? 1 : 0);
+}
@@ -0,0 +1,394 @@
+/**
+ * @file   ngrambench.c
+ *
+ * <JA>
+ * @brief  N-gram ȥȥ졼εϿȺˤ٥ޡ
+ *
+ * Ͽ⡼ɤǤϡ桼쥹ؿ (-userlm) ѤƼºݤ
+ * ǧ˹Ԥ N-gram  (1ѥ2-gram2ѥ N-gram) 
+ * ȥ졼ե˽񤭽Ф⡼ɤǤϡƱǥɤ߹ߡ
+ * ȥ졼λȤ򷫤֤1Ȥλ֤¬롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Benchmark by recording and replaying N-gram lookup traces
+ *
+ * The record mode runs recognition with user-defined LM functions
+ * (-userlm) and writes the N-gram lookups actually made by the decoder
+ * (2-gram on the 1st pass, N-gram on the 2nd pass) to a trace file.
+ * The replay mode loads the same LM and repeats the lookups in the trace
+ * to measure the time per lookup.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/juliuslib.h>
+#include <sys/time.h>
+
+/* trace file format, one lookup per line:
+     b w1 w2          ngram->bigram_prob(ngram, w1, w2) on the 1st pass
+     p n w1 ... wn    ngram_prob(ngram, n, w) on the 2nd pass
+   word IDs are N-gram entry IDs of the LM */
+
+#define MAXN 10			///< Maximum N of N-gram to handle
+#define DIR_BIN -1		///< Direction value for binary N-gram, apart from DIR_LR and DIR_RL
+
+static FILE *tfp;		///< Trace output
+static NGRAM_INFO *tngram;	///< N-gram being traced
+static int tnum;		///< Number of recorded lookups
+
+/* current time in sec */
+static double
+now()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+/**********************************************************************/
+/* record */
+
+static void
+put_ngram(int n, WORD_ID *w)
+{
+  int i;
+
+  fprintf(tfp, "p %d", n);
+  for(i=0;i<n;i++) fprintf(tfp, " %d", w[i]);
+  fprintf(tfp, "\n");
+  tnum++;
+}
+
+static LOGPROB
+rec_uni(WORD_INFO *winfo, WORD_ID w, LOGPROB prob)
+{
+  return(prob);
+}
+
+static LOGPROB
+rec_bi(WORD_INFO *winfo, WORD_ID context, WORD_ID w, LOGPROB prob)
+{
+  fprintf(tfp, "b %d %d\n", winfo->wton[context], winfo->wton[w]);
+  tnum++;
+  return(prob);
+}
+
+/**
+ * Record the lookups of a word on the 2nd pass.  The N-gram context is
+ * built from the word history as set_word_context() does, and the
+ * lookups are written as ngram_prob() or ngram_forw2back() issues them.
+ *
+ * @param winfo [in] word dictionary
+ * @param contexts [in] word history, the last word comes last
+ * @param clen [in] length of @a contexts
+ * @param w [in] word to be expanded
+ * @param prob [in] N-gram probability computed by the decoder
+ *
+ * @return @a prob as is.
+ */
+static LOGPROB
+rec_lm(WORD_INFO *winfo, WORD_ID *contexts, int clen, WORD_ID w, LOGPROB prob)
+{
+  WORD_ID cw[MAXN];
+  WORD_ID arr[MAXN];
+  int i, cnnum, wlen;
+
+  cnnum = 0;
+  for(i=clen-1;i>=0;i--) {
+    if (! winfo->is_transparent[contexts[i]]) {
+      cw[cnnum++] = winfo->wton[contexts[i]];
+      if (cnnum >= tngram->n - 1) break;
+    }
+  }
+  wlen = cnnum + 1;
+  if (tngram->dir == DIR_RL) {
+    for(i=0;i<cnnum;i++) arr[cnnum-1-i] = cw[i];
+    arr[cnnum] = winfo->wton[w];
+    put_ngram(wlen, arr);
+  } else {
+    arr[0] = winfo->wton[w];
+    for(i=0;i<cnnum;i++) arr[i+1] = cw[i];
+    for(i = 1; i < tngram->n; i++) {
+      if (i >= wlen) break;
+      put_ngram(i, &(arr[1]));
+    }
+    for(i = 0; i < tngram->n; i++) {
+      if (i >= wlen) break;
+      put_ngram(i+1, arr);
+    }
+  }
+  return(prob);
+}
+
+/**
+ * Run recognition on the given options and record the lookups.
+ *
+ * @param tracefile [in] trace file to write
+ * @param argc [in] number of Julius options
+ * @param argv [in] Julius options, with the command name at argv[0]
+ *
+ * @return 0 on success, 1 on error.
+ */
+static int
+record(char *tracefile, int argc, char *argv[])
+{
+  Jconf *jconf;
+  Recog *recog;
+  PROCESS_LM *lm;
+  int ret;
+
+  if ((jconf = j_config_load_args_new(argc, argv)) == NULL) return 1;
+  if (j_jconf_finalize(jconf) == FALSE) return 1;
+  recog = j_recog_new();
+  recog->jconf = jconf;
+  if (j_load_all(recog, jconf) == FALSE) return 1;
+  for(lm=recog->lmlist;lm;lm=lm->next) {
+    if (lm->lmvar != LM_NGRAM_USER || lm->ngram == NULL) continue;
+    if (tngram != NULL) {
+      fprintf(stderr, "only one N-gram can be traced\n");
+      return 1;
+    }
+    tngram = lm->ngram;
+    if (tngram->n > MAXN) {
+      fprintf(stderr, "N-gram of N > %d is not supported\n", MAXN);
+      return 1;
+    }
+    j_regist_user_lm_func(lm, rec_uni, rec_bi, rec_lm);
+  }
+  if (tngram == NULL) {
+    fprintf(stderr, "no N-gram to trace, specify -userlm with N-gram\n");
+    return 1;
+  }
+  if (j_final_fusion(recog) == FALSE) return 1;
+  if (j_adin_init(recog) == FALSE) return 1;
+
+  if ((tfp = fopen(tracefile, "w")) == NULL) {
+    perror(tracefile);
+    return 1;
+  }
+  while (1) {
+    ret = j_open_stream(recog, NULL);
+    if (ret == -1) continue;
+    if (ret == -2) break;
+    if (j_recognize_stream(recog) == -1) break;
+  }
+  fclose(tfp);
+  fprintf(stderr, "%d lookups recorded to %s\n", tnum, tracefile);
+
+  j_recog_free(recog);
+  return 0;
+}
+
+/**********************************************************************/
+/* replay */
+
+typedef struct {
+  int n;			///< Number of words, 0 for bigram_prob()
+  WORD_ID w[MAXN];		///< Words
+} LOOKUP;
+
+static LOOKUP *look;		///< Lookups read from a trace
+static int looknum;		///< Number of lookups
+
+static boolean
+read_trace(char *tracefile)
+{
+  FILE *fp;
+  char buf[BUFSIZ], *p;
+  int alloced, i;
+  LOOKUP *l;
+
+  if ((fp = fopen(tracefile, "r")) == NULL) {
+    perror(tracefile);
+    return FALSE;
+  }
+  alloced = 0;
+  looknum = 0;
+  while (fgets(buf, BUFSIZ, fp) != NULL) {
+    if (looknum >= alloced) {
+      alloced += 65536;
+      look = (LOOKUP *)myrealloc(look, sizeof(LOOKUP) * alloced);
+    }
+    l = &(look[looknum]);
+    if ((p = strtok(buf, " \n")) == NULL) continue;
+    if (p[0] == 'b') {
+      l->n = 0;
+      for(i=0;i<2;i++) {
+	if ((p = strtok(NULL, " \n")) == NULL) break;
+	l->w[i] = atoi(p);
+      }
+    } else {
+      if ((p = strtok(NULL, " \n")) == NULL) break;
+      l->n = atoi(p);
+      if (l->n < 1 || l->n > MAXN) break;
+      for(i=0;i<l->n;i++) {
+	if ((p = strtok(NULL, " \n")) == NULL) break;
+	l->w[i] = atoi(p);
+      }
+    }
+    if (p == NULL) break;
+    looknum++;
+  }
+  fclose(fp);
+  if (looknum == 0) {
+    fprintf(stderr, "no lookup in %s\n", tracefile);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Replay all the lookups once.
+ *
+ * @param ngram [in] N-gram to look up
+ * @param prob [out] probability of each lookup
+ * @param t [out] time of each kind of lookups in sec, [0] for
+ * bigram_prob() and [1] for ngram_prob()
+ */
+static void
+replay(NGRAM_INFO *ngram, LOGPROB *prob, double *t)
+{
+  LOOKUP *l;
+  int i, k;
+  double t0;
+
+  t[0] = t[1] = 0.0;
+  for(i=0;i<looknum;i=k) {
+    /* time a run of the same kind at once */
+    t0 = now();
+    if (look[i].n == 0) {
+      for(k=i;k<looknum && look[k].n == 0;k++) {
+	l = &(look[k]);
+	prob[k] = (*(ngram->bigram_prob))(ngram, l->w[0], l->w[1]);
+      }
+      t[0] += now() - t0;
+    } else {
+      for(k=i;k<looknum && look[k].n != 0;k++) {
+	l = &(look[k]);
+	prob[k] = ngram_prob(ngram, l->n, l->w);
+      }
+      t[1] += now() - t0;
+    }
+  }
+}
+
+/**
+ * Load an N-gram and replay the trace on it.
+ *
+ * @param file [in] N-gram file
+ * @param dir [in] direction for ARPA file, or DIR_BIN for binary N-gram
+ * @param repeat [in] number of repetition
+ * @param prob [out] probability of each lookup
+ *
+ * @return TRUE on success, FALSE on failure.
+ */
+static boolean
+replay_file(char *file, int dir, int repeat, LOGPROB *prob)
+{
+  NGRAM_INFO *ngram;
+  double t[2], tsum[2];
+  int i, n[2];
+  boolean ret;
+
+  ngram = ngram_info_new();
+  if (dir == DIR_BIN) {
+    ret = init_ngram_bin(ngram, file);
+  } else {
+    ret = init_ngram_arpa(ngram, file, dir);
+  }
+  if (ret == FALSE) {
+    fprintf(stderr, "failed to read %s\n", file);
+    ngram_info_free(ngram);
+    return FALSE;
+  }
+  n[0] = n[1] = 0;
+  for(i=0;i<looknum;i++) {
+    if (look[i].n == 0) n[0]++; else n[1]++;
+  }
+  tsum[0] = tsum[1] = 0.0;
+  for(i=0;i<repeat;i++) {
+    replay(ngram, prob, t);
+    tsum[0] += t[0]; tsum[1] += t[1];
+  }
+  printf("%s:\n", file);
+  if (n[0] > 0) printf("  bigram_prob %8.1f ns\n", tsum[0] * 1.0e9 / ((double)repeat * n[0]));
+  if (n[1] > 0) printf("  ngram_prob  %8.1f ns\n", tsum[1] * 1.0e9 / ((double)repeat * n[1]));
+
+  ngram_info_free(ngram);
+  return TRUE;
+}
+
+static void
+usage(char *s)
+{
+  fprintf(stderr, "usage: %s -record tracefile [Julius options with -userlm]\n", s);
+  fprintf(stderr, "       %s -replay tracefile [-r repeat] {-d bingram | -nlr arpa | -nrl arpa}...\n", s);
+  fprintf(stderr, "  -r repeat     number of repetition (10)\n");
+  fprintf(stderr, "probabilities on the given N-grams are compared with the first one\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *tracefile;
+  int repeat = 10;
+  LOGPROB *p0, *p;
+  int i, dir, filenum;
+
+  if (argc < 3) usage(argv[0]);
+  tracefile = argv[2];
+  if (strmatch(argv[1], "-record")) {
+    /* pass the rest to Julius, keeping argv[0] */
+    argv[2] = argv[0];
+    return(record(tracefile, argc - 2, &(argv[2])));
+  }
+  if (!strmatch(argv[1], "-replay")) usage(argv[0]);
+
+  /* keep logs of N-gram loading out of the result */
+  jlog_set_output(stderr);
+  if (read_trace(tracefile) == FALSE) return 1;
+  p0 = (LOGPROB *)mymalloc(sizeof(LOGPROB) * looknum);
+  p = (LOGPROB *)mymalloc(sizeof(LOGPROB) * looknum);
+  printf("%d lookups in %s\n", looknum, tracefile);
+
+  filenum = 0;
+  for(i=3;i<argc;i++) {
+    if (i + 1 >= argc) usage(argv[0]);
+    if (strmatch(argv[i], "-r")) {
+      repeat = atoi(argv[++i]);
+      if (repeat < 1) usage(argv[0]);
+      continue;
+    }
+    if (strmatch(argv[i], "-d")) dir = DIR_BIN;
+    else if (strmatch(argv[i], "-nlr")) dir = DIR_LR;
+    else if (strmatch(argv[i], "-nrl")) dir = DIR_RL;
+    else usage(argv[0]);
+    i++;
+    if (replay_file(argv[i], dir, repeat, (filenum == 0) ? p0 : p) == FALSE) return 1;
+    if (filenum > 0) {
+      if (memcmp(p0, p, sizeof(LOGPROB) * looknum) == 0) {
+	printf("  probabilities match\n");
+      } else {
+	printf("  probabilities differ\n");
+      }
+    }
+    filenum++;
+  }
+  if (filenum == 0) usage(argv[0]);
+
+  free(p0);
+  free(p);
+  return 0;
+}
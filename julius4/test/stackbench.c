@@ -0,0 +1,181 @@
+/**
+ * @file   stackbench.c
+ *
+ * <JA>
+ * @brief  2ѥβ⥹åΥ٥ޡ
+ *
+ * 2ѥβ⥹å (hypo_stack_*()) ˤĤơꥹ
+ *  min-max ҡפ®٤Ӥ롥åǥǥ󥰤Ʊͤˡ
+ * ಾФƼñ첾Ѥ򷫤֤ξԤǼФ줿
+ * ν礬Ʊβޤưפ뤫ǧ롥
+ * </JA>
+ *
+ * <EN>
+ * @brief  Benchmark of the hypothesis stack on the 2nd pass
+ *
+ * This compares the speed of the 2nd pass hypothesis stack
+ * (hypo_stack_*()) kept as a score-sorted doubly linked list and as a
+ * min-max heap.  Like the stack decoding, it repeats popping the best
+ * hypothesis and pushing its next word hypotheses.  It also checks that
+ * both pop the hypotheses in the same order, including ones with equal
+ * scores.
+ * </EN>
+ *
+ * @author Julius project team
+ *
+ */
+/*
+ * Copyright (c) 1991-2013 Kawahara Lab., Kyoto University
+ * Copyright (c) 2000-2005 Shikano Lab., Nara Institute of Science and Technology
+ * Copyright (c) 2005-2013 Julius project team, Nagoya Institute of Technology
+ * All rights reserved
+ */
+
+#include <julius/juliuslib.h>
+#include <sys/time.h>
+
+static RecogProcess region;	///< Dummy recognition process for free_node()
+static unsigned int seed;	///< Random seed
+
+/* reproducible random number in [0, 1) */
+static double
+rnd()
+{
+  seed = seed * 1103515245 + 12345;
+  return(((seed >> 8) & 0xffffff) / (double)0x1000000);
+}
+
+/* current time in sec */
+static double
+now()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+/* get a node, recycling ones released by free_node() */
+static NODE *
+get_node()
+{
+  NODE *n;
+
+  if ((n = region.pass2.stocker_root) != NULL) {
+    region.pass2.stocker_root = n->next;
+  } else {
+    n = (NODE *)mymalloc(sizeof(NODE));
+  }
+  memset(n, 0, sizeof(NODE));
+  n->region = &region;
+  return(n);
+}
+
+/**
+ * Run the stack decoding pattern on the hypothesis stack.
+ *
+ * @param stacksize [in] stack size
+ * @param heap [in] TRUE to keep the stack as a heap, FALSE as a list
+ * @param popnum [in] number of hypotheses to pop
+ * @param expand [in] number of next hypotheses per pop
+ * @param step [in] round scores to a multiple of this to make ties, or 0
+ * @param popped [out] IDs of popped hypotheses
+ *
+ * @return number of popped hypotheses.
+ */
+static int
+run(int stacksize, boolean heap, int popnum, int expand, double step, int *popped)
+{
+  HYPOSTACK stack;
+  NODE *n, *new;
+  int i, j, id;
+
+  seed = 1;
+  id = 0;
+  hypo_stack_init(&stack, stacksize, heap);
+  n = get_node();
+  n->score = 0.0;
+  n->state = id++;		/* node ID in this benchmark */
+  hypo_stack_put(&stack, n);
+  for(i=0;i<popnum;i++) {
+    if ((n = hypo_stack_pop_best(&stack)) == NULL) break;
+    popped[i] = n->state;
+    for(j=0;j<expand;j++) {
+      new = get_node();
+      new->score = n->score - 1.0 - rnd() * 100.0;
+      if (step > 0.0) new->score = floor(new->score / step) * step;
+      new->state = id++;
+      if (hypo_stack_can_put(&stack, new) == -1) {
+	free_node(new);
+	continue;
+      }
+      hypo_stack_put(&stack, new);
+    }
+    free_node(n);
+  }
+  hypo_stack_free(&stack);
+
+  return(i);
+}
+
+static void
+usage(char *s)
+{
+  fprintf(stderr, "usage: %s [-s stacksize] [-n popnum] [-e expand] [-t step] [-r repeat]\n", s);
+  fprintf(stderr, "  -s stacksize  maximum number of hypotheses in stack (500)\n");
+  fprintf(stderr, "  -n popnum     number of hypotheses to pop (2000)\n");
+  fprintf(stderr, "  -e expand     number of next word hypotheses per pop (200)\n");
+  fprintf(stderr, "  -t step       round scores to multiples of step to make ties (0: off)\n");
+  fprintf(stderr, "  -r repeat     number of repetition (200)\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int stacksize = 500;
+  int popnum = 2000;
+  int expand = 200;
+  int repeat = 200;
+  double step = 0.0;
+  int *p1, *p2;
+  int i, n1, n2;
+  double t, t1, t2;
+
+  for(i=1;i<argc;i++) {
+    if (i + 1 >= argc) usage(argv[0]);
+    if (strmatch(argv[i], "-s")) stacksize = atoi(argv[++i]);
+    else if (strmatch(argv[i], "-n")) popnum = atoi(argv[++i]);
+    else if (strmatch(argv[i], "-e")) expand = atoi(argv[++i]);
+    else if (strmatch(argv[i], "-t")) step = atof(argv[++i]);
+    else if (strmatch(argv[i], "-r")) repeat = atoi(argv[++i]);
+    else usage(argv[0]);
+  }
+  if (stacksize < 2 || popnum < 1 || expand < 0 || step < 0.0 || repeat < 1) usage(argv[0]);
+
+  memset(&region, 0, sizeof(RecogProcess));
+  region.graphout = FALSE;
+  p1 = (int *)mymalloc(sizeof(int) * popnum);
+  p2 = (int *)mymalloc(sizeof(int) * popnum);
+
+  t = now();
+  for(i=0;i<repeat;i++) n1 = run(stacksize, FALSE, popnum, expand, step, p1);
+  t1 = now() - t;
+  t = now();
+  for(i=0;i<repeat;i++) n2 = run(stacksize, TRUE, popnum, expand, step, p2);
+  t2 = now() - t;
+
+  printf("stack size = %d, %d pops x %d pushes, %d times\n", stacksize, popnum, expand, repeat);
+  printf("linked list: %8.1f ns/push\n", t1 * 1.0e9 / ((double)repeat * n1 * expand));
+  printf("min-max heap:%8.1f ns/push\n", t2 * 1.0e9 / ((double)repeat * n2 * expand));
+  printf("(heap is used from stack size %d)\n", HYPOSTACK_HEAP_MIN);
+  if (n1 != n2 || memcmp(p1, p2, sizeof(int) * n1) != 0) {
+    printf("popped hypotheses differ\n");
+    return 1;
+  }
+  printf("popped hypotheses match\n");
+
+  free(p1);
+  free(p2);
+  return 0;
+}